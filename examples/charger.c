@@ -43,6 +43,10 @@ struct connector {
 
 static struct charger {
 	struct connector connectors[CHARGER_MAX_CONNECTOR];
+
+	/* cached and refreshed only when the configurations change. */
+	uint32_t clock_interval;
+	uint32_t sample_interval;
 } charger;
 
 static bool got_plugged_in(fsm_state_t state, fsm_state_t next_state, void *ctx)
@@ -284,18 +288,26 @@ static void do_metering(fsm_state_t state, fsm_state_t next_state, void *ctx)
 {
 	struct connector *connector = (struct connector *)ctx;
 
-	uint32_t clock_interval = 0;
-	uint32_t sample_interval = 0;
-
-	ocpp_get_configuration("ClockAlignedDataInterval",
-			&clock_interval, sizeof(clock_interval), 0);
-	ocpp_get_configuration("MeterValueSampleInterval",
-			&sample_interval, sizeof(sample_interval), 0);
-
 	send_meter_value_periodic(connector->meter.time_clock_periodic_delivered,
-			clock_interval, now);
+			charger.clock_interval, now);
 	send_meter_value_periodic(connector->meter.time_sample_periodic_delivered,
-			sample_interval, now);
+			charger.sample_interval, now);
+}
+
+static void on_configuration_changed(ocpp_configuration_t key, void *ctx)
+{
+	struct charger *p = (struct charger *)ctx;
+
+	switch (key) {
+	case OCPP_CONF_ClockAlignedDataInterval:
+		p->clock_interval = (uint32_t)ocpp_conf_get_int(key);
+		break;
+	case OCPP_CONF_MeterValueSampleInterval:
+		p->sample_interval = (uint32_t)ocpp_conf_get_int(key);
+		break;
+	default:
+		break;
+	}
 }
 
 static const struct fsm_item transitions[] = {
@@ -377,5 +389,10 @@ int charger_init(void)
 				connector);
 	}
 
+	ocpp_subscribe_configuration(OCPP_CONF_ClockAlignedDataInterval,
+			on_configuration_changed, &charger);
+	ocpp_subscribe_configuration(OCPP_CONF_MeterValueSampleInterval,
+			on_configuration_changed, &charger);
+
 	return ocpp_init(on_ocpp_event, &charger);
 }
@@ -17,6 +17,57 @@ extern "C" {
 
 #include "ocpp/type.h"
 
+#if !defined(OCPP_CONFIGURATION_DEFINES)
+#define OCPP_CONFIGURATION_DEFINES	"ocpp_configuration.def.template"
+#endif
+
+#if !defined(OCPP_CONNECTOR_MAX)
+#define OCPP_CONNECTOR_MAX				1
+#endif
+
+/* A key holding a value per connector id, from 0 for the charge point to
+ * `OCPP_CONNECTOR_MAX`. It is a plain key except for the storage.
+ *
+ * Only the `_at` accessors, the visitor and the store reach the connectors
+ * other than 0. `ocpp_set_configuration()`, transactions and the JSON export
+ * and import handle connector 0 only. */
+#if !defined(OCPP_CONFIG_CONNECTOR)
+#define OCPP_CONFIG_CONNECTOR(key, accessibility, type, default_value)	\
+	OCPP_CONFIG(key, accessibility, type, default_value)
+#endif
+
+/* Optional constraints in `OCPP_CONFIGURATION_DEFINES`, which expand to
+ * nothing except where the library builds its tables from them. */
+#if !defined(OCPP_CONFIG_RANGE)
+#define OCPP_CONFIG_RANGE(key, min, max)
+#endif
+#if !defined(OCPP_CONFIG_ALLOWED)
+#define OCPP_CONFIG_ALLOWED(key, members)
+#endif
+#if !defined(OCPP_CONFIG_REBOOT_REQUIRED)
+#define OCPP_CONFIG_REBOOT_REQUIRED(key)
+#endif
+
+#if !defined(OCPP_CONFIGURATION_TRANSACTION_MAX)
+#define OCPP_CONFIGURATION_TRANSACTION_MAX		8
+#endif
+#if !defined(OCPP_CONFIGURATION_TRANSACTION_DATA_MAXLEN)
+#define OCPP_CONFIGURATION_TRANSACTION_DATA_MAXLEN	256
+#endif
+
+/**
+ * @brief Configuration keys generated from `OCPP_CONFIGURATION_DEFINES`.
+ *
+ * @note The application must be built with the same
+ *       `OCPP_CONFIGURATION_DEFINES` as the library.
+ */
+typedef enum {
+#define OCPP_CONFIG(key, accessibility, type, default_value)	OCPP_CONF_##key,
+#include OCPP_CONFIGURATION_DEFINES
+#undef OCPP_CONFIG
+	OCPP_CONF_MAX,
+} ocpp_configuration_t;
+
 typedef enum {
 	OCPP_CONF_TYPE_UNKNOWN,
 	OCPP_CONF_TYPE_INT,
@@ -25,24 +76,160 @@ typedef enum {
 	OCPP_CONF_TYPE_BOOL,
 } ocpp_configuration_data_t;
 
+typedef enum {
+	OCPP_CONF_ACCESS_R	= 1u << 0,
+	OCPP_CONF_ACCESS_W	= 1u << 1,
+	OCPP_CONF_ACCESS_RW	= OCPP_CONF_ACCESS_R | OCPP_CONF_ACCESS_W,
+} ocpp_configuration_access_t;
+
+struct ocpp_configuration_registry_usage {
+	size_t nr_keys;
+	size_t max_keys;
+	size_t arena_used; /**< bytes taken by key strings, values and defaults */
+	size_t arena_size;
+};
+
+typedef void (*ocpp_configuration_observer_t)(ocpp_configuration_t key,
+		void *ctx);
+
+/**
+ * @brief Changes staged to be applied at once.
+ *
+ * @note The application must be built with the same
+ *       `OCPP_CONFIGURATION_TRANSACTION_MAX` and
+ *       `OCPP_CONFIGURATION_TRANSACTION_DATA_MAXLEN` as the library.
+ */
+struct ocpp_configuration_transaction {
+	struct {
+		ocpp_configuration_t key;
+		uint16_t offset;
+		uint8_t size;
+	} entries[OCPP_CONFIGURATION_TRANSACTION_MAX];
+	size_t nr_entries;
+	uint8_t data[OCPP_CONFIGURATION_TRANSACTION_DATA_MAXLEN];
+	size_t datasize;
+	int err; /**< The first staging error. */
+};
+/**
+ * @brief Visitor of `ocpp_visit_configurations()`.
+ *
+ * @param[in] keystr key string
+ * @param[in] value value in place, valid only in the callback. NULL if the
+ *            key is unknown. The values of all the connectors back to back
+ *            for a per-connector key
+ * @param[in] value_size size of the value, or of all the values
+ * @param[in] type data type of the value
+ * @param[in] readonly true if the key is read-only
+ * @param[in] ctx context given to `ocpp_visit_configurations()`
+ *
+ * @return 0 to continue, or anything else to stop
+ */
+typedef int (*ocpp_configuration_visitor_t)(const char *keystr,
+		const void *value, size_t value_size,
+		ocpp_configuration_data_t type, bool readonly, void *ctx);
+
 bool ocpp_has_configuration(const char * const keystr);
+/**
+ * @brief Visit configurations in a single pass, e.g. to answer
+ *        GetConfiguration.
+ *
+ * Each value is handed over in place under a single configuration lock, so
+ * the visitor must not change configurations.
+ *
+ * @param[in] keys keys to visit. All the readable keys if NULL or empty.
+ *            Unknown and write-only ones are visited with a NULL value
+ * @param[in] nr_keys number of keys
+ * @param[in] visitor callback to be called for each key
+ * @param[in] ctx context passed to the visitor
+ *
+ * @return the number of keys visited, up to `GetConfigurationMaxKeys`
+ *         unless it holds its default, in which case the keys registered at
+ *         runtime are counted in as well
+ */
+int ocpp_visit_configurations(const char * const *keys, size_t nr_keys,
+		ocpp_configuration_visitor_t visitor, void *ctx);
+/**
+ * @brief Register a configuration key at runtime, e.g. a vendor-specific one.
+ *
+ * The key is then accessible by the key string and by index like the ones in
+ * `OCPP_CONFIGURATION_DEFINES`, but not by `ocpp_configuration_t`. It is not
+ * persisted either, as it may be registered differently on the next boot.
+ *
+ * @param[in] keystr key string of up to 50 characters
+ * @param[in] type data type of the value
+ * @param[in] size capacity of the value for `OCPP_CONF_TYPE_STR`. Ignored
+ *            for the others
+ * @param[in] access accessibility
+ * @param[in] default_value default value, a null-terminated string for
+ *            `OCPP_CONF_TYPE_STR`. Zero if NULL
+ *
+ * @return 0 on success, -EEXIST if the key is already there, -ENOSPC if
+ *         `OCPP_CONFIGURATION_REGISTRY_MAX` keys are registered or the arena
+ *         of `OCPP_CONFIGURATION_REGISTRY_ARENA_SIZE` is short, or -EINVAL
+ *         for invalid parameters
+ */
+int ocpp_register_configuration(const char * const keystr,
+		ocpp_configuration_data_t type, size_t size,
+		ocpp_configuration_access_t access, const void *default_value);
+/**
+ * @brief Unregister all the keys registered at runtime.
+ *
+ * @note It must not be called while the keys are being accessed.
+ */
+void ocpp_unregister_configurations(void);
+void ocpp_get_configuration_registry_usage(
+		struct ocpp_configuration_registry_usage *usage);
 /**
  * @brief Count the number of configurations.
  *
- * @return the number of configurations.
+ * @return the number of configurations including the ones registered at
+ *         runtime.
  */
 size_t ocpp_count_configurations(void);
 /**
  * @brief Compute the total configuration size.
  *
+ * @note It excludes the keys registered at runtime, which
+ *       `ocpp_copy_configuration_from()` and `ocpp_copy_configuration_to()`
+ *       do not copy either.
+ * @note The copy is the raw layout of OCPP_CONFIGURATION_DEFINES, which
+ *       changes with any key added, removed or made per connector. Nothing
+ *       in it tells the layout apart, so a copy is to be loaded only with
+ *       the definitions it was made with.
+ *
  * @return the total configuration size.
  */
 size_t ocpp_compute_configuration_size(void);
 int ocpp_copy_configuration_from(const void *data, size_t datasize);
 int ocpp_copy_configuration_to(void *buf, size_t bufsize);
 void ocpp_reset_configuration(void);
+/**
+ * @brief Set the configuration for the key string.
+ *
+ * @param[in] keystr key string
+ * @param[in] value value to set
+ * @param[in] value_size size of the value
+ *
+ * @return 0 for success, -EINVAL if the key is unknown or the value is too
+ *         big, -EPERM if the key is read-only, or -ERANGE if the value is out
+ *         of the constraints.
+ */
 int ocpp_set_configuration(const char * const keystr,
 		const void *value, size_t value_size);
+/**
+ * @brief Change a configuration as requested by ChangeConfiguration.req.
+ *
+ * @param[in] keystr key string
+ * @param[in] value value to set
+ * @param[in] value_size size of the value
+ *
+ * @return the status to respond with. NotSupported for an unknown key,
+ *         Rejected for a read-only key or a value out of the constraints,
+ *         RebootRequired if the key requires a reboot to take effect, or
+ *         Accepted.
+ */
+ocpp_config_status_t ocpp_change_configuration(const char * const keystr,
+		const void *value, size_t value_size);
 /**
  * @brief Get the configuration for the key string.
  *
@@ -57,6 +244,65 @@ int ocpp_get_configuration(const char * const keystr,
 		void *buf, size_t bufsize, bool *readonly);
 int ocpp_get_configuration_by_index(int index,
 		void *buf, size_t bufsize, bool *readonly);
+/**
+ * @brief Get the generation of the configurations.
+ *
+ * The generation changes whenever any configuration changes. Values derived
+ * from configurations can be cached until it changes.
+ *
+ * @note Reading configurations never takes `ocpp_configuration_lock()`
+ *       unless it races a write.
+ *
+ * @return the current generation.
+ */
+uint32_t ocpp_get_configuration_generation(void);
+/**
+ * @brief Subscribe to changes of a configuration.
+ *
+ * @param[in] key configuration key. `OCPP_CONF_MAX` for any key
+ * @param[in] cb callback to be called with the key changed
+ * @param[in] cb_ctx context passed to the callback
+ *
+ * @note The callback is called outside of `ocpp_configuration_lock()` in the
+ *       context of the writer, only when the value actually changes.
+ * @note Up to `OCPP_CONFIGURATION_OBSERVER_MAX` observers can subscribe.
+ *
+ * @return 0 for success, -ENOSPC if no room left.
+ */
+int ocpp_subscribe_configuration(ocpp_configuration_t key,
+		ocpp_configuration_observer_t cb, void *cb_ctx);
+int ocpp_unsubscribe_configuration(ocpp_configuration_t key,
+		ocpp_configuration_observer_t cb, void *cb_ctx);
+/**
+ * @brief Check if a configuration has changed since its dirty flag was
+ *        cleared.
+ *
+ * @note Every key gets dirty on `ocpp_reset_configuration()` and clean on
+ *       `ocpp_copy_configuration_from()`.
+ *
+ * @param[in] key configuration key
+ *
+ * @return true if dirty.
+ */
+bool ocpp_is_configuration_dirty(ocpp_configuration_t key);
+void ocpp_clear_configuration_dirty(ocpp_configuration_t key);
+/**
+ * @brief Get the next dirty configuration.
+ *
+ * @param[in] from key to start searching from, inclusive
+ *
+ * @return the first dirty key from `from`. `OCPP_CONF_MAX` if none.
+ */
+ocpp_configuration_t ocpp_get_next_dirty_configuration(
+		ocpp_configuration_t from);
+/**
+ * @brief Tell if a configuration holds its default value.
+ *
+ * @param[in] key configuration key
+ *
+ * @return true if the value is the default one, otherwise false
+ */
+bool ocpp_is_configuration_default(ocpp_configuration_t key);
 bool ocpp_is_configuration_writable(const char * const keystr);
 bool ocpp_is_configuration_readable(const char * const keystr);
 size_t ocpp_get_configuration_size(const char * const keystr);
@@ -64,6 +310,164 @@ ocpp_configuration_data_t ocpp_get_configuration_data_type(
 		const char * const keystr);
 const char *ocpp_get_configuration_keystr_from_index(int index);
 
+/**
+ * @brief Get the key of the key string.
+ *
+ * @param[in] keystr key string
+ *
+ * @return the key. `OCPP_CONF_MAX` if no matching found.
+ */
+ocpp_configuration_t ocpp_conf_from_keystr(const char * const keystr);
+
+/**
+ * @brief Begin a transaction to change several configurations at once.
+ *
+ * @param[out] tx transaction to initialize
+ */
+void ocpp_begin_configuration_transaction(
+		struct ocpp_configuration_transaction *tx);
+/**
+ * @brief Stage a change as `ocpp_set_configuration()` would make.
+ *
+ * A failure is also kept in the transaction to fail the commit.
+ *
+ * @param[in,out] tx transaction
+ * @param[in] keystr key string
+ * @param[in] value value to set
+ * @param[in] value_size size of the value
+ *
+ * @return 0 on success, -EINVAL if the key is unknown or the value is too
+ *         big, -EPERM if the key is not writable, -ENOSPC if the transaction
+ *         is full, or -ERANGE if the value is out of the constraints.
+ */
+int ocpp_stage_configuration(struct ocpp_configuration_transaction *tx,
+		const char * const keystr, const void *value, size_t value_size);
+/**
+ * @brief Stage a change regardless of the accessibility, as the typed
+ *        setters do.
+ *
+ * @return the same as `ocpp_stage_configuration()`
+ */
+int ocpp_conf_stage(struct ocpp_configuration_transaction *tx,
+		ocpp_configuration_t key, const void *value, size_t value_size);
+/**
+ * @brief Apply the staged changes at once.
+ *
+ * Readers see either none or all of the changes, which bump the generation
+ * once and get saved together in a single record of the store.
+ *
+ * @param[in] tx transaction
+ *
+ * @return 0 on success, or the first staging error, in which case nothing
+ *         is applied.
+ */
+int ocpp_commit_configuration_transaction(
+		struct ocpp_configuration_transaction *tx);
+/**
+ * @brief Get the value of an INT configuration.
+ *
+ * @param[in] key configuration key
+ *
+ * @return the value. 0 if the key is not of INT type.
+ */
+int ocpp_conf_get_int(ocpp_configuration_t key);
+/**
+ * @brief Get the bitmask of a CSL configuration.
+ *
+ * @param[in] key configuration key
+ *
+ * @return the bitmask. 0 if the key is not of CSL type.
+ */
+int ocpp_conf_get_csl(ocpp_configuration_t key);
+/**
+ * @brief Get the value of a BOOL configuration.
+ *
+ * @param[in] key configuration key
+ *
+ * @return the value. false if the key is not of BOOL type.
+ */
+bool ocpp_conf_get_bool(ocpp_configuration_t key);
+/**
+ * @brief Get the value of a STR configuration.
+ *
+ * @param[in] key configuration key
+ * @param[out] buf buffer to be null-terminated
+ * @param[in] bufsize size of buffer
+ *
+ * @return the length of the string copied.
+ */
+size_t ocpp_conf_get_str(ocpp_configuration_t key, char *buf, size_t bufsize);
+/**
+ * @brief Set the value of an INT configuration.
+ *
+ * @param[in] key configuration key
+ * @param[in] value value
+ *
+ * @note Unlike `ocpp_set_configuration()`, the accessibility is not checked
+ *       here as it only applies to the server.
+ *
+ * @return 0 for success, -EINVAL if the key is not of INT type.
+ */
+int ocpp_conf_set_int(ocpp_configuration_t key, int value);
+int ocpp_conf_set_csl(ocpp_configuration_t key, int value);
+int ocpp_conf_set_bool(ocpp_configuration_t key, bool value);
+/**
+ * @brief Set the value of a STR configuration.
+ *
+ * @param[in] key configuration key
+ * @param[in] str null-terminated string
+ *
+ * @return 0 for success, -EINVAL if the key is not of STR type or the string
+ *         is too long.
+ */
+int ocpp_conf_set_str(ocpp_configuration_t key, const char *str);
+
+/**
+ * @brief Count the values a key holds.
+ *
+ * @param[in] keystr key string
+ *
+ * @return `OCPP_CONNECTOR_MAX + 1` for a key defined by
+ *         `OCPP_CONFIG_CONNECTOR`, 1 for the others, or 0 if unknown.
+ */
+size_t ocpp_count_configuration_connectors(const char * const keystr);
+/**
+ * @brief Get the value of a configuration for a connector.
+ *
+ * Same as the ones without `_at` for connector 0. A key not defined per
+ * connector gives its single value for any connector.
+ *
+ * @param[in] key configuration key
+ * @param[in] connector_id 0 to `OCPP_CONNECTOR_MAX`
+ *
+ * @return the value. 0 or false if the key is not of the type or the
+ *         connector is out of range.
+ */
+int ocpp_conf_get_int_at(ocpp_configuration_t key, int connector_id);
+int ocpp_conf_get_csl_at(ocpp_configuration_t key, int connector_id);
+bool ocpp_conf_get_bool_at(ocpp_configuration_t key, int connector_id);
+size_t ocpp_conf_get_str_at(ocpp_configuration_t key, int connector_id,
+		char *buf, size_t bufsize);
+/**
+ * @brief Set the value of a configuration for a connector.
+ *
+ * @param[in] key configuration key
+ * @param[in] connector_id 0 to `OCPP_CONNECTOR_MAX`. Only 0 for a key not
+ *            defined per connector
+ * @param[in] value value
+ *
+ * @return 0 for success, -EINVAL if the key is not of the type or the
+ *         connector is out of range.
+ */
+int ocpp_conf_set_int_at(ocpp_configuration_t key, int connector_id,
+		int value);
+int ocpp_conf_set_csl_at(ocpp_configuration_t key, int connector_id,
+		int value);
+int ocpp_conf_set_bool_at(ocpp_configuration_t key, int connector_id,
+		bool value);
+int ocpp_conf_set_str_at(ocpp_configuration_t key, int connector_id,
+		const char *str);
+
 #if defined(__cplusplus)
 }
 #endif
@@ -0,0 +1,56 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef LIBMCU_OCPP_CONFIGURATION_CSL_H
+#define LIBMCU_OCPP_CONFIGURATION_CSL_H
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+#include "ocpp/core/configuration.h"
+
+/**
+ * @brief Decode a comma-separated list into the bitmask of a CSL key.
+ *
+ * Measurand lists such as `MeterValuesSampledData` decode into
+ * `ocpp_measurand_t` bits and `SupportedFeatureProfiles` into
+ * `ocpp_profile_t` bits. Spaces around the items are ignored.
+ *
+ * @param[in] keystr key string of the CSL configuration
+ * @param[in] csl list, e.g. "Energy.Active.Import.Register,Voltage". Not
+ *            necessarily null-terminated
+ * @param[in] len length of the list
+ * @param[out] mask bitmask decoded
+ *
+ * @return the number of members on success, -ENOTSUP if the key is not a
+ *         list of known members, -EINVAL if an item is unknown or empty, or
+ *         -E2BIG if the members outnumber the `<keystr>MaxLength`
+ *         configuration. A `MaxLength` of 0 means no limit.
+ */
+int ocpp_decode_configuration_csl(const char * const keystr,
+		const char *csl, size_t len, int *mask);
+/**
+ * @brief Encode the bitmask of a CSL key into a comma-separated list.
+ *
+ * @param[in] keystr key string of the CSL configuration
+ * @param[in] mask bitmask to encode. Bits of no member are ignored
+ * @param[out] buf buffer to write the null-terminated list in
+ * @param[in] bufsize size of buffer
+ *
+ * @return the length of the list on success, -ENOTSUP if the key is not a
+ *         list of known members, or -ENOBUFS if the buffer is too small.
+ */
+int ocpp_encode_configuration_csl(const char * const keystr,
+		int mask, char *buf, size_t bufsize);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* LIBMCU_OCPP_CONFIGURATION_CSL_H */
@@ -0,0 +1,97 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef LIBMCU_OCPP_CONFIGURATION_JSON_H
+#define LIBMCU_OCPP_CONFIGURATION_JSON_H
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ocpp/core/configuration.h"
+
+#define OCPP_CONFIGURATION_JSON_KEY_MAXLEN	(50 + 1/*null*/)
+#define OCPP_CONFIGURATION_JSON_VALUE_MAXLEN	(500 + 1/*null*/)
+
+/**
+ * @brief State of an export. Zero-initialize it before the first call.
+ */
+struct ocpp_configuration_json_writer {
+	int index; /**< The key being written. */
+	size_t offset; /**< The number of bytes of the key already written. */
+	int emitted; /**< The number of keys written. */
+	uint32_t generation;
+};
+
+/**
+ * @brief State of an import. Zero-initialize it before the first call.
+ */
+struct ocpp_configuration_json_reader {
+	uint8_t state;
+	uint8_t field;
+	uint8_t escape;
+	uint8_t value_kind;
+	uint16_t unicode;
+	uint16_t len;
+	char name[10];
+	char key[OCPP_CONFIGURATION_JSON_KEY_MAXLEN];
+	char value[OCPP_CONFIGURATION_JSON_VALUE_MAXLEN];
+	bool has_key;
+	bool has_value;
+
+	int applied; /**< The number of keys applied. */
+	int rejected; /**< The number of unknown or invalid keys skipped. */
+};
+
+/**
+ * @brief Export the readable configurations as JSON, chunk by chunk.
+ *
+ * The output is an array of OCPP KeyValue objects, for example
+ * `[{"key":"HeartbeatInterval","readonly":false,"value":"1800"}]`, with the
+ * values stringified as in GetConfiguration.conf. CSL values of measurands
+ * and profiles are the comma-separated names.
+ *
+ * @param[in,out] writer export state
+ * @param[out] buf buffer to write a chunk in. Not null-terminated
+ * @param[in] bufsize size of buffer
+ *
+ * @return the number of bytes written, 0 when done. -ESTALE if the key being
+ *         written in pieces has changed in the middle, in which case the
+ *         export should start over.
+ */
+int ocpp_export_configuration_json(struct ocpp_configuration_json_writer *writer,
+		char *buf, size_t bufsize);
+/**
+ * @brief Import configurations from JSON, chunk by chunk.
+ *
+ * Takes the same format as `ocpp_export_configuration_json()`. INT and CSL
+ * values can be numbers or strings of numbers, CSL values also lists of
+ * names, and BOOL values either booleans or the strings "true" and "false".
+ * The `readonly` fields are ignored.
+ *
+ * @note Values are applied key by key as they are parsed, regardless of the
+ *       accessibility, which only applies to the server. The keys registered
+ *       at runtime are the exception, applied only if writable.
+ *
+ * @param[in,out] reader import state
+ * @param[in] chunk part of the document
+ * @param[in] chunksize size of the chunk
+ *
+ * @return 0 when the document is complete, -EAGAIN when more input is
+ *         expected, or -EBADMSG on malformed input.
+ */
+int ocpp_import_configuration_json(struct ocpp_configuration_json_reader *reader,
+		const void *chunk, size_t chunksize);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* LIBMCU_OCPP_CONFIGURATION_JSON_H */
@@ -0,0 +1,49 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef LIBMCU_OCPP_CONFIGURATION_STORE_H
+#define LIBMCU_OCPP_CONFIGURATION_STORE_H
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include "ocpp/core/configuration.h"
+
+/**
+ * @brief Load the configurations from the storage.
+ *
+ * Resets the configurations to the defaults and replays the records of the
+ * active sector on top of them. A record that fails the CRC check, e.g. torn
+ * by a power loss, and the ones after it are ignored.
+ *
+ * @note Call it once at boot before `ocpp_save_configuration()`.
+ *
+ * @return 0 on success, -ENOENT if nothing has been saved yet or the saved
+ *         one was built from a different `OCPP_CONFIGURATION_DEFINES`, or an
+ *         error from the storage overrides.
+ */
+int ocpp_load_configuration(void);
+/**
+ * @brief Save the changed configurations to the storage.
+ *
+ * Appends the dirty keys as a single record and clears their dirty flags.
+ * When the sector runs out of space, the values differing from the defaults
+ * are written to the other sector as a fresh log, alternating the two
+ * sectors to level the wear.
+ *
+ * @note The configuration lock is held while writing to the storage.
+ *
+ * @return 0 on success, -ENOSPC if the configurations do not fit in a sector,
+ *         or an error from the storage overrides.
+ */
+int ocpp_save_configuration(void);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* LIBMCU_OCPP_CONFIGURATION_STORE_H */
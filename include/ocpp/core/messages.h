@@ -136,6 +136,7 @@ struct ocpp_StartTransaction {
 	char idTag[20+1];
 	uint64_t meterStart;
 	int reservationId;
+	bool has_reservationId; /* reservationId given even if 0 */
 	time_t timestamp;
 };
 
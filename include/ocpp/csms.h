@@ -0,0 +1,279 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef LIBMCU_OCPP_CSMS_H
+#define LIBMCU_OCPP_CSMS_H
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "ocpp/ocpp.h"
+#include "ocpp/websocket.h"
+
+#if !defined(OCPP_CSMS_WORKERS_MAX)
+#define OCPP_CSMS_WORKERS_MAX			8
+#endif
+/* of the CALLs of the server in flight on a connection */
+#if !defined(OCPP_CSMS_PENDING_MAX)
+#define OCPP_CSMS_PENDING_MAX			2
+#endif
+/* of the frame of a CALL, kept to be sent again on timeout */
+#if !defined(OCPP_CSMS_FRAME_MAXLEN)
+#define OCPP_CSMS_FRAME_MAXLEN			512
+#endif
+/* of the payload of a message decoded, one buffer a worker */
+#if !defined(OCPP_CSMS_PAYLOAD_MAXLEN)
+#define OCPP_CSMS_PAYLOAD_MAXLEN		4096
+#endif
+#if !defined(OCPP_CSMS_TX_TIMEOUT_SEC)
+#define OCPP_CSMS_TX_TIMEOUT_SEC		OCPP_DEFAULT_TX_TIMEOUT_SEC
+#endif
+/* of the attempts of a CALL, the first included */
+#if !defined(OCPP_CSMS_TX_RETRIES)
+#define OCPP_CSMS_TX_RETRIES			1
+#endif
+/* seconds the timer wheel spans in a round, a power of two */
+#if !defined(OCPP_CSMS_WHEEL_SLOTS)
+#define OCPP_CSMS_WHEEL_SLOTS			64
+#endif
+/* the longest a worker waits for events before turning the wheel */
+#if !defined(OCPP_CSMS_TICK_MS)
+#define OCPP_CSMS_TICK_MS			1000
+#endif
+#if !defined(OCPP_CSMS_IDENTITY_MAXLEN)
+#define OCPP_CSMS_IDENTITY_MAXLEN		(48 + 1/*null*/)
+#endif
+
+typedef enum {
+	OCPP_CSMS_EVENT_CONNECTED, /* the opening handshake is done */
+	OCPP_CSMS_EVENT_DISCONNECTED,
+	OCPP_CSMS_EVENT_REQUEST, /* a CALL of the station */
+	OCPP_CSMS_EVENT_RESPONSE, /* the answer to a CALL of the server */
+	OCPP_CSMS_EVENT_TIMEOUT, /* a CALL of the server unanswered */
+} ocpp_csms_event_t;
+
+struct ocpp_csms;
+struct ocpp_csms_conn;
+
+/**
+ * @brief Get notified of a connection.
+ *
+ * Called from the worker of the connection, with no lock held, so that it
+ * can send on any connection.
+ *
+ * @param[in] conn connection
+ * @param[in] event what happened
+ * @param[in] msg the message received for @ref OCPP_CSMS_EVENT_REQUEST and
+ *            @ref OCPP_CSMS_EVENT_RESPONSE, of which the payload is valid
+ *            only in the callback. The CALL given up for
+ *            @ref OCPP_CSMS_EVENT_TIMEOUT, without the payload. NULL
+ *            otherwise
+ * @param[in] ctx context given to `ocpp_csms_init()`
+ */
+typedef void (*ocpp_csms_event_callback_t)(struct ocpp_csms_conn *conn,
+		ocpp_csms_event_t event, const struct ocpp_message *msg,
+		void *ctx);
+
+/* A CALL of the server in flight, linked in a slot of the timer wheel. */
+struct ocpp_csms_call {
+	struct ocpp_csms_call *next;
+	struct ocpp_csms_call *prev;
+	struct ocpp_csms_conn *conn;
+	time_t deadline;
+	char id[OCPP_MESSAGE_ID_MAXLEN];
+	ocpp_message_t type;
+	uint8_t attempts;
+	bool used;
+	uint16_t len;
+	char frame[OCPP_CSMS_FRAME_MAXLEN];
+};
+
+struct ocpp_csms_conn {
+	struct ocpp_websocket ws;
+	struct ocpp_csms *csms;
+	struct ocpp_csms_conn *next_free;
+	char identity[OCPP_CSMS_IDENTITY_MAXLEN];
+	uint32_t seq; /* of the message ids */
+	uint32_t events; /* of epoll */
+	uint8_t worker;
+	bool used;
+	bool open; /* since the event of connected */
+	struct ocpp_csms_call calls[OCPP_CSMS_PENDING_MAX];
+};
+
+struct ocpp_csms_worker {
+	struct ocpp_csms *csms;
+	pthread_t thread;
+	pthread_mutex_t lock; /* of its connections and the wheel */
+	int epfd;
+	int wakefd;
+	time_t tick; /* the second the wheel is turned to */
+	struct ocpp_csms_call *wheel[OCPP_CSMS_WHEEL_SLOTS];
+	union {
+		uint8_t raw[OCPP_CSMS_PAYLOAD_MAXLEN];
+		uint64_t align;
+	} payload;
+};
+
+/**
+ * @brief The central system side of OCPP-J, serving many stations over
+ *        `src/websocket.c`.
+ *
+ * The engine of `ocpp/ocpp.h` plays the charge point, so this is a server
+ * of its own but of the same message structs and codecs. Connections are
+ * spread over worker threads, each running an epoll loop of its own. A
+ * worker owns the connections it accepts and a timer wheel of a second a
+ * slot, on which the CALLs of the server in flight on its connections time
+ * out and are sent again, so no timer is kept per connection and nothing
+ * is shared between workers but the pool of connections.
+ *
+ * The structs are meant to be allocated by the application and not to be
+ * touched but through the functions.
+ */
+struct ocpp_csms {
+	int listener;
+	uint16_t port;
+	volatile bool running;
+	uint8_t nr_workers;
+
+	ocpp_csms_event_callback_t cb;
+	void *cb_ctx;
+
+	pthread_mutex_t pool_lock;
+	struct ocpp_csms_conn *pool;
+	struct ocpp_csms_conn *free;
+	size_t nr_conns;
+	size_t nr_open;
+
+	struct ocpp_csms_worker workers[OCPP_CSMS_WORKERS_MAX];
+};
+
+/**
+ * @brief Initialize a server.
+ *
+ * @param[out] csms server
+ * @param[in] conns pool of connections, as many as the stations to serve
+ *            at a time
+ * @param[in] nr_conns number of @p conns
+ * @param[in] cb callback of the events
+ * @param[in] cb_ctx context passed to @p cb
+ *
+ * @return 0 on success. -EINVAL on invalid arguments
+ */
+int ocpp_csms_init(struct ocpp_csms *csms, struct ocpp_csms_conn *conns,
+		size_t nr_conns, ocpp_csms_event_callback_t cb, void *cb_ctx);
+/**
+ * @brief Listen on a TCP port of all the addresses.
+ *
+ * @param[in] csms server
+ * @param[in] port port to listen on. 0 for any, of `ocpp_csms_port()`
+ *
+ * @return 0 on success. Otherwise the error of the socket
+ */
+int ocpp_csms_listen(struct ocpp_csms *csms, uint16_t port);
+uint16_t ocpp_csms_port(const struct ocpp_csms *csms);
+/**
+ * @brief Start the workers accepting and serving stations.
+ *
+ * The stations beyond the pool are closed as soon as accepted.
+ *
+ * @param[in] csms server listening
+ * @param[in] nr_workers number of the worker threads, up to
+ *            `OCPP_CSMS_WORKERS_MAX`
+ *
+ * @return 0 on success. -EINVAL on invalid arguments. Otherwise the error
+ *         of epoll or of the threads
+ */
+int ocpp_csms_start(struct ocpp_csms *csms, uint8_t nr_workers);
+/**
+ * @brief Stop the workers and close all the connections and the listener.
+ *
+ * @ref OCPP_CSMS_EVENT_DISCONNECTED is notified of the connections open.
+ *
+ * @param[in] csms server
+ */
+void ocpp_csms_stop(struct ocpp_csms *csms);
+
+/**
+ * @brief Send a CALL to a station, to be answered by
+ *        @ref OCPP_CSMS_EVENT_RESPONSE or @ref OCPP_CSMS_EVENT_TIMEOUT.
+ *
+ * It is sent again with the same id every `OCPP_CSMS_TX_TIMEOUT_SEC` for
+ * `OCPP_CSMS_TX_RETRIES` attempts in total. Can be called from any thread.
+ *
+ * @param[in] conn connection
+ * @param[in] type type of the request
+ * @param[in] data payload
+ * @param[in] datasize size of @p data
+ * @param[out] id id of the CALL. Can be NULL
+ *
+ * @return 0 on success. -ENOTCONN if not open. -EBUSY if
+ *         `OCPP_CSMS_PENDING_MAX` are in flight. -EMSGSIZE if the frame is
+ *         longer than `OCPP_CSMS_FRAME_MAXLEN`. -EAGAIN if the send queue
+ *         is full for now. -EINVAL if the message is invalid
+ */
+int ocpp_csms_send_request(struct ocpp_csms_conn *conn, ocpp_message_t type,
+		const void *data, size_t datasize,
+		char id[OCPP_MESSAGE_ID_MAXLEN]);
+/**
+ * @brief Answer a CALL of a station with a CALLRESULT.
+ *
+ * Can be called from any thread, in the callback or later.
+ *
+ * @param[in] conn connection
+ * @param[in] req the CALL of @ref OCPP_CSMS_EVENT_REQUEST, of which the id
+ *            and type are taken
+ * @param[in] data payload
+ * @param[in] datasize size of @p data
+ *
+ * @return 0 on success. Otherwise the error of `ocpp_websocket_send()`
+ */
+int ocpp_csms_send_response(struct ocpp_csms_conn *conn,
+		const struct ocpp_message *req, const void *data, size_t datasize);
+/**
+ * @brief Answer a CALL of a station with a CALLERROR.
+ *
+ * @return 0 on success. Otherwise the error of `ocpp_websocket_send()`
+ */
+int ocpp_csms_send_error(struct ocpp_csms_conn *conn,
+		const struct ocpp_message *req, ocpp_callerror_t code);
+
+/**
+ * @brief Get the identity of the station, the last segment of the path of
+ *        the opening handshake such as `CP001` of `/ocpp/CP001`.
+ */
+const char *ocpp_csms_identity(const struct ocpp_csms_conn *conn);
+size_t ocpp_csms_count_connections(const struct ocpp_csms *csms);
+/**
+ * @brief Get the type of a CALL of the server in flight on the connection
+ *        being decoded.
+ *
+ * The decoders type a CALLRESULT or CALLERROR by
+ * `ocpp_get_type_from_idstr()`, which asks
+ * `ocpp_get_relayed_type_from_idstr()` of `ocpp/overrides.h` for the id not
+ * pending in the engine. The application of the server is to implement it
+ * with this, and to have the engine initialized by `ocpp_init()` for the
+ * lookup. The ids are of each connection, so only the connection a worker
+ * is decoding is looked up.
+ *
+ * @param[in] idstr id of the message
+ *
+ * @return type of the CALL. `OCPP_MSG_MAX` if none in flight
+ */
+ocpp_message_t ocpp_csms_get_type(const char *idstr);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* LIBMCU_OCPP_CSMS_H */
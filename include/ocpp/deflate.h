@@ -0,0 +1,106 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef LIBMCU_OCPP_DEFLATE_H
+#define LIBMCU_OCPP_DEFLATE_H
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* The largest LZ77 window, of 2^bits bytes, that either side takes. 8 to
+ * 15, where 15 is the 32KiB of DEFLATE as is. */
+#if !defined(OCPP_DEFLATE_WINDOW_BITS)
+#define OCPP_DEFLATE_WINDOW_BITS		10
+#endif
+#if !defined(OCPP_DEFLATE_HASH_BITS)
+#define OCPP_DEFLATE_HASH_BITS			9
+#endif
+/* of the candidates of a match to look at, trading speed for ratio */
+#if !defined(OCPP_DEFLATE_MAX_CHAIN)
+#define OCPP_DEFLATE_MAX_CHAIN			8
+#endif
+
+#define OCPP_DEFLATE_WINDOW_SIZE		(1u << OCPP_DEFLATE_WINDOW_BITS)
+
+/**
+ * @brief Compressor of messages into raw DEFLATE (RFC 1951), message by
+ *        message as permessage-deflate of RFC 7692 does.
+ *
+ * The memory is fixed: the window, and hash chains of 16-bit positions.
+ */
+struct ocpp_deflater {
+	uint32_t pos; /* of the next byte, wrapping around */
+	uint16_t filled; /* bytes of the history in the window */
+	uint8_t bits;
+	bool takeover; /* of the context from a message to the next */
+	uint16_t head[1u << OCPP_DEFLATE_HASH_BITS];
+	uint16_t prev[OCPP_DEFLATE_WINDOW_SIZE];
+	uint8_t window[OCPP_DEFLATE_WINDOW_SIZE]; /* ring of the history */
+};
+
+struct ocpp_inflater {
+	uint32_t pos;
+	uint16_t filled;
+	uint8_t bits;
+	bool takeover;
+	uint8_t window[OCPP_DEFLATE_WINDOW_SIZE];
+};
+
+/**
+ * @brief Initialize a compressor.
+ *
+ * @param[out] z compressor
+ * @param[in] bits window of 2^bits bytes, capped by `OCPP_DEFLATE_WINDOW_BITS`
+ * @param[in] takeover true to refer to the previous messages, false to
+ *            compress each on its own
+ */
+void ocpp_deflate_init(struct ocpp_deflater *z, uint8_t bits, bool takeover);
+/**
+ * @brief Compress a message.
+ *
+ * The blocks end with an empty stored block of which the trailing
+ * `00 00 ff ff` is left out as in RFC 7692.
+ *
+ * @param[in] z compressor
+ * @param[in] src message
+ * @param[in] len length of @p src
+ * @param[out] dst buffer for the compressed data. Not to overlap @p src
+ * @param[in] dstsize size of @p dst
+ *
+ * @return the length of the compressed data. -ENOBUFS if @p dst is too
+ *         small, in which case the context is as before.
+ */
+int ocpp_deflate(struct ocpp_deflater *z, const void *src, size_t len,
+		void *dst, size_t dstsize);
+
+void ocpp_inflate_init(struct ocpp_inflater *z, uint8_t bits, bool takeover);
+/**
+ * @brief Decompress a message of `ocpp_deflate()` or of any DEFLATE
+ *        compressor of no larger window.
+ *
+ * @param[in] z decompressor
+ * @param[in] src compressed data without the trailing `00 00 ff ff`
+ * @param[in] len length of @p src
+ * @param[out] dst buffer for the message
+ * @param[in] dstsize size of @p dst
+ *
+ * @return the length of the message. -EBADMSG if the data is corrupt or
+ *         refers beyond the window. -ENOBUFS if @p dst is too small. The
+ *         context is not to be used again after an error.
+ */
+int ocpp_inflate(struct ocpp_inflater *z, const void *src, size_t len,
+		void *dst, size_t dstsize);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* LIBMCU_OCPP_DEFLATE_H */
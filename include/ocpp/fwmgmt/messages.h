@@ -34,6 +34,7 @@ struct ocpp_GetDiagnostics {
 	char url[256+1];
 	int retries;
 	int retryInterval;
+	bool has_retries; /* retries given even if 0 */
 	time_t startTime;
 	time_t stopTime;
 };
@@ -47,6 +48,7 @@ struct ocpp_UpdateFirmware {
 	int retries;
 	time_t retrieveDate;
 	int retryInterval;
+	bool has_retries; /* retries given even if 0 */
 };
 
 struct ocpp_UpdateFirmware_conf {
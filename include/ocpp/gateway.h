@@ -0,0 +1,267 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef LIBMCU_OCPP_GATEWAY_H
+#define LIBMCU_OCPP_GATEWAY_H
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "ocpp/ocpp.h"
+
+#if !defined(OCPP_GATEWAY_STATIONS_MAX)
+#define OCPP_GATEWAY_STATIONS_MAX		32
+#endif
+#if !defined(OCPP_GATEWAY_UPLINKS_MAX)
+#define OCPP_GATEWAY_UPLINKS_MAX		4
+#endif
+/* of the requests in flight through the gateway, both ways */
+#if !defined(OCPP_GATEWAY_ROUTES_MAX)
+#define OCPP_GATEWAY_ROUTES_MAX			64
+#endif
+#if !defined(OCPP_GATEWAY_ROUTE_TIMEOUT_SEC)
+#define OCPP_GATEWAY_ROUTE_TIMEOUT_SEC		(OCPP_DEFAULT_TX_TIMEOUT_SEC * 3)
+#endif
+/* of the idTags learned from the answers of the central system */
+#if !defined(OCPP_GATEWAY_AUTH_CACHE_LEN)
+#define OCPP_GATEWAY_AUTH_CACHE_LEN		32
+#endif
+/* of the transactions started while the uplink is down */
+#if !defined(OCPP_GATEWAY_OFFLINE_TX_MAX)
+#define OCPP_GATEWAY_OFFLINE_TX_MAX		16
+#endif
+/* The identity prefixes the message ids upstream, as `<identity>#<seq>`,
+ * so is bounded by the length of the ids. */
+#if !defined(OCPP_GATEWAY_IDENTITY_MAXLEN)
+#define OCPP_GATEWAY_IDENTITY_MAXLEN		(20 + 1/*null*/)
+#endif
+
+/**
+ * @brief Pass a message on to a station or to an uplink.
+ *
+ * @param[in] link index of the station or of the uplink
+ * @param[in] msg message to send
+ * @param[in] ctx context given to `ocpp_gateway_init()`
+ *
+ * @return 0 on success. Otherwise the message is taken as not sent.
+ */
+typedef int (*ocpp_gateway_send_t)(int link, const struct ocpp_message *msg,
+		void *ctx);
+
+struct ocpp_gateway_route {
+	char id[OCPP_MESSAGE_ID_MAXLEN]; /* on the uplink */
+	char station_id[OCPP_MESSAGE_ID_MAXLEN]; /* of the CALL of a station */
+	char idTag[OCPP_ID_TOKEN_MAXLEN]; /* to learn from the answer */
+	time_t expiry;
+	ocpp_message_t type;
+	int16_t station;
+	int8_t offline_tx; /* replayed or stopped, -1 if neither */
+	bool upstream; /* a CALL of a station rather than of the uplink */
+	bool used;
+};
+
+struct ocpp_gateway_auth {
+	char idTag[OCPP_ID_TOKEN_MAXLEN];
+	struct ocpp_idTagInfo info;
+	uint32_t stamp; /* of the last use, the least recent replaced */
+};
+
+/* a transaction started with the uplink down, replayed once it is up */
+struct ocpp_gateway_offline_tx {
+	struct ocpp_StartTransaction req;
+	int local_id; /* answered to the station */
+	int remote_id; /* assigned by the central system in the replay */
+	int16_t station;
+	bool replaying; /* the StartTransaction is in flight */
+	bool replayed;
+	bool used;
+};
+
+/**
+ * @brief A local controller relaying many charge points onto a few uplinks
+ *        to the central system.
+ *
+ * The engine of `ocpp/ocpp.h` is of a single charge point, so each station
+ * runs its own downstream, over any link such as a CBOR one of
+ * `ocpp/message_cbor.h`, and the gateway keeps no more than what routes the
+ * messages: the station identities and the requests in flight. Each station
+ * takes the uplink of its index modulo the number of uplinks.
+ *
+ * The CALL of a station goes upstream with the id of `<identity>#<seq>`,
+ * of which the CALLRESULT or CALLERROR finds its way back to the station
+ * with the original id. The central system is to prefix the ids of its
+ * CALLs with the identity of the station as `<identity>:<id>`, by which they
+ * are routed downstream as they are. The delimiters differ so that the ids
+ * of both ways never clash, and the requests in flight are looked up by the
+ * way they went besides.
+ *
+ * While an uplink is down, Authorize and StartTransaction of its stations
+ * are answered by the gateway out of the idTags learned from the central
+ * system. The transactions started are given local ids, negative not to
+ * clash with the ones of the central system, and replayed once the uplink
+ * is up, after which the transaction ids of StopTransaction, MeterValues and
+ * RemoteStopTransaction are translated. The other CALLs are refused for the
+ * engine of the station to retry them.
+ *
+ * The struct is meant to be allocated by the application and not to be
+ * touched but through the functions. The functions are not thread-safe.
+ */
+struct ocpp_gateway {
+	ocpp_gateway_send_t send_upstream;
+	ocpp_gateway_send_t send_downstream;
+	void *ctx;
+
+	uint32_t seq; /* of the ids upstream */
+	uint32_t stamp; /* of the cache use */
+	int offline_tx_id; /* counting down from -1 */
+	uint8_t nr_uplinks;
+	bool allow_unknown; /* idTags while offline, AllowOfflineTxForUnknownId */
+
+	bool uplink_up[OCPP_GATEWAY_UPLINKS_MAX];
+	struct {
+		char identity[OCPP_GATEWAY_IDENTITY_MAXLEN];
+		bool used;
+	} stations[OCPP_GATEWAY_STATIONS_MAX];
+
+	struct ocpp_gateway_route routes[OCPP_GATEWAY_ROUTES_MAX];
+	struct ocpp_gateway_auth auth[OCPP_GATEWAY_AUTH_CACHE_LEN];
+	struct ocpp_gateway_offline_tx offline[OCPP_GATEWAY_OFFLINE_TX_MAX];
+};
+
+/**
+ * @brief Initialize a gateway, with all the uplinks down.
+ *
+ * @param[out] gw gateway
+ * @param[in] nr_uplinks number of the uplinks, up to
+ *            `OCPP_GATEWAY_UPLINKS_MAX`
+ * @param[in] send_upstream to send a message over an uplink
+ * @param[in] send_downstream to send a message to a station
+ * @param[in] ctx context passed to the callbacks
+ *
+ * @return 0 on success. -EINVAL on invalid arguments
+ */
+int ocpp_gateway_init(struct ocpp_gateway *gw, uint8_t nr_uplinks,
+		ocpp_gateway_send_t send_upstream,
+		ocpp_gateway_send_t send_downstream, void *ctx);
+/**
+ * @brief Add a station.
+ *
+ * @param[in] gw gateway
+ * @param[in] identity charge point identity, as known to the central system
+ *
+ * @return the index of the station. -EINVAL if the identity is empty, too
+ *         long or holds a colon or a hash. -EEXIST if added already. -ENOSPC if
+ *         `OCPP_GATEWAY_STATIONS_MAX` are added
+ */
+int ocpp_gateway_add_station(struct ocpp_gateway *gw, const char *identity);
+/**
+ * @brief Remove a station, dropping its requests in flight.
+ *
+ * The transactions of the station not replayed yet are kept.
+ *
+ * @param[in] gw gateway
+ * @param[in] station index of the station
+ *
+ * @return 0 on success. -ENOENT if no such station
+ */
+int ocpp_gateway_remove_station(struct ocpp_gateway *gw, int station);
+/**
+ * @brief Get the uplink of a station.
+ *
+ * @return the index of the uplink. -ENOENT if no such station
+ */
+int ocpp_gateway_get_uplink(const struct ocpp_gateway *gw, int station);
+/**
+ * @brief Tell the gateway an uplink is up or down.
+ *
+ * The requests in flight on an uplink going down are dropped, the stations
+ * to retry them. The transactions started offline are replayed in
+ * `ocpp_gateway_step()`.
+ *
+ * @param[in] gw gateway
+ * @param[in] uplink index of the uplink
+ * @param[in] up true if connected to the central system
+ *
+ * @return 0 on success. -EINVAL if no such uplink
+ */
+int ocpp_gateway_set_uplink(struct ocpp_gateway *gw, int uplink, bool up);
+/**
+ * @brief Let the gateway answer the idTags unknown to it as accepted while
+ *        offline, as `AllowOfflineTxForUnknownId` of a charge point.
+ */
+void ocpp_gateway_allow_offline_unknown(struct ocpp_gateway *gw, bool allow);
+
+/**
+ * @brief Route a message received from a station.
+ *
+ * The message is passed on over the uplink of the station, or answered by
+ * the gateway while the uplink is down. The transaction id of the payload
+ * is translated in place if the transaction is started offline.
+ *
+ * @param[in] gw gateway
+ * @param[in] station index of the station
+ * @param[in] msg message decoded
+ *
+ * @return 0 on success. -ENOENT if no such station or no request is in
+ *         flight for the result or error. -ENOTCONN if the uplink is down
+ *         and the message is not answered locally. -EAGAIN if the
+ *         transaction of the message is not replayed yet. -ENOSPC if too
+ *         many requests are in flight. Otherwise the error of the callback.
+ */
+int ocpp_gateway_from_station(struct ocpp_gateway *gw, int station,
+		struct ocpp_message *msg);
+/**
+ * @brief Route a message received over an uplink.
+ *
+ * @param[in] gw gateway
+ * @param[in] uplink index of the uplink
+ * @param[in] msg message decoded
+ *
+ * @return 0 on success. -ENOENT if the message is for no station known or
+ *         no request is in flight for the result or error. -ENOSPC if too
+ *         many requests are in flight. Otherwise the error of the callback.
+ */
+int ocpp_gateway_from_upstream(struct ocpp_gateway *gw, int uplink,
+		struct ocpp_message *msg);
+/**
+ * @brief Drop the requests timed out and replay the transactions started
+ *        offline over the uplinks up.
+ *
+ * To be called periodically, once a second or so.
+ *
+ * @param[in] gw gateway
+ */
+void ocpp_gateway_step(struct ocpp_gateway *gw);
+/**
+ * @brief Get the type of a request in flight through the gateway.
+ *
+ * The decoders type a CALLRESULT or CALLERROR by
+ * `ocpp_get_type_from_idstr()`, which asks
+ * `ocpp_get_relayed_type_from_idstr()` of `ocpp/overrides.h` for the id not
+ * pending in the engine. The application of the gateway is to implement it
+ * with this, telling which side the message being decoded came from.
+ *
+ * @param[in] gw gateway
+ * @param[in] from_upstream true if the result is received over an uplink,
+ *            false if from a station
+ * @param[in] idstr id of the message
+ *
+ * @return type of the request. `OCPP_MSG_MAX` if none in flight that way
+ */
+ocpp_message_t ocpp_gateway_get_type(const struct ocpp_gateway *gw,
+		bool from_upstream, const char *idstr);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* LIBMCU_OCPP_GATEWAY_H */
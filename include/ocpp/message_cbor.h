@@ -0,0 +1,77 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef LIBMCU_OCPP_MESSAGE_CBOR_H
+#define LIBMCU_OCPP_MESSAGE_CBOR_H
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+#include "ocpp/ocpp.h"
+
+#if !defined(OCPP_MESSAGE_CBOR_MAX_DEPTH)
+#define OCPP_MESSAGE_CBOR_MAX_DEPTH		8
+#endif
+
+/**
+ * @brief Encode a message into a compact CBOR (RFC 8949) frame.
+ *
+ * Meant for links of which both ends are built with this library, such as
+ * the one between charge points and a local controller translating to
+ * OCPP-J upstream. The frame is laid out as OCPP-J, but by numbers in place
+ * of names: a CALL is `[2, id, type, {...}]`, a CALLRESULT `[3, id, {...}]`
+ * and a CALLERROR `[4, id, errorCode, errorDescription]`, where the type is
+ * of `ocpp_message_t` and the error code of `ocpp_callerror_t`.
+ *
+ * A payload is a map keyed by the index of the member in its schema of
+ * `ocpp/message_schema.def`. Enumerations and measurands are integers of
+ * their values, timestamps integers of seconds since the epoch and decimals
+ * integers of tenths. The members left out are the same as of
+ * `ocpp_encode_message_json()`.
+ *
+ * @param[in] msg message to encode
+ * @param[out] buf buffer to write the frame in
+ * @param[in] bufsize size of buffer
+ *
+ * @return the length of the frame on success. -EINVAL if the message type or
+ *         role is invalid or the payload is smaller than its struct.
+ *         -ENOBUFS if the buffer is too small.
+ */
+int ocpp_encode_message_cbor(const struct ocpp_message *msg,
+		void *buf, size_t bufsize);
+
+/**
+ * @brief Decode a CBOR frame of `ocpp_encode_message_cbor()` into a message.
+ *
+ * The same as `ocpp_decode_message_json()` in how the payload is validated
+ * and stored in @p buf. Keys of the members unknown are skipped, so that an
+ * end of a newer schema can talk to an older one.
+ *
+ * @param[in] data frame to decode
+ * @param[in] len length of the frame
+ * @param[out] msg decoded message, of which `payload.fmt.data` points to
+ *             @p buf
+ * @param[out] buf buffer for the payload
+ * @param[in] bufsize size of @p buf
+ * @param[out] error the error code to reply with in a CALLERROR when the
+ *             frame is rejected. Can be NULL
+ *
+ * @return 0 on success. -EBADMSG if the frame is rejected. -ENOBUFS if
+ *         @p buf is too small for the payload. -ENOENT if no request is
+ *         pending for the result or error. -EINVAL on invalid arguments.
+ */
+int ocpp_decode_message_cbor(const void *data, size_t len,
+		struct ocpp_message *msg, void *buf, size_t bufsize,
+		ocpp_callerror_t *error);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* LIBMCU_OCPP_MESSAGE_CBOR_H */
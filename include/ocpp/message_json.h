@@ -0,0 +1,154 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef LIBMCU_OCPP_MESSAGE_JSON_H
+#define LIBMCU_OCPP_MESSAGE_JSON_H
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+#include "ocpp/ocpp.h"
+
+#if !defined(OCPP_MESSAGE_JSON_CHUNK_SIZE)
+#define OCPP_MESSAGE_JSON_CHUNK_SIZE		64
+#endif
+#if !defined(OCPP_MESSAGE_JSON_IOV_MINLEN)
+#define OCPP_MESSAGE_JSON_IOV_MINLEN		128
+#endif
+#if !defined(OCPP_MESSAGE_JSON_MAX_DEPTH)
+#define OCPP_MESSAGE_JSON_MAX_DEPTH		8
+#endif
+
+/**
+ * @brief A segment of an encoded message, laid out as `struct iovec`.
+ */
+struct ocpp_iovec {
+	const void *base;
+	size_t len;
+};
+
+/**
+ * @brief Function to take a chunk of an encoded message.
+ *
+ * @param[in] chunk part of the frame. Not null-terminated
+ * @param[in] chunksize size of the chunk
+ * @param[in] ctx context given to `ocpp_stream_message_json()`
+ *
+ * @return 0 on success. A negative error stops the encoding.
+ */
+typedef int (*ocpp_message_json_writer_t)(const char *chunk, size_t chunksize,
+		void *ctx);
+
+/**
+ * @brief Encode a message into an OCPP-J frame.
+ *
+ * A CALL is written as `[2,"<id>","<Action>",{...}]`, a CALLRESULT as
+ * `[3,"<id>",{...}]` and a CALLERROR as
+ * `[4,"<id>","<errorCode>","<errorDescription>",{}]`. The payload of a
+ * CALLERROR is `struct ocpp_CallError`, taken as GenericError when missing.
+ *
+ * Optional members with no value are left out: empty strings, zero
+ * timestamps, zero ids and counts, and enumerations out of range or set to
+ * their UNKNOWN value. Trailing strings such as `ocpp_DataTransfer.data` and
+ * the sampled values of `ocpp_MeterValue` are bounded by `payload.size`.
+ *
+ * @param[in] msg message to encode
+ * @param[out] buf buffer to write the frame in. Null-terminated
+ * @param[in] bufsize size of buffer
+ *
+ * @return the length of the frame on success. -EINVAL if the message type or
+ *         role is invalid or the payload is smaller than its struct.
+ *         -ENOBUFS if the buffer is too small.
+ */
+int ocpp_encode_message_json(const struct ocpp_message *msg,
+		char *buf, size_t bufsize);
+/**
+ * @brief Encode a message into an OCPP-J frame, chunk by chunk.
+ *
+ * The same as `ocpp_encode_message_json()`, but hands the frame over to
+ * @p writer in chunks of up to `OCPP_MESSAGE_JSON_CHUNK_SIZE` bytes from a
+ * buffer on the stack, so that no frame-sized buffer is needed.
+ *
+ * @param[in] msg message to encode
+ * @param[in] writer function to take the chunks
+ * @param[in] ctx context passed to @p writer
+ *
+ * @return the length of the frame on success. -EINVAL as in
+ *         `ocpp_encode_message_json()`, or the error returned by @p writer.
+ */
+int ocpp_stream_message_json(const struct ocpp_message *msg,
+		ocpp_message_json_writer_t writer, void *ctx);
+/**
+ * @brief Encode a message into segments of an OCPP-J frame.
+ *
+ * The same as `ocpp_encode_message_json()`, but runs of string of
+ * `OCPP_MESSAGE_JSON_IOV_MINLEN` bytes or longer needing no escape, such as
+ * the ones of `ocpp_DataTransfer.data`, `certificateChain` or `csr`, are
+ * referred to in place in the payload rather than copied. The rest goes in
+ * @p buf, between them. The segments in order make up the frame, to be put
+ * on the wire by writev() or a TLS record at a time. When @p iov runs out,
+ * the rest is copied in @p buf.
+ *
+ * @param[in] msg message to encode. To be kept until the segments are sent
+ * @param[out] iov segments of the frame
+ * @param[in] iovcnt number of @p iov
+ * @param[out] buf buffer for the segments not referred in place. Not
+ *             null-terminated
+ * @param[in] bufsize size of buffer
+ * @param[out] len the length of the frame. Can be NULL
+ *
+ * @return the number of the segments on success. -EINVAL as in
+ *         `ocpp_encode_message_json()` or if @p iovcnt is 0. -ENOBUFS if
+ *         @p buf is too small.
+ */
+int ocpp_encode_message_jsonv(const struct ocpp_message *msg,
+		struct ocpp_iovec *iov, size_t iovcnt,
+		char *buf, size_t bufsize, size_t *len);
+
+/**
+ * @brief Decode an OCPP-J frame into a message.
+ *
+ * The payload is parsed straight into its struct in @p buf, validated
+ * against the message definition on the way: required members, types,
+ * enumeration names, timestamps and the bounds of strings. Strings too long
+ * for their arrays are rejected rather than truncated. Unknown members are
+ * skipped. Of the arrays held as a single struct member, such as
+ * `ocpp_GetConfiguration.key`, the first element is kept. Flexible arrays and
+ * trailing strings are stored after the struct, as far as @p buf holds, with
+ * `payload.size` covering them as `ocpp_encode_message_json()` expects.
+ *
+ * The type of a CALLRESULT or CALLERROR is the one of the pending request
+ * of the same id, by `ocpp_get_type_from_idstr()`. The payload of a
+ * CALLERROR is `struct ocpp_CallError`, of which the description is
+ * truncated to fit.
+ *
+ * @param[in] json frame to decode. Need not be null-terminated
+ * @param[in] len length of the frame
+ * @param[out] msg decoded message, of which `payload.fmt.data` points to
+ *             @p buf
+ * @param[out] buf buffer for the payload
+ * @param[in] bufsize size of @p buf
+ * @param[out] error the error code to reply with in a CALLERROR when the
+ *             frame is rejected. Can be NULL
+ *
+ * @return 0 on success. -EBADMSG if the frame is rejected, in which case
+ *         @p msg holds the id, role and type as far as they are parsed.
+ *         -ENOBUFS if @p buf is too small for the payload. -ENOENT if no
+ *         request is pending for the result or error. -EINVAL on invalid
+ *         arguments.
+ */
+int ocpp_decode_message_json(const char *json, size_t len,
+		struct ocpp_message *msg, void *buf, size_t bufsize,
+		ocpp_callerror_t *error);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* LIBMCU_OCPP_MESSAGE_JSON_H */
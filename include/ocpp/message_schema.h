@@ -0,0 +1,165 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef LIBMCU_OCPP_MESSAGE_SCHEMA_H
+#define LIBMCU_OCPP_MESSAGE_SCHEMA_H
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ocpp/ocpp.h"
+
+#define OCPP_FIELD_NONE				UINT16_MAX
+
+typedef enum {
+	OCPP_FIELD_STR,		/* char array */
+	OCPP_FIELD_TRAILING,	/* flexible char array at the end */
+	OCPP_FIELD_STRPTR,	/* pointer to a string after the struct */
+	OCPP_FIELD_INT,
+	OCPP_FIELD_U64,
+	OCPP_FIELD_TENTH,	/* decimal in int of tenths */
+	OCPP_FIELD_BOOL,
+	OCPP_FIELD_TIME,
+	OCPP_FIELD_ENUM,
+	OCPP_FIELD_MEASURAND,
+	OCPP_FIELD_OBJECT,
+	OCPP_FIELD_ARRAY,	/* flexible array of objects at the end */
+} ocpp_field_type_t;
+
+typedef enum {
+	OCPP_FIELD_OPTIONAL		= 0x00,
+	OCPP_FIELD_REQUIRED		= 0x01,
+	/* an array of which the first element is held in the member */
+	OCPP_FIELD_FIRST_OF_ARRAY	= 0x02,
+} ocpp_field_flag_t;
+
+struct ocpp_names {
+	const char * const *names; /* NULL for a value not on the wire */
+	size_t nr_names;
+};
+
+struct ocpp_schema;
+
+/**
+ * @brief Descriptor of a member of a message struct.
+ *
+ * An optional member is left out of a message when it is zero, unless
+ * `has` is given and the bool member there is true, or when `when` is given
+ * and the member there does not hold `when_value`.
+ */
+struct ocpp_field {
+	/* quoted and followed by the colon as on the wire, so the bare name
+	 * is of `namelen` from `name + 1` */
+	const char *name;
+	/* `struct ocpp_names` of an enum or `struct ocpp_schema` of an
+	 * object or an array element */
+	const void *spec;
+	uint16_t offset;
+	uint16_t size; /* 0 for a flexible array */
+	uint16_t count; /* offset of the number of array elements */
+	uint16_t when; /* offset of the member the presence depends on */
+	uint16_t has; /* offset of the bool telling a zero member is given */
+	int8_t when_value;
+	uint8_t namelen;
+	uint8_t type; /* ocpp_field_type_t */
+	uint8_t flags; /* ocpp_field_flag_t */
+};
+
+struct ocpp_schema {
+	const struct ocpp_field *fields; /* up to 32 */
+	uint16_t size; /* of the struct */
+	uint8_t nr_fields;
+};
+
+/**
+ * @brief Get the schema of a message payload.
+ *
+ * The schemas are generated at compile time from `ocpp/message_schema.def`.
+ *
+ * @param[in] type type of the message
+ * @param[in] role @ref OCPP_MSG_ROLE_CALL for the request or
+ *            @ref OCPP_MSG_ROLE_CALLRESULT for the response
+ *
+ * @return the schema, of no fields for a message without members, or NULL
+ *         if the type or the role is invalid
+ */
+const struct ocpp_schema *ocpp_get_message_schema(ocpp_message_t type,
+		ocpp_message_role_t role);
+
+/**
+ * @brief Load an integer member of 1, 2, 4 or 8 bytes, sign-extended.
+ *
+ * @param[in] p member in the struct. Need not be aligned
+ * @param[in] size size of the member
+ *
+ * @return the value, or 0 of any other size
+ */
+int64_t ocpp_load_field_int(const void *p, size_t size);
+void ocpp_store_field_int(void *p, size_t size, int64_t v);
+
+/**
+ * @brief Get a string member, bounded by its array or by the payload.
+ *
+ * @param[in] f field of a string type
+ * @param[in] p member in the struct
+ * @param[in] avail bytes of the payload from @p p
+ * @param[out] len length of the string
+ *
+ * @return the string, not necessarily null-terminated. NULL of a null
+ *         @ref OCPP_FIELD_STRPTR
+ */
+const char *ocpp_get_field_string(const struct ocpp_field *f, const char *p,
+		size_t avail, size_t *len);
+/**
+ * @brief Get the name on the wire of an enum member.
+ *
+ * @return the name, or NULL if out of range or of no name on the wire
+ */
+const char *ocpp_get_field_enum_name(const struct ocpp_field *f, const char *p);
+/**
+ * @brief Get the number of the elements of a flexible array member.
+ *
+ * @param[in] f field of @ref OCPP_FIELD_ARRAY
+ * @param[in] obj the struct holding the member
+ * @param[in] avail bytes of the payload from @p obj
+ *
+ * @return the number of the elements in the payload, capped by the count
+ *         member if any
+ */
+size_t ocpp_count_field_elements(const struct ocpp_field *f, const char *obj,
+		size_t avail);
+/**
+ * @brief Tell if a member is to be put in a message.
+ *
+ * Required members are, unless `when` rules them out. Optional ones are
+ * when not zero or flagged by `has` as described in @ref ocpp_field.
+ *
+ * @param[in] f field of the member
+ * @param[in] obj the struct holding the member
+ * @param[in] avail bytes of the payload from @p obj
+ *
+ * @return true if present
+ */
+bool ocpp_is_field_present(const struct ocpp_field *f, const char *obj,
+		size_t avail);
+/**
+ * @brief Flag a member decoded as given, for the one of `has`.
+ *
+ * @param[in] f field of the member
+ * @param[in,out] obj the struct holding the member
+ */
+void ocpp_set_field_present(const struct ocpp_field *f, char *obj);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* LIBMCU_OCPP_MESSAGE_SCHEMA_H */
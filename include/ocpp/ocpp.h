@@ -75,6 +75,21 @@ int ocpp_push_request(ocpp_message_t type, const void *data, size_t datasize,
 		bool force);
 int ocpp_push_request_defer(ocpp_message_t type,
 		const void *data, size_t datasize, uint32_t timer_sec);
+/**
+ * @brief Push a response to a request received from the server.
+ *
+ * @param[in] req The request being responded to.
+ * @param[in] data Pointer to the response data.
+ * @param[in] datasize The size of the response data.
+ * @param[in] err true for CALLERROR, false for CALLRESULT.
+ *
+ * @note Responses of up to `OCPP_RESPONSE_CACHE_DATA_MAXLEN` bytes are copied
+ *       into a cache of the last `OCPP_RESPONSE_CACHE_LEN` requests. When the
+ *       server retransmits one of those requests, the cached response is sent
+ *       back again and the request never reaches the application.
+ *
+ * @return 0 on success, otherwise an error.
+ */
 int ocpp_push_response(const struct ocpp_message *req,
 		const void *data, size_t datasize, bool err);
 /**
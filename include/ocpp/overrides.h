@@ -13,6 +13,8 @@ extern "C" {
 
 #include <stddef.h>
 
+#include "ocpp/type.h"
+
 struct ocpp_message;
 
 /**
@@ -48,6 +50,18 @@ int ocpp_recv(struct ocpp_message *msg);
  */
 void ocpp_generate_message_id(void *buf, size_t bufsize);
 
+/**
+ * @brief Looks up the type of a request pending outside of the engine.
+ *
+ * Called by `ocpp_get_type_from_idstr()` for the id of no request pending in
+ * the engine, such as of the requests relayed by `ocpp/gateway.h`. The
+ * default returns `OCPP_MSG_MAX`.
+ *
+ * @param[in] idstr The ID string of the CALLRESULT or CALLERROR.
+ * @return The type of the request, or `OCPP_MSG_MAX` if none is pending.
+ */
+ocpp_message_t ocpp_get_relayed_type_from_idstr(const char *idstr);
+
 /**
  * @brief Acquires a lock for OCPP operations.
  *
@@ -68,6 +82,42 @@ int ocpp_unlock(void);
 int ocpp_configuration_lock(void);
 int ocpp_configuration_unlock(void);
 
+/**
+ * @brief Reads from the storage region of the configuration store.
+ *
+ * The region spans two sectors of `OCPP_CONFIGURATION_STORE_SECTOR_SIZE`
+ * and offsets are relative to its start.
+ *
+ * @param[in] offset The offset to read from.
+ * @param[out] buf A pointer to the buffer to read into.
+ * @param[in] bufsize The number of bytes to read.
+ * @return 0 on success, or a negative error code.
+ */
+int ocpp_configuration_storage_read(size_t offset, void *buf, size_t bufsize);
+/**
+ * @brief Programs the storage region of the configuration store.
+ *
+ * Only erased bytes are written and both the offset and the size are
+ * multiples of `OCPP_CONFIGURATION_STORE_ALIGN`.
+ *
+ * @param[in] offset The offset to write at.
+ * @param[in] data A pointer to the data to write.
+ * @param[in] datasize The number of bytes to write.
+ * @return 0 on success, or a negative error code.
+ */
+int ocpp_configuration_storage_write(size_t offset,
+		const void *data, size_t datasize);
+/**
+ * @brief Erases a sector of the storage region of the configuration store.
+ *
+ * Erased bytes read back as 0xff.
+ *
+ * @param[in] offset The offset of the sector.
+ * @param[in] size The size of the sector.
+ * @return 0 on success, or a negative error code.
+ */
+int ocpp_configuration_storage_erase(size_t offset, size_t size);
+
 #if defined(__cplusplus)
 }
 #endif
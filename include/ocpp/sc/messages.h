@@ -30,6 +30,7 @@ struct ocpp_GetCompositeSchedule {
 struct ocpp_GetCompositeSchedule_conf {
 	ocpp_profile_status_t status;
 	int connectorId;
+	bool has_connectorId; /* connectorId given even if 0 */
 	time_t scheduleStart;
 	struct ocpp_ChargingSchedule chargingSchedule;
 };
@@ -98,6 +98,7 @@ struct ocpp_DeleteCertificate_conf {
 struct ocpp_ExtendedTriggerMessage {
 	ocpp_trigger_message_t requestedMessage;
 	int connectorId;
+	bool has_connectorId; /* connectorId given even if 0 */
 };
 
 struct ocpp_ExtendedTriggerMessage_conf {
@@ -124,6 +125,7 @@ struct ocpp_GetLog {
 	int requestId;
 	int retries;
 	int retryInterval;
+	bool has_retries; /* retries given even if 0 */
 	struct ocpp_LogParameters log;
 };
 
@@ -189,6 +191,7 @@ struct ocpp_SignedUpdateFirmware {
 	int retries;
 	int retryInterval;
 	int requestId;
+	bool has_retries; /* retries given even if 0 */
 	struct ocpp_Firmware firmware;
 };
 
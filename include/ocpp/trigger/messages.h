@@ -17,6 +17,7 @@ extern "C" {
 struct ocpp_TriggerMessage {
 	ocpp_trigger_message_t requestedMessage;
 	int connectorId;
+	bool has_connectorId; /* connectorId given even if 0 */
 };
 
 struct ocpp_TriggerMessage_conf {
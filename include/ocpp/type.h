@@ -373,6 +373,25 @@ typedef enum {
 	OCPP_LOG_SECURITY,
 } ocpp_log_t;
 
+typedef enum {
+	OCPP_CALLERROR_NOT_IMPLEMENTED,
+	OCPP_CALLERROR_NOT_SUPPORTED,
+	OCPP_CALLERROR_INTERNAL,
+	OCPP_CALLERROR_PROTOCOL,
+	OCPP_CALLERROR_SECURITY,
+	OCPP_CALLERROR_FORMATION_VIOLATION,
+	OCPP_CALLERROR_PROPERTY_CONSTRAINT_VIOLATION,
+	OCPP_CALLERROR_OCCURRENCE_CONSTRAINT_VIOLATION,
+	OCPP_CALLERROR_TYPE_CONSTRAINT_VIOLATION,
+	OCPP_CALLERROR_GENERIC,
+} ocpp_callerror_t;
+
+/* The payload of a CALLERROR. */
+struct ocpp_CallError {
+	ocpp_callerror_t errorCode;
+	char errorDescription[255+1];
+};
+
 struct ocpp_KeyValue {
 	char key[50+1];
 	bool readonly;
@@ -0,0 +1,316 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef LIBMCU_OCPP_WEBSOCKET_H
+#define LIBMCU_OCPP_WEBSOCKET_H
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "ocpp/ocpp.h"
+
+/* permessage-deflate of RFC 7692, of which the windows are capped by
+ * `OCPP_DEFLATE_WINDOW_BITS` */
+#if !defined(OCPP_WEBSOCKET_DEFLATE)
+#define OCPP_WEBSOCKET_DEFLATE			0
+#endif
+
+#if OCPP_WEBSOCKET_DEFLATE
+#include "ocpp/deflate.h"
+#endif
+
+#if !defined(OCPP_WEBSOCKET_RXBUF_SIZE)
+#define OCPP_WEBSOCKET_RXBUF_SIZE		4096
+#endif
+#if !defined(OCPP_WEBSOCKET_TXBUF_SIZE)
+#define OCPP_WEBSOCKET_TXBUF_SIZE		4096
+#endif
+#if !defined(OCPP_WEBSOCKET_IOV_MAX)
+#define OCPP_WEBSOCKET_IOV_MAX			16
+#endif
+#if !defined(OCPP_WEBSOCKET_HOST_MAXLEN)
+#define OCPP_WEBSOCKET_HOST_MAXLEN		64
+#endif
+#if !defined(OCPP_WEBSOCKET_PATH_MAXLEN)
+#define OCPP_WEBSOCKET_PATH_MAXLEN		128
+#endif
+
+#define OCPP_WEBSOCKET_SUBPROTOCOL		"ocpp1.6"
+
+typedef enum {
+	OCPP_WEBSOCKET_CLOSED,
+	OCPP_WEBSOCKET_CONNECTING, /* TCP connection in progress */
+	OCPP_WEBSOCKET_HANDSHAKING,
+	OCPP_WEBSOCKET_OPEN,
+	OCPP_WEBSOCKET_CLOSING,
+} ocpp_websocket_state_t;
+
+struct ocpp_websocket_deflate_stats {
+	uint32_t messages;
+	uint64_t raw; /* bytes of the messages */
+	uint64_t compressed; /* bytes of the payloads on the wire */
+};
+
+/**
+ * @brief A WebSocket connection of RFC 6455 on a non-blocking socket.
+ *
+ * Nothing blocks but the name resolution of `ocpp_websocket_connect()`. All
+ * the I/O is done in `ocpp_websocket_step()`, to be called when the socket
+ * of `ocpp_websocket_fd()` gets ready in poll(), select() or epoll, or
+ * periodically. The struct is meant to be allocated by the application and
+ * not to be touched but through the functions.
+ */
+struct ocpp_websocket {
+	int fd;
+	ocpp_websocket_state_t state;
+	bool server;
+	uint32_t seed; /* for masking keys */
+
+	char key[24 + 1/*null*/]; /* Sec-WebSocket-Key sent as a client */
+	char host[OCPP_WEBSOCKET_HOST_MAXLEN]; /* with the port */
+	char path[OCPP_WEBSOCKET_PATH_MAXLEN]; /* requested by the client */
+
+	time_t ping_timestamp; /* of the last ping sent */
+	bool pong_pending;
+	/* WebSocketPingInterval, `OCPP_CONF_MAX` if not defined */
+	ocpp_configuration_t ping_interval;
+
+	struct {
+		/* [head, head + len) holds the payload of the message being
+		 * reassembled, [scan, tail) what is not parsed yet */
+		size_t head;
+		size_t len;
+		size_t scan;
+		size_t tail;
+		bool ready; /* a complete message is at head */
+		bool fragmented;
+		uint8_t buf[OCPP_WEBSOCKET_RXBUF_SIZE];
+	} rx;
+
+	struct {
+		size_t head;
+		size_t tail;
+		uint8_t buf[OCPP_WEBSOCKET_TXBUF_SIZE];
+	} tx;
+
+#if OCPP_WEBSOCKET_DEFLATE
+	struct {
+		bool offered; /* by the application for the handshake */
+		bool takeover; /* of the context, as offered */
+		bool negotiated;
+		bool compressed; /* the message received is */
+		size_t len; /* of the message inflated */
+		struct ocpp_deflater tx;
+		struct ocpp_inflater rx;
+		uint8_t buf[OCPP_WEBSOCKET_RXBUF_SIZE]; /* of the message */
+		struct ocpp_websocket_deflate_stats stats[2][OCPP_MSG_MAX];
+	} deflate;
+#endif
+};
+
+/**
+ * @brief Start connecting to a server as a client.
+ *
+ * The opening handshake asks for the `ocpp1.6` subprotocol and is done in
+ * `ocpp_websocket_step()`, after which the state turns into
+ * @ref OCPP_WEBSOCKET_OPEN.
+ *
+ * @param[out] ws connection to initialize
+ * @param[in] host name or address of the server
+ * @param[in] port port of the server
+ * @param[in] path resource to request, usually ending with the charge point
+ *            identity such as `/ocpp/CP001`
+ *
+ * @return 0 on success. -EINVAL on invalid arguments or a too long host or
+ *         path. -EHOSTUNREACH if the host is not resolved. Otherwise the
+ *         error of the socket.
+ */
+int ocpp_websocket_connect(struct ocpp_websocket *ws,
+		const char *host, uint16_t port, const char *path);
+/**
+ * @brief Take a connection accepted from a listening socket as the server.
+ *
+ * The opening handshake of the client is answered in
+ * `ocpp_websocket_step()`, rejecting the client not offering `ocpp1.6`.
+ *
+ * @param[out] ws connection to initialize
+ * @param[in] fd socket returned by accept(). Made non-blocking and owned by
+ *            @p ws from then on
+ *
+ * @return 0 on success. -EINVAL on invalid arguments
+ */
+int ocpp_websocket_accept(struct ocpp_websocket *ws, int fd);
+/**
+ * @brief Drive the connection.
+ *
+ * Finishes the connection and the handshake, flushes queued frames, reads
+ * frames in and answers pings and closes. Frames are read in till a message
+ * is complete, so it is to be called again after `ocpp_websocket_consume()`
+ * as well. When `WebSocketPingInterval` is non-zero, a ping is sent every the
+ * interval and the connection fails with -ETIMEDOUT if the pong is missing by
+ * the next one. No ping is sent if the key is not defined.
+ *
+ * @param[in] ws connection
+ *
+ * @return 0 on success. -ECONNRESET when closed by the peer. -EPROTO on a
+ *         protocol violation or a rejected handshake. -EMSGSIZE if a message
+ *         does not fit in `OCPP_WEBSOCKET_RXBUF_SIZE`. Otherwise the error
+ *         of the socket. The socket is closed on an error.
+ */
+int ocpp_websocket_step(struct ocpp_websocket *ws);
+/**
+ * @brief Start the closing handshake.
+ *
+ * @param[in] ws connection
+ * @param[in] code status code of the close frame, 1000 for a normal closure
+ *
+ * @return 0 on success. -ENOTCONN if not open
+ */
+int ocpp_websocket_close(struct ocpp_websocket *ws, uint16_t code);
+
+/**
+ * @brief Offer or accept permessage-deflate in the opening handshake.
+ *
+ * To be called right after `ocpp_websocket_connect()` or
+ * `ocpp_websocket_accept()`. The windows of both directions are bounded by
+ * `OCPP_DEFLATE_WINDOW_BITS`, the server declining an offer of a client
+ * which does not take the bound. Messages of `ocpp_websocket_send()` are
+ * compressed once negotiated, but for the ones not getting any smaller.
+ *
+ * @param[in] ws connection
+ * @param[in] context_takeover true to keep the window from a message to the
+ *            next, which compresses the repeating messages of OCPP the most.
+ *            false to save the memory of the peer, which then has no window
+ *            to keep
+ *
+ * @return 0 on success. -EALREADY if the handshake is under way.
+ *         -ENOTSUP if not built with `OCPP_WEBSOCKET_DEFLATE`
+ */
+int ocpp_websocket_enable_deflate(struct ocpp_websocket *ws,
+		bool context_takeover);
+/**
+ * @brief Tell if permessage-deflate is negotiated.
+ *
+ * @param[in] ws connection
+ *
+ * @return true if negotiated
+ */
+bool ocpp_websocket_has_deflate(const struct ocpp_websocket *ws);
+/**
+ * @brief Get the bytes of a type of message before and after compression.
+ *
+ * Counted by `ocpp_websocket_send()` and `ocpp_websocket_recv()` once
+ * permessage-deflate is negotiated, the messages left uncompressed as they
+ * are, so that `compressed / raw` is the ratio on the wire.
+ *
+ * @param[in] ws connection
+ * @param[in] type type of message
+ * @param[out] tx stats of the messages sent. Can be NULL
+ * @param[out] rx stats of the messages received. Can be NULL
+ *
+ * @return 0 on success. -EINVAL on invalid arguments. -ENOTSUP if not
+ *         built with `OCPP_WEBSOCKET_DEFLATE`
+ */
+int ocpp_websocket_get_deflate_stats(const struct ocpp_websocket *ws,
+		ocpp_message_t type, struct ocpp_websocket_deflate_stats *tx,
+		struct ocpp_websocket_deflate_stats *rx);
+
+ocpp_websocket_state_t ocpp_websocket_state(const struct ocpp_websocket *ws);
+/**
+ * @brief Get the socket to wait on.
+ *
+ * @param[in] ws connection
+ *
+ * @return the socket or -1 if closed
+ */
+int ocpp_websocket_fd(const struct ocpp_websocket *ws);
+/**
+ * @brief Tell if the socket is to be waited on for writability as well.
+ *
+ * @param[in] ws connection
+ *
+ * @return true while connecting or any frame is queued
+ */
+bool ocpp_websocket_wants_write(const struct ocpp_websocket *ws);
+
+/**
+ * @brief Queue a text frame.
+ *
+ * @param[in] ws connection
+ * @param[in] data payload
+ * @param[in] datasize size of @p data
+ *
+ * @return 0 on success. -ENOTCONN if not open. -EAGAIN if the queue is full
+ *         for now. -EMSGSIZE if it does not fit in the queue at all
+ */
+int ocpp_websocket_write(struct ocpp_websocket *ws,
+		const void *data, size_t datasize);
+/**
+ * @brief Get the received message, in place.
+ *
+ * The message stays in the receive buffer until `ocpp_websocket_consume()`,
+ * and no more frames are taken in till then.
+ *
+ * @param[in] ws connection
+ * @param[out] data payload of the message. Not null-terminated
+ *
+ * @return the length of the message. -ENOMSG if none is received yet
+ */
+int ocpp_websocket_peek(struct ocpp_websocket *ws, const char **data);
+/**
+ * @brief Drop the message got by `ocpp_websocket_peek()`.
+ *
+ * @param[in] ws connection
+ */
+void ocpp_websocket_consume(struct ocpp_websocket *ws);
+
+/**
+ * @brief Send a message as an OCPP-J frame.
+ *
+ * The frame is encoded straight into the send queue, but for long strings
+ * taken in place by `ocpp_encode_message_jsonv()`. As the server, they go
+ * out with the header in a single sendmsg() when nothing is queued, and
+ * as the client, they are copied once while masked. With permessage-deflate,
+ * the frame is encoded whole and compressed in the queue instead. To be
+ * called from `ocpp_send()`.
+ *
+ * @param[in] ws connection
+ * @param[in] msg message to send
+ *
+ * @return 0 on success. -ENOTCONN, -EAGAIN or -EMSGSIZE as in
+ *         `ocpp_websocket_write()`. -EINVAL if the message is invalid
+ */
+int ocpp_websocket_send(struct ocpp_websocket *ws,
+		const struct ocpp_message *msg);
+/**
+ * @brief Receive a message of an OCPP-J frame.
+ *
+ * To be called from `ocpp_recv()`. The frame is consumed whether or not it
+ * is decoded.
+ *
+ * @param[in] ws connection
+ * @param[out] msg message received
+ * @param[out] buf buffer for the payload
+ * @param[in] bufsize size of @p buf
+ * @param[out] error the error code to answer with when rejected. Can be NULL
+ *
+ * @return 0 on success. -ENOMSG if none is received yet. Otherwise the error
+ *         of `ocpp_decode_message_json()`.
+ */
+int ocpp_websocket_recv(struct ocpp_websocket *ws, struct ocpp_message *msg,
+		void *buf, size_t bufsize, ocpp_callerror_t *error);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* LIBMCU_OCPP_WEBSOCKET_H */
@@ -13,37 +13,152 @@
 #define OCPP_LIBRARY_VERSION		0
 #endif
 
-#if !defined(OCPP_CONFIGURATION_DEFINES)
-#define OCPP_CONFIGURATION_DEFINES	"ocpp_configuration.def.template"
-#endif
-
 #if !defined(MIN)
 #define MIN(a, b)			(((a) > (b))? (b) : (a))
 #endif
 
+#if !defined(OCPP_CONFIGURATION_OBSERVER_MAX)
+#define OCPP_CONFIGURATION_OBSERVER_MAX	4
+#endif
+
+#if !defined(OCPP_CONFIGURATION_REGISTRY_MAX)
+#define OCPP_CONFIGURATION_REGISTRY_MAX		8
+#endif
+#if !defined(OCPP_CONFIGURATION_REGISTRY_ARENA_SIZE)
+#define OCPP_CONFIGURATION_REGISTRY_ARENA_SIZE	256
+#endif
+
+#define KEYSTR_MAXLEN			50
+#define KEY_INDEX_LEN			(CONFIGURATION_MAX * 2 + 1)
+#define BITMAP_WORDS			((UnknownConfiguration + 31) / 32)
+
 #define CONF_SIZE(x)			(x)
-#define BOOL				CONF_SIZE(sizeof(bool))
-#define INT				CONF_SIZE(sizeof(int))
-#define CSL				CONF_SIZE(sizeof(int))
-#define STR				CONF_SIZE
 
 typedef enum {
 #define OCPP_CONFIG(key, accessbility, type, default_value)	key,
 #include OCPP_CONFIGURATION_DEFINES
 #undef OCPP_CONFIG
 	CONFIGURATION_MAX,
-	UnknownConfiguration,
+	/* keys registered at runtime take the ids following the built-in
+	 * ones. */
+	UnknownConfiguration =
+		CONFIGURATION_MAX + OCPP_CONFIGURATION_REGISTRY_MAX,
 } configuration_t;
 
-#define OCPP_CONFIG(key, accessbility, type, default_value)	+ type
-static uint8_t configurations_pool[0
+#define CONNECTORS			(OCPP_CONNECTOR_MAX + 1)
+
+/* Default values laid out the same as the pool, placed in read-only memory
+ * so that a reset is a single copy. A per-connector key holds the values of
+ * connector 0 to OCPP_CONNECTOR_MAX back to back. */
+#define DEFAULT_BOOL			bool
+#define DEFAULT_INT			int
+#define DEFAULT_CSL			int
+#define DEFAULT_STR(n)			struct { char s[n]; }
+#define INIT_BOOL(v)			(v)
+#define INIT_INT(v)			(int)(v)
+#define INIT_CSL(v)			(int)(v)
+#define INIT_STR(n)			INIT_STRING
+#define INIT_STRING(v)			{ v }
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-macros"
+#undef OCPP_CONFIG_CONNECTOR
+static const struct __attribute__((packed)) default_image {
+#define OCPP_CONFIG(key, accessbility, type, default_value)	\
+	DEFAULT_##type key;
+#define OCPP_CONFIG_CONNECTOR(key, accessbility, type, default_value)	\
+	DEFAULT_##type key[CONNECTORS];
+#include OCPP_CONFIGURATION_DEFINES
+#undef OCPP_CONFIG_CONNECTOR
+#undef OCPP_CONFIG
+} default_image = {
+#define OCPP_CONFIG(key, accessbility, type, default_value)	\
+	.key = INIT_##type(default_value),
+#define OCPP_CONFIG_CONNECTOR(key, accessbility, type, default_value)	\
+	.key = { [0 ... OCPP_CONNECTOR_MAX] = INIT_##type(default_value) },
+#include OCPP_CONFIGURATION_DEFINES
+#undef OCPP_CONFIG_CONNECTOR
+#undef OCPP_CONFIG
+};
+
+static const bool per_connector[CONFIGURATION_MAX] = {
+#define OCPP_CONFIG(key, accessbility, type, default_value)
+#define OCPP_CONFIG_CONNECTOR(key, accessbility, type, default_value)	\
+	[key] = true,
+#include OCPP_CONFIGURATION_DEFINES
+#undef OCPP_CONFIG_CONNECTOR
+#undef OCPP_CONFIG
+};
+
+#define OCPP_CONFIG_CONNECTOR(key, accessibility, type, default_value)	\
+	OCPP_CONFIG(key, accessibility, type, default_value)
+#pragma GCC diagnostic pop
+#undef INIT_STRING
+#undef INIT_STR
+#undef INIT_CSL
+#undef INIT_INT
+#undef INIT_BOOL
+#undef DEFAULT_STR
+#undef DEFAULT_CSL
+#undef DEFAULT_INT
+#undef DEFAULT_BOOL
+
+static uint8_t configurations_pool[sizeof(struct default_image)];
+
+static const uint16_t offsets[CONFIGURATION_MAX] = {
+#define OCPP_CONFIG(key, accessbility, type, default_value)	\
+	[key] = offsetof(struct default_image, key),
+#include OCPP_CONFIGURATION_DEFINES
+#undef OCPP_CONFIG
+};
+
+/* Built from the optional constraints in OCPP_CONFIGURATION_DEFINES, any of
+ * which may be missing there. */
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-macros"
+static const struct constraint {
+	int min;
+	int max;
+	int allowed; /* mask of the CSL members allowed */
+	bool ranged;
+	bool restricted;
+	bool reboot_required;
+} constraints[CONFIGURATION_MAX] = {
+#undef OCPP_CONFIG_REBOOT_REQUIRED
+#undef OCPP_CONFIG_ALLOWED
+#undef OCPP_CONFIG_RANGE
+#define OCPP_CONFIG_RANGE(key, lo, hi)				\
+	[key].min = (lo), [key].max = (hi), [key].ranged = true,
+#define OCPP_CONFIG_ALLOWED(key, members)			\
+	[key].allowed = (int)(members), [key].restricted = true,
+#define OCPP_CONFIG_REBOOT_REQUIRED(key)			\
+	[key].reboot_required = true,
+#define OCPP_CONFIG(key, accessbility, type, default_value)
 #include OCPP_CONFIGURATION_DEFINES
-];
 #undef OCPP_CONFIG
+#undef OCPP_CONFIG_REBOOT_REQUIRED
+#undef OCPP_CONFIG_ALLOWED
+#undef OCPP_CONFIG_RANGE
+#define OCPP_CONFIG_RANGE(key, min, max)
+#define OCPP_CONFIG_ALLOWED(key, members)
+#define OCPP_CONFIG_REBOOT_REQUIRED(key)
+};
+#pragma GCC diagnostic pop
+
+/* Sequence counter of the pool. Writers serialize on
+ * ocpp_configuration_lock() and keep it odd while writing, so that readers
+ * can copy values without taking the lock and retry only when they raced a
+ * write. */
+static uint32_t sequence;
 
-static struct ocpp_configuration {
-	uint8_t *value;
-} configurations[CONFIGURATION_MAX];
+/* One bit per key, set when the value changes and cleared by the consumer,
+ * e.g. the one persisting configurations. */
+static uint32_t dirty[BITMAP_WORDS];
+
+static struct observer {
+	ocpp_configuration_observer_t callback;
+	void *ctx;
+	ocpp_configuration_t key; /**< `OCPP_CONF_MAX` for any key. */
+} observers[OCPP_CONFIGURATION_OBSERVER_MAX];
 
 static const char * const confstr[] = {
 #define OCPP_CONFIG(key, accessbility, type, default_value)	[key] = #key,
@@ -51,8 +166,125 @@ static const char * const confstr[] = {
 #undef OCPP_CONFIG
 };
 
+/* Keys registered at runtime. Their key strings, values and defaults are
+ * carved out of the arena, which is given back only all at once. */
+static struct runtime_key {
+	uint32_t hash; /**< of the key string */
+	uint16_t keystr; /**< offsets in the arena */
+	uint16_t value;
+	uint16_t default_value;
+	uint8_t cap;
+	uint8_t type; /**< `ocpp_configuration_data_t` */
+	uint8_t access; /**< `ocpp_configuration_access_t` */
+} runtime_keys[OCPP_CONFIGURATION_REGISTRY_MAX];
+static size_t nr_runtime_keys;
+static uint8_t arena[OCPP_CONFIGURATION_REGISTRY_ARENA_SIZE];
+static size_t arena_used;
+
+_Static_assert(UnknownConfiguration < UINT8_MAX, "too many configurations");
+_Static_assert(OCPP_CONFIGURATION_REGISTRY_ARENA_SIZE <= UINT16_MAX,
+		"arena too large");
+_Static_assert((int)CONFIGURATION_MAX == (int)OCPP_CONF_MAX,
+		"keys out of sync with the header");
+
+/* Open addressing hash table of `key + 1` indexed by the hash of the key
+ * string. Zero marks an empty slot. It is built from `confstr[]` at runtime
+ * so that any custom OCPP_CONFIGURATION_DEFINES works without a generator.
+ * The built-in keys never change, so it is built only once by whichever
+ * lookup comes first and never written again. Keys registered at runtime are
+ * kept out of it and matched by their hash. */
+static uint8_t key_index[KEY_INDEX_LEN];
+static int key_index_state;
+
+enum {
+	KEY_INDEX_NONE,
+	KEY_INDEX_BUILDING,
+	KEY_INDEX_BUILT,
+};
+
+static uint32_t hash_keystr(const char *keystr)
+{
+	uint32_t hash = 2166136261u; /* FNV-1a */
+
+	while (*keystr) {
+		hash ^= (uint8_t)*keystr++;
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+static size_t count_keys(void)
+{
+	return CONFIGURATION_MAX +
+		__atomic_load_n(&nr_runtime_keys, __ATOMIC_ACQUIRE);
+}
+
+static bool is_valid(configuration_t key)
+{
+	return key < count_keys();
+}
+
+static const struct runtime_key *get_runtime_key(configuration_t key)
+{
+	if (key < CONFIGURATION_MAX || key >= UnknownConfiguration) {
+		return NULL;
+	}
+
+	return &runtime_keys[key - CONFIGURATION_MAX];
+}
+
+static const char *get_keystr(configuration_t key)
+{
+	const struct runtime_key *rkey = get_runtime_key(key);
+
+	if (rkey) {
+		return (const char *)&arena[rkey->keystr];
+	}
+
+	return confstr[key];
+}
+
+static void build_key_index(void)
+{
+	for (configuration_t key = 0; key < CONFIGURATION_MAX; key++) {
+		uint32_t slot = hash_keystr(confstr[key]) % KEY_INDEX_LEN;
+
+		while (key_index[slot] != 0) {
+			slot = (slot + 1) % KEY_INDEX_LEN;
+		}
+
+		key_index[slot] = (uint8_t)(key + 1);
+	}
+
+	__atomic_store_n(&key_index_state, KEY_INDEX_BUILT, __ATOMIC_RELEASE);
+}
+
+/* Returns false while another one is building the index, in which case the
+ * caller falls back to a linear search rather than waiting. */
+static bool prepare_key_index(void)
+{
+	int state = __atomic_load_n(&key_index_state, __ATOMIC_ACQUIRE);
+
+	if (state == KEY_INDEX_NONE &&
+			__atomic_compare_exchange_n(&key_index_state, &state,
+					KEY_INDEX_BUILDING, false,
+					__ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+		build_key_index();
+		return true;
+	}
+
+	return state == KEY_INDEX_BUILT;
+}
+
 static ocpp_configuration_data_t get_value_type(configuration_t key)
 {
+	const struct runtime_key *rkey = get_runtime_key(key);
+
+	if (rkey) {
+		return (ocpp_configuration_data_t)rkey->type;
+	}
+
 	const ocpp_configuration_data_t value_types[CONFIGURATION_MAX] = {
 #define STR_TYPE(x) OCPP_CONF_TYPE_STR
 #undef STR
@@ -77,6 +309,12 @@ static ocpp_configuration_data_t get_value_type(configuration_t key)
 
 static size_t get_value_cap(configuration_t key)
 {
+	const struct runtime_key *rkey = get_runtime_key(key);
+
+	if (rkey) {
+		return rkey->cap;
+	}
+
 	const uint8_t size[CONFIGURATION_MAX] = {
 #define BOOL CONF_SIZE(sizeof(bool))
 #define INT CONF_SIZE(sizeof(int))
@@ -94,60 +332,52 @@ static size_t get_value_cap(configuration_t key)
 	return (size_t)size[key];
 }
 
-static void link_configuration_pool(void)
+static uint8_t *get_value_ptr(configuration_t key)
 {
-	size_t cidx = 0;
+	const struct runtime_key *rkey = get_runtime_key(key);
 
-	for (configuration_t i = 0; i < CONFIGURATION_MAX; i++) {
-		configurations[i].value = &configurations_pool[cidx];
-		cidx += get_value_cap(i);
+	if (rkey) {
+		return &arena[rkey->value];
 	}
+
+	return &configurations_pool[offsets[key]];
 }
 
-static void set_default_value(void)
+static size_t count_connectors(configuration_t key)
 {
-	union {
-		bool v_BOOL;
-		int v_INT;
-		int v_CSL;
-		const char *v_STR;
-	} v;
+	return key < CONFIGURATION_MAX && per_connector[key]? CONNECTORS : 1;
+}
 
-#define BOOL CONF_SIZE(sizeof(bool))
-#define INT CONF_SIZE(sizeof(int))
-#define CSL CONF_SIZE(sizeof(int))
-#define STR CONF_SIZE
-#define OCPP_CONFIG(key, accessbility, type, default_value)	\
-	switch (get_value_type(key)) { \
-	case OCPP_CONF_TYPE_STR: \
-		v.v_STR = (const char *)(default_value); \
-		if (v.v_STR) { \
-			strncpy((char *)configurations[key].value, v.v_STR, type); \
-		} \
-		break; \
-	case OCPP_CONF_TYPE_INT: /* fall through */ \
-	case OCPP_CONF_TYPE_CSL: /* fall through */ \
-		v.v_INT = (int)(uintptr_t)(default_value); \
-		memcpy(configurations[key].value, &v.v_INT, type); \
-		break; \
-	case OCPP_CONF_TYPE_BOOL: /* fall through */\
-		v.v_BOOL = (bool)(uintptr_t)(default_value); \
-		memcpy(configurations[key].value, &v.v_BOOL, type); \
-		break; \
-	default: /*fall through */ \
-	case OCPP_CONF_TYPE_UNKNOWN: \
-		break; \
+/* Connectors of a shared key all read the single value. */
+static uint8_t *get_value_ptr_at(configuration_t key, int connector_id)
+{
+	const size_t index = count_connectors(key) > 1? (size_t)connector_id : 0;
+	return get_value_ptr(key) + index * get_value_cap(key);
+}
+
+static bool is_connector_valid(configuration_t key, int connector_id,
+		bool writing)
+{
+	if (connector_id < 0 || connector_id > OCPP_CONNECTOR_MAX) {
+		return false;
 	}
-#include OCPP_CONFIGURATION_DEFINES
-#undef OCPP_CONFIG
-#undef STR
-#undef CSL
-#undef INT
-#undef BOOL
+
+	return !writing || connector_id == 0 || count_connectors(key) > 1;
+}
+
+static const uint8_t *get_default_ptr(configuration_t key)
+{
+	return (const uint8_t *)&default_image + offsets[key];
 }
 
 static bool is_readable(configuration_t key)
 {
+	const struct runtime_key *rkey = get_runtime_key(key);
+
+	if (rkey) {
+		return (rkey->access & OCPP_CONF_ACCESS_R) != 0;
+	}
+
 	switch (key) {
 #define R					true
 #define W					false
@@ -159,7 +389,9 @@ static bool is_readable(configuration_t key)
 #undef RW
 #undef W
 #undef R
+#if OCPP_CONFIGURATION_REGISTRY_MAX > 0
 	case CONFIGURATION_MAX: /* fall through */
+#endif
 	case UnknownConfiguration: /* fall through */
 	default:
 		return false;
@@ -168,6 +400,12 @@ static bool is_readable(configuration_t key)
 
 static bool is_writable(configuration_t key)
 {
+	const struct runtime_key *rkey = get_runtime_key(key);
+
+	if (rkey) {
+		return (rkey->access & OCPP_CONF_ACCESS_W) != 0;
+	}
+
 	switch (key) {
 #define R					false
 #define W					true
@@ -179,190 +417,990 @@ static bool is_writable(configuration_t key)
 #undef RW
 #undef W
 #undef R
+#if OCPP_CONFIGURATION_REGISTRY_MAX > 0
 	case CONFIGURATION_MAX: /* fall through */
+#endif
 	case UnknownConfiguration: /* fall through */
 	default:
 		return false;
 	}
 }
 
-static configuration_t get_key_from_keystr(const char * const keystr)
+static configuration_t find_builtin_key(const char * const keystr,
+		uint32_t hash)
 {
-	for (int i = 0; i < CONFIGURATION_MAX; i++) {
-		if (strcmp(keystr, confstr[i]) == 0) {
-			return (configuration_t)i;
+	if (!prepare_key_index()) {
+		for (configuration_t key = 0; key < CONFIGURATION_MAX; key++) {
+			if (strcmp(keystr, confstr[key]) == 0) {
+				return key;
+			}
+		}
+
+		return UnknownConfiguration;
+	}
+
+	uint32_t slot = hash % KEY_INDEX_LEN;
+	uint8_t entry;
+
+	while ((entry = key_index[slot]) != 0) {
+		const configuration_t key = (configuration_t)(entry - 1);
+
+		if (strcmp(keystr, confstr[key]) == 0) {
+			return key;
 		}
+
+		slot = (slot + 1) % KEY_INDEX_LEN;
 	}
 
 	return UnknownConfiguration;
 }
 
-static int get_configuration(configuration_t key,
-		void *buf, size_t bufsize, bool *readonly)
+/* The count is published after the key is filled in, so that a key found is
+ * always complete. */
+static configuration_t find_runtime_key(const char * const keystr,
+		uint32_t hash)
 {
-	if (key >= CONFIGURATION_MAX) {
-		return -EINVAL;
-	}
+	const size_t n = __atomic_load_n(&nr_runtime_keys, __ATOMIC_ACQUIRE);
 
-	if (readonly) {
-		*readonly = !is_writable(key) && is_readable(key);
-	}
+	for (size_t i = 0; i < n; i++) {
+		const struct runtime_key *rkey = &runtime_keys[i];
 
-	memcpy(buf, configurations[key].value,
-			MIN(get_value_cap(key), bufsize));
+		if (rkey->hash == hash && strcmp(keystr,
+				(const char *)&arena[rkey->keystr]) == 0) {
+			return (configuration_t)(CONFIGURATION_MAX + i);
+		}
+	}
 
-	return 0;
+	return UnknownConfiguration;
 }
 
-bool ocpp_has_configuration(const char * const keystr)
+static configuration_t get_key_from_keystr(const char * const keystr)
 {
-	return get_key_from_keystr(keystr) != UnknownConfiguration;
+	const uint32_t hash = hash_keystr(keystr);
+	const configuration_t key = find_builtin_key(keystr, hash);
+
+	if (key != UnknownConfiguration) {
+		return key;
+	}
+
+	return find_runtime_key(keystr, hash);
 }
 
-size_t ocpp_count_configurations(void)
+/* Writers call write_begin() and write_end() holding
+ * ocpp_configuration_lock(). */
+static void write_begin(void)
 {
-	return CONFIGURATION_MAX;
+	__atomic_store_n(&sequence, sequence + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
 }
 
-size_t ocpp_compute_configuration_size(void)
+static void write_end(void)
 {
-	return sizeof(configurations_pool);
+	__atomic_store_n(&sequence, sequence + 1, __ATOMIC_RELEASE);
 }
 
-int ocpp_copy_configuration_from(const void *data, size_t datasize)
+static void read_pool(void *buf, const void *src, size_t len)
 {
-	if (data == NULL || datasize > sizeof(configurations_pool)) {
-		return -EINVAL;
-	}
+	const uint32_t seq = __atomic_load_n(&sequence, __ATOMIC_ACQUIRE);
 
-	ocpp_configuration_lock();
+	if ((seq & 1u) == 0) {
+		memcpy(buf, src, len);
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
 
-	memcpy(configurations_pool, data, datasize);
-	link_configuration_pool();
+		if (__atomic_load_n(&sequence, __ATOMIC_RELAXED) == seq) {
+			return;
+		}
+	}
 
+	/* Raced a write. Wait for the writer rather than spinning, which
+	 * would never end if the writer was preempted by this reader. */
+	ocpp_configuration_lock();
+	memcpy(buf, src, len);
 	ocpp_configuration_unlock();
-
-	return 0;
 }
 
-int ocpp_copy_configuration_to(void *buf, size_t bufsize)
+static void write_value(configuration_t key, int connector_id,
+		const void *value, size_t value_size)
 {
-	if (buf == NULL || bufsize < sizeof(configurations_pool)) {
-		return -EINVAL;
-	}
+	const size_t cap = get_value_cap(key);
+	uint8_t *p = get_value_ptr_at(key, connector_id);
 
-	ocpp_configuration_lock();
-	memcpy(buf, configurations_pool, sizeof(configurations_pool));
-	ocpp_configuration_unlock();
-
-	return 0;
+	memcpy(p, value, value_size);
+	memset(&p[value_size], 0, cap - value_size);
 }
 
-int ocpp_set_configuration(const char * const keystr,
+static bool is_value_equal(configuration_t key, int connector_id,
 		const void *value, size_t value_size)
 {
-	configuration_t key = get_key_from_keystr(keystr);
+	const uint8_t *p = get_value_ptr_at(key, connector_id);
+	const size_t cap = get_value_cap(key);
 
-	if (key == UnknownConfiguration || value_size > get_value_cap(key)) {
-		return -EINVAL;
+	if (memcmp(p, value, value_size) != 0) {
+		return false;
 	}
 
-	if (!is_writable(key)) {
-		return -EPERM;
+	for (size_t i = value_size; i < cap; i++) {
+		if (p[i] != 0) {
+			return false;
+		}
 	}
 
-	ocpp_configuration_lock();
-	memcpy(configurations[key].value, value, value_size);
-	ocpp_configuration_unlock();
-
-	return 0;
+	return true;
 }
 
-size_t ocpp_get_configuration_size(const char * const keystr)
+static int validate(configuration_t key, const void *value, size_t value_size)
 {
-	configuration_t key = get_key_from_keystr(keystr);
+	if (key >= CONFIGURATION_MAX) {
+		return 0;
+	}
 
-	if (key == UnknownConfiguration) {
+	const struct constraint *constraint = &constraints[key];
+	int v = 0;
+
+	if (!constraint->ranged && !constraint->restricted) {
 		return 0;
 	}
 
-	return get_value_cap(key);
+	memcpy(&v, value, MIN(value_size, sizeof(v)));
+
+	if (constraint->ranged &&
+			(v < constraint->min || v > constraint->max)) {
+		return -ERANGE;
+	}
+	if (constraint->restricted && (v & ~constraint->allowed)) {
+		return -ERANGE;
+	}
+
+	return 0;
 }
 
-ocpp_configuration_data_t ocpp_get_configuration_data_type(
-		const char * const keystr)
+static void set_dirty(uint32_t *bitmap, configuration_t key)
 {
-	configuration_t key = get_key_from_keystr(keystr);
+	__atomic_fetch_or(&bitmap[key / 32], 1u << (key % 32),
+			__ATOMIC_RELAXED);
+}
 
-	if (key == UnknownConfiguration) {
-		return OCPP_CONF_TYPE_UNKNOWN;
-	}
+static void notify(const uint32_t *changed)
+{
+	for (int i = 0; i < OCPP_CONFIGURATION_OBSERVER_MAX; i++) {
+		const struct observer *observer = &observers[i];
 
-	return get_value_type(key);
+		if (observer->callback == NULL) {
+			continue;
+		}
+
+		for (configuration_t key = 0; key < CONFIGURATION_MAX; key++) {
+			if (!(changed[key / 32] & (1u << (key % 32))) ||
+					(observer->key != OCPP_CONF_MAX &&
+					observer->key != (ocpp_configuration_t)key)) {
+				continue;
+			}
+
+			(*observer->callback)((ocpp_configuration_t)key,
+					observer->ctx);
+		}
+	}
 }
 
-int ocpp_get_configuration(const char * const keystr,
-		void *buf, size_t bufsize, bool *readonly)
+/* Write a value only if it differs, then notify the observers outside of
+ * the lock. */
+static void update_value(configuration_t key, int connector_id,
+		const void *value, size_t value_size)
 {
-	configuration_t key = get_key_from_keystr(keystr);
+	uint32_t changed[BITMAP_WORDS] = { 0, };
 
 	ocpp_configuration_lock();
-	int rc = get_configuration(key, buf, bufsize, readonly);
+
+	if (!is_value_equal(key, connector_id, value, value_size)) {
+		write_begin();
+		write_value(key, connector_id, value, value_size);
+		write_end();
+
+		set_dirty(dirty, key);
+		set_dirty(changed, key);
+	}
+
 	ocpp_configuration_unlock();
 
-	return rc;
+	notify(changed);
 }
 
-int ocpp_get_configuration_by_index(int index,
+static int get_configuration(configuration_t key,
 		void *buf, size_t bufsize, bool *readonly)
 {
-	ocpp_configuration_lock();
-	int rc = get_configuration((configuration_t)index,
-			buf, bufsize, readonly);
-	ocpp_configuration_unlock();
+	if (!is_valid(key)) {
+		return -EINVAL;
+	}
 
-	return rc;
+	if (readonly) {
+		*readonly = !is_writable(key) && is_readable(key);
+	}
+
+	read_pool(buf, get_value_ptr(key),
+			MIN(get_value_cap(key), bufsize));
+
+	return 0;
 }
 
-const char *ocpp_get_configuration_keystr_from_index(int index)
+bool ocpp_has_configuration(const char * const keystr)
 {
-	if (index < 0 || index >= CONFIGURATION_MAX) {
-		return NULL;
-	}
-
-	return confstr[index];
+	return get_key_from_keystr(keystr) != UnknownConfiguration;
 }
 
-bool ocpp_is_configuration_writable(const char * const keystr)
+/* Called with the lock held. Not capped if the key is not defined or still
+ * holds its default, which counts the built-in keys only and would cut off
+ * the keys registered at runtime. */
+static int get_max_keys(void)
 {
-	configuration_t key = get_key_from_keystr(keystr);
+	const configuration_t key =
+		get_key_from_keystr("GetConfigurationMaxKeys");
+	int max = (int)count_keys();
 
-	if (key == UnknownConfiguration) {
-		return false;
+	if (key < CONFIGURATION_MAX &&
+			get_value_type(key) == OCPP_CONF_TYPE_INT &&
+			memcmp(get_value_ptr(key), get_default_ptr(key),
+					sizeof(max)) != 0) {
+		memcpy(&max, get_value_ptr(key), sizeof(max));
 	}
 
-	return is_writable(key);
+	return max;
 }
 
-bool ocpp_is_configuration_readable(const char * const keystr)
+static int visit(configuration_t key, const char *keystr,
+		ocpp_configuration_visitor_t visitor, void *ctx)
 {
-	configuration_t key = get_key_from_keystr(keystr);
-
-	if (key == UnknownConfiguration) {
-		return false;
+	if (key == UnknownConfiguration || !is_readable(key)) {
+		return (*visitor)(keystr, NULL, 0,
+				OCPP_CONF_TYPE_UNKNOWN, false, ctx);
 	}
 
-	return is_readable(key);
+	return (*visitor)(get_keystr(key), get_value_ptr(key),
+			get_value_cap(key) * count_connectors(key),
+			get_value_type(key), !is_writable(key), ctx);
 }
 
-void ocpp_reset_configuration(void)
+int ocpp_visit_configurations(const char * const *keys, size_t nr_keys,
+		ocpp_configuration_visitor_t visitor, void *ctx)
 {
-	memset(&configurations_pool, 0, sizeof(configurations_pool));
+	const bool all = keys == NULL || nr_keys == 0;
+	const size_t n = all? count_keys() : nr_keys;
+	int count = 0;
+
+	if (visitor == NULL) {
+		return -EINVAL;
+	}
 
 	ocpp_configuration_lock();
 
-	link_configuration_pool();
-	set_default_value();
+	const int max = get_max_keys();
+
+	for (size_t i = 0; i < n && count < max; i++) {
+		const configuration_t key = all?
+			(configuration_t)i : get_key_from_keystr(keys[i]);
+
+		if (all && !is_readable(key)) {
+			continue;
+		}
+
+		count++;
+
+		if (visit(key, all? get_keystr(key) : keys[i], visitor, ctx)) {
+			break;
+		}
+	}
+
+	ocpp_configuration_unlock();
+
+	return count;
+}
+
+size_t ocpp_count_configurations(void)
+{
+	return count_keys();
+}
+
+size_t ocpp_compute_configuration_size(void)
+{
+	return sizeof(configurations_pool);
+}
+
+int ocpp_copy_configuration_from(const void *data, size_t datasize)
+{
+	if (data == NULL || datasize > sizeof(configurations_pool)) {
+		return -EINVAL;
+	}
+
+	uint32_t changed[BITMAP_WORDS] = { 0, };
+
+	ocpp_configuration_lock();
+
+	for (configuration_t key = 0; key < CONFIGURATION_MAX; key++) {
+		const size_t offset = offsets[key];
+		const size_t span = get_value_cap(key) * count_connectors(key);
+		const size_t len = offset < datasize?
+				MIN(span, datasize - offset) : 0;
+
+		if (memcmp(get_value_ptr(key),
+				(const uint8_t *)data + offset, len) != 0) {
+			set_dirty(changed, key);
+		}
+	}
+
+	write_begin();
+	memcpy(configurations_pool, data, datasize);
+	write_end();
+
+	/* loaded values are the persisted ones. */
+	memset(dirty, 0, sizeof(dirty));
+
+	ocpp_configuration_unlock();
+
+	notify(changed);
+
+	return 0;
+}
+
+int ocpp_copy_configuration_to(void *buf, size_t bufsize)
+{
+	if (buf == NULL || bufsize < sizeof(configurations_pool)) {
+		return -EINVAL;
+	}
+
+	read_pool(buf, configurations_pool, sizeof(configurations_pool));
+
+	return 0;
+}
+
+int ocpp_set_configuration(const char * const keystr,
+		const void *value, size_t value_size)
+{
+	configuration_t key = get_key_from_keystr(keystr);
+
+	if (key == UnknownConfiguration || value_size > get_value_cap(key)) {
+		return -EINVAL;
+	}
+
+	if (!is_writable(key)) {
+		return -EPERM;
+	}
+
+	int err = validate(key, value, value_size);
+
+	if (err) {
+		return err;
+	}
+
+	update_value(key, 0, value, value_size);
+
+	return 0;
+}
+
+ocpp_config_status_t ocpp_change_configuration(const char * const keystr,
+		const void *value, size_t value_size)
+{
+	const configuration_t key = get_key_from_keystr(keystr);
+
+	if (key == UnknownConfiguration) {
+		return OCPP_CONFIG_STATUS_NOT_SUPPORTED;
+	}
+
+	if (ocpp_set_configuration(keystr, value, value_size) != 0) {
+		return OCPP_CONFIG_STATUS_REJECTED;
+	}
+
+	return key < CONFIGURATION_MAX && constraints[key].reboot_required?
+		OCPP_CONFIG_STATUS_REBOOT_REQUIRED : OCPP_CONFIG_STATUS_ACCEPTED;
+}
+
+size_t ocpp_get_configuration_size(const char * const keystr)
+{
+	configuration_t key = get_key_from_keystr(keystr);
+
+	if (key == UnknownConfiguration) {
+		return 0;
+	}
+
+	return get_value_cap(key);
+}
+
+ocpp_configuration_data_t ocpp_get_configuration_data_type(
+		const char * const keystr)
+{
+	configuration_t key = get_key_from_keystr(keystr);
+
+	if (key == UnknownConfiguration) {
+		return OCPP_CONF_TYPE_UNKNOWN;
+	}
+
+	return get_value_type(key);
+}
+
+int ocpp_get_configuration(const char * const keystr,
+		void *buf, size_t bufsize, bool *readonly)
+{
+	return get_configuration(get_key_from_keystr(keystr),
+			buf, bufsize, readonly);
+}
+
+int ocpp_get_configuration_by_index(int index,
+		void *buf, size_t bufsize, bool *readonly)
+{
+	if (index < 0) {
+		return -EINVAL;
+	}
+
+	return get_configuration((configuration_t)index,
+			buf, bufsize, readonly);
+}
+
+const char *ocpp_get_configuration_keystr_from_index(int index)
+{
+	if (index < 0 || !is_valid((configuration_t)index)) {
+		return NULL;
+	}
+
+	return get_keystr((configuration_t)index);
+}
+
+bool ocpp_is_configuration_writable(const char * const keystr)
+{
+	configuration_t key = get_key_from_keystr(keystr);
+
+	if (key == UnknownConfiguration) {
+		return false;
+	}
+
+	return is_writable(key);
+}
+
+bool ocpp_is_configuration_readable(const char * const keystr)
+{
+	configuration_t key = get_key_from_keystr(keystr);
+
+	if (key == UnknownConfiguration) {
+		return false;
+	}
+
+	return is_readable(key);
+}
+
+ocpp_configuration_t ocpp_conf_from_keystr(const char * const keystr)
+{
+	configuration_t key = get_key_from_keystr(keystr);
+
+	/* runtime keys are accessible only by the key string. */
+	if (key >= CONFIGURATION_MAX) {
+		return OCPP_CONF_MAX;
+	}
+
+	return (ocpp_configuration_t)key;
+}
+
+static bool is_type(ocpp_configuration_t key, ocpp_configuration_data_t type)
+{
+	return key < OCPP_CONF_MAX && get_value_type((configuration_t)key) == type;
+}
+
+static int get_int(ocpp_configuration_t key, int connector_id,
+		ocpp_configuration_data_t type)
+{
+	int value = 0;
+
+	if (is_type(key, type) &&
+			is_connector_valid((configuration_t)key, connector_id,
+					false)) {
+		read_pool(&value, get_value_ptr_at((configuration_t)key,
+				connector_id), sizeof(value));
+	}
+
+	return value;
+}
+
+static int set_value(ocpp_configuration_t key, int connector_id,
+		ocpp_configuration_data_t type,
+		const void *value, size_t value_size)
+{
+	const size_t cap = is_type(key, type)?
+		get_value_cap((configuration_t)key) : 0;
+
+	if (cap == 0 || value_size > cap ||
+			!is_connector_valid((configuration_t)key, connector_id,
+					true)) {
+		return -EINVAL;
+	}
+
+	update_value((configuration_t)key, connector_id, value, value_size);
+
+	return 0;
+}
+
+int ocpp_conf_get_int(ocpp_configuration_t key)
+{
+	return get_int(key, 0, OCPP_CONF_TYPE_INT);
+}
+
+int ocpp_conf_get_csl(ocpp_configuration_t key)
+{
+	return get_int(key, 0, OCPP_CONF_TYPE_CSL);
+}
+
+bool ocpp_conf_get_bool(ocpp_configuration_t key)
+{
+	return ocpp_conf_get_bool_at(key, 0);
+}
+
+size_t ocpp_conf_get_str(ocpp_configuration_t key, char *buf, size_t bufsize)
+{
+	return ocpp_conf_get_str_at(key, 0, buf, bufsize);
+}
+
+int ocpp_conf_set_int(ocpp_configuration_t key, int value)
+{
+	return set_value(key, 0, OCPP_CONF_TYPE_INT, &value, sizeof(value));
+}
+
+int ocpp_conf_set_csl(ocpp_configuration_t key, int value)
+{
+	return set_value(key, 0, OCPP_CONF_TYPE_CSL, &value, sizeof(value));
+}
+
+int ocpp_conf_set_bool(ocpp_configuration_t key, bool value)
+{
+	return set_value(key, 0, OCPP_CONF_TYPE_BOOL, &value, sizeof(value));
+}
+
+int ocpp_conf_set_str(ocpp_configuration_t key, const char *str)
+{
+	return ocpp_conf_set_str_at(key, 0, str);
+}
+
+int ocpp_conf_get_int_at(ocpp_configuration_t key, int connector_id)
+{
+	return get_int(key, connector_id, OCPP_CONF_TYPE_INT);
+}
+
+int ocpp_conf_get_csl_at(ocpp_configuration_t key, int connector_id)
+{
+	return get_int(key, connector_id, OCPP_CONF_TYPE_CSL);
+}
+
+bool ocpp_conf_get_bool_at(ocpp_configuration_t key, int connector_id)
+{
+	bool value = false;
+
+	if (is_type(key, OCPP_CONF_TYPE_BOOL) &&
+			is_connector_valid((configuration_t)key, connector_id,
+					false)) {
+		read_pool(&value, get_value_ptr_at((configuration_t)key,
+				connector_id), sizeof(value));
+	}
+
+	return value;
+}
+
+size_t ocpp_conf_get_str_at(ocpp_configuration_t key, int connector_id,
+		char *buf, size_t bufsize)
+{
+	size_t len = 0;
+
+	if (bufsize == 0) {
+		return 0;
+	}
+
+	if (is_type(key, OCPP_CONF_TYPE_STR) &&
+			is_connector_valid((configuration_t)key, connector_id,
+					false)) {
+		len = MIN(get_value_cap((configuration_t)key), bufsize - 1);
+		read_pool(buf, get_value_ptr_at((configuration_t)key,
+				connector_id), len);
+		len = strnlen(buf, len);
+	}
+
+	buf[len] = '\0';
+
+	return len;
+}
+
+int ocpp_conf_set_int_at(ocpp_configuration_t key, int connector_id,
+		int value)
+{
+	return set_value(key, connector_id, OCPP_CONF_TYPE_INT,
+			&value, sizeof(value));
+}
+
+int ocpp_conf_set_csl_at(ocpp_configuration_t key, int connector_id,
+		int value)
+{
+	return set_value(key, connector_id, OCPP_CONF_TYPE_CSL,
+			&value, sizeof(value));
+}
+
+int ocpp_conf_set_bool_at(ocpp_configuration_t key, int connector_id,
+		bool value)
+{
+	return set_value(key, connector_id, OCPP_CONF_TYPE_BOOL,
+			&value, sizeof(value));
+}
+
+int ocpp_conf_set_str_at(ocpp_configuration_t key, int connector_id,
+		const char *str)
+{
+	/* the terminating null is dropped when the string fills the cap. */
+	return set_value(key, connector_id, OCPP_CONF_TYPE_STR,
+			str, strlen(str));
+}
+
+size_t ocpp_count_configuration_connectors(const char * const keystr)
+{
+	const configuration_t key = get_key_from_keystr(keystr);
+
+	if (key == UnknownConfiguration) {
+		return 0;
+	}
+
+	return count_connectors(key);
+}
+
+static int stage(struct ocpp_configuration_transaction *tx,
+		configuration_t key, const void *value, size_t value_size,
+		bool check_access)
+{
+	int err = 0;
+
+	if (!is_valid(key) || value_size > get_value_cap(key)) {
+		err = -EINVAL;
+	} else if (check_access && !is_writable(key)) {
+		err = -EPERM;
+	} else if (tx->nr_entries >= OCPP_CONFIGURATION_TRANSACTION_MAX ||
+			value_size > sizeof(tx->data) - tx->datasize) {
+		err = -ENOSPC;
+	} else if (check_access) {
+		err = validate(key, value, value_size);
+	}
+
+	if (err) {
+		if (tx->err == 0) {
+			tx->err = err;
+		}
+		return err;
+	}
+
+	tx->entries[tx->nr_entries].key = (ocpp_configuration_t)key;
+	tx->entries[tx->nr_entries].offset = (uint16_t)tx->datasize;
+	tx->entries[tx->nr_entries].size = (uint8_t)value_size;
+	tx->nr_entries++;
+
+	memcpy(&tx->data[tx->datasize], value, value_size);
+	tx->datasize += value_size;
+
+	return 0;
+}
+
+void ocpp_begin_configuration_transaction(
+		struct ocpp_configuration_transaction *tx)
+{
+	tx->nr_entries = 0;
+	tx->datasize = 0;
+	tx->err = 0;
+}
+
+int ocpp_stage_configuration(struct ocpp_configuration_transaction *tx,
+		const char * const keystr, const void *value, size_t value_size)
+{
+	return stage(tx, get_key_from_keystr(keystr), value, value_size, true);
+}
+
+int ocpp_conf_stage(struct ocpp_configuration_transaction *tx,
+		ocpp_configuration_t key, const void *value, size_t value_size)
+{
+	return stage(tx, (configuration_t)key, value, value_size, false);
+}
+
+int ocpp_commit_configuration_transaction(
+		struct ocpp_configuration_transaction *tx)
+{
+	uint32_t changed[BITMAP_WORDS] = { 0, };
+	bool written = false;
+
+	if (tx->err) {
+		return tx->err;
+	}
+
+	ocpp_configuration_lock();
+
+	for (size_t i = 0; i < tx->nr_entries; i++) {
+		const configuration_t key = (configuration_t)tx->entries[i].key;
+		const uint8_t *value = &tx->data[tx->entries[i].offset];
+		const size_t value_size = tx->entries[i].size;
+
+		if (is_value_equal(key, 0, value, value_size)) {
+			continue;
+		}
+
+		if (!written) {
+			write_begin();
+			written = true;
+		}
+
+		write_value(key, 0, value, value_size);
+		set_dirty(dirty, key);
+		set_dirty(changed, key);
+	}
+
+	if (written) {
+		write_end();
+	}
+
+	ocpp_configuration_unlock();
+
+	notify(changed);
+
+	return 0;
+}
+
+int ocpp_subscribe_configuration(ocpp_configuration_t key,
+		ocpp_configuration_observer_t cb, void *cb_ctx)
+{
+	int rc = -ENOSPC;
+
+	if (cb == NULL || key > OCPP_CONF_MAX) {
+		return -EINVAL;
+	}
+
+	ocpp_configuration_lock();
+
+	for (int i = 0; i < OCPP_CONFIGURATION_OBSERVER_MAX; i++) {
+		struct observer *observer = &observers[i];
+
+		if (observer->callback == NULL) {
+			observer->key = key;
+			observer->ctx = cb_ctx;
+			observer->callback = cb;
+			rc = 0;
+			break;
+		}
+	}
+
+	ocpp_configuration_unlock();
+
+	return rc;
+}
+
+int ocpp_unsubscribe_configuration(ocpp_configuration_t key,
+		ocpp_configuration_observer_t cb, void *cb_ctx)
+{
+	int rc = -ENOENT;
+
+	ocpp_configuration_lock();
+
+	for (int i = 0; i < OCPP_CONFIGURATION_OBSERVER_MAX; i++) {
+		struct observer *observer = &observers[i];
+
+		if (observer->callback == cb && observer->ctx == cb_ctx &&
+				observer->key == key) {
+			memset(observer, 0, sizeof(*observer));
+			rc = 0;
+			break;
+		}
+	}
+
+	ocpp_configuration_unlock();
+
+	return rc;
+}
+
+bool ocpp_is_configuration_dirty(ocpp_configuration_t key)
+{
+	if (key >= OCPP_CONF_MAX) {
+		return false;
+	}
+
+	return !!(__atomic_load_n(&dirty[key / 32], __ATOMIC_RELAXED) &
+			(1u << (key % 32)));
+}
+
+void ocpp_clear_configuration_dirty(ocpp_configuration_t key)
+{
+	if (key >= OCPP_CONF_MAX) {
+		return;
+	}
+
+	__atomic_fetch_and(&dirty[key / 32], ~(1u << (key % 32)),
+			__ATOMIC_RELAXED);
+}
+
+ocpp_configuration_t ocpp_get_next_dirty_configuration(
+		ocpp_configuration_t from)
+{
+	for (uint32_t i = (uint32_t)from; i < (uint32_t)OCPP_CONF_MAX;) {
+		const uint32_t bits = __atomic_load_n(&dirty[i / 32],
+				__ATOMIC_RELAXED) & (~0u << (i % 32));
+
+		if (bits != 0) {
+			i = (i & ~31u) + (uint32_t)__builtin_ctz(bits);
+			return i < (uint32_t)OCPP_CONF_MAX?
+				(ocpp_configuration_t)i : OCPP_CONF_MAX;
+		}
+
+		i = (i & ~31u) + 32;
+	}
+
+	return OCPP_CONF_MAX;
+}
+
+bool ocpp_is_configuration_default(ocpp_configuration_t key)
+{
+	uint8_t value[UINT8_MAX];
+
+	if (key >= OCPP_CONF_MAX) {
+		return false;
+	}
+
+	const size_t cap = get_value_cap((configuration_t)key);
+	const size_t n = count_connectors((configuration_t)key);
+
+	for (size_t i = 0; i < n; i++) {
+		read_pool(value, get_value_ptr_at((configuration_t)key,
+				(int)i), cap);
+
+		if (memcmp(value, get_default_ptr((configuration_t)key) +
+				i * cap, cap) != 0) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+uint32_t ocpp_get_configuration_generation(void)
+{
+	return __atomic_load_n(&sequence, __ATOMIC_ACQUIRE) >> 1;
+}
+
+void ocpp_reset_configuration(void)
+{
+	uint32_t changed[BITMAP_WORDS];
+
+	ocpp_configuration_lock();
+
+	write_begin();
+	memcpy(configurations_pool, &default_image, sizeof(configurations_pool));
+	for (size_t i = 0; i < nr_runtime_keys; i++) {
+		memcpy(&arena[runtime_keys[i].value],
+				&arena[runtime_keys[i].default_value],
+				runtime_keys[i].cap);
+	}
+	write_end();
+
+	for (configuration_t key = 0; key < CONFIGURATION_MAX; key++) {
+		set_dirty(dirty, key);
+	}
+	memcpy(changed, dirty, sizeof(changed));
+
+	ocpp_configuration_unlock();
+
+	notify(changed);
+}
+
+static size_t get_cap_of(ocpp_configuration_data_t type, size_t size)
+{
+	switch (type) {
+	case OCPP_CONF_TYPE_INT: /* fall through */
+	case OCPP_CONF_TYPE_CSL:
+		return sizeof(int);
+	case OCPP_CONF_TYPE_BOOL:
+		return sizeof(bool);
+	case OCPP_CONF_TYPE_STR:
+		return size <= UINT8_MAX? size : 0;
+	case OCPP_CONF_TYPE_UNKNOWN: /* fall through */
+	default:
+		return 0;
+	}
+}
+
+static void add_runtime_key(const char * const keystr, size_t keylen,
+		ocpp_configuration_data_t type, size_t cap,
+		ocpp_configuration_access_t access, const void *default_value)
+{
+	struct runtime_key *rkey = &runtime_keys[nr_runtime_keys];
+
+	rkey->hash = hash_keystr(keystr);
+	rkey->keystr = (uint16_t)arena_used;
+	rkey->value = (uint16_t)(rkey->keystr + keylen);
+	rkey->default_value = (uint16_t)(rkey->value + cap);
+	rkey->cap = (uint8_t)cap;
+	rkey->type = (uint8_t)type;
+	rkey->access = (uint8_t)access;
+
+	arena_used += keylen + cap * 2;
+
+	memcpy(&arena[rkey->keystr], keystr, keylen);
+	memset(&arena[rkey->default_value], 0, cap);
+	if (default_value) {
+		memcpy(&arena[rkey->default_value], default_value,
+				type == OCPP_CONF_TYPE_STR?
+				strnlen((const char *)default_value, cap) : cap);
+	}
+	memcpy(&arena[rkey->value], &arena[rkey->default_value], cap);
+
+	__atomic_store_n(&nr_runtime_keys, nr_runtime_keys + 1,
+			__ATOMIC_RELEASE);
+}
+
+int ocpp_register_configuration(const char * const keystr,
+		ocpp_configuration_data_t type, size_t size,
+		ocpp_configuration_access_t access, const void *default_value)
+{
+	const size_t keylen = keystr? strnlen(keystr, KEYSTR_MAXLEN + 1) : 0;
+	const size_t cap = get_cap_of(type, size);
+	int err = 0;
+
+	const unsigned int unknown_access =
+		(unsigned int)access & ~(unsigned int)OCPP_CONF_ACCESS_RW;
+
+	if (keylen == 0 || keylen > KEYSTR_MAXLEN || cap == 0 ||
+			unknown_access != 0) {
+		return -EINVAL;
+	}
+
+	ocpp_configuration_lock();
+
+	if (get_key_from_keystr(keystr) != UnknownConfiguration) {
+		err = -EEXIST;
+	} else if (nr_runtime_keys >= OCPP_CONFIGURATION_REGISTRY_MAX ||
+			keylen + 1 + cap * 2 > sizeof(arena) - arena_used) {
+		err = -ENOSPC;
+	} else {
+		add_runtime_key(keystr, keylen + 1, type, cap, access,
+				default_value);
+	}
+
+	ocpp_configuration_unlock();
+
+	return err;
+}
+
+void ocpp_unregister_configurations(void)
+{
+	ocpp_configuration_lock();
+
+	__atomic_store_n(&nr_runtime_keys, 0, __ATOMIC_RELEASE);
+	arena_used = 0;
+
+	ocpp_configuration_unlock();
+}
+
+void ocpp_get_configuration_registry_usage(
+		struct ocpp_configuration_registry_usage *usage)
+{
+	ocpp_configuration_lock();
+
+	*usage = (struct ocpp_configuration_registry_usage) {
+		.nr_keys = nr_runtime_keys,
+		.max_keys = OCPP_CONFIGURATION_REGISTRY_MAX,
+		.arena_used = arena_used,
+		.arena_size = sizeof(arena),
+	};
 
 	ocpp_configuration_unlock();
 }
@@ -0,0 +1,257 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "ocpp/core/configuration_csl.h"
+#include <string.h>
+#include <errno.h>
+
+#define KEYSTR_MAXLEN			50
+#define MAXLENGTH_SUFFIX		"MaxLength"
+
+/* Members are found by a perfect hash: FNV-1a with a seed picked offline so
+ * that the top bits of the hash land every name in its own slot. The name
+ * in the slot is then compared once to reject unknown items. Re-pick the
+ * seed when changing the names. */
+struct vocabulary {
+	const char * const *names; /* in the bit order of the mask */
+	const uint8_t *slots; /* bit + 1, or 0 for an empty slot */
+	uint32_t seed;
+	uint8_t shift;
+	uint8_t nr_names;
+};
+
+static const char * const measurand_names[] = {
+	"Current.Export",
+	"Current.Import",
+	"Current.Offered",
+	"Energy.Active.Export.Register",
+	"Energy.Active.Import.Register",
+	"Energy.Reactive.Export.Register",
+	"Energy.Reactive.Import.Register",
+	"Energy.Active.Export.Interval",
+	"Energy.Active.Import.Interval",
+	"Energy.Reactive.Export.Interval",
+	"Energy.Reactive.Import.Interval",
+	"Frequency",
+	"Power.Active.Export",
+	"Power.Active.Import",
+	"Power.Factor",
+	"Power.Offered",
+	"Power.Reactive.Export",
+	"Power.Reactive.Import",
+	"RPM",
+	"SoC",
+	"Temperature",
+	"Voltage",
+};
+
+static const uint8_t measurand_slots[32] = {
+	0, 10, 17, 4, 21, 0, 12, 0, 2, 3, 6, 16, 0, 22, 18, 14,
+	11, 9, 5, 19, 0, 0, 7, 0, 0, 0, 1, 15, 13, 8, 0, 20,
+};
+
+static const char * const profile_names[] = {
+	"Core",
+	"FirmwareManagement",
+	"LocalAuthListManagement",
+	"Reservation",
+	"SmartCharging",
+	"RemoteTrigger",
+};
+
+static const uint8_t profile_slots[8] = {
+	1, 2, 0, 4, 6, 0, 5, 3,
+};
+
+static const struct vocabulary measurands = {
+	.names = measurand_names,
+	.slots = measurand_slots,
+	.seed = 0x42fa,
+	.shift = 32 - 5,
+	.nr_names = sizeof(measurand_names) / sizeof(*measurand_names),
+};
+
+static const struct vocabulary profiles = {
+	.names = profile_names,
+	.slots = profile_slots,
+	.seed = 0x6,
+	.shift = 32 - 3,
+	.nr_names = sizeof(profile_names) / sizeof(*profile_names),
+};
+
+static const struct {
+	const char *keystr;
+	const struct vocabulary *vocabulary;
+} lists[] = {
+	{ "MeterValuesAlignedData",	&measurands },
+	{ "MeterValuesSampledData",	&measurands },
+	{ "StopTxnAlignedData",		&measurands },
+	{ "StopTxnSampledData",		&measurands },
+	{ "SupportedFeatureProfiles",	&profiles },
+};
+
+static const struct vocabulary *get_vocabulary(const char * const keystr)
+{
+	for (size_t i = 0; i < sizeof(lists) / sizeof(*lists); i++) {
+		if (strcmp(keystr, lists[i].keystr) == 0) {
+			return lists[i].vocabulary;
+		}
+	}
+
+	return NULL;
+}
+
+static uint32_t hash_char(uint32_t hash, char c)
+{
+	return (hash ^ (uint8_t)c) * 16777619u;
+}
+
+static int find_member(const struct vocabulary *vocabulary,
+		const char *item, size_t len, uint32_t hash)
+{
+	const uint8_t slot = vocabulary->slots[hash >> vocabulary->shift];
+
+	if (slot == 0) {
+		return -EINVAL;
+	}
+
+	const char *name = vocabulary->names[slot - 1];
+
+	if (strncmp(name, item, len) != 0 || name[len] != '\0') {
+		return -EINVAL;
+	}
+
+	return slot - 1;
+}
+
+static int get_max_length(const char * const keystr)
+{
+	char maxlen_keystr[KEYSTR_MAXLEN + sizeof(MAXLENGTH_SUFFIX)];
+	const size_t len = strnlen(keystr, KEYSTR_MAXLEN);
+	int max = 0;
+
+	memcpy(maxlen_keystr, keystr, len);
+	memcpy(&maxlen_keystr[len], MAXLENGTH_SUFFIX, sizeof(MAXLENGTH_SUFFIX));
+
+	if (ocpp_get_configuration_data_type(maxlen_keystr) !=
+			OCPP_CONF_TYPE_INT ||
+			ocpp_get_configuration(maxlen_keystr,
+					&max, sizeof(max), NULL) != 0) {
+		return 0;
+	}
+
+	return max;
+}
+
+static bool is_space(char c)
+{
+	return c == ' ' || c == '\t';
+}
+
+int ocpp_decode_configuration_csl(const char * const keystr,
+		const char *csl, size_t len, int *mask)
+{
+	const struct vocabulary *vocabulary = get_vocabulary(keystr);
+	uint32_t bits = 0;
+
+	if (vocabulary == NULL) {
+		return -ENOTSUP;
+	}
+
+	/* A single pass over the list, hashing the item while looking for
+	 * its end. Trailing spaces are excluded by taking the hash and the
+	 * end at the last non-space character. */
+	size_t start = 0;
+	size_t end = 0;
+	uint32_t hash = vocabulary->seed;
+	uint32_t hash_at_end = hash;
+	bool empty = true;
+
+	for (size_t i = 0; i <= len; i++) {
+		if (i == len || csl[i] == ',') {
+			if (empty && (i < len || bits != 0)) {
+				return -EINVAL;
+			} else if (!empty) {
+				const int bit = find_member(vocabulary,
+						&csl[start], end - start,
+						hash_at_end);
+				if (bit < 0) {
+					return bit;
+				}
+				bits |= 1u << bit;
+			}
+
+			hash = hash_at_end = vocabulary->seed;
+			empty = true;
+			continue;
+		}
+
+		if (empty) {
+			if (is_space(csl[i])) {
+				continue;
+			}
+			start = i;
+			empty = false;
+		}
+
+		hash = hash_char(hash, csl[i]);
+
+		if (!is_space(csl[i])) {
+			hash_at_end = hash;
+			end = i + 1;
+		}
+	}
+
+	const int nr_members = __builtin_popcount(bits);
+	const int max = get_max_length(keystr);
+
+	if (max > 0 && nr_members > max) {
+		return -E2BIG;
+	}
+
+	*mask = (int)bits;
+
+	return nr_members;
+}
+
+int ocpp_encode_configuration_csl(const char * const keystr,
+		int mask, char *buf, size_t bufsize)
+{
+	const struct vocabulary *vocabulary = get_vocabulary(keystr);
+	size_t len = 0;
+
+	if (vocabulary == NULL) {
+		return -ENOTSUP;
+	}
+	if (bufsize == 0) {
+		return -ENOBUFS;
+	}
+
+	for (uint8_t bit = 0; bit < vocabulary->nr_names; bit++) {
+		if (!((unsigned int)mask & (1u << bit))) {
+			continue;
+		}
+
+		const char *name = vocabulary->names[bit];
+		const size_t namelen = strlen(name);
+		const size_t sep = len? 1 : 0;
+
+		if (len + sep + namelen >= bufsize) {
+			buf[0] = '\0';
+			return -ENOBUFS;
+		}
+
+		if (sep) {
+			buf[len++] = ',';
+		}
+		memcpy(&buf[len], name, namelen);
+		len += namelen;
+	}
+
+	buf[len] = '\0';
+
+	return (int)len;
+}
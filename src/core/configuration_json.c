@@ -0,0 +1,590 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "ocpp/core/configuration_json.h"
+#include "ocpp/core/configuration_csl.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+enum {
+	ST_BEGIN,		/* expecting '[' */
+	ST_OBJECT_OR_END,	/* expecting '{' or ']' */
+	ST_OBJECT,		/* expecting '{' */
+	ST_NAME_OR_END,		/* expecting '"' or '}' */
+	ST_NAME_BEGIN,		/* expecting '"' */
+	ST_NAME,		/* in member name */
+	ST_COLON,		/* expecting ':' */
+	ST_VALUE,		/* expecting a value */
+	ST_STRING,		/* in string value */
+	ST_LITERAL,		/* in number, true, false or null */
+	ST_MEMBER_END,		/* expecting ',' or '}' */
+	ST_OBJECT_END,		/* expecting ',' or ']' */
+	ST_DONE,
+	ST_ERROR,
+};
+
+enum {
+	FIELD_OTHER,
+	FIELD_KEY,
+	FIELD_VALUE,
+};
+
+enum {
+	KIND_STRING,
+	KIND_LITERAL,
+};
+
+enum {
+	ESC_NONE,
+	ESC_BEGIN,
+	ESC_HEX1,
+	ESC_HEX2,
+	ESC_HEX3,
+	ESC_HEX4,
+};
+
+struct sink {
+	char *buf;
+	size_t bufsize;
+	size_t len; /* counts beyond bufsize to tell the overflow */
+	size_t skip;
+};
+
+static void put_char(struct sink *sink, char c)
+{
+	if (sink->skip) {
+		sink->skip--;
+		return;
+	}
+
+	if (sink->len < sink->bufsize) {
+		sink->buf[sink->len] = c;
+	}
+
+	sink->len++;
+}
+
+static void put_str(struct sink *sink, const char *str)
+{
+	while (*str) {
+		put_char(sink, *str++);
+	}
+}
+
+static void put_escaped(struct sink *sink, const char *str)
+{
+	static const char hex[] = "0123456789abcdef";
+
+	for (; *str; str++) {
+		const uint8_t c = (uint8_t)*str;
+
+		if (c == '"' || c == '\\') {
+			put_char(sink, '\\');
+			put_char(sink, (char)c);
+		} else if (c < 0x20) {
+			put_str(sink, "\\u00");
+			put_char(sink, hex[c >> 4]);
+			put_char(sink, hex[c & 0xf]);
+		} else {
+			put_char(sink, (char)c);
+		}
+	}
+}
+
+/* Read by index rather than by `ocpp_configuration_t` to cover the keys
+ * registered at runtime as well. */
+static void put_value(struct sink *sink, int index, const char *keystr,
+		ocpp_configuration_data_t type)
+{
+	char str[OCPP_CONFIGURATION_JSON_VALUE_MAXLEN] = { 0, };
+	bool b = false;
+	int v = 0;
+
+	switch (type) {
+	case OCPP_CONF_TYPE_BOOL:
+		ocpp_get_configuration_by_index(index, &b, sizeof(b), NULL);
+		put_str(sink, b? "true" : "false");
+		return;
+	case OCPP_CONF_TYPE_CSL:
+		ocpp_get_configuration_by_index(index, &v, sizeof(v), NULL);
+		/* as the list of names in GetConfiguration if it is one */
+		if (ocpp_encode_configuration_csl(keystr,
+				v, str, sizeof(str)) < 0) {
+			snprintf(str, sizeof(str), "%d", v);
+		}
+		break;
+	case OCPP_CONF_TYPE_INT:
+		ocpp_get_configuration_by_index(index, &v, sizeof(v), NULL);
+		snprintf(str, sizeof(str), "%d", v);
+		break;
+	case OCPP_CONF_TYPE_STR:
+		ocpp_get_configuration_by_index(index, str, sizeof(str) - 1,
+				NULL);
+		break;
+	case OCPP_CONF_TYPE_UNKNOWN:
+	default:
+		str[0] = '\0';
+		break;
+	}
+
+	put_escaped(sink, str);
+}
+
+static void put_key(struct sink *sink, int index, bool first)
+{
+	const char *keystr = ocpp_get_configuration_keystr_from_index(index);
+
+	put_char(sink, first? '[' : ',');
+	put_str(sink, "{\"key\":\"");
+	put_escaped(sink, keystr);
+	put_str(sink, "\",\"readonly\":");
+	put_str(sink, ocpp_is_configuration_writable(keystr)? "false" : "true");
+	put_str(sink, ",\"value\":");
+
+	const ocpp_configuration_data_t type =
+		ocpp_get_configuration_data_type(keystr);
+
+	if (type != OCPP_CONF_TYPE_BOOL) {
+		put_char(sink, '"');
+	}
+	put_value(sink, index, keystr, type);
+	if (type != OCPP_CONF_TYPE_BOOL) {
+		put_char(sink, '"');
+	}
+
+	put_char(sink, '}');
+}
+
+int ocpp_export_configuration_json(struct ocpp_configuration_json_writer *writer,
+		char *buf, size_t bufsize)
+{
+	const int nr_keys = (int)ocpp_count_configurations();
+	struct sink sink = { .buf = buf, .bufsize = bufsize, };
+
+	if (writer == NULL || buf == NULL || bufsize == 0) {
+		return -EINVAL;
+	}
+
+	while (writer->index <= nr_keys && sink.len < bufsize) {
+		const size_t start = sink.len;
+		const char *keystr =
+			ocpp_get_configuration_keystr_from_index(writer->index);
+
+		if (writer->index < nr_keys &&
+				!ocpp_is_configuration_readable(keystr)) {
+			writer->index++;
+			continue;
+		}
+
+		/* A key written in pieces is rendered again on every call, so
+		 * its value must not change in the middle. */
+		if (writer->offset == 0) {
+			writer->generation = ocpp_get_configuration_generation();
+		} else if (writer->generation !=
+				ocpp_get_configuration_generation()) {
+			return -ESTALE;
+		}
+
+		sink.skip = writer->offset;
+
+		if (writer->index < nr_keys) {
+			put_key(&sink, writer->index, writer->emitted == 0);
+		} else {
+			put_str(&sink, writer->emitted == 0? "[]" : "]");
+		}
+
+		if (sink.len > bufsize) {
+			writer->offset += bufsize - start;
+			sink.len = bufsize;
+			break;
+		}
+
+		writer->offset = 0;
+		writer->emitted++;
+		writer->index++;
+	}
+
+	return (int)sink.len;
+}
+
+static bool parse_int(const char *str, int *value)
+{
+	const bool negative = *str == '-';
+	long long v = 0;
+
+	if (negative) {
+		str++;
+	}
+
+	if (*str == '\0') {
+		return false;
+	}
+
+	for (; *str; str++) {
+		if (*str < '0' || *str > '9') {
+			return false;
+		}
+
+		v = v * 10 + (*str - '0');
+
+		if (v > (long long)INT32_MAX + 1) {
+			return false;
+		}
+	}
+
+	v = negative? -v : v;
+
+	if (v > INT32_MAX) {
+		return false;
+	}
+
+	*value = (int)v;
+
+	return true;
+}
+
+/* Keys registered at runtime have no `ocpp_configuration_t`, so they are set
+ * by the key string, honoring their accessibility. */
+static int apply_runtime(const struct ocpp_configuration_json_reader *reader,
+		const void *value, size_t value_size)
+{
+	return ocpp_set_configuration(reader->key, value, value_size);
+}
+
+static int apply(const struct ocpp_configuration_json_reader *reader)
+{
+	const ocpp_configuration_t key = ocpp_conf_from_keystr(reader->key);
+	const bool runtime = key == OCPP_CONF_MAX;
+	int value;
+
+	switch (ocpp_get_configuration_data_type(reader->key)) {
+	case OCPP_CONF_TYPE_BOOL:
+		if (strcmp(reader->value, "true") == 0 ||
+				strcmp(reader->value, "false") == 0) {
+			const bool b = reader->value[0] == 't';
+			return runtime? apply_runtime(reader, &b, sizeof(b)) :
+				ocpp_conf_set_bool(key, b);
+		}
+		break;
+	case OCPP_CONF_TYPE_INT:
+		if (parse_int(reader->value, &value)) {
+			return runtime? apply_runtime(reader, &value, sizeof(value)) :
+				ocpp_conf_set_int(key, value);
+		}
+		break;
+	case OCPP_CONF_TYPE_CSL:
+		if (parse_int(reader->value, &value) ||
+				(reader->value_kind == KIND_STRING &&
+				ocpp_decode_configuration_csl(reader->key,
+						reader->value,
+						strlen(reader->value),
+						&value) >= 0)) {
+			return runtime? apply_runtime(reader, &value, sizeof(value)) :
+				ocpp_conf_set_csl(key, value);
+		}
+		break;
+	case OCPP_CONF_TYPE_STR:
+		if (reader->value_kind == KIND_STRING) {
+			return runtime? apply_runtime(reader, reader->value,
+					strlen(reader->value)) :
+				ocpp_conf_set_str(key, reader->value);
+		}
+		break;
+	case OCPP_CONF_TYPE_UNKNOWN:
+	default:
+		break;
+	}
+
+	return -EINVAL;
+}
+
+static void end_object(struct ocpp_configuration_json_reader *reader)
+{
+	if (reader->has_key && reader->has_value &&
+			!(reader->value_kind == KIND_LITERAL &&
+					strcmp(reader->value, "null") == 0) &&
+			apply(reader) == 0) {
+		reader->applied++;
+	} else {
+		reader->rejected++;
+	}
+}
+
+static char *get_token_buffer(struct ocpp_configuration_json_reader *reader,
+		size_t *bufsize)
+{
+	switch (reader->state) {
+	case ST_NAME:
+		*bufsize = sizeof(reader->name);
+		return reader->name;
+	case ST_STRING: /* fall through */
+	case ST_LITERAL:
+		if (reader->field == FIELD_KEY) {
+			*bufsize = sizeof(reader->key);
+			return reader->key;
+		} else if (reader->field == FIELD_VALUE) {
+			*bufsize = sizeof(reader->value);
+			return reader->value;
+		}
+		break;
+	default:
+		break;
+	}
+
+	return NULL;
+}
+
+static void put_token(struct ocpp_configuration_json_reader *reader, char c)
+{
+	size_t bufsize = 0;
+	char *buf = get_token_buffer(reader, &bufsize);
+
+	if (buf == NULL) {
+		return;
+	}
+
+	if ((size_t)reader->len + 1 < bufsize) {
+		buf[reader->len] = c;
+		buf[reader->len + 1] = '\0';
+	} else if (reader->state != ST_NAME) {
+		/* an oversized value is never valid */
+		reader->field = FIELD_OTHER;
+		reader->has_value = false;
+	}
+
+	reader->len++;
+}
+
+static void put_codepoint(struct ocpp_configuration_json_reader *reader,
+		uint16_t cp)
+{
+	if (cp < 0x80) {
+		put_token(reader, (char)cp);
+	} else if (cp < 0x800) {
+		put_token(reader, (char)(0xc0 | (cp >> 6)));
+		put_token(reader, (char)(0x80 | (cp & 0x3f)));
+	} else {
+		put_token(reader, (char)(0xe0 | (cp >> 12)));
+		put_token(reader, (char)(0x80 | ((cp >> 6) & 0x3f)));
+		put_token(reader, (char)(0x80 | (cp & 0x3f)));
+	}
+}
+
+static int hexval(char c)
+{
+	if (c >= '0' && c <= '9') {
+		return c - '0';
+	} else if (c >= 'a' && c <= 'f') {
+		return c - 'a' + 10;
+	} else if (c >= 'A' && c <= 'F') {
+		return c - 'A' + 10;
+	}
+
+	return -1;
+}
+
+static bool parse_escape(struct ocpp_configuration_json_reader *reader, char c)
+{
+	if (reader->escape == ESC_BEGIN) {
+		const char *from = "\"\\/bfnrt";
+		const char *to = "\"\\/\b\f\n\r\t";
+		const char *p = c? strchr(from, c) : NULL;
+
+		if (c == 'u') {
+			reader->escape = ESC_HEX1;
+			reader->unicode = 0;
+			return true;
+		} else if (p == NULL) {
+			return false;
+		}
+
+		put_token(reader, to[p - from]);
+		reader->escape = ESC_NONE;
+		return true;
+	}
+
+	const int v = hexval(c);
+
+	if (v < 0) {
+		return false;
+	}
+
+	reader->unicode = (uint16_t)((reader->unicode << 4) | v);
+
+	if (reader->escape++ == ESC_HEX4) {
+		put_codepoint(reader, reader->unicode);
+		reader->escape = ESC_NONE;
+	}
+
+	return true;
+}
+
+static bool is_space(char c)
+{
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static bool is_literal(char c)
+{
+	return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') ||
+		c == '-' || c == '+' || c == '.' || c == 'E';
+}
+
+static void begin_token(struct ocpp_configuration_json_reader *reader,
+		uint8_t state)
+{
+	reader->state = state;
+	reader->len = 0;
+
+	size_t bufsize = 0;
+	char *buf = get_token_buffer(reader, &bufsize);
+
+	if (buf) {
+		buf[0] = '\0';
+	}
+}
+
+static void end_name(struct ocpp_configuration_json_reader *reader)
+{
+	reader->field = FIELD_OTHER;
+
+	if (reader->len >= sizeof(reader->name)) {
+		return;
+	} else if (strcmp(reader->name, "key") == 0) {
+		reader->field = FIELD_KEY;
+	} else if (strcmp(reader->name, "value") == 0) {
+		reader->field = FIELD_VALUE;
+	}
+}
+
+static void end_value(struct ocpp_configuration_json_reader *reader,
+		uint8_t kind)
+{
+	if (reader->field == FIELD_KEY) {
+		reader->has_key = kind == KIND_STRING;
+	} else if (reader->field == FIELD_VALUE) {
+		reader->has_value = true;
+		reader->value_kind = kind;
+	}
+
+	reader->state = ST_MEMBER_END;
+}
+
+static uint8_t parse_char(struct ocpp_configuration_json_reader *reader, char c)
+{
+	switch (reader->state) {
+	case ST_NAME: /* fall through */
+	case ST_STRING:
+		if (reader->escape != ESC_NONE) {
+			return parse_escape(reader, c)? reader->state : ST_ERROR;
+		} else if (c == '\\') {
+			reader->escape = ESC_BEGIN;
+		} else if (c == '"') {
+			if (reader->state == ST_NAME) {
+				end_name(reader);
+				return ST_COLON;
+			}
+			end_value(reader, KIND_STRING);
+		} else if ((uint8_t)c < 0x20) {
+			return ST_ERROR;
+		} else {
+			put_token(reader, c);
+		}
+		return reader->state;
+	case ST_LITERAL:
+		if (is_literal(c)) {
+			put_token(reader, c);
+			return ST_LITERAL;
+		}
+		end_value(reader, KIND_LITERAL);
+		return parse_char(reader, c);
+	default:
+		break;
+	}
+
+	if (is_space(c)) {
+		return reader->state;
+	}
+
+	switch (reader->state) {
+	case ST_BEGIN:
+		return c == '['? ST_OBJECT_OR_END : ST_ERROR;
+	case ST_OBJECT_OR_END:
+		if (c == ']') {
+			return ST_DONE;
+		} /* fall through */
+	case ST_OBJECT:
+		if (c != '{') {
+			return ST_ERROR;
+		}
+		reader->has_key = false;
+		reader->has_value = false;
+		return ST_NAME_OR_END;
+	case ST_NAME_OR_END:
+		if (c == '}') {
+			end_object(reader);
+			return ST_OBJECT_END;
+		} /* fall through */
+	case ST_NAME_BEGIN:
+		if (c != '"') {
+			return ST_ERROR;
+		}
+		begin_token(reader, ST_NAME);
+		return ST_NAME;
+	case ST_COLON:
+		return c == ':'? ST_VALUE : ST_ERROR;
+	case ST_VALUE:
+		if (c == '"') {
+			begin_token(reader, ST_STRING);
+			return ST_STRING;
+		} else if (is_literal(c)) {
+			begin_token(reader, ST_LITERAL);
+			put_token(reader, c);
+			return ST_LITERAL;
+		}
+		return ST_ERROR;
+	case ST_MEMBER_END:
+		if (c == ',') {
+			return ST_NAME_BEGIN;
+		} else if (c == '}') {
+			end_object(reader);
+			return ST_OBJECT_END;
+		}
+		return ST_ERROR;
+	case ST_OBJECT_END:
+		if (c == ',') {
+			return ST_OBJECT;
+		}
+		return c == ']'? ST_DONE : ST_ERROR;
+	case ST_DONE: /* fall through */
+	default:
+		return ST_ERROR;
+	}
+}
+
+int ocpp_import_configuration_json(struct ocpp_configuration_json_reader *reader,
+		const void *chunk, size_t chunksize)
+{
+	const char *p = (const char *)chunk;
+
+	if (reader == NULL || (chunk == NULL && chunksize > 0)) {
+		return -EINVAL;
+	}
+
+	for (size_t i = 0; i < chunksize && reader->state != ST_ERROR; i++) {
+		reader->state = parse_char(reader, p[i]);
+	}
+
+	switch (reader->state) {
+	case ST_DONE:
+		return 0;
+	case ST_ERROR:
+		return -EBADMSG;
+	default:
+		return -EAGAIN;
+	}
+}
@@ -0,0 +1,560 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "ocpp/core/configuration_store.h"
+#include "ocpp/overrides.h"
+#include <string.h>
+#include <errno.h>
+
+#if !defined(OCPP_CONFIGURATION_STORE_SECTOR_SIZE)
+#define OCPP_CONFIGURATION_STORE_SECTOR_SIZE	4096
+#endif
+
+#if !defined(OCPP_CONFIGURATION_STORE_ALIGN)
+#define OCPP_CONFIGURATION_STORE_ALIGN		4
+#endif
+
+#if !defined(MIN)
+#define MIN(a, b)			(((a) > (b))? (b) : (a))
+#endif
+
+#define SECTOR_SIZE			OCPP_CONFIGURATION_STORE_SECTOR_SIZE
+#define ALIGN				OCPP_CONFIGURATION_STORE_ALIGN
+#define ALIGN_UP(x)			(((x) + ALIGN - 1) & ~((size_t)ALIGN - 1))
+
+#define MAGIC				0x5350434fu /* "OCPS" */
+#define ERASED_LEN			0xffffu
+#define STAGE_LEN			64
+#define DATA_OFFSET			ALIGN_UP(sizeof(struct sector_header))
+
+_Static_assert(ALIGN > 0 && (ALIGN & (ALIGN - 1)) == 0 && ALIGN <= STAGE_LEN,
+		"alignment must be a power of 2 up to 64");
+_Static_assert(SECTOR_SIZE % ALIGN == 0, "misaligned sector size");
+
+/* A sector begins with the header and is followed by records, each of which
+ * holds the keys saved at once as `[key][size][value]` entries. A key defined
+ * per connector has consecutive entries from connector 0. The header is
+ * written last when a sector gets filled, so that a torn compaction leaves
+ * the previous sector active. */
+struct sector_header {
+	uint32_t magic;
+	uint32_t seq;
+	uint32_t fingerprint;
+	uint32_t crc;
+};
+
+struct record_header {
+	uint16_t len;
+	uint16_t len_inv;
+	uint32_t crc; /* of the entries followed by len */
+};
+
+/* Combines small writes into aligned ones. It only counts the length and
+ * computes the CRC when dry. */
+struct stage {
+	size_t offset;
+	uint8_t buf[STAGE_LEN];
+	size_t len;
+	size_t total;
+	uint32_t crc;
+	bool dry;
+	int err;
+};
+
+static struct {
+	int sector; /* active sector, -1 if none */
+	uint32_t seq;
+	size_t offset; /* where the next record goes in the active sector */
+	bool scanned;
+} store = {
+	.sector = -1,
+};
+
+static uint32_t crc32_update(uint32_t crc, const void *data, size_t len)
+{
+	static const uint32_t table[16] = {
+		0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac,
+		0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c,
+		0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c,
+		0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c,
+	};
+	const uint8_t *p = (const uint8_t *)data;
+
+	crc = ~crc;
+
+	for (size_t i = 0; i < len; i++) {
+		crc = table[(crc ^ p[i]) & 0xf] ^ (crc >> 4);
+		crc = table[(crc ^ (uint32_t)(p[i] >> 4)) & 0xf] ^ (crc >> 4);
+	}
+
+	return ~crc;
+}
+
+/* Tells apart the logs of different `OCPP_CONFIGURATION_DEFINES`. The keys
+ * registered at runtime are not saved, so they are left out not to tell the
+ * log apart by them. */
+static uint32_t compute_fingerprint(void)
+{
+	uint32_t crc = 0;
+
+	for (int i = 0; i < (int)OCPP_CONF_MAX; i++) {
+		const char *keystr = ocpp_get_configuration_keystr_from_index(i);
+		const ocpp_configuration_data_t type =
+			ocpp_get_configuration_data_type(keystr);
+		const size_t size = ocpp_get_configuration_size(keystr);
+		const uint8_t attr[2] = { (uint8_t)type, (uint8_t)size, };
+		const uint8_t connectors =
+			(uint8_t)ocpp_count_configuration_connectors(keystr);
+
+		crc = crc32_update(crc, keystr, strlen(keystr));
+		crc = crc32_update(crc, attr, sizeof(attr));
+
+		/* only when per connector, not to lose the logs saved before
+		 * the connectors came in. */
+		if (connectors > 1) {
+			crc = crc32_update(crc, &connectors, sizeof(connectors));
+		}
+	}
+
+	return crc;
+}
+
+static size_t get_sector_base(int sector)
+{
+	return (size_t)sector * SECTOR_SIZE;
+}
+
+static void stage_put(struct stage *stage, const void *data, size_t len)
+{
+	const uint8_t *p = (const uint8_t *)data;
+
+	stage->total += len;
+
+	if (stage->dry) {
+		return;
+	}
+
+	while (len > 0) {
+		const size_t n = MIN(len, STAGE_LEN - stage->len);
+
+		memcpy(&stage->buf[stage->len], p, n);
+		stage->len += n;
+		p += n;
+		len -= n;
+
+		if (stage->len == STAGE_LEN) {
+			if (stage->err == 0) {
+				stage->err = ocpp_configuration_storage_write(
+						stage->offset,
+						stage->buf, STAGE_LEN);
+			}
+			stage->offset += STAGE_LEN;
+			stage->len = 0;
+		}
+	}
+}
+
+static void stage_put_payload(struct stage *stage, const void *data, size_t len)
+{
+	stage->crc = crc32_update(stage->crc, data, len);
+	stage_put(stage, data, len);
+}
+
+static int stage_flush(struct stage *stage)
+{
+	if (!stage->dry && stage->len > 0) {
+		const size_t len = ALIGN_UP(stage->len);
+
+		memset(&stage->buf[stage->len], 0, len - stage->len);
+
+		if (stage->err == 0) {
+			stage->err = ocpp_configuration_storage_write(
+					stage->offset, stage->buf, len);
+		}
+	}
+
+	return stage->err;
+}
+
+/* Returns the length of the value read, which is the one of the string
+ * for STR. */
+static size_t read_value(ocpp_configuration_t key, int connector_id,
+		uint8_t *value, size_t cap)
+{
+	const char *keystr = ocpp_get_configuration_keystr_from_index((int)key);
+	int v;
+
+	switch (ocpp_get_configuration_data_type(keystr)) {
+	case OCPP_CONF_TYPE_INT:
+		v = ocpp_conf_get_int_at(key, connector_id);
+		memcpy(value, &v, sizeof(v));
+		return sizeof(v);
+	case OCPP_CONF_TYPE_CSL:
+		v = ocpp_conf_get_csl_at(key, connector_id);
+		memcpy(value, &v, sizeof(v));
+		return sizeof(v);
+	case OCPP_CONF_TYPE_BOOL:
+		value[0] = ocpp_conf_get_bool_at(key, connector_id);
+		return sizeof(bool);
+	case OCPP_CONF_TYPE_STR:
+		return ocpp_conf_get_str_at(key, connector_id,
+				(char *)value, cap + 1/*null*/);
+	case OCPP_CONF_TYPE_UNKNOWN:
+	default:
+		return 0;
+	}
+}
+
+/* A snapshot holds the values differing from the defaults, since the log
+ * is replayed on top of them. Otherwise the dirty ones. */
+static void put_entries(struct stage *stage, bool snapshot)
+{
+	uint8_t value[UINT8_MAX + 1/*null*/];
+
+	for (ocpp_configuration_t key = 0; key < OCPP_CONF_MAX; key++) {
+		if (snapshot? ocpp_is_configuration_default(key) :
+				!ocpp_is_configuration_dirty(key)) {
+			continue;
+		}
+
+		const char *keystr =
+			ocpp_get_configuration_keystr_from_index((int)key);
+		const size_t cap = ocpp_get_configuration_size(keystr);
+		const size_t n = ocpp_count_configuration_connectors(keystr);
+
+		for (size_t i = 0; i < n; i++) {
+			const uint8_t entry[2] = {
+				(uint8_t)key,
+				(uint8_t)read_value(key, (int)i, value, cap),
+			};
+
+			stage_put_payload(stage, entry, sizeof(entry));
+			stage_put_payload(stage, value, entry[1]);
+		}
+	}
+}
+
+/* Returns the number of bytes the record takes in the sector. */
+static size_t measure_record(bool snapshot)
+{
+	struct stage stage = { .dry = true, };
+
+	put_entries(&stage, snapshot);
+
+	return ALIGN_UP(sizeof(struct record_header) + stage.total);
+}
+
+static int write_record(size_t offset, bool snapshot)
+{
+	struct stage dry = { .dry = true, };
+	struct stage stage = { .offset = offset, };
+
+	put_entries(&dry, snapshot);
+
+	if (dry.total >= ERASED_LEN) {
+		return -ENOSPC;
+	}
+
+	const uint16_t len = (uint16_t)dry.total;
+	const struct record_header rec = {
+		.len = len,
+		.len_inv = (uint16_t)~len,
+		.crc = crc32_update(dry.crc, &len, sizeof(len)),
+	};
+
+	stage_put(&stage, &rec, sizeof(rec));
+	put_entries(&stage, snapshot);
+
+	return stage_flush(&stage);
+}
+
+static int write_sector_header(int sector, uint32_t seq)
+{
+	struct sector_header header = {
+		.magic = MAGIC,
+		.seq = seq,
+		.fingerprint = compute_fingerprint(),
+	};
+	struct stage stage = { .offset = get_sector_base(sector), };
+
+	header.crc = crc32_update(0, &header, offsetof(struct sector_header, crc));
+
+	stage_put(&stage, &header, sizeof(header));
+
+	return stage_flush(&stage);
+}
+
+/* Writes a snapshot to the other sector as a fresh log. */
+static int compact(void)
+{
+	const int sector = store.sector == 0? 1 : 0;
+	const size_t len = measure_record(true);
+	int err;
+
+	if (DATA_OFFSET + len > SECTOR_SIZE) {
+		return -ENOSPC;
+	}
+
+	if ((err = ocpp_configuration_storage_erase(get_sector_base(sector),
+			SECTOR_SIZE)) != 0 ||
+			(err = write_record(get_sector_base(sector) + DATA_OFFSET,
+					true)) != 0 ||
+			(err = write_sector_header(sector, store.seq + 1)) != 0) {
+		/* leave it to the next save to start over */
+		store.offset = SECTOR_SIZE;
+		return err;
+	}
+
+	store.sector = sector;
+	store.seq++;
+	store.offset = DATA_OFFSET + len;
+
+	return 0;
+}
+
+static int read_sector_header(int sector, struct sector_header *header)
+{
+	int err = ocpp_configuration_storage_read(get_sector_base(sector),
+			header, sizeof(*header));
+
+	if (err) {
+		return err;
+	}
+
+	if (header->magic != MAGIC || header->crc != crc32_update(0, header,
+			offsetof(struct sector_header, crc))) {
+		return -ENOENT;
+	}
+
+	return 0;
+}
+
+static int compute_record_crc(size_t offset, uint16_t len, uint32_t *crc)
+{
+	uint8_t buf[STAGE_LEN];
+
+	*crc = 0;
+
+	for (size_t i = 0; i < len; i += sizeof(buf)) {
+		const size_t n = MIN(sizeof(buf), (size_t)len - i);
+		int err = ocpp_configuration_storage_read(offset + i, buf, n);
+
+		if (err) {
+			return err;
+		}
+
+		*crc = crc32_update(*crc, buf, n);
+	}
+
+	*crc = crc32_update(*crc, &len, sizeof(len));
+
+	return 0;
+}
+
+static void restore_value(ocpp_configuration_t key, int connector_id,
+		uint8_t *value, size_t len)
+{
+	const char *keystr = ocpp_get_configuration_keystr_from_index((int)key);
+	const size_t cap = ocpp_get_configuration_size(keystr);
+	int v;
+
+	switch (ocpp_get_configuration_data_type(keystr)) {
+	case OCPP_CONF_TYPE_INT:
+		if (len == sizeof(v)) {
+			memcpy(&v, value, sizeof(v));
+			ocpp_conf_set_int_at(key, connector_id, v);
+		}
+		break;
+	case OCPP_CONF_TYPE_CSL:
+		if (len == sizeof(v)) {
+			memcpy(&v, value, sizeof(v));
+			ocpp_conf_set_csl_at(key, connector_id, v);
+		}
+		break;
+	case OCPP_CONF_TYPE_BOOL:
+		if (len == sizeof(bool)) {
+			ocpp_conf_set_bool_at(key, connector_id,
+					value[0] != 0);
+		}
+		break;
+	case OCPP_CONF_TYPE_STR:
+		if (len <= cap) {
+			value[len] = '\0';
+			ocpp_conf_set_str_at(key, connector_id,
+					(const char *)value);
+		}
+		break;
+	case OCPP_CONF_TYPE_UNKNOWN:
+	default:
+		break;
+	}
+}
+
+static int restore_record(size_t offset, uint16_t len)
+{
+	uint8_t value[UINT8_MAX + 1/*null*/];
+	const size_t end = offset + len;
+	uint8_t last_key = UINT8_MAX;
+	int connector_id = 0;
+
+	while (offset + 2 <= end) {
+		uint8_t entry[2];
+		int err = ocpp_configuration_storage_read(offset,
+				entry, sizeof(entry));
+
+		if (err == 0 && offset + 2 + entry[1] <= end) {
+			err = ocpp_configuration_storage_read(offset + 2,
+					value, entry[1]);
+		}
+		if (err) {
+			return err;
+		}
+
+		if (entry[0] < OCPP_CONF_MAX) {
+			connector_id = entry[0] == last_key? connector_id + 1 : 0;
+			last_key = entry[0];
+			restore_value((ocpp_configuration_t)entry[0],
+					connector_id, value, entry[1]);
+		}
+
+		offset += 2 + (size_t)entry[1];
+	}
+
+	return 0;
+}
+
+/* Walks the records of the active sector to find the end of the log,
+ * restoring the values on the way if asked. */
+static int replay(bool restore)
+{
+	const size_t base = get_sector_base(store.sector);
+	size_t offset = DATA_OFFSET;
+
+	while (offset + sizeof(struct record_header) <= SECTOR_SIZE) {
+		struct record_header rec;
+		uint32_t crc;
+		int err = ocpp_configuration_storage_read(base + offset,
+				&rec, sizeof(rec));
+
+		if (err) {
+			return err;
+		}
+
+		if (rec.len == ERASED_LEN && rec.len_inv == ERASED_LEN) {
+			store.offset = offset;
+			return 0;
+		}
+
+		if ((rec.len ^ rec.len_inv) != ERASED_LEN || offset +
+				sizeof(rec) + rec.len > SECTOR_SIZE) {
+			break;
+		}
+
+		if ((err = compute_record_crc(base + offset + sizeof(rec),
+				rec.len, &crc)) != 0) {
+			return err;
+		}
+		if (crc != rec.crc) {
+			break;
+		}
+
+		if (restore && (err = restore_record(base + offset + sizeof(rec),
+				rec.len)) != 0) {
+			return err;
+		}
+
+		offset += ALIGN_UP(sizeof(rec) + rec.len);
+	}
+
+	/* full or a torn record on the way, which cannot be written over. The
+	 * next save starts a fresh log in the other sector. */
+	store.offset = SECTOR_SIZE;
+
+	return 0;
+}
+
+static int scan(bool restore)
+{
+	const uint32_t fingerprint = compute_fingerprint();
+	struct sector_header header;
+
+	store.sector = -1;
+	store.seq = 0;
+	store.offset = SECTOR_SIZE;
+	store.scanned = true;
+
+	for (int i = 0; i < 2; i++) {
+		int err = read_sector_header(i, &header);
+
+		if (err == -ENOENT) {
+			continue;
+		} else if (err) {
+			return err;
+		}
+
+		if (store.sector < 0 || (int32_t)(header.seq - store.seq) > 0) {
+			store.seq = header.seq;
+			store.sector = header.fingerprint == fingerprint? i : -1;
+		}
+	}
+
+	if (store.sector < 0) {
+		return -ENOENT;
+	}
+
+	return replay(restore);
+}
+
+int ocpp_load_configuration(void)
+{
+	int err;
+
+	ocpp_reset_configuration();
+
+	err = scan(true);
+
+	for (ocpp_configuration_t key = 0; key < OCPP_CONF_MAX; key++) {
+		ocpp_clear_configuration_dirty(key);
+	}
+
+	return err;
+}
+
+int ocpp_save_configuration(void)
+{
+	int err = 0;
+
+	ocpp_configuration_lock();
+
+	if (ocpp_get_next_dirty_configuration(0) == OCPP_CONF_MAX) {
+		goto out;
+	}
+
+	if (!store.scanned && (err = scan(false)) != 0 && err != -ENOENT) {
+		goto out;
+	}
+
+	const size_t len = measure_record(false);
+
+	if (store.sector < 0 || store.offset + len > SECTOR_SIZE) {
+		err = compact();
+	} else if ((err = write_record(get_sector_base(store.sector) +
+			store.offset, false)) == 0) {
+		store.offset += len;
+	} else {
+		store.offset = SECTOR_SIZE;
+	}
+
+	if (err == 0) {
+		for (ocpp_configuration_t key = 0; key < OCPP_CONF_MAX; key++) {
+			ocpp_clear_configuration_dirty(key);
+		}
+	}
+out:
+	ocpp_configuration_unlock();
+
+	return err;
+}
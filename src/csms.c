@@ -0,0 +1,739 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "ocpp/csms.h"
+#include "ocpp/message_json.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+
+#if (OCPP_CSMS_WHEEL_SLOTS & (OCPP_CSMS_WHEEL_SLOTS - 1)) != 0
+#error "OCPP_CSMS_WHEEL_SLOTS must be a power of two"
+#endif
+
+#if !defined(EPOLLEXCLUSIVE)
+#define EPOLLEXCLUSIVE				0
+#endif
+
+#define MAX_EVENTS				64
+
+/* the connection of which a worker is decoding a message, for the type of
+ * a result to be looked up by ocpp_csms_get_type() */
+static _Thread_local const struct ocpp_csms_conn *decoding;
+
+static struct ocpp_csms_worker *worker_of(const struct ocpp_csms_conn *conn)
+{
+	return &conn->csms->workers[conn->worker];
+}
+
+static struct ocpp_csms_call **get_slot(struct ocpp_csms_worker *w,
+		time_t t)
+{
+	return &w->wheel[(size_t)t & (OCPP_CSMS_WHEEL_SLOTS - 1)];
+}
+
+static void schedule(struct ocpp_csms_worker *w,
+		struct ocpp_csms_call *call, time_t deadline)
+{
+	struct ocpp_csms_call **slot = get_slot(w, deadline);
+
+	call->deadline = deadline;
+	call->prev = NULL;
+	call->next = *slot;
+
+	if (*slot) {
+		(*slot)->prev = call;
+	}
+
+	*slot = call;
+}
+
+static void unschedule(struct ocpp_csms_worker *w,
+		struct ocpp_csms_call *call)
+{
+	if (call->prev) {
+		call->prev->next = call->next;
+	} else {
+		*get_slot(w, call->deadline) = call->next;
+	}
+
+	if (call->next) {
+		call->next->prev = call->prev;
+	}
+
+	call->next = call->prev = NULL;
+}
+
+static struct ocpp_csms_call *find_call(const struct ocpp_csms_conn *conn,
+		const char *idstr)
+{
+	for (int i = 0; i < OCPP_CSMS_PENDING_MAX; i++) {
+		const struct ocpp_csms_call *call = &conn->calls[i];
+
+		if (call->used && strcmp(call->id, idstr) == 0) {
+			return (struct ocpp_csms_call *)(uintptr_t)call;
+		}
+	}
+
+	return NULL;
+}
+
+static struct ocpp_csms_call *alloc_call(struct ocpp_csms_conn *conn)
+{
+	for (int i = 0; i < OCPP_CSMS_PENDING_MAX; i++) {
+		if (!conn->calls[i].used) {
+			return &conn->calls[i];
+		}
+	}
+
+	return NULL;
+}
+
+/* Called with the lock of the worker, which is released meanwhile for the
+ * callback to send on any connection. Only the worker closes its
+ * connections, so the connection stays. */
+static void notify(struct ocpp_csms_worker *w, struct ocpp_csms_conn *conn,
+		ocpp_csms_event_t event, const struct ocpp_message *msg)
+{
+	pthread_mutex_unlock(&w->lock);
+	(*w->csms->cb)(conn, event, msg, w->csms->cb_ctx);
+	pthread_mutex_lock(&w->lock);
+}
+
+static void update_events(struct ocpp_csms_worker *w,
+		struct ocpp_csms_conn *conn)
+{
+	const uint32_t events = EPOLLIN |
+		(ocpp_websocket_wants_write(&conn->ws)? EPOLLOUT : 0u);
+	const int fd = ocpp_websocket_fd(&conn->ws);
+
+	if (fd >= 0 && events != conn->events) {
+		struct epoll_event ev = {
+			.events = events,
+			.data.ptr = conn,
+		};
+
+		if (epoll_ctl(w->epfd, EPOLL_CTL_MOD, fd, &ev) == 0) {
+			conn->events = events;
+		}
+	}
+}
+
+static struct ocpp_csms_conn *take_conn(struct ocpp_csms *csms)
+{
+	pthread_mutex_lock(&csms->pool_lock);
+	struct ocpp_csms_conn *conn = csms->free;
+	if (conn) {
+		csms->free = conn->next_free;
+	}
+	pthread_mutex_unlock(&csms->pool_lock);
+
+	return conn;
+}
+
+static void give_conn(struct ocpp_csms *csms, struct ocpp_csms_conn *conn)
+{
+	pthread_mutex_lock(&csms->pool_lock);
+	conn->next_free = csms->free;
+	csms->free = conn;
+	pthread_mutex_unlock(&csms->pool_lock);
+}
+
+static void close_conn(struct ocpp_csms_worker *w,
+		struct ocpp_csms_conn *conn)
+{
+	const int fd = ocpp_websocket_fd(&conn->ws);
+	const bool was_open = conn->open;
+
+	for (int i = 0; i < OCPP_CSMS_PENDING_MAX; i++) {
+		if (conn->calls[i].used) {
+			unschedule(w, &conn->calls[i]);
+			conn->calls[i].used = false;
+		}
+	}
+
+	if (fd >= 0) {
+		epoll_ctl(w->epfd, EPOLL_CTL_DEL, fd, NULL);
+		close(fd);
+	}
+
+	conn->open = false;
+
+	if (was_open) {
+		__atomic_fetch_sub(&w->csms->nr_open, 1, __ATOMIC_RELAXED);
+		notify(w, conn, OCPP_CSMS_EVENT_DISCONNECTED, NULL);
+	}
+
+	conn->used = false;
+	give_conn(w->csms, conn);
+}
+
+static void set_identity(struct ocpp_csms_conn *conn)
+{
+	const char *path = conn->ws.path;
+	const char *p = strrchr(path, '/');
+	size_t len;
+
+	p = p? p + 1 : path;
+	len = strlen(p);
+	if (len >= sizeof(conn->identity)) {
+		len = sizeof(conn->identity) - 1;
+	}
+
+	memcpy(conn->identity, p, len);
+	conn->identity[len] = '\0';
+}
+
+static int send_locked(struct ocpp_csms_worker *w,
+		struct ocpp_csms_conn *conn, const struct ocpp_message *msg)
+{
+	int err = -ENOTCONN;
+
+	if (conn->open && (err = ocpp_websocket_send(&conn->ws, msg)) == 0) {
+		update_events(w, conn);
+	}
+
+	return err;
+}
+
+static int reject(struct ocpp_csms_worker *w, struct ocpp_csms_conn *conn,
+		const struct ocpp_message *req, ocpp_callerror_t code)
+{
+	struct ocpp_CallError error = { .errorCode = code, };
+	struct ocpp_message msg = {
+		.role = OCPP_MSG_ROLE_CALLERROR,
+		.type = req->type,
+		.payload.fmt.response = &error,
+		.payload.size = sizeof(error),
+	};
+
+	memcpy(msg.id, req->id, sizeof(msg.id));
+
+	return send_locked(w, conn, &msg);
+}
+
+static void take_message(struct ocpp_csms_worker *w,
+		struct ocpp_csms_conn *conn, const char *data, size_t len)
+{
+	struct ocpp_message msg = { 0, };
+	ocpp_callerror_t code = OCPP_CALLERROR_FORMATION_VIOLATION;
+
+	decoding = conn;
+	const int err = ocpp_decode_message_json(data, len, &msg,
+			w->payload.raw, sizeof(w->payload.raw), &code);
+	decoding = NULL;
+
+	/* the payload is decoded out of the receive buffer */
+	ocpp_websocket_consume(&conn->ws);
+
+	if (msg.role == OCPP_MSG_ROLE_CALL) {
+		if (err == 0) {
+			notify(w, conn, OCPP_CSMS_EVENT_REQUEST, &msg);
+		} else if (err == -EBADMSG && msg.id[0] != '\0') {
+			reject(w, conn, &msg, code);
+		}
+	} else if (err == 0) {
+		struct ocpp_csms_call *call = find_call(conn, msg.id);
+
+		if (call) {
+			unschedule(w, call);
+			call->used = false;
+			notify(w, conn, OCPP_CSMS_EVENT_RESPONSE, &msg);
+		}
+	}
+}
+
+static void serve(struct ocpp_csms_worker *w, struct ocpp_csms_conn *conn)
+{
+	int err;
+
+	pthread_mutex_lock(&w->lock);
+
+	while ((err = ocpp_websocket_step(&conn->ws)) == 0) {
+		const char *data;
+		int len;
+
+		if (!conn->open && ocpp_websocket_state(&conn->ws) ==
+				OCPP_WEBSOCKET_OPEN) {
+			set_identity(conn);
+			conn->open = true;
+			__atomic_fetch_add(&w->csms->nr_open, 1,
+					__ATOMIC_RELAXED);
+			notify(w, conn, OCPP_CSMS_EVENT_CONNECTED, NULL);
+		}
+
+		if ((len = ocpp_websocket_peek(&conn->ws, &data)) < 0) {
+			break;
+		}
+
+		take_message(w, conn, data, (size_t)len);
+	}
+
+	if (err != 0) {
+		close_conn(w, conn);
+	} else {
+		update_events(w, conn);
+	}
+
+	pthread_mutex_unlock(&w->lock);
+}
+
+static void accept_stations(struct ocpp_csms_worker *w)
+{
+	struct ocpp_csms *csms = w->csms;
+	int fd;
+
+	while ((fd = accept(csms->listener, NULL, NULL)) >= 0) {
+		struct ocpp_csms_conn *conn = take_conn(csms);
+
+		if (conn == NULL) {
+			close(fd);
+			continue;
+		}
+
+		pthread_mutex_lock(&w->lock);
+
+		struct epoll_event ev = {
+			.events = EPOLLIN,
+			.data.ptr = conn,
+		};
+
+		conn->worker = (uint8_t)(w - csms->workers);
+		conn->identity[0] = '\0';
+		conn->seq = 0;
+		conn->events = ev.events;
+		conn->open = false;
+		conn->used = true;
+		for (int i = 0; i < OCPP_CSMS_PENDING_MAX; i++) {
+			conn->calls[i].used = false;
+		}
+
+		if (ocpp_websocket_accept(&conn->ws, fd) != 0 ||
+				epoll_ctl(w->epfd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+			close(fd);
+			conn->used = false;
+			give_conn(csms, conn);
+		}
+
+		pthread_mutex_unlock(&w->lock);
+	}
+}
+
+static void send_again_or_give_up(struct ocpp_csms_worker *w,
+		struct ocpp_csms_call *call, time_t now)
+{
+	struct ocpp_csms_conn *conn = call->conn;
+
+	if (call->attempts < OCPP_CSMS_TX_RETRIES) {
+		call->attempts++;
+		/* a queue full for now counts as an attempt all the same */
+		ocpp_websocket_write(&conn->ws, call->frame, call->len);
+		schedule(w, call, now + OCPP_CSMS_TX_TIMEOUT_SEC);
+		update_events(w, conn);
+		return;
+	}
+
+	struct ocpp_message msg = {
+		.role = OCPP_MSG_ROLE_CALL,
+		.type = call->type,
+	};
+
+	memcpy(msg.id, call->id, sizeof(msg.id));
+	call->used = false;
+
+	notify(w, conn, OCPP_CSMS_EVENT_TIMEOUT, &msg);
+}
+
+/* Turns the wheel through the seconds passed since the last turn, taking
+ * out the calls due. The ones of later rounds stay in their slots. */
+static void turn_wheel(struct ocpp_csms_worker *w, time_t now)
+{
+	struct ocpp_csms_call *expired = NULL;
+	time_t t = w->tick + 1;
+
+	if (now <= w->tick) {
+		return;
+	} else if (now - w->tick > OCPP_CSMS_WHEEL_SLOTS) {
+		t = now - OCPP_CSMS_WHEEL_SLOTS + 1;
+	}
+
+	for (; t <= now; t++) {
+		struct ocpp_csms_call *call = *get_slot(w, t);
+
+		while (call) {
+			struct ocpp_csms_call *next = call->next;
+
+			if (call->deadline <= now) {
+				unschedule(w, call);
+				call->next = expired;
+				expired = call;
+			}
+
+			call = next;
+		}
+	}
+
+	w->tick = now;
+
+	while (expired) {
+		struct ocpp_csms_call *call = expired;
+		expired = call->next;
+		send_again_or_give_up(w, call, now);
+	}
+}
+
+static void *run(void *arg)
+{
+	struct ocpp_csms_worker *w = (struct ocpp_csms_worker *)arg;
+	struct epoll_event events[MAX_EVENTS];
+
+	while (__atomic_load_n(&w->csms->running, __ATOMIC_ACQUIRE)) {
+		const int n = epoll_wait(w->epfd, events, MAX_EVENTS,
+				OCPP_CSMS_TICK_MS);
+
+		for (int i = 0; i < n; i++) {
+			void *p = events[i].data.ptr;
+
+			if (p == NULL) {
+				accept_stations(w);
+			} else if (p == w) {
+				uint64_t count;
+				if (read(w->wakefd, &count, sizeof(count)) < 0) {
+					continue;
+				}
+			} else {
+				serve(w, (struct ocpp_csms_conn *)p);
+			}
+		}
+
+		pthread_mutex_lock(&w->lock);
+		turn_wheel(w, time(NULL));
+		pthread_mutex_unlock(&w->lock);
+	}
+
+	return NULL;
+}
+
+static int send_message(struct ocpp_csms_conn *conn,
+		const struct ocpp_message *msg)
+{
+	struct ocpp_csms_worker *w = worker_of(conn);
+
+	pthread_mutex_lock(&w->lock);
+	const int err = send_locked(w, conn, msg);
+	pthread_mutex_unlock(&w->lock);
+
+	return err;
+}
+
+int ocpp_csms_send_response(struct ocpp_csms_conn *conn,
+		const struct ocpp_message *req, const void *data, size_t datasize)
+{
+	if (conn == NULL || req == NULL) {
+		return -EINVAL;
+	}
+
+	struct ocpp_message msg = {
+		.role = OCPP_MSG_ROLE_CALLRESULT,
+		.type = req->type,
+		.payload.fmt.response = data,
+		.payload.size = datasize,
+	};
+
+	memcpy(msg.id, req->id, sizeof(msg.id));
+
+	return send_message(conn, &msg);
+}
+
+int ocpp_csms_send_error(struct ocpp_csms_conn *conn,
+		const struct ocpp_message *req, ocpp_callerror_t code)
+{
+	if (conn == NULL || req == NULL) {
+		return -EINVAL;
+	}
+
+	struct ocpp_csms_worker *w = worker_of(conn);
+
+	pthread_mutex_lock(&w->lock);
+	const int err = reject(w, conn, req, code);
+	pthread_mutex_unlock(&w->lock);
+
+	return err;
+}
+
+int ocpp_csms_send_request(struct ocpp_csms_conn *conn, ocpp_message_t type,
+		const void *data, size_t datasize,
+		char id[OCPP_MESSAGE_ID_MAXLEN])
+{
+	if (conn == NULL || conn->csms == NULL) {
+		return -EINVAL;
+	}
+
+	struct ocpp_csms_worker *w = worker_of(conn);
+	struct ocpp_csms_call *call;
+	struct ocpp_message msg = {
+		.role = OCPP_MSG_ROLE_CALL,
+		.type = type,
+		.payload.fmt.request = data,
+		.payload.size = datasize,
+	};
+	int err;
+
+	pthread_mutex_lock(&w->lock);
+
+	if (!conn->open) {
+		err = -ENOTCONN;
+	} else if ((call = alloc_call(conn)) == NULL) {
+		err = -EBUSY;
+	} else {
+		snprintf(msg.id, sizeof(msg.id), "%lu",
+				(unsigned long)++conn->seq);
+
+		const int len = ocpp_encode_message_json(&msg,
+				call->frame, sizeof(call->frame));
+
+		if (len < 0) {
+			err = len == -ENOBUFS? -EMSGSIZE : len;
+		} else if ((err = ocpp_websocket_write(&conn->ws,
+				call->frame, (size_t)len)) == 0) {
+			memcpy(call->id, msg.id, sizeof(call->id));
+			call->conn = conn;
+			call->type = type;
+			call->len = (uint16_t)len;
+			call->attempts = 1;
+			call->used = true;
+			schedule(w, call, time(NULL) + OCPP_CSMS_TX_TIMEOUT_SEC);
+			update_events(w, conn);
+
+			if (id) {
+				memcpy(id, msg.id, sizeof(msg.id));
+			}
+		}
+	}
+
+	pthread_mutex_unlock(&w->lock);
+
+	return err;
+}
+
+ocpp_message_t ocpp_csms_get_type(const char *idstr)
+{
+	const struct ocpp_csms_call *call;
+
+	if (decoding == NULL || (call = find_call(decoding, idstr)) == NULL) {
+		return OCPP_MSG_MAX;
+	}
+
+	return call->type;
+}
+
+const char *ocpp_csms_identity(const struct ocpp_csms_conn *conn)
+{
+	return conn->identity;
+}
+
+size_t ocpp_csms_count_connections(const struct ocpp_csms *csms)
+{
+	return __atomic_load_n(&csms->nr_open, __ATOMIC_RELAXED);
+}
+
+uint16_t ocpp_csms_port(const struct ocpp_csms *csms)
+{
+	return csms->port;
+}
+
+static void close_workers(struct ocpp_csms *csms, uint8_t nr_workers)
+{
+	for (uint8_t i = 0; i < nr_workers; i++) {
+		struct ocpp_csms_worker *w = &csms->workers[i];
+
+		close(w->epfd);
+		close(w->wakefd);
+		pthread_mutex_destroy(&w->lock);
+	}
+}
+
+static int open_worker(struct ocpp_csms *csms, struct ocpp_csms_worker *w)
+{
+	struct epoll_event wake = { .events = EPOLLIN, .data.ptr = w, };
+	struct epoll_event accept = {
+		.events = EPOLLIN | EPOLLEXCLUSIVE,
+		.data.ptr = NULL,
+	};
+
+	memset(w->wheel, 0, sizeof(w->wheel));
+	w->csms = csms;
+	w->tick = time(NULL);
+	w->epfd = epoll_create1(EPOLL_CLOEXEC);
+	w->wakefd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+	if (w->epfd < 0 || w->wakefd < 0 ||
+			epoll_ctl(w->epfd, EPOLL_CTL_ADD, w->wakefd, &wake) ||
+			epoll_ctl(w->epfd, EPOLL_CTL_ADD, csms->listener,
+					&accept)) {
+		const int err = -errno;
+		if (w->epfd >= 0) {
+			close(w->epfd);
+		}
+		if (w->wakefd >= 0) {
+			close(w->wakefd);
+		}
+		return err;
+	}
+
+	pthread_mutex_init(&w->lock, NULL);
+
+	return 0;
+}
+
+static void wake_and_join(struct ocpp_csms *csms, uint8_t nr_workers)
+{
+	const uint64_t one = 1;
+
+	__atomic_store_n(&csms->running, false, __ATOMIC_RELEASE);
+
+	for (uint8_t i = 0; i < nr_workers; i++) {
+		if (write(csms->workers[i].wakefd, &one, sizeof(one)) < 0) {
+			/* woken up by the tick anyway */
+		}
+	}
+	for (uint8_t i = 0; i < nr_workers; i++) {
+		pthread_join(csms->workers[i].thread, NULL);
+	}
+}
+
+int ocpp_csms_start(struct ocpp_csms *csms, uint8_t nr_workers)
+{
+	uint8_t opened = 0;
+	uint8_t started = 0;
+	int err = 0;
+
+	if (csms == NULL || csms->listener < 0 || csms->nr_workers != 0 ||
+			nr_workers == 0 || nr_workers > OCPP_CSMS_WORKERS_MAX) {
+		return -EINVAL;
+	}
+
+	while (opened < nr_workers && (err = open_worker(csms,
+			&csms->workers[opened])) == 0) {
+		opened++;
+	}
+
+	__atomic_store_n(&csms->running, true, __ATOMIC_RELEASE);
+
+	while (err == 0 && started < nr_workers && (err = -pthread_create(
+			&csms->workers[started].thread, NULL,
+			run, &csms->workers[started])) == 0) {
+		started++;
+	}
+
+	if (err != 0) {
+		wake_and_join(csms, started);
+		close_workers(csms, opened);
+		return err;
+	}
+
+	csms->nr_workers = nr_workers;
+
+	return 0;
+}
+
+void ocpp_csms_stop(struct ocpp_csms *csms)
+{
+	wake_and_join(csms, csms->nr_workers);
+
+	for (size_t i = 0; i < csms->nr_conns; i++) {
+		struct ocpp_csms_conn *conn = &csms->pool[i];
+
+		if (conn->used) {
+			struct ocpp_csms_worker *w = worker_of(conn);
+			pthread_mutex_lock(&w->lock);
+			close_conn(w, conn);
+			pthread_mutex_unlock(&w->lock);
+		}
+	}
+
+	close_workers(csms, csms->nr_workers);
+	csms->nr_workers = 0;
+
+	if (csms->listener >= 0) {
+		close(csms->listener);
+		csms->listener = -1;
+	}
+}
+
+int ocpp_csms_listen(struct ocpp_csms *csms, uint16_t port)
+{
+	struct sockaddr_in addr = {
+		.sin_family = AF_INET,
+		.sin_port = htons(port),
+		.sin_addr.s_addr = htonl(INADDR_ANY),
+	};
+	socklen_t len = sizeof(addr);
+	const int one = 1;
+
+	if (csms == NULL || csms->listener >= 0) {
+		return -EINVAL;
+	}
+
+	const int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+	if (fd < 0) {
+		return -errno;
+	} else if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR,
+				&one, sizeof(one)) != 0 ||
+			bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+			listen(fd, SOMAXCONN) != 0 ||
+			getsockname(fd, (struct sockaddr *)&addr, &len) != 0 ||
+			fcntl(fd, F_SETFL, O_NONBLOCK) != 0) {
+		const int err = -errno;
+		close(fd);
+		return err;
+	}
+
+	csms->listener = fd;
+	csms->port = ntohs(addr.sin_port);
+
+	return 0;
+}
+
+int ocpp_csms_init(struct ocpp_csms *csms, struct ocpp_csms_conn *conns,
+		size_t nr_conns, ocpp_csms_event_callback_t cb, void *cb_ctx)
+{
+	if (csms == NULL || conns == NULL || nr_conns == 0 || cb == NULL) {
+		return -EINVAL;
+	}
+
+	csms->listener = -1;
+	csms->port = 0;
+	csms->running = false;
+	csms->nr_workers = 0;
+	csms->cb = cb;
+	csms->cb_ctx = cb_ctx;
+	csms->pool = conns;
+	csms->free = NULL;
+	csms->nr_conns = nr_conns;
+	csms->nr_open = 0;
+	pthread_mutex_init(&csms->pool_lock, NULL);
+
+	for (size_t i = nr_conns; i > 0; i--) {
+		struct ocpp_csms_conn *conn = &conns[i - 1];
+
+		conn->csms = csms;
+		conn->used = false;
+		conn->open = false;
+		conn->next_free = csms->free;
+		csms->free = conn;
+	}
+
+	return 0;
+}
@@ -0,0 +1,632 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "ocpp/deflate.h"
+#include <errno.h>
+#include <string.h>
+
+#define MIN_WINDOW_BITS			8
+#define WINDOW_MASK			(OCPP_DEFLATE_WINDOW_SIZE - 1)
+
+#define MIN_MATCH			3u
+#define MAX_MATCH			258u
+#define MAX_CODE_BITS			15
+#define END_OF_BLOCK			256
+#define LITLEN_CODES			288
+#define MAX_LITLEN_CODES		286
+#define DIST_CODES			30
+
+enum block_type {
+	BLOCK_STORED			= 0,
+	BLOCK_FIXED			= 1,
+	BLOCK_DYNAMIC			= 2,
+};
+
+static const uint16_t len_base[29] = {
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+	35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258,
+};
+static const uint8_t len_extra[29] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+	3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0,
+};
+static const uint16_t dist_base[DIST_CODES] = {
+	1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+	257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+	8193, 12289, 16385, 24577,
+};
+static const uint8_t dist_extra[DIST_CODES] = {
+	0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+	7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13,
+};
+
+struct bitwriter {
+	uint8_t *p;
+	uint8_t *end;
+	uint32_t bitbuf;
+	unsigned int bitcnt;
+	bool overflow;
+};
+
+struct bitreader {
+	const uint8_t *p;
+	size_t left;
+	unsigned int tail; /* bytes of the sync flush marker read */
+	uint32_t bitbuf;
+	unsigned int bitcnt;
+	bool eof;
+};
+
+struct huffman {
+	uint16_t count[MAX_CODE_BITS + 1];
+	uint16_t symbol[LITLEN_CODES];
+};
+
+struct inflate_state {
+	struct bitreader r;
+	const struct ocpp_inflater *z;
+	uint8_t *out;
+	size_t outsize;
+	size_t n;
+};
+
+static uint8_t clamp_bits(uint8_t bits)
+{
+	if (bits < MIN_WINDOW_BITS) {
+		return MIN_WINDOW_BITS;
+	} else if (bits > OCPP_DEFLATE_WINDOW_BITS) {
+		return OCPP_DEFLATE_WINDOW_BITS;
+	}
+	return bits;
+}
+
+/* Append a message to the history, keeping the last window of it. */
+static void append_window(uint8_t *window, uint32_t pos,
+		const uint8_t *src, size_t len)
+{
+	if (len > OCPP_DEFLATE_WINDOW_SIZE) {
+		src += len - OCPP_DEFLATE_WINDOW_SIZE;
+		pos += (uint32_t)(len - OCPP_DEFLATE_WINDOW_SIZE);
+		len = OCPP_DEFLATE_WINDOW_SIZE;
+	}
+
+	const size_t off = pos & WINDOW_MASK;
+	const size_t first = len < OCPP_DEFLATE_WINDOW_SIZE - off?
+		len : OCPP_DEFLATE_WINDOW_SIZE - off;
+
+	memcpy(&window[off], src, first);
+	memcpy(window, &src[first], len - first);
+}
+
+static uint16_t update_filled(uint16_t filled, size_t len, uint8_t bits)
+{
+	const size_t wsize = (size_t)1 << bits;
+	const size_t n = (size_t)filled + len;
+	return (uint16_t)(n < wsize? n : wsize);
+}
+
+static void put_bits(struct bitwriter *w, uint32_t bits, unsigned int n)
+{
+	w->bitbuf |= bits << w->bitcnt;
+	w->bitcnt += n;
+
+	while (w->bitcnt >= 8) {
+		if (w->p == w->end) {
+			w->overflow = true;
+		} else {
+			*w->p++ = (uint8_t)w->bitbuf;
+		}
+		w->bitbuf >>= 8;
+		w->bitcnt -= 8;
+	}
+}
+
+/* Huffman codes go out from the most significant bit. */
+static void put_code(struct bitwriter *w, uint32_t code, unsigned int n)
+{
+	uint32_t reversed = 0;
+
+	for (unsigned int i = 0; i < n; i++) {
+		reversed = (reversed << 1) | (code & 1);
+		code >>= 1;
+	}
+
+	put_bits(w, reversed, n);
+}
+
+static void put_litlen(struct bitwriter *w, unsigned int sym)
+{
+	if (sym < 144) {
+		put_code(w, 0x30 + sym, 8);
+	} else if (sym < 256) {
+		put_code(w, 0x190 + sym - 144, 9);
+	} else if (sym < 280) {
+		put_code(w, sym - 256, 7);
+	} else {
+		put_code(w, 0xc0 + sym - 280, 8);
+	}
+}
+
+static void put_match(struct bitwriter *w, unsigned int len, unsigned int dist)
+{
+	unsigned int i = 28;
+
+	while (len_base[i] > len) {
+		i--;
+	}
+	put_litlen(w, 257 + i);
+	put_bits(w, len - len_base[i], len_extra[i]);
+
+	for (i = DIST_CODES - 1; dist_base[i] > dist; i--) {
+		/* down to the code of the distance */
+	}
+	put_code(w, i, 5);
+	put_bits(w, dist - dist_base[i], dist_extra[i]);
+}
+
+static unsigned int hash(const uint8_t *p)
+{
+	const uint32_t v = (uint32_t)p[0] << 16 | (uint32_t)p[1] << 8 | p[2];
+	return (v * 2654435761u) >> (32 - OCPP_DEFLATE_HASH_BITS);
+}
+
+static void insert(struct ocpp_deflater *z, const uint8_t *msg, size_t i)
+{
+	const unsigned int h = hash(&msg[i]);
+	const uint16_t pos = (uint16_t)(z->pos + i);
+
+	z->prev[pos & WINDOW_MASK] = z->head[h];
+	z->head[h] = pos;
+}
+
+/* The positions of the chains are of 16 bits and so may be stale, but a
+ * candidate is taken only as far as its bytes really match within the
+ * window, so a stale one costs a lookup and never the output. */
+static unsigned int longest_match(const struct ocpp_deflater *z,
+		const uint8_t *msg, size_t len, size_t i, unsigned int *distp)
+{
+	const size_t wsize = (size_t)1 << z->bits;
+	const size_t reach = i + z->filled;
+	const size_t maxdist = reach < wsize? reach : wsize;
+	const size_t maxlen = len - i < MAX_MATCH? len - i : MAX_MATCH;
+	const uint16_t cur = (uint16_t)(z->pos + i);
+	uint16_t cand = z->head[hash(&msg[i])];
+	size_t best = 0;
+
+	for (unsigned int chain = 0; chain < OCPP_DEFLATE_MAX_CHAIN; chain++) {
+		const size_t dist = (uint16_t)(cur - cand);
+		size_t n = 0;
+
+		if (dist == 0 || dist > maxdist) {
+			break;
+		}
+
+		if (dist <= i) {
+			const uint8_t *s = &msg[i - dist];
+			while (n < maxlen && s[n] == msg[i + n]) {
+				n++;
+			}
+		} else {
+			for (; n < maxlen; n++) {
+				const uint8_t c = dist - n > i?
+					z->window[(z->pos + i + n - dist)
+						& WINDOW_MASK] :
+					msg[i + n - dist];
+				if (c != msg[i + n]) {
+					break;
+				}
+			}
+		}
+
+		if (n > best) {
+			best = n;
+			*distp = (unsigned int)dist;
+			if (n == maxlen) {
+				break;
+			}
+		}
+
+		cand = z->prev[cand & WINDOW_MASK];
+	}
+
+	return (unsigned int)best;
+}
+
+int ocpp_deflate(struct ocpp_deflater *z, const void *src, size_t len,
+		void *dst, size_t dstsize)
+{
+	const uint8_t *msg = (const uint8_t *)src;
+	struct bitwriter w = {
+		.p = (uint8_t *)dst,
+		.end = (uint8_t *)dst + dstsize,
+	};
+	size_t i = 0;
+
+	put_bits(&w, BLOCK_FIXED << 1, 3);
+
+	while (i < len && !w.overflow) {
+		unsigned int dist = 0;
+		unsigned int n = 0;
+
+		if (len - i >= MIN_MATCH) {
+			n = longest_match(z, msg, len, i, &dist);
+			insert(z, msg, i);
+		}
+
+		if (n < MIN_MATCH) {
+			put_litlen(&w, msg[i++]);
+			continue;
+		}
+
+		put_match(&w, n, dist);
+		for (size_t k = i + 1; k < i + n && k + MIN_MATCH <= len; k++) {
+			insert(z, msg, k);
+		}
+		i += n;
+	}
+
+	put_litlen(&w, END_OF_BLOCK);
+	/* sync flush: an empty stored block of which only the header is
+	 * sent, the rest being the 00 00 ff ff to leave out */
+	put_bits(&w, BLOCK_STORED << 1, 3);
+	if (w.bitcnt) {
+		put_bits(&w, 0, 8 - w.bitcnt);
+	}
+
+	if (w.overflow) {
+		return -ENOBUFS;
+	}
+
+	if (z->takeover) {
+		append_window(z->window, z->pos, msg, len);
+		z->filled = update_filled(z->filled, len, z->bits);
+	}
+	z->pos += (uint32_t)len;
+
+	return (int)(w.p - (uint8_t *)dst);
+}
+
+void ocpp_deflate_init(struct ocpp_deflater *z, uint8_t bits, bool takeover)
+{
+	memset(z, 0, sizeof(*z));
+	z->bits = clamp_bits(bits);
+	z->takeover = takeover;
+}
+
+static uint8_t get_byte(struct bitreader *r)
+{
+	static const uint8_t sync_marker[] = { 0x00, 0x00, 0xff, 0xff };
+
+	if (r->left) {
+		r->left--;
+		return *r->p++;
+	} else if (r->tail < sizeof(sync_marker)) {
+		return sync_marker[r->tail++];
+	}
+
+	r->eof = true;
+	return 0;
+}
+
+static bool is_drained(const struct bitreader *r)
+{
+	return r->left == 0 && r->tail == 4;
+}
+
+static uint32_t get_bits(struct bitreader *r, unsigned int n)
+{
+	while (r->bitcnt < n) {
+		r->bitbuf |= (uint32_t)get_byte(r) << r->bitcnt;
+		r->bitcnt += 8;
+	}
+
+	const uint32_t v = r->bitbuf & ((1u << n) - 1);
+	r->bitbuf >>= n;
+	r->bitcnt -= n;
+
+	return v;
+}
+
+/* Canonical codes counted by their lengths as in puff of zlib. Returns 0 for
+ * a complete code, positive for an incomplete one and negative for an
+ * over-subscribed one. */
+static int build_huffman(struct huffman *h, const uint8_t *lengths,
+		unsigned int n)
+{
+	uint16_t offs[MAX_CODE_BITS + 1];
+	int left = 1;
+
+	memset(h->count, 0, sizeof(h->count));
+	for (unsigned int i = 0; i < n; i++) {
+		h->count[lengths[i]]++;
+	}
+	if (h->count[0] == n) {
+		return 0;
+	}
+
+	for (unsigned int len = 1; len <= MAX_CODE_BITS; len++) {
+		left = left * 2 - h->count[len];
+		if (left < 0) {
+			return left;
+		}
+	}
+
+	offs[1] = 0;
+	for (unsigned int len = 1; len < MAX_CODE_BITS; len++) {
+		offs[len + 1] = (uint16_t)(offs[len] + h->count[len]);
+	}
+	for (unsigned int sym = 0; sym < n; sym++) {
+		if (lengths[sym]) {
+			h->symbol[offs[lengths[sym]]++] = (uint16_t)sym;
+		}
+	}
+
+	return left;
+}
+
+static int decode(struct bitreader *r, const struct huffman *h)
+{
+	int code = 0;
+	int first = 0;
+	int index = 0;
+
+	for (unsigned int len = 1; len <= MAX_CODE_BITS; len++) {
+		code |= (int)get_bits(r, 1);
+		const int count = h->count[len];
+		if (code - count < first) {
+			return h->symbol[index + (code - first)];
+		}
+		index += count;
+		first = (first + count) << 1;
+		code <<= 1;
+	}
+
+	return -EBADMSG;
+}
+
+static uint32_t get_code(struct bitreader *r, unsigned int n)
+{
+	uint32_t code = 0;
+
+	for (unsigned int i = 0; i < n; i++) {
+		code = (code << 1) | get_bits(r, 1);
+	}
+
+	return code;
+}
+
+/* The fixed codes are decoded by their ranges, with no table to build. */
+static int decode_fixed(struct bitreader *r)
+{
+	uint32_t code = get_code(r, 7);
+
+	if (code < 0x18) {
+		return (int)(256 + code);
+	}
+
+	code = (code << 1) | get_bits(r, 1);
+	if (code < 0xc0) {
+		return (int)(code - 0x30);
+	} else if (code < 0xc8) {
+		return (int)(280 + code - 0xc0);
+	}
+
+	code = (code << 1) | get_bits(r, 1);
+	return (int)(144 + code - 0x190);
+}
+
+static int copy_match(struct inflate_state *s, size_t len, size_t dist)
+{
+	const struct ocpp_inflater *z = s->z;
+
+	if (dist > s->n + z->filled) {
+		return -EBADMSG;
+	} else if (len > s->outsize - s->n) {
+		return -ENOBUFS;
+	}
+
+	for (size_t i = 0; i < len; i++, s->n++) {
+		s->out[s->n] = dist <= s->n? s->out[s->n - dist] :
+			z->window[(z->pos + s->n - dist) & WINDOW_MASK];
+	}
+
+	return 0;
+}
+
+/* Of the fixed codes when @p lencode and @p distcode are NULL. */
+static int inflate_codes(struct inflate_state *s, const struct huffman *lencode,
+		const struct huffman *distcode)
+{
+	for (;;) {
+		int sym = lencode? decode(&s->r, lencode) : decode_fixed(&s->r);
+
+		if (sym < 0) {
+			return -EBADMSG;
+		} else if (sym < END_OF_BLOCK) {
+			if (s->n == s->outsize) {
+				return -ENOBUFS;
+			}
+			s->out[s->n++] = (uint8_t)sym;
+		} else if (sym == END_OF_BLOCK) {
+			return 0;
+		} else if ((sym -= END_OF_BLOCK + 1) >= 29) {
+			return -EBADMSG;
+		} else {
+			const size_t len = len_base[sym] +
+				get_bits(&s->r, len_extra[sym]);
+			const int dsym = distcode? decode(&s->r, distcode) :
+				(int)get_code(&s->r, 5);
+
+			if (dsym < 0 || dsym >= DIST_CODES) {
+				return -EBADMSG;
+			}
+
+			const size_t dist = dist_base[dsym] +
+				get_bits(&s->r, dist_extra[dsym]);
+			const int err = copy_match(s, len, dist);
+
+			if (err) {
+				return err;
+			}
+		}
+
+		if (s->r.eof) {
+			return -EBADMSG;
+		}
+	}
+}
+
+static int inflate_stored(struct inflate_state *s)
+{
+	struct bitreader *r = &s->r;
+
+	/* to the byte boundary, as no more than 7 bits are ever left */
+	r->bitbuf = 0;
+	r->bitcnt = 0;
+
+	const uint32_t len = get_bits(r, 16);
+	if (len != (~get_bits(r, 16) & 0xffffu) ||
+			len > r->left + 4 - r->tail) {
+		return -EBADMSG;
+	} else if (len > s->outsize - s->n) {
+		return -ENOBUFS;
+	}
+
+	for (uint32_t i = 0; i < len && !r->eof; i++) {
+		s->out[s->n++] = get_byte(r);
+	}
+
+	return r->eof? -EBADMSG : 0;
+}
+
+static bool is_valid_code(int err, const struct huffman *h, unsigned int n)
+{
+	/* an incomplete code is allowed only of a single length */
+	return err == 0 || (err > 0 && n - h->count[0] == 1);
+}
+
+static int inflate_dynamic(struct inflate_state *s)
+{
+	static const uint8_t order[19] = {
+		16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+	};
+	struct huffman lencode;
+	struct huffman distcode;
+	uint8_t lengths[MAX_LITLEN_CODES + DIST_CODES] = { 0, };
+	const unsigned int nlen = get_bits(&s->r, 5) + 257;
+	const unsigned int ndist = get_bits(&s->r, 5) + 1;
+	const unsigned int ncode = get_bits(&s->r, 4) + 4;
+	unsigned int index = 0;
+
+	if (nlen > MAX_LITLEN_CODES || ndist > DIST_CODES) {
+		return -EBADMSG;
+	}
+
+	for (unsigned int i = 0; i < ncode; i++) {
+		lengths[order[i]] = (uint8_t)get_bits(&s->r, 3);
+	}
+	if (build_huffman(&lencode, lengths, 19) != 0) {
+		return -EBADMSG;
+	}
+
+	while (index < nlen + ndist) {
+		const int sym = decode(&s->r, &lencode);
+		uint8_t len = 0;
+		unsigned int repeat;
+
+		if (sym < 0 || s->r.eof) {
+			return -EBADMSG;
+		} else if (sym < 16) {
+			lengths[index++] = (uint8_t)sym;
+			continue;
+		} else if (sym == 16) {
+			if (index == 0) {
+				return -EBADMSG;
+			}
+			len = lengths[index - 1];
+			repeat = 3 + get_bits(&s->r, 2);
+		} else if (sym == 17) {
+			repeat = 3 + get_bits(&s->r, 3);
+		} else {
+			repeat = 11 + get_bits(&s->r, 7);
+		}
+
+		if (index + repeat > nlen + ndist) {
+			return -EBADMSG;
+		}
+		memset(&lengths[index], len, repeat);
+		index += repeat;
+	}
+
+	if (lengths[END_OF_BLOCK] == 0) {
+		return -EBADMSG;
+	}
+
+	int err = build_huffman(&lencode, lengths, nlen);
+	if (!is_valid_code(err, &lencode, nlen)) {
+		return -EBADMSG;
+	}
+	err = build_huffman(&distcode, &lengths[nlen], ndist);
+	if (!is_valid_code(err, &distcode, ndist)) {
+		return -EBADMSG;
+	}
+
+	return inflate_codes(s, &lencode, &distcode);
+}
+
+int ocpp_inflate(struct ocpp_inflater *z, const void *src, size_t len,
+		void *dst, size_t dstsize)
+{
+	struct inflate_state s = {
+		.r = { .p = (const uint8_t *)src, .left = len, },
+		.z = z,
+		.out = (uint8_t *)dst,
+		.outsize = dstsize,
+	};
+	bool last;
+
+	do {
+		int err;
+
+		last = get_bits(&s.r, 1);
+
+		switch (get_bits(&s.r, 2)) {
+		case BLOCK_STORED:
+			err = inflate_stored(&s);
+			break;
+		case BLOCK_FIXED:
+			err = inflate_codes(&s, NULL, NULL);
+			break;
+		case BLOCK_DYNAMIC:
+			err = inflate_dynamic(&s);
+			break;
+		default:
+			err = -EBADMSG;
+			break;
+		}
+
+		if (err) {
+			return err;
+		} else if (s.r.eof) {
+			return -EBADMSG;
+		}
+	} while (!last && !is_drained(&s.r));
+
+	if (z->takeover) {
+		append_window(z->window, z->pos, s.out, s.n);
+		z->filled = update_filled(z->filled, s.n, z->bits);
+	}
+	z->pos += (uint32_t)s.n;
+
+	return (int)s.n;
+}
+
+void ocpp_inflate_init(struct ocpp_inflater *z, uint8_t bits, bool takeover)
+{
+	memset(z, 0, sizeof(*z));
+	z->bits = clamp_bits(bits);
+	z->takeover = takeover;
+}
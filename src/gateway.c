@@ -0,0 +1,649 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "ocpp/gateway.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+
+/* The central system prefixes the ids of its CALLs as `<identity>:<id>`,
+ * while the gateway does as `<identity>#<seq>`, so that an id in flight one
+ * way is never taken for one the other way. */
+#define ID_DELIMITER				':'
+#define UPSTREAM_ID_DELIMITER			'#'
+
+static bool is_station(const struct ocpp_gateway *gw, int station)
+{
+	return station >= 0 && station < OCPP_GATEWAY_STATIONS_MAX &&
+		gw->stations[station].used;
+}
+
+static int uplink_of(const struct ocpp_gateway *gw, int station)
+{
+	return station % gw->nr_uplinks;
+}
+
+static bool is_online(const struct ocpp_gateway *gw, int station)
+{
+	return gw->uplink_up[uplink_of(gw, station)];
+}
+
+static struct ocpp_gateway_route *alloc_route(struct ocpp_gateway *gw,
+		int station, ocpp_message_t type, bool upstream)
+{
+	for (int i = 0; i < OCPP_GATEWAY_ROUTES_MAX; i++) {
+		struct ocpp_gateway_route *route = &gw->routes[i];
+
+		if (!route->used) {
+			*route = (struct ocpp_gateway_route) {
+				.expiry = time(NULL) +
+					OCPP_GATEWAY_ROUTE_TIMEOUT_SEC,
+				.type = type,
+				.station = (int16_t)station,
+				.offline_tx = -1,
+				.upstream = upstream,
+				.used = true,
+			};
+			return route;
+		}
+	}
+
+	return NULL;
+}
+
+static int find_route(const struct ocpp_gateway *gw, const char *idstr,
+		bool upstream)
+{
+	for (int i = 0; i < OCPP_GATEWAY_ROUTES_MAX; i++) {
+		const struct ocpp_gateway_route *route = &gw->routes[i];
+
+		if (route->used && route->upstream == upstream &&
+				strcmp(route->id, idstr) == 0) {
+			return i;
+		}
+	}
+
+	return -ENOENT;
+}
+
+static bool is_replay(const struct ocpp_gateway_route *route)
+{
+	return route->offline_tx >= 0 && route->type ==
+		OCPP_MSG_START_TRANSACTION;
+}
+
+static void free_route(struct ocpp_gateway *gw,
+		struct ocpp_gateway_route *route)
+{
+	if (is_replay(route)) {
+		gw->offline[route->offline_tx].replaying = false;
+	}
+
+	route->used = false;
+}
+
+static int make_upstream_id(struct ocpp_gateway *gw, int station,
+		char id[OCPP_MESSAGE_ID_MAXLEN])
+{
+	const int len = snprintf(id, OCPP_MESSAGE_ID_MAXLEN, "%s%c%lu",
+			gw->stations[station].identity, UPSTREAM_ID_DELIMITER,
+			(unsigned long)++gw->seq);
+	return len > 0 && len < OCPP_MESSAGE_ID_MAXLEN? 0 : -ERANGE;
+}
+
+static void learn(struct ocpp_gateway *gw, const char *idTag,
+		const struct ocpp_idTagInfo *info)
+{
+	struct ocpp_gateway_auth *victim = &gw->auth[0];
+
+	if (idTag[0] == '\0') {
+		return;
+	}
+
+	for (int i = 0; i < OCPP_GATEWAY_AUTH_CACHE_LEN; i++) {
+		struct ocpp_gateway_auth *p = &gw->auth[i];
+
+		if (strcmp(p->idTag, idTag) == 0) {
+			victim = p;
+			break;
+		} else if (p->stamp < victim->stamp) {
+			victim = p;
+		}
+	}
+
+	strcpy(victim->idTag, idTag);
+	victim->info = *info;
+	victim->stamp = ++gw->stamp;
+}
+
+static void authorize_offline(struct ocpp_gateway *gw, const char *idTag,
+		struct ocpp_idTagInfo *info)
+{
+	*info = (struct ocpp_idTagInfo) {
+		.status = gw->allow_unknown?
+			OCPP_AUTH_STATUS_ACCEPTED : OCPP_AUTH_STATUS_INVALID,
+	};
+
+	for (int i = 0; i < OCPP_GATEWAY_AUTH_CACHE_LEN; i++) {
+		struct ocpp_gateway_auth *p = &gw->auth[i];
+
+		if (p->stamp == 0 || strcmp(p->idTag, idTag) != 0) {
+			continue;
+		}
+
+		p->stamp = ++gw->stamp;
+		*info = p->info;
+
+		if (info->status == OCPP_AUTH_STATUS_ACCEPTED &&
+				info->expiryDate != 0 &&
+				info->expiryDate <= time(NULL)) {
+			info->status = OCPP_AUTH_STATUS_EXPIRED;
+		}
+		break;
+	}
+}
+
+static int reply(struct ocpp_gateway *gw, int station,
+		const struct ocpp_message *req, void *payload, size_t size)
+{
+	struct ocpp_message res = {
+		.role = OCPP_MSG_ROLE_CALLRESULT,
+		.type = req->type,
+		.payload.fmt.data = payload,
+		.payload.size = size,
+	};
+
+	memcpy(res.id, req->id, sizeof(res.id));
+
+	return gw->send_downstream(station, &res, gw->ctx);
+}
+
+static int start_transaction_offline(struct ocpp_gateway *gw, int station,
+		const struct ocpp_message *msg)
+{
+	const struct ocpp_StartTransaction *req = msg->payload.fmt.request;
+
+	for (int i = 0; i < OCPP_GATEWAY_OFFLINE_TX_MAX; i++) {
+		struct ocpp_gateway_offline_tx *tx = &gw->offline[i];
+
+		if (tx->used) {
+			continue;
+		}
+
+		struct ocpp_StartTransaction_conf conf = {
+			.transactionId = gw->offline_tx_id,
+		};
+		authorize_offline(gw, req->idTag, &conf.idTagInfo);
+
+		const int err = reply(gw, station, msg, &conf, sizeof(conf));
+
+		if (err == 0) {
+			*tx = (struct ocpp_gateway_offline_tx) {
+				.req = *req,
+				.local_id = conf.transactionId,
+				.station = (int16_t)station,
+				.used = true,
+			};
+			gw->offline_tx_id = gw->offline_tx_id == INT_MIN?
+				-1 : gw->offline_tx_id - 1;
+		}
+
+		return err;
+	}
+
+	return -ENOSPC;
+}
+
+static int answer_offline(struct ocpp_gateway *gw, int station,
+		const struct ocpp_message *msg)
+{
+	if (msg->type == OCPP_MSG_AUTHORIZE &&
+			msg->payload.size >= sizeof(struct ocpp_Authorize)) {
+		const struct ocpp_Authorize *req = msg->payload.fmt.request;
+		struct ocpp_Authorize_conf conf;
+
+		authorize_offline(gw, req->idTag, &conf.idTagInfo);
+		return reply(gw, station, msg, &conf, sizeof(conf));
+	} else if (msg->type == OCPP_MSG_START_TRANSACTION &&
+			msg->payload.size >=
+			sizeof(struct ocpp_StartTransaction)) {
+		return start_transaction_offline(gw, station, msg);
+	}
+
+	return -ENOTCONN;
+}
+
+static int *get_transaction_id(const struct ocpp_message *msg)
+{
+	void *p = msg->payload.fmt.data;
+
+	if (msg->type == OCPP_MSG_STOP_TRANSACTION &&
+			msg->payload.size >= sizeof(struct ocpp_StopTransaction)) {
+		return &((struct ocpp_StopTransaction *)p)->transactionId;
+	} else if (msg->type == OCPP_MSG_METER_VALUES &&
+			msg->payload.size >= sizeof(struct ocpp_MeterValues)) {
+		return &((struct ocpp_MeterValues *)p)->transactionId;
+	} else if (msg->type == OCPP_MSG_REMOTE_STOP_TRANSACTION &&
+			msg->payload.size >=
+			sizeof(struct ocpp_RemoteStopTransaction)) {
+		return &((struct ocpp_RemoteStopTransaction *)p)->transactionId;
+	}
+
+	return NULL;
+}
+
+/* Local ids of the transactions started offline turn into the ones of the
+ * central system on the way up. The offline transaction is returned for
+ * StopTransaction, to be forgotten once the transaction is over. */
+static int translate_upstream(struct ocpp_gateway *gw, int station,
+		const struct ocpp_message *msg, int *offline_tx)
+{
+	int *txid = get_transaction_id(msg);
+
+	*offline_tx = -1;
+
+	if (txid == NULL || *txid >= 0) {
+		return 0;
+	}
+
+	for (int i = 0; i < OCPP_GATEWAY_OFFLINE_TX_MAX; i++) {
+		const struct ocpp_gateway_offline_tx *tx = &gw->offline[i];
+
+		if (!tx->used || tx->station != station ||
+				tx->local_id != *txid) {
+			continue;
+		} else if (!tx->replayed) {
+			return -EAGAIN;
+		}
+
+		*txid = tx->remote_id;
+		if (msg->type == OCPP_MSG_STOP_TRANSACTION) {
+			*offline_tx = i;
+		}
+		break;
+	}
+
+	return 0;
+}
+
+static void translate_downstream(const struct ocpp_gateway *gw, int station,
+		const struct ocpp_message *msg)
+{
+	int *txid = get_transaction_id(msg);
+
+	if (txid == NULL) {
+		return;
+	}
+
+	for (int i = 0; i < OCPP_GATEWAY_OFFLINE_TX_MAX; i++) {
+		const struct ocpp_gateway_offline_tx *tx = &gw->offline[i];
+
+		if (tx->used && tx->replayed && tx->station == station &&
+				tx->remote_id == *txid) {
+			*txid = tx->local_id;
+			break;
+		}
+	}
+}
+
+static const char *get_idtag(const struct ocpp_message *msg)
+{
+	if (msg->type == OCPP_MSG_AUTHORIZE &&
+			msg->payload.size >= sizeof(struct ocpp_Authorize)) {
+		return ((const struct ocpp_Authorize *)
+				msg->payload.fmt.request)->idTag;
+	} else if (msg->type == OCPP_MSG_START_TRANSACTION &&
+			msg->payload.size >=
+			sizeof(struct ocpp_StartTransaction)) {
+		return ((const struct ocpp_StartTransaction *)
+				msg->payload.fmt.request)->idTag;
+	}
+
+	return NULL;
+}
+
+static void learn_from(struct ocpp_gateway *gw,
+		const struct ocpp_gateway_route *route,
+		const struct ocpp_message *msg)
+{
+	if (msg->role != OCPP_MSG_ROLE_CALLRESULT) {
+		return;
+	} else if (route->type == OCPP_MSG_AUTHORIZE && msg->payload.size >=
+			sizeof(struct ocpp_Authorize_conf)) {
+		learn(gw, route->idTag, &((const struct ocpp_Authorize_conf *)
+				msg->payload.fmt.response)->idTagInfo);
+	} else if (route->type == OCPP_MSG_START_TRANSACTION &&
+			msg->payload.size >=
+			sizeof(struct ocpp_StartTransaction_conf)) {
+		learn(gw, route->idTag,
+				&((const struct ocpp_StartTransaction_conf *)
+				msg->payload.fmt.response)->idTagInfo);
+	}
+}
+
+/* @return true if the result is of the gateway itself, not to be passed
+ *         down */
+static bool settle_offline(struct ocpp_gateway *gw,
+		const struct ocpp_gateway_route *route,
+		const struct ocpp_message *msg)
+{
+	if (route->offline_tx < 0) {
+		return false;
+	}
+
+	struct ocpp_gateway_offline_tx *tx = &gw->offline[route->offline_tx];
+	const bool result = msg->role == OCPP_MSG_ROLE_CALLRESULT;
+
+	if (route->type == OCPP_MSG_STOP_TRANSACTION) {
+		tx->used = !result;
+		return false;
+	}
+
+	/* The replay refused is dropped, not to be replayed forever. */
+	if (result && msg->payload.size >=
+			sizeof(struct ocpp_StartTransaction_conf)) {
+		tx->remote_id = ((const struct ocpp_StartTransaction_conf *)
+				msg->payload.fmt.response)->transactionId;
+		tx->replayed = true;
+	} else {
+		tx->used = false;
+	}
+
+	tx->replaying = false;
+
+	return true;
+}
+
+static int replay(struct ocpp_gateway *gw, int index)
+{
+	struct ocpp_gateway_offline_tx *tx = &gw->offline[index];
+	struct ocpp_gateway_route *route;
+	struct ocpp_message msg = {
+		.role = OCPP_MSG_ROLE_CALL,
+		.type = OCPP_MSG_START_TRANSACTION,
+		.payload.fmt.request = &tx->req,
+		.payload.size = sizeof(tx->req),
+	};
+	int err;
+
+	if ((route = alloc_route(gw, tx->station, msg.type, true)) == NULL) {
+		return -ENOSPC;
+	} else if ((err = make_upstream_id(gw, tx->station, msg.id)) != 0 ||
+			(err = gw->send_upstream(uplink_of(gw, tx->station),
+					&msg, gw->ctx)) != 0) {
+		route->used = false;
+		return err;
+	}
+
+	memcpy(route->id, msg.id, sizeof(route->id));
+	strcpy(route->idTag, tx->req.idTag);
+	route->offline_tx = (int8_t)index;
+	tx->replaying = true;
+
+	return 0;
+}
+
+static int relay_call_upstream(struct ocpp_gateway *gw, int station,
+		struct ocpp_message *msg)
+{
+	struct ocpp_gateway_route *route;
+	struct ocpp_message fwd = *msg;
+	const char *idTag;
+	int offline_tx;
+	int err;
+
+	if (!is_online(gw, station)) {
+		return answer_offline(gw, station, msg);
+	} else if ((err = translate_upstream(gw, station, msg, &offline_tx))
+			!= 0) {
+		return err;
+	} else if ((route = alloc_route(gw, station, msg->type, true))
+			== NULL) {
+		return -ENOSPC;
+	} else if ((err = make_upstream_id(gw, station, fwd.id)) != 0 ||
+			(err = gw->send_upstream(uplink_of(gw, station),
+					&fwd, gw->ctx)) != 0) {
+		route->used = false;
+		return err;
+	}
+
+	memcpy(route->id, fwd.id, sizeof(route->id));
+	memcpy(route->station_id, msg->id, sizeof(route->station_id));
+	route->offline_tx = (int8_t)offline_tx;
+	if ((idTag = get_idtag(msg)) != NULL) {
+		strcpy(route->idTag, idTag);
+	}
+
+	return 0;
+}
+
+static int relay_call_downstream(struct ocpp_gateway *gw, int uplink,
+		struct ocpp_message *msg)
+{
+	const char *delimiter = strchr(msg->id, ID_DELIMITER);
+	const size_t len = delimiter? (size_t)(delimiter - msg->id) : 0;
+	struct ocpp_gateway_route *route;
+	int station;
+	int err;
+
+	for (station = 0; station < OCPP_GATEWAY_STATIONS_MAX; station++) {
+		const char *identity = gw->stations[station].identity;
+
+		if (gw->stations[station].used &&
+				uplink_of(gw, station) == uplink &&
+				strncmp(identity, msg->id, len) == 0 &&
+				identity[len] == '\0') {
+			break;
+		}
+	}
+
+	if (len == 0 || station >= OCPP_GATEWAY_STATIONS_MAX) {
+		return -ENOENT;
+	} else if ((route = alloc_route(gw, station, msg->type, false))
+			== NULL) {
+		return -ENOSPC;
+	}
+
+	memcpy(route->id, msg->id, sizeof(route->id));
+	translate_downstream(gw, station, msg);
+
+	if ((err = gw->send_downstream(station, msg, gw->ctx)) != 0) {
+		route->used = false;
+	}
+
+	return err;
+}
+
+int ocpp_gateway_from_station(struct ocpp_gateway *gw, int station,
+		struct ocpp_message *msg)
+{
+	int i;
+
+	if (gw == NULL || msg == NULL) {
+		return -EINVAL;
+	} else if (!is_station(gw, station)) {
+		return -ENOENT;
+	} else if (msg->role == OCPP_MSG_ROLE_CALL) {
+		return relay_call_upstream(gw, station, msg);
+	} else if ((i = find_route(gw, msg->id, false)) < 0 ||
+			gw->routes[i].station != station) {
+		return -ENOENT;
+	}
+
+	gw->routes[i].used = false;
+
+	return gw->send_upstream(uplink_of(gw, station), msg, gw->ctx);
+}
+
+int ocpp_gateway_from_upstream(struct ocpp_gateway *gw, int uplink,
+		struct ocpp_message *msg)
+{
+	struct ocpp_gateway_route *route;
+	int i;
+
+	if (gw == NULL || msg == NULL || uplink < 0 ||
+			uplink >= gw->nr_uplinks) {
+		return -EINVAL;
+	} else if (msg->role == OCPP_MSG_ROLE_CALL) {
+		return relay_call_downstream(gw, uplink, msg);
+	} else if ((i = find_route(gw, msg->id, true)) < 0) {
+		return -ENOENT;
+	}
+
+	route = &gw->routes[i];
+
+	learn_from(gw, route, msg);
+
+	const bool settled = settle_offline(gw, route, msg);
+	const int station = route->station;
+	struct ocpp_message res = *msg;
+
+	memcpy(res.id, route->station_id, sizeof(res.id));
+	route->used = false;
+
+	if (settled || !is_station(gw, station)) {
+		return 0;
+	}
+
+	return gw->send_downstream(station, &res, gw->ctx);
+}
+
+void ocpp_gateway_step(struct ocpp_gateway *gw)
+{
+	const time_t now = time(NULL);
+
+	for (int i = 0; i < OCPP_GATEWAY_ROUTES_MAX; i++) {
+		struct ocpp_gateway_route *route = &gw->routes[i];
+
+		if (route->used && route->expiry <= now) {
+			free_route(gw, route);
+		}
+	}
+
+	for (int i = 0; i < OCPP_GATEWAY_OFFLINE_TX_MAX; i++) {
+		const struct ocpp_gateway_offline_tx *tx = &gw->offline[i];
+
+		if (tx->used && !tx->replayed && !tx->replaying &&
+				is_online(gw, tx->station)) {
+			if (replay(gw, i) == -ENOSPC) {
+				break;
+			}
+		}
+	}
+}
+
+ocpp_message_t ocpp_gateway_get_type(const struct ocpp_gateway *gw,
+		bool from_upstream, const char *idstr)
+{
+	const int i = find_route(gw, idstr, from_upstream);
+	return i < 0? OCPP_MSG_MAX : gw->routes[i].type;
+}
+
+int ocpp_gateway_set_uplink(struct ocpp_gateway *gw, int uplink, bool up)
+{
+	if (gw == NULL || uplink < 0 || uplink >= gw->nr_uplinks) {
+		return -EINVAL;
+	}
+
+	gw->uplink_up[uplink] = up;
+
+	if (up) {
+		return 0;
+	}
+
+	for (int i = 0; i < OCPP_GATEWAY_ROUTES_MAX; i++) {
+		struct ocpp_gateway_route *route = &gw->routes[i];
+
+		if (route->used && uplink_of(gw, route->station) == uplink) {
+			free_route(gw, route);
+		}
+	}
+
+	return 0;
+}
+
+void ocpp_gateway_allow_offline_unknown(struct ocpp_gateway *gw, bool allow)
+{
+	gw->allow_unknown = allow;
+}
+
+int ocpp_gateway_get_uplink(const struct ocpp_gateway *gw, int station)
+{
+	if (!is_station(gw, station)) {
+		return -ENOENT;
+	}
+
+	return uplink_of(gw, station);
+}
+
+int ocpp_gateway_add_station(struct ocpp_gateway *gw, const char *identity)
+{
+	int free_slot = -ENOSPC;
+
+	if (gw == NULL || identity == NULL || identity[0] == '\0' ||
+			strlen(identity) >= OCPP_GATEWAY_IDENTITY_MAXLEN ||
+			strchr(identity, ID_DELIMITER) != NULL ||
+			strchr(identity, UPSTREAM_ID_DELIMITER) != NULL) {
+		return -EINVAL;
+	}
+
+	for (int i = OCPP_GATEWAY_STATIONS_MAX - 1; i >= 0; i--) {
+		if (!gw->stations[i].used) {
+			free_slot = i;
+		} else if (strcmp(gw->stations[i].identity, identity) == 0) {
+			return -EEXIST;
+		}
+	}
+
+	if (free_slot >= 0) {
+		strcpy(gw->stations[free_slot].identity, identity);
+		gw->stations[free_slot].used = true;
+	}
+
+	return free_slot;
+}
+
+int ocpp_gateway_remove_station(struct ocpp_gateway *gw, int station)
+{
+	if (gw == NULL || !is_station(gw, station)) {
+		return -ENOENT;
+	}
+
+	for (int i = 0; i < OCPP_GATEWAY_ROUTES_MAX; i++) {
+		struct ocpp_gateway_route *route = &gw->routes[i];
+
+		if (route->used && route->station == station &&
+				!is_replay(route)) {
+			route->used = false;
+		}
+	}
+
+	gw->stations[station].used = false;
+
+	return 0;
+}
+
+int ocpp_gateway_init(struct ocpp_gateway *gw, uint8_t nr_uplinks,
+		ocpp_gateway_send_t send_upstream,
+		ocpp_gateway_send_t send_downstream, void *ctx)
+{
+	if (gw == NULL || send_upstream == NULL || send_downstream == NULL ||
+			nr_uplinks == 0 || nr_uplinks > OCPP_GATEWAY_UPLINKS_MAX) {
+		return -EINVAL;
+	}
+
+	*gw = (struct ocpp_gateway) {
+		.send_upstream = send_upstream,
+		.send_downstream = send_downstream,
+		.ctx = ctx,
+		.offline_tx_id = -1,
+		.nr_uplinks = nr_uplinks,
+	};
+
+	return 0;
+}
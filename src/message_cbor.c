@@ -0,0 +1,822 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "ocpp/message_cbor.h"
+#include "ocpp/message_schema.h"
+#include "ocpp/core/configuration_csl.h"
+#include <string.h>
+#include <errno.h>
+
+#define MEASURAND_NAME_MAXLEN		(31 + 1/*null*/)
+
+typedef enum {
+	MAJOR_UINT,
+	MAJOR_NINT,
+	MAJOR_BYTES,
+	MAJOR_TEXT,
+	MAJOR_ARRAY,
+	MAJOR_MAP,
+	MAJOR_TAG,
+	MAJOR_SIMPLE,
+} major_t;
+
+#define SIMPLE_FALSE			20
+#define SIMPLE_TRUE			21
+
+struct writer {
+	uint8_t *buf;
+	size_t bufsize;
+	size_t total; /* counts beyond bufsize to tell the overflow */
+};
+
+static void put_bytes(struct writer *w, const void *data, size_t n)
+{
+	if (n <= w->bufsize && w->total <= w->bufsize - n) {
+		memcpy(&w->buf[w->total], data, n);
+	}
+
+	w->total += n;
+}
+
+/* The initial byte and the argument in the shortest form. */
+static void put_head(struct writer *w, major_t major, uint64_t arg)
+{
+	uint8_t head[9];
+	size_t n = 0;
+
+	if (arg < 24) {
+		head[0] = (uint8_t)(major << 5 | arg);
+	} else if (arg <= UINT8_MAX) {
+		head[0] = (uint8_t)(major << 5 | 24);
+		n = 1;
+	} else if (arg <= UINT16_MAX) {
+		head[0] = (uint8_t)(major << 5 | 25);
+		n = 2;
+	} else if (arg <= UINT32_MAX) {
+		head[0] = (uint8_t)(major << 5 | 26);
+		n = 4;
+	} else {
+		head[0] = (uint8_t)(major << 5 | 27);
+		n = 8;
+	}
+
+	for (size_t i = 0; i < n; i++) {
+		head[n - i] = (uint8_t)(arg >> (i * 8));
+	}
+
+	put_bytes(w, head, n + 1);
+}
+
+static void put_int(struct writer *w, int64_t v)
+{
+	if (v < 0) {
+		put_head(w, MAJOR_NINT, (uint64_t)-(v + 1));
+	} else {
+		put_head(w, MAJOR_UINT, (uint64_t)v);
+	}
+}
+
+static void put_text(struct writer *w, const char *s, size_t len)
+{
+	put_head(w, MAJOR_TEXT, len);
+	put_bytes(w, s, len);
+}
+
+static bool has_value(const struct ocpp_field *f, const char *obj,
+		size_t avail)
+{
+	if (!ocpp_is_field_present(f, obj, avail)) {
+		return false;
+	} else if (f->type == OCPP_FIELD_ENUM) {
+		return ocpp_get_field_enum_name(f, obj + f->offset) != NULL;
+	}
+
+	return true;
+}
+
+static void put_object(struct writer *w, const struct ocpp_schema *schema,
+		const char *obj, size_t avail);
+
+static void put_value(struct writer *w, const struct ocpp_field *f,
+		const char *obj, size_t avail)
+{
+	const char *p = obj + f->offset;
+	const struct ocpp_schema *schema = f->spec;
+	const char *s;
+	size_t len;
+	uint64_t u64;
+	time_t t;
+
+	switch (f->type) {
+	case OCPP_FIELD_STR:
+	case OCPP_FIELD_TRAILING:
+	case OCPP_FIELD_STRPTR:
+		s = ocpp_get_field_string(f, p, avail - f->offset, &len);
+		put_text(w, s, len);
+		break;
+	case OCPP_FIELD_INT:
+	case OCPP_FIELD_TENTH:
+	case OCPP_FIELD_ENUM:
+	case OCPP_FIELD_MEASURAND:
+		put_int(w, ocpp_load_field_int(p, f->size));
+		break;
+	case OCPP_FIELD_U64:
+		memcpy(&u64, p, sizeof(u64));
+		put_head(w, MAJOR_UINT, u64);
+		break;
+	case OCPP_FIELD_BOOL:
+		put_head(w, MAJOR_SIMPLE, *p? SIMPLE_TRUE : SIMPLE_FALSE);
+		break;
+	case OCPP_FIELD_TIME:
+		memcpy(&t, p, sizeof(t));
+		put_int(w, (int64_t)t);
+		break;
+	case OCPP_FIELD_OBJECT:
+		put_object(w, schema, p, avail - f->offset);
+		break;
+	case OCPP_FIELD_ARRAY:
+		len = ocpp_count_field_elements(f, obj, avail);
+		put_head(w, MAJOR_ARRAY, len);
+		for (size_t i = 0; i < len; i++) {
+			put_object(w, schema, p, schema->size);
+			p += schema->size;
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+/* A map of the members present, keyed by their index in the schema. */
+static void put_object(struct writer *w, const struct ocpp_schema *schema,
+		const char *obj, size_t avail)
+{
+	uint32_t present = 0;
+
+	for (uint8_t i = 0; i < schema->nr_fields; i++) {
+		if (has_value(&schema->fields[i], obj, avail)) {
+			present |= 1u << i;
+		}
+	}
+
+	put_head(w, MAJOR_MAP, (uint64_t)__builtin_popcount(present));
+
+	for (; present; present &= present - 1) {
+		const unsigned int i = (unsigned int)__builtin_ctz(present);
+		const struct ocpp_field *f = &schema->fields[i];
+
+		put_head(w, MAJOR_UINT, i);
+		if (f->flags & OCPP_FIELD_FIRST_OF_ARRAY) {
+			put_head(w, MAJOR_ARRAY, 1);
+		}
+		put_value(w, f, obj, avail);
+	}
+}
+
+static void put_callerror(struct writer *w, const struct ocpp_message *msg)
+{
+	const struct ocpp_CallError *err = msg->payload.fmt.response;
+	ocpp_callerror_t code = OCPP_CALLERROR_GENERIC;
+	const char *desc = "";
+	size_t desclen = 0;
+
+	if (err && msg->payload.size >= sizeof(*err)) {
+		desc = err->errorDescription;
+		desclen = strnlen(desc, sizeof(err->errorDescription));
+		if (err->errorCode <= OCPP_CALLERROR_GENERIC) {
+			code = err->errorCode;
+		}
+	}
+
+	put_head(w, MAJOR_UINT, code);
+	put_text(w, desc, desclen);
+}
+
+static int encode(struct writer *w, const struct ocpp_message *msg)
+{
+	const struct ocpp_schema *schema = NULL;
+
+	if (msg->type >= OCPP_MSG_MAX) {
+		return -EINVAL;
+	}
+
+	switch (msg->role) {
+	case OCPP_MSG_ROLE_CALL:
+	case OCPP_MSG_ROLE_CALLRESULT:
+		schema = ocpp_get_message_schema(msg->type, msg->role);
+		break;
+	case OCPP_MSG_ROLE_CALLERROR:
+		break;
+	case OCPP_MSG_ROLE_NONE:
+	case OCPP_MSG_ROLE_ALLOC:
+	default:
+		return -EINVAL;
+	}
+
+	if (schema && schema->size > 0 && (msg->payload.fmt.data == NULL ||
+			msg->payload.size < schema->size)) {
+		return -EINVAL;
+	}
+
+	put_head(w, MAJOR_ARRAY, msg->role == OCPP_MSG_ROLE_CALLRESULT? 3 : 4);
+	put_head(w, MAJOR_UINT, msg->role);
+	put_text(w, msg->id, strnlen(msg->id, sizeof(msg->id)));
+
+	if (schema == NULL) {
+		put_callerror(w, msg);
+		return 0;
+	} else if (msg->role == OCPP_MSG_ROLE_CALL) {
+		put_head(w, MAJOR_UINT, msg->type);
+	}
+
+	put_object(w, schema, (const char *)msg->payload.fmt.data,
+			msg->payload.size);
+
+	return 0;
+}
+
+int ocpp_encode_message_cbor(const struct ocpp_message *msg,
+		void *buf, size_t bufsize)
+{
+	struct writer w = {
+		.buf = (uint8_t *)buf,
+		.bufsize = bufsize,
+	};
+
+	if (msg == NULL || (buf == NULL && bufsize > 0)) {
+		return -EINVAL;
+	}
+
+	const int err = encode(&w, msg);
+
+	if (err < 0) {
+		return err;
+	} else if (w.total > w.bufsize) {
+		return -ENOBUFS;
+	}
+
+	return (int)w.total;
+}
+
+struct parser {
+	const uint8_t *p;
+	const uint8_t *end;
+	char *buf;
+	size_t bufsize;
+	size_t tail; /* end of the data stored after the struct */
+	unsigned int depth;
+	ocpp_callerror_t error;
+};
+
+static int fail(struct parser *ps, ocpp_callerror_t error, int err)
+{
+	ps->error = error;
+	return err;
+}
+
+static int fail_formation(struct parser *ps)
+{
+	return fail(ps, OCPP_CALLERROR_FORMATION_VIOLATION, -EBADMSG);
+}
+
+static int fail_type(struct parser *ps)
+{
+	return fail(ps, OCPP_CALLERROR_TYPE_CONSTRAINT_VIOLATION, -EBADMSG);
+}
+
+static int fail_property(struct parser *ps)
+{
+	return fail(ps, OCPP_CALLERROR_PROPERTY_CONSTRAINT_VIOLATION, -EBADMSG);
+}
+
+static size_t remaining(const struct parser *ps)
+{
+	return (size_t)(ps->end - ps->p);
+}
+
+static int peek_major(const struct parser *ps)
+{
+	return ps->p < ps->end? *ps->p >> 5 : -1;
+}
+
+/* Of definite lengths only, as the encoder never puts the indefinite. */
+static int get_head(struct parser *ps, major_t *major, uint64_t *arg)
+{
+	if (ps->p >= ps->end) {
+		return fail_formation(ps);
+	}
+
+	const uint8_t ib = *ps->p++;
+	const uint8_t ai = ib & 0x1f;
+
+	*major = (major_t)(ib >> 5);
+	*arg = ai;
+
+	if (ai < 24) {
+		return 0;
+	} else if (ai > 27) {
+		return fail_formation(ps);
+	}
+
+	const size_t n = 1u << (ai - 24);
+
+	if (remaining(ps) < n) {
+		return fail_formation(ps);
+	}
+
+	*arg = 0;
+	for (size_t i = 0; i < n; i++) {
+		*arg = *arg << 8 | *ps->p++;
+	}
+
+	return 0;
+}
+
+/* @return 0 with the argument if of the major type expected */
+static int expect(struct parser *ps, major_t major, uint64_t *arg)
+{
+	major_t got;
+	const int err = get_head(ps, &got, arg);
+
+	if (err != 0) {
+		return err;
+	} else if (got != major) {
+		return fail_type(ps);
+	}
+
+	return 0;
+}
+
+/* The same as `expect()` but for the frame around the payload, of which a
+ * mismatch is of the formation rather than the type of a member. */
+static int expect_frame(struct parser *ps, major_t major, uint64_t *arg)
+{
+	if (peek_major(ps) != (int)major) {
+		return fail_formation(ps);
+	}
+
+	return expect(ps, major, arg);
+}
+
+static int skip_value(struct parser *ps)
+{
+	major_t major;
+	uint64_t arg;
+	int err;
+
+	if ((err = get_head(ps, &major, &arg)) != 0) {
+		return err;
+	}
+
+	switch (major) {
+	case MAJOR_BYTES:
+	case MAJOR_TEXT:
+		if (arg > remaining(ps)) {
+			return fail_formation(ps);
+		}
+		ps->p += arg;
+		return 0;
+	case MAJOR_MAP:
+		if (arg > remaining(ps) / 2) {
+			return fail_formation(ps);
+		}
+		arg *= 2;
+		/* fall through */
+	case MAJOR_ARRAY:
+		if (arg > remaining(ps)) { /* a byte at least for each */
+			return fail_formation(ps);
+		} else if (ps->depth >= OCPP_MESSAGE_CBOR_MAX_DEPTH) {
+			return fail_formation(ps);
+		}
+		ps->depth++;
+		for (uint64_t i = 0; i < arg && err == 0; i++) {
+			err = skip_value(ps);
+		}
+		ps->depth--;
+		return err;
+	case MAJOR_TAG: /* nests the value tagged as deep as a container */
+		if (ps->depth >= OCPP_MESSAGE_CBOR_MAX_DEPTH) {
+			return fail_formation(ps);
+		}
+		ps->depth++;
+		err = skip_value(ps);
+		ps->depth--;
+		return err;
+	case MAJOR_UINT:
+	case MAJOR_NINT:
+	case MAJOR_SIMPLE:
+	default:
+		return 0;
+	}
+}
+
+static int get_int(struct parser *ps, int64_t *v)
+{
+	major_t major;
+	uint64_t arg;
+	int err;
+
+	if ((err = get_head(ps, &major, &arg)) != 0) {
+		return err;
+	} else if (major != MAJOR_UINT && major != MAJOR_NINT) {
+		return fail_type(ps);
+	} else if (arg > INT64_MAX) {
+		return fail_property(ps);
+	}
+
+	*v = major == MAJOR_UINT? (int64_t)arg : -1 - (int64_t)arg;
+
+	return 0;
+}
+
+/* Integers are bounded by their members, of up to 32 bits as in OCPP-J. */
+static int parse_integer(struct parser *ps, const struct ocpp_field *f,
+		int64_t *v)
+{
+	const size_t bits = f->size < sizeof(int32_t)? f->size * 8 : 32;
+	const int64_t max = (int64_t)((1ull << (bits - 1)) - 1);
+	int err;
+
+	if ((err = get_int(ps, v)) != 0) {
+		return err;
+	} else if (*v > max || *v < -max - 1) {
+		return fail_property(ps);
+	}
+
+	return 0;
+}
+
+static int parse_object(struct parser *ps, const struct ocpp_schema *schema,
+		char *obj);
+
+static int parse_array(struct parser *ps, const struct ocpp_field *f, char *obj,
+		char *dst)
+{
+	const struct ocpp_schema *schema = f->spec;
+	uint64_t n;
+	int err;
+
+	if ((err = expect(ps, MAJOR_ARRAY, &n)) != 0) {
+		return err;
+	} else if (n > remaining(ps)) {
+		return fail_formation(ps);
+	}
+
+	for (uint64_t i = 0; i < n; i++) {
+		char *elem = dst + (size_t)i * schema->size;
+		const size_t end = (size_t)(elem - ps->buf) + schema->size;
+
+		if (end > ps->bufsize) {
+			return fail(ps, OCPP_CALLERROR_OCCURRENCE_CONSTRAINT_VIOLATION,
+					-ENOBUFS);
+		}
+
+		memset(elem, 0, schema->size);
+		if ((err = parse_object(ps, schema, elem)) != 0) {
+			return err;
+		}
+
+		ps->tail = end > ps->tail? end : ps->tail;
+	}
+
+	if (f->count != OCPP_FIELD_NONE) {
+		ocpp_store_field_int(obj + f->count, sizeof(int), (int64_t)n);
+	}
+
+	return 0;
+}
+
+static int parse_string_field(struct parser *ps, const struct ocpp_field *f,
+		char *dst)
+{
+	size_t cap = f->size - 1u;
+	uint64_t len;
+	int err;
+
+	if ((err = expect(ps, MAJOR_TEXT, &len)) != 0) {
+		return err;
+	} else if (len > remaining(ps)) {
+		return fail_formation(ps);
+	}
+
+	switch (f->type) {
+	case OCPP_FIELD_STR:
+		if (len > cap) {
+			return fail_property(ps);
+		}
+		break;
+	case OCPP_FIELD_TRAILING:
+	case OCPP_FIELD_STRPTR:
+		if (f->type == OCPP_FIELD_STRPTR) {
+			char *str = ps->buf + ps->tail;
+			memcpy(dst, &str, sizeof(str));
+			dst = str;
+		}
+		if ((size_t)(dst - ps->buf) >= ps->bufsize) {
+			return fail(ps, OCPP_CALLERROR_PROPERTY_CONSTRAINT_VIOLATION,
+					-ENOBUFS);
+		}
+		cap = ps->bufsize - (size_t)(dst - ps->buf) - 1/*null*/;
+		if (len > cap) {
+			return fail(ps, OCPP_CALLERROR_PROPERTY_CONSTRAINT_VIOLATION,
+					-ENOBUFS);
+		}
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	memcpy(dst, ps->p, (size_t)len);
+	dst[len] = '\0';
+	ps->p += len;
+
+	if (f->type != OCPP_FIELD_STR) {
+		const size_t end = (size_t)(dst - ps->buf) + (size_t)len + 1;
+		ps->tail = end > ps->tail? end : ps->tail;
+	}
+
+	return 0;
+}
+
+static int parse_value(struct parser *ps, const struct ocpp_field *f, char *obj,
+		char *dst)
+{
+	const struct ocpp_names *names = f->spec;
+	char str[MEASURAND_NAME_MAXLEN];
+	int64_t v;
+	uint64_t u64;
+	time_t t;
+	int err;
+
+	switch (f->type) {
+	case OCPP_FIELD_STR:
+	case OCPP_FIELD_TRAILING:
+	case OCPP_FIELD_STRPTR:
+		return parse_string_field(ps, f, dst);
+	case OCPP_FIELD_INT:
+	case OCPP_FIELD_TENTH:
+		if ((err = parse_integer(ps, f, &v)) == 0) {
+			ocpp_store_field_int(dst, f->size, v);
+		}
+		return err;
+	case OCPP_FIELD_U64:
+		if ((err = expect(ps, MAJOR_UINT, &u64)) == 0) {
+			memcpy(dst, &u64, sizeof(u64));
+		}
+		return err;
+	case OCPP_FIELD_BOOL:
+		if ((err = expect(ps, MAJOR_SIMPLE, &u64)) != 0) {
+			return err;
+		} else if (u64 != SIMPLE_TRUE && u64 != SIMPLE_FALSE) {
+			return fail_type(ps);
+		} else {
+			const bool b = u64 == SIMPLE_TRUE;
+			memcpy(dst, &b, sizeof(b));
+		}
+		return 0;
+	case OCPP_FIELD_TIME:
+		if ((err = get_int(ps, &v)) == 0) {
+			t = (time_t)v;
+			memcpy(dst, &t, sizeof(t));
+		}
+		return err;
+	case OCPP_FIELD_ENUM:
+		if ((err = parse_integer(ps, f, &v)) != 0) {
+			return err;
+		} else if (v < 0 || (uint64_t)v >= names->nr_names ||
+				names->names[v] == NULL) {
+			return fail_property(ps);
+		}
+		ocpp_store_field_int(dst, f->size, v);
+		return 0;
+	case OCPP_FIELD_MEASURAND: /* one of them as in OCPP-J */
+		if ((err = parse_integer(ps, f, &v)) != 0) {
+			return err;
+		} else if (v <= 0 || (v & (v - 1)) != 0 ||
+				ocpp_encode_configuration_csl(
+					"MeterValuesSampledData", (int)v,
+					str, sizeof(str)) <= 0) {
+			return fail_property(ps);
+		}
+		ocpp_store_field_int(dst, f->size, v);
+		return 0;
+	case OCPP_FIELD_OBJECT:
+		return parse_object(ps, f->spec, dst);
+	case OCPP_FIELD_ARRAY:
+		return parse_array(ps, f, obj, dst);
+	default:
+		return -EINVAL;
+	}
+}
+
+static int parse_field(struct parser *ps, const struct ocpp_field *f, char *obj)
+{
+	char *dst = obj + f->offset;
+	uint64_t n;
+	int err;
+
+	if (!(f->flags & OCPP_FIELD_FIRST_OF_ARRAY)) {
+		return parse_value(ps, f, obj, dst);
+	}
+
+	if ((err = expect(ps, MAJOR_ARRAY, &n)) != 0) {
+		return err;
+	} else if (n > remaining(ps)) {
+		return fail_formation(ps);
+	} else if (n > 0 && (err = parse_value(ps, f, obj, dst)) != 0) {
+		return err;
+	}
+
+	for (uint64_t i = 1; i < n && err == 0; i++) {
+		err = skip_value(ps);
+	}
+
+	return err;
+}
+
+static int parse_object(struct parser *ps, const struct ocpp_schema *schema,
+		char *obj)
+{
+	uint32_t seen = 0;
+	uint64_t n;
+	int err;
+
+	if ((err = expect(ps, MAJOR_MAP, &n)) != 0) {
+		return err;
+	} else if (n > remaining(ps) / 2) {
+		return fail_formation(ps);
+	} else if (ps->depth >= OCPP_MESSAGE_CBOR_MAX_DEPTH) {
+		return fail_formation(ps);
+	}
+
+	ps->depth++;
+
+	for (uint64_t i = 0; i < n; i++) {
+		uint64_t key;
+
+		if ((err = expect_frame(ps, MAJOR_UINT, &key)) != 0) {
+			return err;
+		}
+
+		if (key >= schema->nr_fields) {
+			err = skip_value(ps);
+		} else {
+			seen |= 1u << key;
+			err = parse_field(ps, &schema->fields[key], obj);
+			ocpp_set_field_present(&schema->fields[key], obj);
+		}
+
+		if (err != 0) {
+			return err;
+		}
+	}
+
+	for (uint8_t i = 0; i < schema->nr_fields; i++) {
+		if ((schema->fields[i].flags & OCPP_FIELD_REQUIRED) &&
+				!(seen & (1u << i))) {
+			return fail(ps,
+				OCPP_CALLERROR_OCCURRENCE_CONSTRAINT_VIOLATION,
+				-EBADMSG);
+		}
+	}
+
+	ps->depth--;
+	return 0;
+}
+
+static int decode_payload(struct parser *ps, const struct ocpp_schema *schema,
+		struct ocpp_message *msg)
+{
+	if (ps->bufsize < schema->size) {
+		return fail(ps, OCPP_CALLERROR_INTERNAL, -ENOBUFS);
+	}
+
+	memset(ps->buf, 0, schema->size);
+	ps->tail = schema->size;
+
+	const int err = parse_object(ps, schema, ps->buf);
+
+	msg->payload.fmt.data = ps->buf;
+	msg->payload.size = ps->tail;
+
+	return err;
+}
+
+static int decode_callerror(struct parser *ps, struct ocpp_message *msg)
+{
+	struct ocpp_CallError *callerror = (struct ocpp_CallError *)(void *)ps->buf;
+	uint64_t code;
+	uint64_t len;
+	int err;
+
+	if (ps->bufsize < sizeof(*callerror)) {
+		return fail(ps, OCPP_CALLERROR_INTERNAL, -ENOBUFS);
+	} else if ((err = expect_frame(ps, MAJOR_UINT, &code)) != 0 ||
+			(err = expect_frame(ps, MAJOR_TEXT, &len)) != 0) {
+		return err;
+	} else if (len > remaining(ps)) {
+		return fail_formation(ps);
+	}
+
+	callerror->errorCode = code > OCPP_CALLERROR_GENERIC?
+		OCPP_CALLERROR_GENERIC : (ocpp_callerror_t)code;
+
+	/* the description is informative, so cut to fit */
+	const size_t n = len < sizeof(callerror->errorDescription) - 1?
+		(size_t)len : sizeof(callerror->errorDescription) - 1;
+	memcpy(callerror->errorDescription, ps->p, n);
+	callerror->errorDescription[n] = '\0';
+	ps->p += len;
+
+	msg->payload.fmt.data = callerror;
+	msg->payload.size = sizeof(*callerror);
+
+	return 0;
+}
+
+static int decode(struct parser *ps, struct ocpp_message *msg)
+{
+	uint64_t n;
+	uint64_t role;
+	uint64_t v;
+	int err;
+
+	if ((err = expect_frame(ps, MAJOR_ARRAY, &n)) != 0 ||
+			(err = expect_frame(ps, MAJOR_UINT, &role)) != 0) {
+		return err;
+	} else if (role < OCPP_MSG_ROLE_CALL || role > OCPP_MSG_ROLE_CALLERROR ||
+			n != (role == OCPP_MSG_ROLE_CALLRESULT? 3 : 4)) {
+		return fail_formation(ps);
+	}
+
+	if ((err = expect_frame(ps, MAJOR_TEXT, &v)) != 0) {
+		return err;
+	} else if (v > remaining(ps)) {
+		return fail_formation(ps);
+	} else if (v > sizeof(msg->id) - 1) {
+		return fail_property(ps);
+	}
+
+	memcpy(msg->id, ps->p, (size_t)v);
+	ps->p += v;
+	msg->role = (ocpp_message_role_t)role;
+
+	if (msg->role == OCPP_MSG_ROLE_CALL) {
+		if ((err = expect_frame(ps, MAJOR_UINT, &v)) != 0) {
+			return err;
+		} else if (v >= OCPP_MSG_MAX) {
+			return fail(ps, OCPP_CALLERROR_NOT_IMPLEMENTED,
+					-EBADMSG);
+		}
+		msg->type = (ocpp_message_t)v;
+	} else if ((msg->type = ocpp_get_type_from_idstr(msg->id))
+			== OCPP_MSG_MAX) {
+		return -ENOENT;
+	}
+
+	if (msg->role == OCPP_MSG_ROLE_CALLERROR) {
+		err = decode_callerror(ps, msg);
+	} else {
+		err = decode_payload(ps,
+			ocpp_get_message_schema(msg->type, msg->role), msg);
+	}
+
+	if (err != 0) {
+		return err;
+	} else if (ps->p != ps->end) {
+		return fail_formation(ps);
+	}
+
+	return 0;
+}
+
+int ocpp_decode_message_cbor(const void *data, size_t len,
+		struct ocpp_message *msg, void *buf, size_t bufsize,
+		ocpp_callerror_t *error)
+{
+	struct parser ps = {
+		.p = (const uint8_t *)data,
+		.end = (const uint8_t *)data + len,
+		.buf = (char *)buf,
+		.bufsize = bufsize,
+		.error = OCPP_CALLERROR_GENERIC,
+	};
+
+	if (data == NULL || msg == NULL || (buf == NULL && bufsize > 0)) {
+		return -EINVAL;
+	}
+
+	memset(msg, 0, sizeof(*msg));
+	msg->type = OCPP_MSG_MAX;
+
+	const int err = decode(&ps, msg);
+
+	if (err != 0 && error) {
+		*error = ps.error;
+	}
+
+	return err;
+}
@@ -0,0 +1,1525 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "ocpp/message_json.h"
+#include "ocpp/message_schema.h"
+#include "ocpp/core/configuration_csl.h"
+#include <string.h>
+#include <errno.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#define MEASURAND_NAME_MAXLEN		(31 + 1/*null*/)
+#define ISO8601_LEN			20 /* 2024-01-01T00:00:00Z */
+#define WORD_MAXLEN			(40 + 1/*null*/)
+
+struct writer {
+	char *buf;
+	size_t bufsize;
+	size_t len; /* in buf */
+	size_t total; /* counts beyond bufsize to tell the overflow */
+	ocpp_message_json_writer_t flush;
+	void *ctx;
+	int err;
+	char last; /* to put the separator before the next element */
+
+	struct ocpp_iovec *iov; /* NULL unless encoding into segments */
+	size_t iovcnt;
+	size_t nr_iov;
+	size_t seg; /* start in buf of the segment being written */
+	size_t referred; /* bytes in the segments referring in place */
+};
+
+static const char * const callerror_names[] = {
+	"NotImplemented",
+	"NotSupported",
+	"InternalError",
+	"ProtocolError",
+	"SecurityError",
+	"FormationViolation",
+	"PropertyConstraintViolation",
+	"OccurenceConstraintViolation", /* as spelled in OCPP-J 1.6 */
+	"TypeConstraintViolation",
+	"GenericError",
+};
+
+static void flush_chunk(struct writer *w)
+{
+	if (w->err == 0 && w->len > 0) {
+		w->err = (*w->flush)(w->buf, w->len, w->ctx);
+	}
+
+	w->len = 0;
+}
+
+static void put_raw(struct writer *w, const char *s, size_t n)
+{
+	if (n == 0) {
+		return;
+	}
+
+	w->total += n;
+	w->last = s[n - 1];
+
+	while (n > 0 && w->err == 0) {
+		if (w->len == w->bufsize) {
+			if (w->flush == NULL) {
+				return;
+			}
+			flush_chunk(w);
+			continue;
+		}
+
+		const size_t space = w->bufsize - w->len;
+		const size_t chunk = n < space? n : space;
+
+		memcpy(&w->buf[w->len], s, chunk);
+		w->len += chunk;
+		s += chunk;
+		n -= chunk;
+	}
+}
+
+static void put_char(struct writer *w, char c)
+{
+	put_raw(w, &c, 1);
+}
+
+/* Strings are scanned a vector at a time for the next quote, backslash or
+ * control character, as most of a frame is in strings, both ways. */
+static const char *scan_string(const char *p, const char *end)
+{
+#if defined(__AVX2__)
+	const __m256i quote32 = _mm256_set1_epi8('"');
+	const __m256i backslash32 = _mm256_set1_epi8('\\');
+	const __m256i ctrl32 = _mm256_set1_epi8(0x1f);
+
+	for (; (size_t)(end - p) >= 32; p += 32) {
+		const __m256i v =
+			_mm256_loadu_si256((const __m256i *)(const void *)p);
+		const __m256i hit = _mm256_or_si256(
+				_mm256_or_si256(_mm256_cmpeq_epi8(v, quote32),
+					_mm256_cmpeq_epi8(v, backslash32)),
+				_mm256_cmpeq_epi8(_mm256_max_epu8(v, ctrl32),
+					ctrl32));
+		const uint32_t mask = (uint32_t)_mm256_movemask_epi8(hit);
+
+		if (mask != 0) {
+			return p + __builtin_ctz(mask);
+		}
+	}
+#endif
+#if defined(__SSE2__)
+	const __m128i quote = _mm_set1_epi8('"');
+	const __m128i backslash = _mm_set1_epi8('\\');
+	const __m128i ctrl = _mm_set1_epi8(0x1f);
+
+	for (; (size_t)(end - p) >= 16; p += 16) {
+		const __m128i v = _mm_loadu_si128((const __m128i *)(const void *)p);
+		const __m128i hit = _mm_or_si128(
+				_mm_or_si128(_mm_cmpeq_epi8(v, quote),
+					_mm_cmpeq_epi8(v, backslash)),
+				_mm_cmpeq_epi8(_mm_max_epu8(v, ctrl), ctrl));
+		const uint32_t mask = (uint32_t)_mm_movemask_epi8(hit);
+
+		if (mask != 0) {
+			return p + __builtin_ctz(mask);
+		}
+	}
+#elif defined(__ARM_NEON)
+	for (; (size_t)(end - p) >= 16; p += 16) {
+		const uint8x16_t v = vld1q_u8((const uint8_t *)p);
+		const uint8x16_t hit = vorrq_u8(
+				vorrq_u8(vceqq_u8(v, vdupq_n_u8('"')),
+					vceqq_u8(v, vdupq_n_u8('\\'))),
+				vcltq_u8(v, vdupq_n_u8(0x20)));
+		/* a nibble per byte to fit the mask in 64 bits */
+		const uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(
+				vshrn_n_u16(vreinterpretq_u16_u8(hit), 4)), 0);
+
+		if (mask != 0) {
+			return p + (__builtin_ctzll(mask) >> 2);
+		}
+	}
+#endif
+	/* SWAR for the rest, or all of it without SIMD */
+	static const uint64_t ones = 0x0101010101010101ull;
+	static const uint64_t highs = 0x8080808080808080ull;
+
+	for (; (size_t)(end - p) >= 8; p += 8) {
+		uint64_t v;
+		memcpy(&v, p, sizeof(v));
+		const uint64_t q = v ^ (ones * '"');
+		const uint64_t b = v ^ (ones * '\\');
+
+		if ((((q - ones) & ~q) | ((b - ones) & ~b) |
+				((v - ones * 0x20) & ~v)) & highs) {
+			break;
+		}
+	}
+
+	for (; p < end; p++) {
+		const uint8_t c = (uint8_t)*p;
+		if (c == '"' || c == '\\' || c < 0x20) {
+			break;
+		}
+	}
+
+	return p;
+}
+
+/* A run of plain characters long enough is referred to in place instead of
+ * copied when encoding into segments. */
+static void put_run(struct writer *w, const char *s, size_t n)
+{
+	if (w->iov == NULL || n < OCPP_MESSAGE_JSON_IOV_MINLEN ||
+			w->nr_iov + 3/*run, ref and the rest*/ > w->iovcnt) {
+		put_raw(w, s, n);
+		return;
+	}
+
+	if (w->len > w->seg) {
+		w->iov[w->nr_iov++] = (struct ocpp_iovec) {
+			.base = &w->buf[w->seg],
+			.len = w->len - w->seg,
+		};
+		w->seg = w->len;
+	}
+
+	w->iov[w->nr_iov++] = (struct ocpp_iovec) { .base = s, .len = n };
+	w->total += n;
+	w->referred += n;
+	w->last = s[n - 1];
+}
+
+/* Copies the runs of plain characters at once, escaping the rest. */
+static void put_escaped(struct writer *w, const char *s, size_t len)
+{
+	static const char hex[] = "0123456789abcdef";
+	const char *end = &s[len];
+
+	while (s < end) {
+		const char *special = scan_string(s, end);
+
+		put_run(w, s, (size_t)(special - s));
+
+		if (special == end) {
+			break;
+		}
+
+		const uint8_t c = (uint8_t)*special;
+
+		if (c == '"' || c == '\\') {
+			const char esc[2] = { '\\', (char)c };
+			put_raw(w, esc, sizeof(esc));
+		} else {
+			const char esc[6] = { '\\', 'u', '0', '0',
+				hex[c >> 4], hex[c & 0xf] };
+			put_raw(w, esc, sizeof(esc));
+		}
+
+		s = special + 1;
+	}
+}
+
+static void put_quoted(struct writer *w, const char *s, size_t len)
+{
+	put_char(w, '"');
+	put_escaped(w, s, len);
+	put_char(w, '"');
+}
+
+static void put_separator(struct writer *w)
+{
+	if (w->last != '{' && w->last != '[') {
+		put_char(w, ',');
+	}
+}
+
+static void put_u64(struct writer *w, uint64_t v)
+{
+	char digits[20];
+	size_t i = sizeof(digits);
+
+	do {
+		digits[--i] = (char)('0' + v % 10);
+		v /= 10;
+	} while (v != 0);
+
+	put_raw(w, &digits[i], sizeof(digits) - i);
+}
+
+static void put_i64(struct writer *w, int64_t v)
+{
+	if (v < 0) {
+		put_char(w, '-');
+		put_u64(w, (uint64_t)-(v + 1) + 1);
+	} else {
+		put_u64(w, (uint64_t)v);
+	}
+}
+
+static void put_name(struct writer *w, const struct ocpp_field *f)
+{
+	put_separator(w);
+	put_raw(w, f->name, f->namelen + 3u);
+}
+
+/* Fixed-point values in tenths, such as `limit_tenth`, as decimals. */
+static void put_tenth(struct writer *w, int64_t tenth)
+{
+	const uint64_t abs = tenth < 0? (uint64_t)-tenth : (uint64_t)tenth;
+
+	if (tenth < 0) {
+		put_char(w, '-');
+	}
+	put_u64(w, abs / 10);
+	put_char(w, '.');
+	put_char(w, (char)('0' + abs % 10));
+}
+
+static void put_digits(char *buf, uint32_t v, size_t n)
+{
+	while (n-- > 0) {
+		buf[n] = (char)('0' + v % 10);
+		v /= 10;
+	}
+}
+
+/* The civil date from days since the epoch, by Howard Hinnant's algorithm,
+ * not to depend on gmtime() and the time zone of the libc. */
+static void put_time(struct writer *w, time_t t)
+{
+	const int64_t secs = (int64_t)t;
+	int64_t days = secs / 86400;
+	int64_t rem = secs % 86400;
+
+	if (rem < 0) {
+		rem += 86400;
+		days--;
+	}
+
+	days += 719468;
+	const int64_t era = (days >= 0? days : days - 146096) / 146097;
+	const uint32_t doe = (uint32_t)(days - era * 146097);
+	const uint32_t yoe =
+		(doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+	const uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+	const uint32_t mp = (5 * doy + 2) / 153;
+	const uint32_t day = doy - (153 * mp + 2) / 5 + 1;
+	const uint32_t month = mp < 10? mp + 3 : mp - 9;
+	const int64_t year = (int64_t)yoe + era * 400 + (month <= 2);
+	const uint32_t sod = (uint32_t)rem;
+	char str[ISO8601_LEN + 2/*quotes*/] = "\"0000-00-00T00:00:00Z\"";
+
+	put_digits(&str[1], (uint32_t)(year < 0? 0 : year), 4);
+	put_digits(&str[6], month, 2);
+	put_digits(&str[9], day, 2);
+	put_digits(&str[12], sod / 3600, 2);
+	put_digits(&str[15], sod / 60 % 60, 2);
+	put_digits(&str[18], sod % 60, 2);
+
+	put_raw(w, str, sizeof(str));
+}
+
+static void put_object(struct writer *w, const struct ocpp_schema *schema,
+		const char *obj, size_t avail);
+
+static void put_array(struct writer *w, const struct ocpp_field *f,
+		const char *obj, size_t avail)
+{
+	const struct ocpp_schema *schema = f->spec;
+	const size_t n = ocpp_count_field_elements(f, obj, avail);
+	const char *elem = obj + f->offset;
+
+	put_char(w, '[');
+	for (size_t i = 0; i < n; i++) {
+		put_separator(w);
+		put_object(w, schema, elem, schema->size);
+		elem += schema->size;
+	}
+	put_char(w, ']');
+}
+
+static void put_value(struct writer *w, const struct ocpp_field *f,
+		const char *obj, size_t avail)
+{
+	const char *p = obj + f->offset;
+	const char *s;
+	size_t len;
+	uint64_t u64;
+	time_t t;
+
+	switch (f->type) {
+	case OCPP_FIELD_STR:
+	case OCPP_FIELD_TRAILING:
+	case OCPP_FIELD_STRPTR:
+		s = ocpp_get_field_string(f, p, avail - f->offset, &len);
+		put_quoted(w, s, len);
+		break;
+	case OCPP_FIELD_INT:
+		put_i64(w, ocpp_load_field_int(p, f->size));
+		break;
+	case OCPP_FIELD_U64:
+		memcpy(&u64, p, sizeof(u64));
+		put_u64(w, u64);
+		break;
+	case OCPP_FIELD_TENTH:
+		put_tenth(w, ocpp_load_field_int(p, f->size));
+		break;
+	case OCPP_FIELD_BOOL:
+		if (*p) {
+			put_raw(w, "true", 4);
+		} else {
+			put_raw(w, "false", 5);
+		}
+		break;
+	case OCPP_FIELD_TIME:
+		memcpy(&t, p, sizeof(t));
+		put_time(w, t);
+		break;
+	case OCPP_FIELD_OBJECT:
+		put_object(w, f->spec, p, avail - f->offset);
+		break;
+	case OCPP_FIELD_ARRAY:
+		put_array(w, f, obj, avail);
+		break;
+	default:
+		break;
+	}
+}
+
+static void put_field(struct writer *w, const struct ocpp_field *f,
+		const char *obj, size_t avail)
+{
+	const char *p = obj + f->offset;
+	char str[MEASURAND_NAME_MAXLEN];
+	const char *name;
+	int len;
+
+	if (!ocpp_is_field_present(f, obj, avail)) {
+		return;
+	}
+
+	/* of which the name is known only after the value is looked up */
+	switch (f->type) {
+	case OCPP_FIELD_ENUM:
+		if ((name = ocpp_get_field_enum_name(f, p)) != NULL) {
+			put_name(w, f);
+			put_quoted(w, name, strlen(name));
+		}
+		return;
+	case OCPP_FIELD_MEASURAND:
+		len = ocpp_encode_configuration_csl("MeterValuesSampledData",
+				(int)ocpp_load_field_int(p, f->size), str, sizeof(str));
+		if (len > 0) {
+			put_name(w, f);
+			put_quoted(w, str, (size_t)len);
+		}
+		return;
+	default:
+		break;
+	}
+
+	put_name(w, f);
+	if (f->flags & OCPP_FIELD_FIRST_OF_ARRAY) {
+		put_char(w, '[');
+		put_value(w, f, obj, avail);
+		put_char(w, ']');
+	} else {
+		put_value(w, f, obj, avail);
+	}
+}
+
+/* The members of the struct are looked up in the schema, bounded by the
+ * bytes available from the start of the struct in the payload. */
+static void put_object(struct writer *w, const struct ocpp_schema *schema,
+		const char *obj, size_t avail)
+{
+	put_char(w, '{');
+	for (uint8_t i = 0; i < schema->nr_fields; i++) {
+		put_field(w, &schema->fields[i], obj, avail);
+	}
+	put_char(w, '}');
+}
+
+static void put_callerror(struct writer *w, const struct ocpp_message *msg)
+{
+	const struct ocpp_CallError *err = msg->payload.fmt.response;
+	int code = OCPP_CALLERROR_GENERIC;
+	const char *desc = "";
+	size_t desclen = 0;
+
+	if (err && msg->payload.size >= sizeof(*err)) {
+		code = (int)err->errorCode;
+		desc = err->errorDescription;
+		desclen = strnlen(desc, sizeof(err->errorDescription));
+	}
+	if (code < 0 || (size_t)code >=
+			sizeof(callerror_names) / sizeof(*callerror_names)) {
+		code = OCPP_CALLERROR_GENERIC;
+	}
+
+	put_char(w, ',');
+	put_quoted(w, callerror_names[code], strlen(callerror_names[code]));
+	put_char(w, ',');
+	put_quoted(w, desc, desclen);
+	put_raw(w, ",{}", 3);
+}
+
+static int encode(struct writer *w, const struct ocpp_message *msg)
+{
+	const struct ocpp_schema *schema = NULL;
+
+	switch (msg->role) {
+	case OCPP_MSG_ROLE_CALL:
+	case OCPP_MSG_ROLE_CALLRESULT:
+		if (msg->type >= OCPP_MSG_MAX) {
+			return -EINVAL;
+		}
+		schema = ocpp_get_message_schema(msg->type, msg->role);
+		break;
+	case OCPP_MSG_ROLE_CALLERROR: /* of no type to answer an unknown one */
+		break;
+	case OCPP_MSG_ROLE_NONE:
+	case OCPP_MSG_ROLE_ALLOC:
+	default:
+		return -EINVAL;
+	}
+
+	if (schema && schema->size > 0 && (msg->payload.fmt.data == NULL ||
+			msg->payload.size < schema->size)) {
+		return -EINVAL;
+	}
+
+	put_char(w, '[');
+	put_char(w, (char)('0' + msg->role));
+	put_char(w, ',');
+	put_quoted(w, msg->id, strnlen(msg->id, sizeof(msg->id)));
+
+	if (schema == NULL) {
+		put_callerror(w, msg);
+	} else {
+		if (msg->role == OCPP_MSG_ROLE_CALL) {
+			const char *action = ocpp_stringify_type(msg->type);
+			put_char(w, ',');
+			put_quoted(w, action, strlen(action));
+		}
+		put_char(w, ',');
+		put_object(w, schema, (const char *)msg->payload.fmt.data,
+				msg->payload.size);
+	}
+
+	put_char(w, ']');
+
+	return 0;
+}
+
+int ocpp_encode_message_json(const struct ocpp_message *msg,
+		char *buf, size_t bufsize)
+{
+	struct writer w = {
+		.buf = buf,
+		.bufsize = bufsize > 0? bufsize - 1/*null*/ : 0,
+	};
+
+	if (msg == NULL || (buf == NULL && bufsize > 0)) {
+		return -EINVAL;
+	}
+
+	const int err = encode(&w, msg);
+
+	if (err < 0) {
+		return err;
+	} else if (w.total > w.len || bufsize == 0) {
+		return -ENOBUFS;
+	}
+
+	buf[w.len] = '\0';
+
+	return (int)w.total;
+}
+
+int ocpp_stream_message_json(const struct ocpp_message *msg,
+		ocpp_message_json_writer_t writer, void *ctx)
+{
+	char chunk[OCPP_MESSAGE_JSON_CHUNK_SIZE];
+	struct writer w = {
+		.buf = chunk,
+		.bufsize = sizeof(chunk),
+		.flush = writer,
+		.ctx = ctx,
+	};
+
+	if (msg == NULL || writer == NULL) {
+		return -EINVAL;
+	}
+
+	const int err = encode(&w, msg);
+
+	if (err < 0) {
+		return err;
+	}
+
+	flush_chunk(&w);
+
+	return w.err < 0? w.err : (int)w.total;
+}
+
+int ocpp_encode_message_jsonv(const struct ocpp_message *msg,
+		struct ocpp_iovec *iov, size_t iovcnt,
+		char *buf, size_t bufsize, size_t *len)
+{
+	struct writer w = {
+		.buf = buf,
+		.bufsize = bufsize,
+		.iov = iov,
+		.iovcnt = iovcnt,
+	};
+
+	if (msg == NULL || iov == NULL || iovcnt == 0 ||
+			(buf == NULL && bufsize > 0)) {
+		return -EINVAL;
+	}
+
+	const int err = encode(&w, msg);
+
+	if (err < 0) {
+		return err;
+	} else if (w.total - w.referred > w.len) {
+		return -ENOBUFS;
+	}
+
+	if (w.len > w.seg) {
+		iov[w.nr_iov++] = (struct ocpp_iovec) {
+			.base = &buf[w.seg],
+			.len = w.len - w.seg,
+		};
+	}
+
+	if (len) {
+		*len = w.total;
+	}
+
+	return (int)w.nr_iov;
+}
+
+struct number {
+	uint64_t magnitude;
+	uint8_t tenth;
+	bool negative;
+	bool fraction;
+	bool exponent;
+	bool overflow;
+};
+
+struct parser {
+	const char *p;
+	const char *end;
+	char *buf;
+	size_t bufsize;
+	size_t tail; /* end of the data stored after the struct */
+	unsigned int depth;
+	ocpp_callerror_t error;
+};
+
+static int fail(struct parser *ps, ocpp_callerror_t error, int err)
+{
+	ps->error = error;
+	return err;
+}
+
+static int fail_formation(struct parser *ps)
+{
+	return fail(ps, OCPP_CALLERROR_FORMATION_VIOLATION, -EBADMSG);
+}
+
+static void skip_ws(struct parser *ps)
+{
+	while (ps->p < ps->end && (*ps->p == ' ' || *ps->p == '\t' ||
+			*ps->p == '\n' || *ps->p == '\r')) {
+		ps->p++;
+	}
+}
+
+static int peek(struct parser *ps)
+{
+	skip_ws(ps);
+	return ps->p < ps->end? (uint8_t)*ps->p : -1;
+}
+
+static bool consume(struct parser *ps, char c)
+{
+	if (peek(ps) == c) {
+		ps->p++;
+		return true;
+	}
+
+	return false;
+}
+
+/* A value of another type is a type violation, anything else a formation
+ * violation. */
+static int fail_type(struct parser *ps)
+{
+	const int c = peek(ps);
+
+	if (c >= 0 && strchr("\"{[-0123456789tfn", c) != NULL) {
+		return fail(ps, OCPP_CALLERROR_TYPE_CONSTRAINT_VIOLATION,
+				-EBADMSG);
+	}
+
+	return fail_formation(ps);
+}
+
+static void append(char *out, size_t cap, size_t *len,
+		const char *s, size_t n)
+{
+	if (out && *len < cap) {
+		const size_t room = cap - *len;
+		memcpy(&out[*len], s, n < room? n : room);
+	}
+
+	*len += n;
+}
+
+static int parse_hex4(struct parser *ps, uint32_t *code)
+{
+	uint32_t v = 0;
+
+	if ((size_t)(ps->end - ps->p) < 4) {
+		return fail_formation(ps);
+	}
+
+	for (int i = 0; i < 4; i++) {
+		const char c = *ps->p++;
+		uint32_t d;
+
+		if (c >= '0' && c <= '9') {
+			d = (uint32_t)(c - '0');
+		} else if (c >= 'a' && c <= 'f') {
+			d = (uint32_t)(c - 'a' + 10);
+		} else if (c >= 'A' && c <= 'F') {
+			d = (uint32_t)(c - 'A' + 10);
+		} else {
+			return fail_formation(ps);
+		}
+
+		v = v << 4 | d;
+	}
+
+	*code = v;
+	return 0;
+}
+
+static int parse_unicode(struct parser *ps, char *out, size_t cap,
+		size_t *len)
+{
+	uint32_t code;
+	char utf8[4];
+	size_t n;
+	int err;
+
+	if ((err = parse_hex4(ps, &code)) != 0) {
+		return err;
+	}
+
+	if (code >= 0xd800 && code < 0xdc00) {
+		uint32_t low;
+
+		if ((size_t)(ps->end - ps->p) < 2 || ps->p[0] != '\\' ||
+				ps->p[1] != 'u') {
+			return fail_formation(ps);
+		}
+		ps->p += 2;
+		if ((err = parse_hex4(ps, &low)) != 0) {
+			return err;
+		} else if (low < 0xdc00 || low >= 0xe000) {
+			return fail_formation(ps);
+		}
+		code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+	} else if (code >= 0xdc00 && code < 0xe000) {
+		return fail_formation(ps);
+	}
+
+	if (code < 0x80) {
+		utf8[0] = (char)code;
+		n = 1;
+	} else if (code < 0x800) {
+		utf8[0] = (char)(0xc0 | code >> 6);
+		utf8[1] = (char)(0x80 | (code & 0x3f));
+		n = 2;
+	} else if (code < 0x10000) {
+		utf8[0] = (char)(0xe0 | code >> 12);
+		utf8[1] = (char)(0x80 | (code >> 6 & 0x3f));
+		utf8[2] = (char)(0x80 | (code & 0x3f));
+		n = 3;
+	} else {
+		utf8[0] = (char)(0xf0 | code >> 18);
+		utf8[1] = (char)(0x80 | (code >> 12 & 0x3f));
+		utf8[2] = (char)(0x80 | (code >> 6 & 0x3f));
+		utf8[3] = (char)(0x80 | (code & 0x3f));
+		n = 4;
+	}
+
+	append(out, cap, len, utf8, n);
+	return 0;
+}
+
+/* Unescapes the string at the cursor into `out` of `cap` characters plus
+ * the null, or skips it if `out` is NULL. Returns -ERANGE if it does not
+ * fit, after the whole string is consumed. */
+static int parse_string(struct parser *ps, char *out, size_t cap,
+		size_t *outlen)
+{
+	static const char escapes[] = "\"\\/bfnrt";
+	static const char unescaped[] = "\"\\/\b\f\n\r\t";
+	size_t len = 0;
+	int err;
+
+	if (!consume(ps, '"')) {
+		return fail_type(ps);
+	}
+
+	for (;;) {
+		const char *q = scan_string(ps->p, ps->end);
+
+		append(out, cap, &len, ps->p, (size_t)(q - ps->p));
+		ps->p = q;
+
+		if (q == ps->end || (uint8_t)*q < 0x20) {
+			return fail_formation(ps);
+		} else if (*q == '"') {
+			ps->p++;
+			break;
+		} else if (++ps->p == ps->end) {
+			return fail_formation(ps);
+		}
+
+		const char c = *ps->p++;
+		const char *esc = c? strchr(escapes, c) : NULL;
+
+		if (esc != NULL) {
+			append(out, cap, &len, &unescaped[esc - escapes], 1);
+		} else if (c != 'u') {
+			return fail_formation(ps);
+		} else if ((err = parse_unicode(ps, out, cap, &len)) != 0) {
+			return err;
+		}
+	}
+
+	if (out) {
+		out[len < cap? len : cap] = '\0';
+	}
+	if (outlen) {
+		*outlen = len;
+	}
+
+	return len > cap? -ERANGE : 0;
+}
+
+static int parse_number(struct parser *ps, struct number *num)
+{
+	const char *p = ps->p;
+	const char *end = ps->end;
+
+	memset(num, 0, sizeof(*num));
+
+	if (p < end && *p == '-') {
+		num->negative = true;
+		p++;
+	}
+	if (p == end || *p < '0' || *p > '9') {
+		return fail_formation(ps);
+	}
+	if (*p == '0' && p + 1 < end && p[1] >= '0' && p[1] <= '9') {
+		return fail_formation(ps);
+	}
+
+	for (; p < end && *p >= '0' && *p <= '9'; p++) {
+		const uint32_t d = (uint32_t)(*p - '0');
+
+		if (num->magnitude > (UINT64_MAX - d) / 10) {
+			num->overflow = true;
+		}
+		num->magnitude = num->magnitude * 10 + d;
+	}
+
+	if (p < end && *p == '.') {
+		if (++p == end || *p < '0' || *p > '9') {
+			return fail_formation(ps);
+		}
+		num->fraction = true;
+		num->tenth = (uint8_t)(*p - '0');
+		while (p < end && *p >= '0' && *p <= '9') {
+			p++;
+		}
+	}
+
+	if (p < end && (*p == 'e' || *p == 'E')) {
+		if (++p < end && (*p == '+' || *p == '-')) {
+			p++;
+		}
+		if (p == end || *p < '0' || *p > '9') {
+			return fail_formation(ps);
+		}
+		num->exponent = true;
+		while (p < end && *p >= '0' && *p <= '9') {
+			p++;
+		}
+	}
+
+	ps->p = p;
+	return 0;
+}
+
+static int parse_literal(struct parser *ps, const char *literal)
+{
+	const size_t len = strlen(literal);
+
+	if ((size_t)(ps->end - ps->p) < len ||
+			memcmp(ps->p, literal, len) != 0) {
+		return fail_formation(ps);
+	}
+
+	ps->p += len;
+	return 0;
+}
+
+static int skip_value(struct parser *ps);
+
+static int skip_container(struct parser *ps, char close, bool members)
+{
+	int err;
+
+	if (ps->depth >= OCPP_MESSAGE_JSON_MAX_DEPTH) {
+		return fail_formation(ps);
+	}
+
+	ps->depth++;
+	ps->p++;
+	if (!consume(ps, close)) {
+		do {
+			if (members) {
+				if (peek(ps) != '"') {
+					return fail_formation(ps);
+				} else if ((err = parse_string(ps,
+						NULL, 0, NULL)) < 0 &&
+						err != -ERANGE) {
+					return err;
+				} else if (!consume(ps, ':')) {
+					return fail_formation(ps);
+				}
+			}
+			if ((err = skip_value(ps)) != 0) {
+				return err;
+			}
+		} while (consume(ps, ','));
+
+		if (!consume(ps, close)) {
+			return fail_formation(ps);
+		}
+	}
+
+	ps->depth--;
+	return 0;
+}
+
+static int skip_value(struct parser *ps)
+{
+	struct number num;
+	int err;
+
+	switch (peek(ps)) {
+	case '"':
+		err = parse_string(ps, NULL, 0, NULL);
+		return err == -ERANGE? 0 : err;
+	case '{':
+		return skip_container(ps, '}', true);
+	case '[':
+		return skip_container(ps, ']', false);
+	case 't':
+		return parse_literal(ps, "true");
+	case 'f':
+		return parse_literal(ps, "false");
+	case 'n':
+		return parse_literal(ps, "null");
+	default:
+		return parse_number(ps, &num);
+	}
+}
+
+static int parse_word(struct parser *ps, char word[WORD_MAXLEN], size_t *len)
+{
+	const int err = parse_string(ps, word, WORD_MAXLEN - 1, len);
+
+	/* too long for any name, so unknown */
+	if (err == -ERANGE) {
+		word[0] = '\0';
+		*len = 0;
+		return 0;
+	}
+
+	return err;
+}
+
+static int find_name(const struct ocpp_names *names, const char *word, size_t len)
+{
+	for (size_t i = 0; i < names->nr_names; i++) {
+		const char *name = names->names[i];
+		if (name && strncmp(name, word, len) == 0 &&
+				name[len] == '\0') {
+			return (int)i;
+		}
+	}
+
+	return -1;
+}
+
+static bool get_digits(const char *s, size_t n, uint32_t *v)
+{
+	*v = 0;
+
+	for (size_t i = 0; i < n; i++) {
+		if (s[i] < '0' || s[i] > '9') {
+			return false;
+		}
+		*v = *v * 10 + (uint32_t)(s[i] - '0');
+	}
+
+	return true;
+}
+
+/* The inverse of put_time(), taking fractions of a second and UTC offsets
+ * as well. */
+static bool parse_time(const char *s, size_t len, time_t *t)
+{
+	uint32_t year, month, day, hour, min, sec;
+	int64_t offset = 0;
+	size_t i = ISO8601_LEN - 1;
+
+	if (len < i || s[4] != '-' || s[7] != '-' ||
+			(s[10] != 'T' && s[10] != 't') ||
+			s[13] != ':' || s[16] != ':' ||
+			!get_digits(&s[0], 4, &year) ||
+			!get_digits(&s[5], 2, &month) ||
+			!get_digits(&s[8], 2, &day) ||
+			!get_digits(&s[11], 2, &hour) ||
+			!get_digits(&s[14], 2, &min) ||
+			!get_digits(&s[17], 2, &sec) ||
+			month < 1 || month > 12 || day < 1 || day > 31 ||
+			hour > 23 || min > 59 || sec > 60) {
+		return false;
+	}
+
+	if (i < len && s[i] == '.') {
+		for (i++; i < len && s[i] >= '0' && s[i] <= '9'; i++) {
+		}
+	}
+
+	if (i < len && (s[i] == 'Z' || s[i] == 'z')) {
+		i++;
+	} else if (i < len && (s[i] == '+' || s[i] == '-')) {
+		uint32_t oh, om;
+
+		if (len - i < 6 || s[i + 3] != ':' ||
+				!get_digits(&s[i + 1], 2, &oh) ||
+				!get_digits(&s[i + 4], 2, &om)) {
+			return false;
+		}
+		offset = (int64_t)(oh * 3600 + om * 60);
+		offset = s[i] == '-'? -offset : offset;
+		i += 6;
+	}
+
+	if (i != len) {
+		return false;
+	}
+
+	const int64_t y = (int64_t)year - (month <= 2);
+	const int64_t era = (y >= 0? y : y - 399) / 400;
+	const uint32_t yoe = (uint32_t)(y - era * 400);
+	const uint32_t doy = (153 * (month > 2? month - 3 : month + 9) + 2) / 5
+		+ day - 1;
+	const uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+	const int64_t days = era * 146097 + (int64_t)doe - 719468;
+
+	*t = (time_t)(days * 86400 + (int64_t)(hour * 3600 + min * 60 + sec)
+			- offset);
+
+	return true;
+}
+
+static int parse_integer(struct parser *ps, const struct ocpp_field *f,
+		int64_t *v)
+{
+	struct number num;
+	int err;
+
+	if (peek(ps) != '-' && (peek(ps) < '0' || peek(ps) > '9')) {
+		return fail_type(ps);
+	} else if ((err = parse_number(ps, &num)) != 0) {
+		return err;
+	} else if (num.exponent ||
+			(num.fraction && f->type != OCPP_FIELD_TENTH)) {
+		return fail(ps, OCPP_CALLERROR_TYPE_CONSTRAINT_VIOLATION,
+				-EBADMSG);
+	}
+
+	if (f->type == OCPP_FIELD_U64) {
+		if (num.overflow || num.negative) {
+			goto out_of_range;
+		}
+		*v = (int64_t)num.magnitude; /* stored as is */
+		return 0;
+	}
+
+	const uint64_t limit = f->type == OCPP_FIELD_TENTH?
+		(uint64_t)INT32_MAX / 10 : (uint64_t)INT32_MAX;
+
+	if (num.overflow || num.magnitude > limit) {
+		goto out_of_range;
+	}
+
+	*v = (int64_t)num.magnitude;
+	if (f->type == OCPP_FIELD_TENTH) {
+		*v = *v * 10 + num.tenth;
+	}
+	if (num.negative) {
+		*v = -*v;
+	}
+
+	return 0;
+out_of_range:
+	return fail(ps, OCPP_CALLERROR_PROPERTY_CONSTRAINT_VIOLATION,
+			-EBADMSG);
+}
+
+static int parse_object(struct parser *ps, const struct ocpp_schema *schema,
+		char *obj);
+
+static int parse_array(struct parser *ps, const struct ocpp_field *f, char *obj,
+		char *dst)
+{
+	const struct ocpp_schema *schema = f->spec;
+	int n = 0;
+	int err;
+
+	if (peek(ps) != '[') {
+		return fail_type(ps);
+	}
+
+	ps->p++;
+	if (!consume(ps, ']')) {
+		do {
+			char *elem = dst + (size_t)n * schema->size;
+			const size_t end = (size_t)(elem - ps->buf) +
+				schema->size;
+
+			if (end > ps->bufsize) {
+				return fail(ps, OCPP_CALLERROR_OCCURRENCE_CONSTRAINT_VIOLATION,
+						-ENOBUFS);
+			}
+
+			memset(elem, 0, schema->size);
+			if ((err = parse_object(ps, schema, elem)) != 0) {
+				return err;
+			}
+
+			n++;
+			ps->tail = end > ps->tail? end : ps->tail;
+		} while (consume(ps, ','));
+
+		if (!consume(ps, ']')) {
+			return fail_formation(ps);
+		}
+	}
+
+	if (f->count != OCPP_FIELD_NONE) {
+		ocpp_store_field_int(obj + f->count, sizeof(int), n);
+	}
+
+	return 0;
+}
+
+static int parse_string_field(struct parser *ps, const struct ocpp_field *f,
+		char *dst)
+{
+	size_t cap = f->size - 1u;
+	size_t len;
+	int err;
+
+	switch (f->type) {
+	case OCPP_FIELD_STR:
+		break;
+	case OCPP_FIELD_TRAILING:
+	case OCPP_FIELD_STRPTR:
+		if (f->type == OCPP_FIELD_STRPTR) {
+			char *str = ps->buf + ps->tail;
+			memcpy(dst, &str, sizeof(str));
+			dst = str;
+		}
+		if ((size_t)(dst - ps->buf) >= ps->bufsize) {
+			return fail(ps, OCPP_CALLERROR_PROPERTY_CONSTRAINT_VIOLATION,
+					-ENOBUFS);
+		}
+		cap = ps->bufsize - (size_t)(dst - ps->buf) - 1/*null*/;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	if ((err = parse_string(ps, dst, cap, &len)) == -ERANGE) {
+		return fail(ps, OCPP_CALLERROR_PROPERTY_CONSTRAINT_VIOLATION,
+				f->type == OCPP_FIELD_STR? -EBADMSG : -ENOBUFS);
+	} else if (err != 0) {
+		return err;
+	}
+
+	if (f->type != OCPP_FIELD_STR) {
+		const size_t end = (size_t)(dst - ps->buf) + len + 1/*null*/;
+		ps->tail = end > ps->tail? end : ps->tail;
+	}
+
+	return 0;
+}
+
+static int parse_value(struct parser *ps, const struct ocpp_field *f, char *obj,
+		char *dst)
+{
+	char word[WORD_MAXLEN];
+	size_t len;
+	int64_t v = 0;
+	time_t t;
+	int measurand;
+	int err;
+
+	switch (f->type) {
+	case OCPP_FIELD_STR:
+	case OCPP_FIELD_TRAILING:
+	case OCPP_FIELD_STRPTR:
+		return parse_string_field(ps, f, dst);
+	case OCPP_FIELD_INT:
+	case OCPP_FIELD_U64:
+	case OCPP_FIELD_TENTH:
+		if ((err = parse_integer(ps, f, &v)) == 0) {
+			ocpp_store_field_int(dst, f->size, v);
+		}
+		return err;
+	case OCPP_FIELD_BOOL:
+		if (peek(ps) != 't' && peek(ps) != 'f') {
+			return fail_type(ps);
+		} else {
+			const bool b = *ps->p == 't';
+			if ((err = parse_literal(ps, b? "true" : "false")) == 0) {
+				memcpy(dst, &b, sizeof(b));
+			}
+		}
+		return err;
+	case OCPP_FIELD_TIME:
+		if ((err = parse_word(ps, word, &len)) != 0) {
+			return err;
+		} else if (!parse_time(word, len, &t)) {
+			return fail(ps, OCPP_CALLERROR_TYPE_CONSTRAINT_VIOLATION,
+					-EBADMSG);
+		}
+		memcpy(dst, &t, sizeof(t));
+		return 0;
+	case OCPP_FIELD_ENUM:
+		if ((err = parse_word(ps, word, &len)) != 0) {
+			return err;
+		} else if ((v = find_name(f->spec, word, len)) < 0) {
+			return fail(ps, OCPP_CALLERROR_PROPERTY_CONSTRAINT_VIOLATION,
+					-EBADMSG);
+		}
+		ocpp_store_field_int(dst, f->size, v);
+		return 0;
+	case OCPP_FIELD_MEASURAND:
+		if ((err = parse_word(ps, word, &len)) != 0) {
+			return err;
+		} else if (len == 0 || ocpp_decode_configuration_csl(
+				"MeterValuesSampledData", word, len,
+				&measurand) != 1) {
+			return fail(ps, OCPP_CALLERROR_PROPERTY_CONSTRAINT_VIOLATION,
+					-EBADMSG);
+		}
+		ocpp_store_field_int(dst, f->size, measurand);
+		return 0;
+	case OCPP_FIELD_OBJECT:
+		return parse_object(ps, f->spec, dst);
+	case OCPP_FIELD_ARRAY:
+		return parse_array(ps, f, obj, dst);
+	default:
+		return -EINVAL;
+	}
+}
+
+static int parse_field(struct parser *ps, const struct ocpp_field *f, char *obj)
+{
+	char *dst = obj + f->offset;
+	int err;
+
+	if (!(f->flags & OCPP_FIELD_FIRST_OF_ARRAY)) {
+		return parse_value(ps, f, obj, dst);
+	}
+
+	if (peek(ps) != '[') {
+		return fail_type(ps);
+	}
+
+	ps->p++;
+	if (!consume(ps, ']')) {
+		if ((err = parse_value(ps, f, obj, dst)) != 0) {
+			return err;
+		}
+		while (consume(ps, ',')) {
+			if ((err = skip_value(ps)) != 0) {
+				return err;
+			}
+		}
+		if (!consume(ps, ']')) {
+			return fail_formation(ps);
+		}
+	}
+
+	return 0;
+}
+
+static const struct ocpp_field *find_field(const struct ocpp_schema *schema,
+		const char *name, size_t len, uint32_t *bit)
+{
+	for (uint8_t i = 0; i < schema->nr_fields; i++) {
+		const struct ocpp_field *f = &schema->fields[i];
+
+		if (f->namelen == len && memcmp(f->name + 1, name, len) == 0) {
+			*bit = 1u << i;
+			return f;
+		}
+	}
+
+	return NULL;
+}
+
+static int parse_object(struct parser *ps, const struct ocpp_schema *schema,
+		char *obj)
+{
+	uint32_t seen = 0;
+	int err;
+
+	if (peek(ps) != '{') {
+		return fail_type(ps);
+	} else if (ps->depth >= OCPP_MESSAGE_JSON_MAX_DEPTH) {
+		return fail_formation(ps);
+	}
+
+	ps->depth++;
+	ps->p++;
+	if (!consume(ps, '}')) {
+		do {
+			char name[WORD_MAXLEN];
+			size_t len;
+			uint32_t bit = 0;
+
+			if (peek(ps) != '"') {
+				return fail_formation(ps);
+			} else if ((err = parse_word(ps, name, &len)) != 0) {
+				return err;
+			} else if (!consume(ps, ':')) {
+				return fail_formation(ps);
+			}
+
+			const struct ocpp_field *f =
+				find_field(schema, name, len, &bit);
+
+			if (f == NULL) {
+				err = skip_value(ps);
+			} else {
+				seen |= bit;
+				err = parse_field(ps, f, obj);
+				ocpp_set_field_present(f, obj);
+			}
+
+			if (err != 0) {
+				return err;
+			}
+		} while (consume(ps, ','));
+
+		if (!consume(ps, '}')) {
+			return fail_formation(ps);
+		}
+	}
+
+	for (uint8_t i = 0; i < schema->nr_fields; i++) {
+		if ((schema->fields[i].flags & OCPP_FIELD_REQUIRED) &&
+				!(seen & (1u << i))) {
+			return fail(ps,
+				OCPP_CALLERROR_OCCURRENCE_CONSTRAINT_VIOLATION,
+				-EBADMSG);
+		}
+	}
+
+	ps->depth--;
+	return 0;
+}
+
+static int decode_payload(struct parser *ps, const struct ocpp_schema *schema,
+		struct ocpp_message *msg)
+{
+	if (ps->bufsize < schema->size) {
+		return fail(ps, OCPP_CALLERROR_INTERNAL, -ENOBUFS);
+	}
+
+	memset(ps->buf, 0, schema->size);
+	ps->tail = schema->size;
+
+	const int err = parse_object(ps, schema, ps->buf);
+
+	msg->payload.fmt.data = ps->buf;
+	msg->payload.size = ps->tail;
+
+	return err;
+}
+
+static int decode_callerror(struct parser *ps, struct ocpp_message *msg)
+{
+	struct ocpp_CallError *callerror = (struct ocpp_CallError *)(void *)ps->buf;
+	const struct ocpp_names codes = {
+		callerror_names,
+		sizeof(callerror_names) / sizeof(*callerror_names),
+	};
+	char word[WORD_MAXLEN];
+	size_t len;
+	int err;
+
+	if (ps->bufsize < sizeof(*callerror)) {
+		return fail(ps, OCPP_CALLERROR_INTERNAL, -ENOBUFS);
+	} else if ((err = parse_word(ps, word, &len)) != 0) {
+		return err;
+	} else if (!consume(ps, ',')) {
+		return fail_formation(ps);
+	}
+
+	const int code = find_name(&codes, word, len);
+	callerror->errorCode = code < 0?
+		OCPP_CALLERROR_GENERIC : (ocpp_callerror_t)code;
+
+	/* the description is informative, so cut to fit */
+	err = parse_string(ps, callerror->errorDescription,
+			sizeof(callerror->errorDescription) - 1, NULL);
+	if (err != 0 && err != -ERANGE) {
+		return err;
+	} else if (!consume(ps, ',')) {
+		return fail_formation(ps);
+	} else if (peek(ps) != '{') {
+		return fail_type(ps);
+	}
+
+	msg->payload.fmt.data = callerror;
+	msg->payload.size = sizeof(*callerror);
+
+	return skip_value(ps); /* errorDetails */
+}
+
+static int decode(struct parser *ps, struct ocpp_message *msg)
+{
+	const struct ocpp_schema *schema;
+	struct number num;
+	int err;
+
+	if (!consume(ps, '[')) {
+		return fail_formation(ps);
+	} else if ((err = parse_number(ps, &num)) != 0) {
+		return err;
+	} else if (num.negative || num.fraction || num.exponent ||
+			num.magnitude < OCPP_MSG_ROLE_CALL ||
+			num.magnitude > OCPP_MSG_ROLE_CALLERROR ||
+			!consume(ps, ',')) {
+		return fail_formation(ps);
+	}
+
+	if ((err = parse_string(ps, msg->id, sizeof(msg->id) - 1, NULL))
+			== -ERANGE) {
+		return fail(ps, OCPP_CALLERROR_PROPERTY_CONSTRAINT_VIOLATION,
+				-EBADMSG);
+	} else if (err != 0) {
+		return err;
+	} else if (!consume(ps, ',')) {
+		return fail_formation(ps);
+	}
+
+	msg->role = (ocpp_message_role_t)num.magnitude;
+
+	if (msg->role == OCPP_MSG_ROLE_CALL) {
+		char action[WORD_MAXLEN];
+		size_t len;
+
+		if ((err = parse_word(ps, action, &len)) != 0) {
+			return err;
+		} else if ((msg->type = ocpp_get_type_from_string(action))
+				== OCPP_MSG_MAX) {
+			return fail(ps, OCPP_CALLERROR_NOT_IMPLEMENTED,
+					-EBADMSG);
+		} else if (!consume(ps, ',')) {
+			return fail_formation(ps);
+		}
+
+		schema = ocpp_get_message_schema(msg->type, msg->role);
+	} else if ((msg->type = ocpp_get_type_from_idstr(msg->id))
+			== OCPP_MSG_MAX) {
+		return -ENOENT;
+	} else {
+		schema = ocpp_get_message_schema(msg->type, msg->role);
+	}
+
+	if (msg->role == OCPP_MSG_ROLE_CALLERROR) {
+		err = decode_callerror(ps, msg);
+	} else {
+		err = decode_payload(ps, schema, msg);
+	}
+
+	if (err != 0) {
+		return err;
+	} else if (!consume(ps, ']') || peek(ps) >= 0) {
+		return fail_formation(ps);
+	}
+
+	return 0;
+}
+
+int ocpp_decode_message_json(const char *json, size_t len,
+		struct ocpp_message *msg, void *buf, size_t bufsize,
+		ocpp_callerror_t *error)
+{
+	struct parser ps = {
+		.p = json,
+		.end = json + len,
+		.buf = (char *)buf,
+		.bufsize = bufsize,
+		.error = OCPP_CALLERROR_GENERIC,
+	};
+
+	if (json == NULL || msg == NULL || (buf == NULL && bufsize > 0)) {
+		return -EINVAL;
+	}
+
+	memset(msg, 0, sizeof(*msg));
+	msg->type = OCPP_MSG_MAX;
+
+	const int err = decode(&ps, msg);
+
+	if (err != 0 && error) {
+		*error = ps.error;
+	}
+
+	return err;
+}
@@ -0,0 +1,286 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "ocpp/message_schema.h"
+#include <string.h>
+
+#define FLAGS_REQ		OCPP_FIELD_REQUIRED
+#define FLAGS_OPT		OCPP_FIELD_OPTIONAL
+#define FLAGS_REQ_LIST		(OCPP_FIELD_REQUIRED | OCPP_FIELD_FIRST_OF_ARRAY)
+#define FLAGS_OPT_LIST		OCPP_FIELD_FIRST_OF_ARRAY
+
+/* What the spec of a field refers to, by the type of the field. */
+#define SPEC_STR(x)		NULL
+#define SPEC_TRAILING(x)	NULL
+#define SPEC_STRPTR(x)		NULL
+#define SPEC_INT(x)		NULL
+#define SPEC_U64(x)		NULL
+#define SPEC_TENTH(x)		NULL
+#define SPEC_BOOL(x)		NULL
+#define SPEC_TIME(x)		NULL
+#define SPEC_MEASURAND(x)	NULL
+#define SPEC_ENUM(x)		&x##_names
+#define SPEC_OBJECT(x)		&x##_schema
+
+#define MEMBER_SIZE(s, m)	sizeof(((struct ocpp_##s *)0)->m)
+
+#define DEFINE_FIELD(s, m, n, t, f, sp, sz, cnt, dep, v, h) {		\
+	.name = "\"" n "\":",						\
+	.spec = sp,							\
+	.offset = offsetof(struct ocpp_##s, m),				\
+	.size = sz,							\
+	.count = cnt,							\
+	.when = dep,							\
+	.has = h,							\
+	.when_value = v,						\
+	.namelen = sizeof(n) - 1,					\
+	.type = t,							\
+	.flags = f,							\
+},
+
+static const struct ocpp_schema EMPTY_schema = { NULL, 0, 0 };
+
+#define OCPP_NAMES(x, ...)						\
+	static const char * const x##_names_tbl[] = { __VA_ARGS__ };	\
+	static const struct ocpp_names x##_names = {			\
+		x##_names_tbl,						\
+		sizeof(x##_names_tbl) / sizeof(*x##_names_tbl),		\
+	};
+#define OCPP_SCHEMA(s)							\
+	static const struct ocpp_field s##_fields[] = {
+#define OCPP_SCHEMA_END(s)						\
+	};								\
+	static const struct ocpp_schema s##_schema = {			\
+		s##_fields, sizeof(struct ocpp_##s),			\
+		sizeof(s##_fields) / sizeof(*s##_fields),		\
+	};
+#define OCPP_FIELD(s, m, name, type, flags, spec)			\
+	DEFINE_FIELD(s, m, name, OCPP_FIELD_##type, FLAGS_##flags,	\
+			SPEC_##type(spec), MEMBER_SIZE(s, m),		\
+			OCPP_FIELD_NONE, OCPP_FIELD_NONE, 0, OCPP_FIELD_NONE)
+#define OCPP_FIELD_WHEN(s, m, name, type, flags, spec, dep, value)	\
+	DEFINE_FIELD(s, m, name, OCPP_FIELD_##type, FLAGS_##flags,	\
+			SPEC_##type(spec), MEMBER_SIZE(s, m),		\
+			OCPP_FIELD_NONE, offsetof(struct ocpp_##s, dep), value, \
+			OCPP_FIELD_NONE)
+#define OCPP_FIELD_HAS(s, m, name, type, flags, spec, has)		\
+	DEFINE_FIELD(s, m, name, OCPP_FIELD_##type, FLAGS_##flags,	\
+			SPEC_##type(spec), MEMBER_SIZE(s, m),		\
+			OCPP_FIELD_NONE, OCPP_FIELD_NONE, 0,		\
+			offsetof(struct ocpp_##s, has))
+#define OCPP_FIELD_WHEN_HAS(s, m, name, type, flags, spec, has, dep, value) \
+	DEFINE_FIELD(s, m, name, OCPP_FIELD_##type, FLAGS_##flags,	\
+			SPEC_##type(spec), MEMBER_SIZE(s, m),		\
+			OCPP_FIELD_NONE, offsetof(struct ocpp_##s, dep), value, \
+			offsetof(struct ocpp_##s, has))
+#define OCPP_ARRAY(s, m, name, flags, elem)				\
+	DEFINE_FIELD(s, m, name, OCPP_FIELD_ARRAY, FLAGS_##flags,	\
+			&elem##_schema, 0, OCPP_FIELD_NONE,		\
+			OCPP_FIELD_NONE, 0, OCPP_FIELD_NONE)
+#define OCPP_COUNTED_ARRAY(s, m, name, flags, elem, count)		\
+	DEFINE_FIELD(s, m, name, OCPP_FIELD_ARRAY, FLAGS_##flags,	\
+			&elem##_schema, 0,				\
+			offsetof(struct ocpp_##s, count),		\
+			OCPP_FIELD_NONE, 0, OCPP_FIELD_NONE)
+#define OCPP_MESSAGE(type, req, conf)
+#include "ocpp/message_schema.def"
+#undef OCPP_MESSAGE
+#undef OCPP_COUNTED_ARRAY
+#undef OCPP_ARRAY
+#undef OCPP_FIELD_WHEN_HAS
+#undef OCPP_FIELD_HAS
+#undef OCPP_FIELD_WHEN
+#undef OCPP_FIELD
+#undef OCPP_SCHEMA_END
+#undef OCPP_SCHEMA
+#undef OCPP_NAMES
+
+static const struct {
+	const struct ocpp_schema *req;
+	const struct ocpp_schema *conf;
+} schemas[OCPP_MSG_MAX] = {
+#define OCPP_NAMES(x, ...)
+#define OCPP_SCHEMA(s)
+#define OCPP_SCHEMA_END(s)
+#define OCPP_FIELD(s, m, name, type, flags, spec)
+#define OCPP_FIELD_WHEN(s, m, name, type, flags, spec, dep, value)
+#define OCPP_FIELD_HAS(s, m, name, type, flags, spec, has)
+#define OCPP_FIELD_WHEN_HAS(s, m, name, type, flags, spec, has, dep, value)
+#define OCPP_ARRAY(s, m, name, flags, elem)
+#define OCPP_COUNTED_ARRAY(s, m, name, flags, elem, count)
+#define OCPP_MESSAGE(type, req, conf)					\
+	[OCPP_MSG_##type] = { &req##_schema, &conf##_schema },
+#include "ocpp/message_schema.def"
+#undef OCPP_MESSAGE
+#undef OCPP_COUNTED_ARRAY
+#undef OCPP_ARRAY
+#undef OCPP_FIELD_WHEN_HAS
+#undef OCPP_FIELD_HAS
+#undef OCPP_FIELD_WHEN
+#undef OCPP_FIELD
+#undef OCPP_SCHEMA_END
+#undef OCPP_SCHEMA
+#undef OCPP_NAMES
+};
+
+const struct ocpp_schema *ocpp_get_message_schema(ocpp_message_t type,
+		ocpp_message_role_t role)
+{
+	if (type >= OCPP_MSG_MAX) {
+		return NULL;
+	}
+
+	switch (role) {
+	case OCPP_MSG_ROLE_CALL:
+		return schemas[type].req;
+	case OCPP_MSG_ROLE_CALLRESULT:
+		return schemas[type].conf;
+	case OCPP_MSG_ROLE_NONE:
+	case OCPP_MSG_ROLE_ALLOC:
+	case OCPP_MSG_ROLE_CALLERROR:
+	default:
+		return NULL;
+	}
+}
+
+int64_t ocpp_load_field_int(const void *p, size_t size)
+{
+	if (size == sizeof(int64_t)) {
+		int64_t i64;
+		memcpy(&i64, p, sizeof(i64));
+		return i64;
+	} else if (size == sizeof(int32_t)) {
+		int32_t i32;
+		memcpy(&i32, p, sizeof(i32));
+		return i32;
+	} else if (size == sizeof(int16_t)) {
+		int16_t i16;
+		memcpy(&i16, p, sizeof(i16));
+		return i16;
+	} else if (size == sizeof(int8_t)) {
+		return *(const int8_t *)p;
+	}
+
+	return 0;
+}
+
+void ocpp_store_field_int(void *p, size_t size, int64_t v)
+{
+	if (size == sizeof(int64_t)) {
+		memcpy(p, &v, sizeof(v));
+	} else if (size == sizeof(int32_t)) {
+		const int32_t i32 = (int32_t)v;
+		memcpy(p, &i32, sizeof(i32));
+	} else if (size == sizeof(int16_t)) {
+		const int16_t i16 = (int16_t)v;
+		memcpy(p, &i16, sizeof(i16));
+	} else if (size == sizeof(int8_t)) {
+		const int8_t i8 = (int8_t)v;
+		memcpy(p, &i8, sizeof(i8));
+	}
+}
+
+static bool is_zero(const char *p, size_t size)
+{
+	for (size_t i = 0; i < size; i++) {
+		if (p[i] != 0) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+const char *ocpp_get_field_string(const struct ocpp_field *f, const char *p,
+		size_t avail, size_t *len)
+{
+	const char *s = p;
+
+	switch (f->type) {
+	case OCPP_FIELD_STR:
+		*len = strnlen(s, f->size);
+		break;
+	case OCPP_FIELD_TRAILING: /* at the end, bounded by the payload */
+		*len = strnlen(s, avail);
+		break;
+	case OCPP_FIELD_STRPTR:
+	default:
+		memcpy(&s, p, sizeof(s));
+		*len = s? strlen(s) : 0;
+		break;
+	}
+
+	return s;
+}
+
+const char *ocpp_get_field_enum_name(const struct ocpp_field *f, const char *p)
+{
+	const struct ocpp_names *names = f->spec;
+	const int64_t v = ocpp_load_field_int(p, f->size);
+
+	if (v < 0 || (uint64_t)v >= names->nr_names) {
+		return NULL;
+	}
+
+	return names->names[v];
+}
+
+/* As many as the payload holds and no more than the number given in the
+ * struct if any. */
+size_t ocpp_count_field_elements(const struct ocpp_field *f, const char *obj,
+		size_t avail)
+{
+	const struct ocpp_schema *schema = f->spec;
+	size_t n = avail > f->offset?
+		(avail - f->offset) / schema->size : 0;
+
+	if (f->count != OCPP_FIELD_NONE) {
+		const int64_t count =
+			ocpp_load_field_int(obj + f->count, sizeof(int));
+		n = count < 0? 0 : (size_t)count < n? (size_t)count : n;
+	}
+
+	return n;
+}
+
+bool ocpp_is_field_present(const struct ocpp_field *f, const char *obj,
+		size_t avail)
+{
+	const char *p = obj + f->offset;
+	size_t len;
+
+	if (f->when != OCPP_FIELD_NONE && ocpp_load_field_int(obj + f->when,
+			sizeof(int)) != f->when_value) {
+		return false;
+	} else if (f->flags & OCPP_FIELD_REQUIRED) {
+		return true;
+	} else if (f->has != OCPP_FIELD_NONE && *(const bool *)(obj + f->has)) {
+		return true;
+	}
+
+	switch (f->type) {
+	case OCPP_FIELD_STR:
+	case OCPP_FIELD_TRAILING:
+	case OCPP_FIELD_STRPTR:
+		ocpp_get_field_string(f, p, avail - f->offset, &len);
+		return len > 0;
+	case OCPP_FIELD_ENUM:
+		return true; /* unless of no name on the wire */
+	case OCPP_FIELD_OBJECT:
+		return !is_zero(p, avail - f->offset);
+	case OCPP_FIELD_ARRAY:
+		return ocpp_count_field_elements(f, obj, avail) > 0;
+	default:
+		return !is_zero(p, f->size);
+	}
+}
+
+void ocpp_set_field_present(const struct ocpp_field *f, char *obj)
+{
+	if (f->has != OCPP_FIELD_NONE) {
+		*(bool *)(obj + f->has) = true;
+	}
+}
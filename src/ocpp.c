@@ -17,15 +17,41 @@
 #if !defined(OCPP_DEFAULT_TX_RETRIES)
 #define OCPP_DEFAULT_TX_RETRIES			1
 #endif
+#if !defined(OCPP_DEFAULT_HEARTBEAT_INTERVAL_SEC)
+#define OCPP_DEFAULT_HEARTBEAT_INTERVAL_SEC	1800
+#endif
+#if !defined(OCPP_RESPONSE_CACHE_LEN)
+#define OCPP_RESPONSE_CACHE_LEN			4
+#endif
+#if !defined(OCPP_RESPONSE_CACHE_DATA_MAXLEN)
+#define OCPP_RESPONSE_CACHE_DATA_MAXLEN		64
+#endif
 
 #define container_of(ptr, type, member)		\
 	((type *)(void *)((char *)(ptr) - offsetof(type, member)))
 
+/* A response to a request received from the server, kept to answer the
+ * server's retransmission of the same request without handing it to the
+ * application again. */
+struct response {
+	char id[OCPP_MESSAGE_ID_MAXLEN];
+	/**< `OCPP_MSG_ROLE_CALL` while the application is still handling the
+	 * request, `OCPP_MSG_ROLE_CALLRESULT` or `OCPP_MSG_ROLE_CALLERROR` once
+	 * the response is cached. `OCPP_MSG_ROLE_NONE` if unused. */
+	ocpp_message_role_t role;
+	ocpp_message_t type;
+	uint32_t last_used;
+	uint32_t refs; /**< The number of queued messages using `data`. */
+	size_t datasize;
+	uint8_t data[OCPP_RESPONSE_CACHE_DATA_MAXLEN];
+};
+
 struct message {
 	struct list link;
 	struct ocpp_message body;
 	time_t expiry;
 	uint32_t attempts; /**< The number of message sending attempts. */
+	struct response *cached; /**< Set when the payload is a cached one. */
 };
 
 typedef void (*list_add_func_t)(struct message *);
@@ -44,8 +70,19 @@ static struct {
 	} tx;
 
 	struct {
+		struct response cache[OCPP_RESPONSE_CACHE_LEN];
+		uint32_t clock;
+
 		time_t timestamp;
 	} rx;
+
+	/* Keys resolved once at init, `OCPP_CONF_MAX` for the ones missing in
+	 * a custom OCPP_CONFIGURATION_DEFINES. */
+	struct {
+		ocpp_configuration_t heartbeat_interval;
+		ocpp_configuration_t tx_attempts;
+		ocpp_configuration_t tx_retry_interval;
+	} conf;
 } m;
 
 static void put_msg_ready_infront(struct message *msg)
@@ -110,7 +147,10 @@ static struct message *alloc_message(void)
 
 static void free_message(struct message *msg)
 {
-	if (m.event_callback) {
+	if (msg->cached) {
+		/* the payload belongs to the cache, not to the application. */
+		msg->cached->refs--;
+	} else if (m.event_callback) {
 		ocpp_unlock();
 		(*m.event_callback)(OCPP_EVENT_MESSAGE_FREE,
 				&msg->body, m.event_callback_ctx);
@@ -188,14 +228,17 @@ static bool should_drop(struct message *msg)
 	return false;
 }
 
-static bool should_send_heartbeat(const time_t *now)
+static int get_conf_int(ocpp_configuration_t key, int fallback)
 {
-	uint32_t interval;
+	return key < OCPP_CONF_MAX? ocpp_conf_get_int(key) : fallback;
+}
 
-	ocpp_get_configuration("HeartbeatInterval",
-			&interval, sizeof(interval), 0);
+static bool should_send_heartbeat(const time_t *now)
+{
+	const int interval = get_conf_int(m.conf.heartbeat_interval,
+			OCPP_DEFAULT_HEARTBEAT_INTERVAL_SEC);
 
-	if (interval == 0 || (uint32_t)(*now - m.tx.timestamp) < interval ||
+	if (interval <= 0 || *now - m.tx.timestamp < interval ||
 			list_count(&m.tx.ready) > 0 ||
 			list_count(&m.tx.wait) > 0) {
 		return false;
@@ -209,13 +252,13 @@ static time_t calc_message_timeout(const struct message *msg, const time_t *now)
 	uint32_t interval = OCPP_DEFAULT_TX_TIMEOUT_SEC;
 
 	if (is_transaction_related(msg)) {
-		ocpp_get_configuration("TransactionMessageRetryInterval",
-				&interval, sizeof(interval), 0);
+		interval = (uint32_t)get_conf_int(m.conf.tx_retry_interval,
+				(int)interval);
 		interval = interval * msg->attempts;
 	} else if (msg->body.type == OCPP_MSG_BOOTNOTIFICATION ||
 			msg->body.type == OCPP_MSG_HEARTBEAT) {
-		ocpp_get_configuration("HeartbeatInterval",
-				&interval, sizeof(interval), 0);
+		interval = (uint32_t)get_conf_int(m.conf.heartbeat_interval,
+				(int)interval);
 	}
 
 	return *now + interval;
@@ -326,9 +369,112 @@ static int process_timer_messages(const time_t *now)
 	return 0;
 }
 
-static void process_central_request(const struct ocpp_message *received)
+static struct response *find_response(const char *msgid)
+{
+	for (int i = 0; i < OCPP_RESPONSE_CACHE_LEN; i++) {
+		struct response *resp = &m.rx.cache[i];
+
+		if (resp->role != OCPP_MSG_ROLE_NONE &&
+				strncmp(msgid, resp->id, sizeof(resp->id)) == 0) {
+			return resp;
+		}
+	}
+
+	return NULL;
+}
+
+/* Pick an unused entry, or evict the least recently used one that is not
+ * referenced by any queued message. */
+static struct response *alloc_response(void)
+{
+	struct response *victim = NULL;
+
+	for (int i = 0; i < OCPP_RESPONSE_CACHE_LEN; i++) {
+		struct response *resp = &m.rx.cache[i];
+
+		if (resp->role == OCPP_MSG_ROLE_NONE) {
+			return resp;
+		}
+		if (resp->refs == 0 && (victim == NULL ||
+				(int32_t)(resp->last_used - victim->last_used) < 0)) {
+			victim = resp;
+		}
+	}
+
+	return victim;
+}
+
+static void touch_response(struct response *resp)
+{
+	resp->last_used = ++m.rx.clock;
+}
+
+static void put_response(struct response *resp,
+		const void *data, size_t datasize, bool err)
+{
+	if (resp->refs > 0) {
+		return;
+	}
+
+	if (datasize > sizeof(resp->data)) {
+		/* too big to keep. Let retransmissions through. */
+		resp->role = OCPP_MSG_ROLE_NONE;
+		return;
+	}
+
+	if (datasize > 0) {
+		memcpy(resp->data, data, datasize);
+	}
+
+	resp->datasize = datasize;
+	resp->role = err? OCPP_MSG_ROLE_CALLERROR : OCPP_MSG_ROLE_CALLRESULT;
+	touch_response(resp);
+}
+
+static void push_cached_response(struct response *resp)
+{
+	struct message *msg = new_message(resp->id, resp->type,
+			resp->role == OCPP_MSG_ROLE_CALLERROR);
+
+	if (msg == NULL) {
+		return; /* the server will retry anyway */
+	}
+
+	msg->body.payload.fmt.response = resp->data;
+	msg->body.payload.size = resp->datasize;
+	msg->cached = resp;
+	resp->refs++;
+
+	put_msg_ready_infront(msg);
+}
+
+static int process_central_request(const struct ocpp_message *received)
 {
-	(void)received;
+	struct response *resp = find_response(received->id);
+
+	if (resp == NULL) {
+		if ((resp = alloc_response()) != NULL) {
+			memcpy(resp->id, received->id, sizeof(resp->id));
+			resp->role = OCPP_MSG_ROLE_CALL;
+			resp->type = received->type;
+			resp->refs = 0;
+			resp->datasize = 0;
+			touch_response(resp);
+		}
+
+		return 0;
+	}
+
+	/* A retransmission. It is answered here, never reaching the
+	 * application again. */
+	touch_response(resp);
+
+	if (resp->role != OCPP_MSG_ROLE_CALL &&
+			find_msg_by_idstr(&m.tx.ready, resp->id) == NULL) {
+		push_cached_response(resp);
+	}
+
+	return -EALREADY;
 }
 
 static void process_central_response(const struct ocpp_message *received,
@@ -338,10 +484,8 @@ static void process_central_response(const struct ocpp_message *received,
 
 	if (received->role == OCPP_MSG_ROLE_CALLERROR &&
 			is_transaction_related(req)) {
-		uint32_t max_attempts = OCPP_DEFAULT_TX_RETRIES;
-		ocpp_get_configuration("TransactionMessageAttempts",
-				&max_attempts, sizeof(max_attempts),
-				NULL);
+		const uint32_t max_attempts = (uint32_t)get_conf_int(
+				m.conf.tx_attempts, OCPP_DEFAULT_TX_RETRIES);
 		if (req->attempts < max_attempts) {
 			put_msg_ready_infront(req);
 			return;
@@ -366,7 +510,7 @@ static int process_incoming_messages(void)
 
 	switch (received.role) {
 	case OCPP_MSG_ROLE_CALL:
-		process_central_request(&received);
+		err = process_central_request(&received);
 		break;
 	case OCPP_MSG_ROLE_CALLRESULT: /* fall through */
 	case OCPP_MSG_ROLE_CALLERROR:
@@ -381,7 +525,7 @@ static int process_incoming_messages(void)
 	}
 
 out:
-	if (m.event_callback && err != -ENOMSG) {
+	if (m.event_callback && err != -ENOMSG && err != -EALREADY) {
 		ocpp_unlock();
 		(*m.event_callback)(err, &received, m.event_callback_ctx);
 		ocpp_lock();
@@ -480,17 +624,101 @@ const char *ocpp_stringify_type(ocpp_message_t msgtype)
 	return msgtype >= OCPP_MSG_MAX? "UnknownMessage" : msgstr[msgtype];
 }
 
+/* The action names are unique by length plus at most one character, so the
+ * only possible candidate is picked without scanning the whole table. The
+ * caller still confirms it with a single strcmp(). Keep this in sync with
+ * get_typestr_array() when adding a new message type. */
+static ocpp_message_t guess_type(const char *typestr, size_t len)
+{
+	switch (len) {
+	case 5:
+		return OCPP_MSG_RESET;
+	case 6:
+		return OCPP_MSG_GET_LOG;
+	case 9:
+		return typestr[0] == 'A'?
+			OCPP_MSG_AUTHORIZE : OCPP_MSG_HEARTBEAT;
+	case 10:
+		return typestr[0] == 'C'?
+			OCPP_MSG_CLEAR_CACHE : OCPP_MSG_RESERVE_NOW;
+	case 11:
+		return OCPP_MSG_METER_VALUES;
+	case 12:
+		return OCPP_MSG_DATA_TRANSFER;
+	case 13:
+		return OCPP_MSG_SEND_LOCAL_LIST;
+	case 14:
+		switch (typestr[0]) {
+		case 'G': return OCPP_MSG_GET_DIAGNOSTICS;
+		case 'U': return OCPP_MSG_UPDATE_FIRMWARE;
+		default:  return OCPP_MSG_TRIGGER_MESSAGE;
+		}
+	case 15:
+		switch (typestr[1]) {
+		case 't': return OCPP_MSG_STOP_TRANSACTION;
+		case 'n': return OCPP_MSG_UNLOCK_CONNECTOR;
+		default:  return OCPP_MSG_SIGN_CERTIFICATE;
+		}
+	case 16:
+		switch (typestr[0]) {
+		case 'B': return OCPP_MSG_BOOTNOTIFICATION;
+		case 'G': return OCPP_MSG_GET_CONFIGURATION;
+		default:  return OCPP_MSG_START_TRANSACTION;
+		}
+	case 17:
+		switch (typestr[1]) {
+		case 'a': return OCPP_MSG_CANCEL_RESERVATION;
+		case 'e': return typestr[0] == 'C'?
+				OCPP_MSG_CERTIFICATE_SIGNED :
+				OCPP_MSG_DELETE_CERTIFICATE;
+		default:  return OCPP_MSG_MAX;
+		}
+	case 18:
+		switch (typestr[1]) {
+		case 'h': return OCPP_MSG_CHANGE_AVAILABILITY;
+		case 't': return OCPP_MSG_STATUS_NOTIFICATION;
+		case 'e': return OCPP_MSG_SET_CHARGING_PROFILE;
+		default:  return OCPP_MSG_INSTALL_CERTIFICATE;
+		}
+	case 19:
+		return typestr[0] == 'C'? OCPP_MSG_CHANGE_CONFIGURATION :
+			OCPP_MSG_GET_LOCAL_LIST_VERSION;
+	case 20:
+		switch (typestr[0]) {
+		case 'C': return OCPP_MSG_CLEAR_CHARGING_PROFILE;
+		case 'G': return OCPP_MSG_GET_COMPOSITE_SCHEDULE;
+		default:  return OCPP_MSG_SIGNED_UPDATE_FIRMWARE;
+		}
+	case 21:
+		return typestr[0] == 'R'? OCPP_MSG_REMOTE_STOP_TRANSACTION :
+			OCPP_MSG_LOG_STATUS_NOTIFICATION;
+	case 22:
+		return typestr[0] == 'R'? OCPP_MSG_REMOTE_START_TRANSACTION :
+			OCPP_MSG_EXTENDED_TRIGGER_MESSAGE;
+	case 25:
+		return OCPP_MSG_SECURITY_EVENT_NOTIFICATION;
+	case 26:
+		return typestr[0] == 'F'? OCPP_MSG_FIRMWARE_NOTIFICATION :
+			OCPP_MSG_GET_INSTALLED_CERTIFICATE_IDS;
+	case 29:
+		return OCPP_MSG_DIAGNOSTICS_NOTIFICATION;
+	case 32:
+		return OCPP_MSG_SIGNED_FIRMWARE_STATUS_NOTIFICATION;
+	default:
+		return OCPP_MSG_MAX;
+	}
+}
+
 ocpp_message_t ocpp_get_type_from_string(const char *typestr)
 {
 	const char **msgstr = get_typestr_array();
+	ocpp_message_t type = guess_type(typestr, strlen(typestr));
 
-	for (ocpp_message_t i = 0; i < OCPP_MSG_MAX; i++) {
-		if (strcmp(typestr, msgstr[i]) == 0) {
-			return i;
-		}
+	if (type == OCPP_MSG_MAX || strcmp(typestr, msgstr[type]) != 0) {
+		return OCPP_MSG_MAX;
 	}
 
-	return OCPP_MSG_MAX;
+	return type;
 }
 
 ocpp_message_t ocpp_get_type_from_idstr(const char *idstr)
@@ -500,7 +728,7 @@ ocpp_message_t ocpp_get_type_from_idstr(const char *idstr)
 	ocpp_unlock();
 
 	if (req == NULL) {
-		return OCPP_MSG_MAX;
+		return ocpp_get_relayed_type_from_idstr(idstr);
 	}
 
 	return req->body.type;
@@ -545,8 +773,15 @@ int ocpp_push_response(const struct ocpp_message *req,
 		const void *data, size_t datasize, bool err)
 {
 	ocpp_lock();
+
 	int rc = push_message(req->id, req->type, data, datasize,
 			0, put_msg_ready, err);
+	struct response *resp = find_response(req->id);
+
+	if (rc == 0 && resp) {
+		put_response(resp, data, datasize, err);
+	}
+
 	ocpp_unlock();
 
 	return rc;
@@ -582,5 +817,10 @@ int ocpp_init(ocpp_event_callback_t cb, void *cb_ctx)
 
 	ocpp_reset_configuration();
 
+	m.conf.heartbeat_interval = ocpp_conf_from_keystr("HeartbeatInterval");
+	m.conf.tx_attempts = ocpp_conf_from_keystr("TransactionMessageAttempts");
+	m.conf.tx_retry_interval =
+		ocpp_conf_from_keystr("TransactionMessageRetryInterval");
+
 	return 0;
 }
@@ -12,3 +12,10 @@ void __attribute__((weak)) ocpp_generate_message_id(void *buf, size_t bufsize)
 {
 	snprintf(buf, bufsize, "%lu", time(NULL));
 }
+
+ocpp_message_t __attribute__((weak))
+ocpp_get_relayed_type_from_idstr(const char *idstr)
+{
+	(void)idstr;
+	return OCPP_MSG_MAX;
+}
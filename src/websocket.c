@@ -0,0 +1,1666 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "ocpp/websocket.h"
+#include "ocpp/message_json.h"
+#include "ocpp/core/configuration.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#if !defined(MSG_NOSIGNAL)
+#define MSG_NOSIGNAL				0
+#endif
+
+#define GUID				"258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+#define KEY_LEN				24 /* base64 of 16 bytes */
+#define ACCEPT_LEN			28 /* base64 of a SHA-1 digest */
+#define FRAME_HEADER_MAXLEN		14
+#define CONTROL_PAYLOAD_MAXLEN		125
+#define CLOSE_PROTOCOL_ERROR		1002
+#define CLOSE_TOO_BIG			1009
+#define RSV1				0x40 /* of a compressed message */
+#if OCPP_WEBSOCKET_DEFLATE
+#define DEFLATE_TOKEN			"permessage-deflate"
+#endif
+
+typedef enum {
+	OP_CONTINUATION	= 0x0,
+	OP_TEXT		= 0x1,
+	OP_BINARY	= 0x2,
+	OP_CLOSE	= 0x8,
+	OP_PING		= 0x9,
+	OP_PONG		= 0xA,
+} opcode_t;
+
+struct frame {
+	uint64_t len;
+	uint8_t key[4];
+	uint8_t opcode;
+	bool fin;
+	bool masked;
+	bool compressed;
+};
+
+enum {
+	STATS_TX,
+	STATS_RX,
+};
+
+struct deflate_params {
+	uint8_t server_bits; /* 0 if not given */
+	uint8_t client_bits; /* 0 if not given or given with no value */
+	bool client_bits_given;
+	bool server_no_takeover;
+	bool client_no_takeover;
+};
+
+static uint32_t rol32(uint32_t x, unsigned int n)
+{
+	return (x << n) | (x >> (32 - n));
+}
+
+static uint32_t load_be32(const uint8_t *p)
+{
+	return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 |
+		(uint32_t)p[2] << 8 | (uint32_t)p[3];
+}
+
+static void sha1_block(uint32_t h[5], const uint8_t *p)
+{
+	uint32_t w[80];
+
+	for (int i = 0; i < 16; i++) {
+		w[i] = load_be32(&p[i * 4]);
+	}
+	for (int i = 16; i < 80; i++) {
+		w[i] = rol32(w[i-3] ^ w[i-8] ^ w[i-14] ^ w[i-16], 1);
+	}
+
+	uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+
+	for (int i = 0; i < 80; i++) {
+		uint32_t f, k;
+
+		if (i < 20) {
+			f = (b & c) | (~b & d);
+			k = 0x5a827999;
+		} else if (i < 40) {
+			f = b ^ c ^ d;
+			k = 0x6ed9eba1;
+		} else if (i < 60) {
+			f = (b & c) | (b & d) | (c & d);
+			k = 0x8f1bbcdc;
+		} else {
+			f = b ^ c ^ d;
+			k = 0xca62c1d6;
+		}
+
+		const uint32_t t = rol32(a, 5) + f + e + k + w[i];
+		e = d;
+		d = c;
+		c = rol32(b, 30);
+		b = a;
+		a = t;
+	}
+
+	h[0] += a;
+	h[1] += b;
+	h[2] += c;
+	h[3] += d;
+	h[4] += e;
+}
+
+/* Only for the handshake, so the input is taken in one go. */
+static void sha1(const void *data, size_t len, uint8_t digest[20])
+{
+	uint32_t h[5] = {
+		0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0,
+	};
+	const uint8_t *p = (const uint8_t *)data;
+	const uint64_t bits = (uint64_t)len * 8;
+	uint8_t tail[128] = { 0, };
+	size_t n = len;
+
+	for (; n >= 64; n -= 64, p += 64) {
+		sha1_block(h, p);
+	}
+
+	memcpy(tail, p, n);
+	tail[n] = 0x80;
+	const size_t tail_len = n < 56? 64 : 128;
+	for (int i = 0; i < 8; i++) {
+		tail[tail_len - 1 - (size_t)i] = (uint8_t)(bits >> (i * 8));
+	}
+
+	sha1_block(h, tail);
+	if (tail_len == 128) {
+		sha1_block(h, &tail[64]);
+	}
+
+	for (int i = 0; i < 20; i++) {
+		digest[i] = (uint8_t)(h[i / 4] >> (24 - (i % 4) * 8));
+	}
+}
+
+static void encode_base64(char *out, const uint8_t *in, size_t len)
+{
+	static const char tbl[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+		"abcdefghijklmnopqrstuvwxyz0123456789+/";
+
+	for (size_t i = 0; i < len; i += 3) {
+		const uint32_t v = (uint32_t)in[i] << 16 |
+			(i + 1 < len? (uint32_t)in[i + 1] << 8 : 0) |
+			(i + 2 < len? (uint32_t)in[i + 2] : 0);
+
+		*out++ = tbl[(v >> 18) & 0x3f];
+		*out++ = tbl[(v >> 12) & 0x3f];
+		*out++ = i + 1 < len? tbl[(v >> 6) & 0x3f] : '=';
+		*out++ = i + 2 < len? tbl[v & 0x3f] : '=';
+	}
+
+	*out = '\0';
+}
+
+static void make_accept_key(char accept[ACCEPT_LEN + 1],
+		const char *key, size_t keylen)
+{
+	char buf[KEY_LEN + sizeof(GUID)];
+	uint8_t digest[20];
+
+	if (keylen > KEY_LEN) {
+		keylen = KEY_LEN;
+	}
+
+	memcpy(buf, key, keylen);
+	memcpy(&buf[keylen], GUID, sizeof(GUID) - 1);
+	sha1(buf, keylen + sizeof(GUID) - 1, digest);
+	encode_base64(accept, digest, sizeof(digest));
+}
+
+/* Masking keys need not be of a strong source but unpredictable to the
+ * scripts of the same network, which a reference client has none of. */
+static uint32_t next_random(struct ocpp_websocket *ws)
+{
+	uint32_t x = ws->seed;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+
+	return ws->seed = x;
+}
+
+/* @p dst may be @p src or before it, to mask a payload moving it down. */
+static void mask(uint8_t *dst, const uint8_t *src, size_t len,
+		const uint8_t key[4])
+{
+	uint32_t key32;
+	size_t i = 0;
+
+	memcpy(&key32, key, sizeof(key32));
+
+#if defined(__AVX2__)
+	const __m256i key256 = _mm256_set1_epi32((int)key32);
+
+	for (; len - i >= 32; i += 32) {
+		const __m256i v = _mm256_loadu_si256(
+				(const __m256i *)(const void *)&src[i]);
+		_mm256_storeu_si256((__m256i *)(void *)&dst[i],
+				_mm256_xor_si256(v, key256));
+	}
+#endif
+#if defined(__SSE2__)
+	const __m128i key128 = _mm_set1_epi32((int)key32);
+
+	for (; len - i >= 16; i += 16) {
+		const __m128i v =
+			_mm_loadu_si128((const __m128i *)(const void *)&src[i]);
+		_mm_storeu_si128((__m128i *)(void *)&dst[i],
+				_mm_xor_si128(v, key128));
+	}
+#elif defined(__ARM_NEON)
+	const uint8x16_t key128 = vreinterpretq_u8_u32(vdupq_n_u32(key32));
+
+	for (; len - i >= 16; i += 16) {
+		vst1q_u8(&dst[i], veorq_u8(vld1q_u8(&src[i]), key128));
+	}
+#endif
+	/* the key repeats every 4 bytes, so it stays in phase in a word */
+	const uint64_t key64 = (uint64_t)key32 << 32 | key32;
+
+	for (; len - i >= 8; i += 8) {
+		uint64_t v;
+		memcpy(&v, &src[i], sizeof(v));
+		v ^= key64;
+		memcpy(&dst[i], &v, sizeof(v));
+	}
+
+	for (; i < len; i++) {
+		dst[i] = src[i] ^ key[i & 3];
+	}
+}
+
+static size_t put_frame_header(uint8_t *p, opcode_t opcode, size_t len,
+		const uint8_t *key)
+{
+	const uint8_t masked = key? 0x80 : 0;
+	size_t n = 0;
+
+	p[n++] = (uint8_t)(0x80/*FIN*/ | opcode);
+
+	if (len < 126) {
+		p[n++] = (uint8_t)(masked | len);
+	} else if (len <= UINT16_MAX) {
+		p[n++] = masked | 126;
+		p[n++] = (uint8_t)(len >> 8);
+		p[n++] = (uint8_t)len;
+	} else {
+		p[n++] = masked | 127;
+		for (int i = 7; i >= 0; i--) {
+			p[n++] = (uint8_t)((uint64_t)len >> (i * 8));
+		}
+	}
+
+	if (key) {
+		memcpy(&p[n], key, 4);
+		n += 4;
+	}
+
+	return n;
+}
+
+/* @return the length of the header, 0 if incomplete or -EPROTO */
+static int parse_frame_header(const uint8_t *p, size_t avail, struct frame *f,
+		uint8_t rsv)
+{
+	size_t n = 2;
+
+	if (avail < n) {
+		return 0;
+	}
+	if (p[0] & 0x70 & ~rsv) { /* but of the extension negotiated */
+		return -EPROTO;
+	}
+
+	f->fin = (p[0] & 0x80) != 0;
+	f->compressed = (p[0] & RSV1) != 0;
+	f->opcode = p[0] & 0x0f;
+	f->masked = (p[1] & 0x80) != 0;
+	f->len = p[1] & 0x7f;
+
+	if (f->len == 126) {
+		if (avail < (n += 2)) {
+			return 0;
+		}
+		f->len = (uint64_t)p[2] << 8 | p[3];
+	} else if (f->len == 127) {
+		if (avail < (n += 8)) {
+			return 0;
+		}
+		f->len = 0;
+		for (size_t i = 2; i < 10; i++) {
+			f->len = f->len << 8 | p[i];
+		}
+		if (f->len >> 63) {
+			return -EPROTO;
+		}
+	}
+
+	if (f->masked) {
+		if (avail < n + 4) {
+			return 0;
+		}
+		memcpy(f->key, &p[n], 4);
+		n += 4;
+	}
+
+	if ((f->opcode & 0x8) && (!f->fin || f->len > CONTROL_PAYLOAD_MAXLEN)) {
+		return -EPROTO;
+	}
+
+	return (int)n;
+}
+
+static void teardown(struct ocpp_websocket *ws)
+{
+	if (ws->fd >= 0) {
+		close(ws->fd);
+	}
+
+	ws->fd = -1;
+	ws->state = OCPP_WEBSOCKET_CLOSED;
+}
+
+static int set_nonblocking(int fd)
+{
+	const int flags = fcntl(fd, F_GETFL, 0);
+
+	if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+		return -errno;
+	}
+
+	/* OCPP messages are small and latency-bound */
+	const int one = 1;
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+	return 0;
+}
+
+static void init(struct ocpp_websocket *ws, int fd)
+{
+	const time_t now = time(NULL);
+
+	memset(ws, 0, sizeof(*ws));
+	ws->fd = fd;
+	ws->seed = (uint32_t)now ^ (uint32_t)(uintptr_t)ws ^ (uint32_t)fd;
+	if (ws->seed == 0) {
+		ws->seed = 1;
+	}
+	ws->ping_interval = ocpp_conf_from_keystr("WebSocketPingInterval");
+}
+
+static void compact_tx(struct ocpp_websocket *ws)
+{
+	if (ws->tx.head == 0) {
+		return;
+	}
+
+	memmove(ws->tx.buf, &ws->tx.buf[ws->tx.head],
+			ws->tx.tail - ws->tx.head);
+	ws->tx.tail -= ws->tx.head;
+	ws->tx.head = 0;
+}
+
+static int reserve_tx(struct ocpp_websocket *ws, size_t len)
+{
+	if (len > sizeof(ws->tx.buf)) {
+		return -EMSGSIZE;
+	}
+
+	if (len > sizeof(ws->tx.buf) - ws->tx.tail) {
+		compact_tx(ws);
+		if (len > sizeof(ws->tx.buf) - ws->tx.tail) {
+			return -EAGAIN;
+		}
+	}
+
+	return 0;
+}
+
+/* Put a frame of @p src at the tail of the queue, which @p src may be in
+ * already right after the room of the longest header. The payload is masked
+ * as it moves down to the header. */
+static void commit_frame(struct ocpp_websocket *ws, opcode_t opcode,
+		const uint8_t *src, size_t len)
+{
+	uint8_t *frame = &ws->tx.buf[ws->tx.tail];
+	size_t n;
+
+	if (ws->server) {
+		n = put_frame_header(frame, opcode, len, NULL);
+		if (len > 0) {
+			memmove(&frame[n], src, len);
+		}
+	} else {
+		const uint32_t r = next_random(ws);
+		uint8_t key[4];
+
+		memcpy(key, &r, sizeof(key));
+		n = put_frame_header(frame, opcode, len, key);
+		mask(&frame[n], src, len, key);
+	}
+
+	ws->tx.tail += n + len;
+}
+
+/* Lay the segments of a payload out from @p offset on, masked in the phase
+ * of the payload. */
+static void gather(uint8_t *dst, const struct ocpp_iovec *iov, size_t n,
+		size_t offset, const uint8_t *key)
+{
+	size_t pos = 0;
+
+	for (size_t i = 0; i < n; pos += iov[i].len, i++) {
+		if (pos + iov[i].len <= offset) {
+			continue;
+		}
+
+		const size_t skip = offset > pos? offset - pos : 0;
+		const uint8_t *src = (const uint8_t *)iov[i].base + skip;
+		const size_t len = iov[i].len - skip;
+
+		if (key) {
+			uint8_t rotated[4];
+			for (size_t j = 0; j < sizeof(rotated); j++) {
+				rotated[j] = key[(pos + skip + j) & 3];
+			}
+			mask(dst, src, len, rotated);
+		} else {
+			memcpy(dst, src, len);
+		}
+
+		dst += len;
+	}
+}
+
+/* @return the bytes sent right away, which is done only with nothing queued
+ * and no masking */
+static size_t send_direct(struct ocpp_websocket *ws, const uint8_t *hdr,
+		size_t hlen, const struct ocpp_iovec *iov, size_t n)
+{
+	struct iovec v[OCPP_WEBSOCKET_IOV_MAX + 1];
+	struct msghdr mh = { .msg_iov = v, .msg_iovlen = n + 1, };
+
+	if (!ws->server || ws->tx.head < ws->tx.tail) {
+		return 0;
+	}
+
+	v[0].iov_base = (void *)(uintptr_t)hdr;
+	v[0].iov_len = hlen;
+	for (size_t i = 0; i < n; i++) {
+		v[i + 1].iov_base = (void *)(uintptr_t)iov[i].base;
+		v[i + 1].iov_len = iov[i].len;
+	}
+
+	const ssize_t sent = sendmsg(ws->fd, &mh, MSG_NOSIGNAL);
+
+	return sent > 0? (size_t)sent : 0; /* errors to be seen in the step */
+}
+
+/* Put a frame of segments, of which some are in @p scratch in the queue
+ * and the rest in place in the message. The server hands them to the
+ * socket at once, queueing what is left. The client masks them into the
+ * queue, copying the long strings once. */
+static int commit_framev(struct ocpp_websocket *ws, struct ocpp_iovec *iov,
+		size_t n, size_t len, const uint8_t *scratch)
+{
+	uint8_t *end = &ws->tx.buf[sizeof(ws->tx.buf)];
+	uint8_t hdr[FRAME_HEADER_MAXLEN];
+	uint8_t key[4];
+	size_t used = 0;
+
+	for (size_t i = 0; i < n; i++) {
+		const uint8_t *base = (const uint8_t *)iov[i].base;
+		if (base >= scratch && base < end &&
+				(size_t)(base - scratch) + iov[i].len > used) {
+			used = (size_t)(base - scratch) + iov[i].len;
+		}
+	}
+
+	if (!ws->server) {
+		const uint32_t r = next_random(ws);
+		memcpy(key, &r, sizeof(key));
+	}
+
+	const size_t hlen = put_frame_header(hdr, OP_TEXT, len,
+			ws->server? NULL : key);
+
+	/* the scratch goes to the end, out of the way of the frame */
+	if (hlen + len + used > sizeof(ws->tx.buf) - ws->tx.tail) {
+		return -EMSGSIZE;
+	}
+
+	uint8_t *moved = end - used;
+	memmove(moved, scratch, used);
+	for (size_t i = 0; i < n; i++) {
+		const uint8_t *base = (const uint8_t *)iov[i].base;
+		if (base >= scratch && base < scratch + used) {
+			iov[i].base = moved + (base - scratch);
+		}
+	}
+
+	const size_t sent = send_direct(ws, hdr, hlen, iov, n);
+	uint8_t *p = &ws->tx.buf[ws->tx.tail];
+
+	if (sent < hlen) {
+		memcpy(p, &hdr[sent], hlen - sent);
+		p += hlen - sent;
+	}
+	if (sent < hlen + len) {
+		const size_t offset = sent > hlen? sent - hlen : 0;
+		gather(p, iov, n, offset, ws->server? NULL : key);
+		p += len - offset;
+	}
+
+	ws->tx.tail = (size_t)(p - ws->tx.buf);
+
+	return 0;
+}
+
+static int queue_frame(struct ocpp_websocket *ws, opcode_t opcode,
+		const void *data, size_t len)
+{
+	const int err = reserve_tx(ws, FRAME_HEADER_MAXLEN + len);
+
+	if (err == 0) {
+		commit_frame(ws, opcode, (const uint8_t *)data, len);
+	}
+
+	return err;
+}
+
+static int queue_close(struct ocpp_websocket *ws, uint16_t code)
+{
+	const uint8_t payload[2] = { (uint8_t)(code >> 8), (uint8_t)code };
+	return queue_frame(ws, OP_CLOSE, payload, sizeof(payload));
+}
+
+static int flush_tx(struct ocpp_websocket *ws)
+{
+	while (ws->tx.head < ws->tx.tail) {
+		const ssize_t n = send(ws->fd, &ws->tx.buf[ws->tx.head],
+				ws->tx.tail - ws->tx.head, MSG_NOSIGNAL);
+
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			} else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+				return 0;
+			}
+			return -errno;
+		}
+
+		ws->tx.head += (size_t)n;
+	}
+
+	ws->tx.head = ws->tx.tail = 0;
+
+	return 0;
+}
+
+/* Move what is alive down to the start, which is rare as the buffer gets
+ * back to the start whenever drained. */
+static void compact_rx(struct ocpp_websocket *ws)
+{
+	const size_t head = ws->rx.head;
+
+	if (head == 0) {
+		return;
+	}
+
+	memmove(ws->rx.buf, &ws->rx.buf[head], ws->rx.tail - head);
+	ws->rx.scan -= head;
+	ws->rx.tail -= head;
+	ws->rx.head = 0;
+}
+
+/* @return the bytes read, 0 if none to read for now or a negative error */
+static int fill_rx(struct ocpp_websocket *ws)
+{
+	if (ws->rx.tail == sizeof(ws->rx.buf)) {
+		compact_rx(ws);
+		if (ws->rx.tail == sizeof(ws->rx.buf)) {
+			return -EMSGSIZE;
+		}
+	}
+
+	const ssize_t n = recv(ws->fd, &ws->rx.buf[ws->rx.tail],
+			sizeof(ws->rx.buf) - ws->rx.tail, 0);
+
+	if (n == 0) {
+		return -ECONNRESET;
+	} else if (n < 0) {
+		if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+			return 0;
+		}
+		return -errno;
+	}
+
+	ws->rx.tail += (size_t)n;
+
+	return (int)n;
+}
+
+static int process_close(struct ocpp_websocket *ws,
+		const uint8_t *payload, size_t len)
+{
+	if (ws->state == OCPP_WEBSOCKET_CLOSING) { /* the reply to ours */
+		teardown(ws);
+		return 0;
+	}
+
+	const uint16_t code = len >= 2?
+		(uint16_t)(payload[0] << 8 | payload[1]) : 1000/*normal*/;
+
+	if (queue_close(ws, code) == 0) {
+		(void)flush_tx(ws);
+	}
+
+	return -ECONNRESET;
+}
+
+static uint8_t get_rsv(const struct ocpp_websocket *ws)
+{
+#if OCPP_WEBSOCKET_DEFLATE
+	return ws->deflate.negotiated? RSV1 : 0;
+#else
+	(void)ws;
+	return 0;
+#endif
+}
+
+#if OCPP_WEBSOCKET_DEFLATE
+static int inflate_message(struct ocpp_websocket *ws)
+{
+	const int len = ocpp_inflate(&ws->deflate.rx, &ws->rx.buf[ws->rx.head],
+			ws->rx.len, ws->deflate.buf, sizeof(ws->deflate.buf));
+
+	if (len < 0) {
+		return len == -ENOBUFS? -EMSGSIZE : -EPROTO;
+	}
+
+	ws->deflate.len = (size_t)len;
+
+	return 0;
+}
+
+static void count_message(struct ocpp_websocket *ws, int dir,
+		ocpp_message_t type, size_t raw, size_t compressed)
+{
+	if (!ws->deflate.negotiated || (unsigned int)type >= OCPP_MSG_MAX) {
+		return;
+	}
+
+	struct ocpp_websocket_deflate_stats *stats =
+		&ws->deflate.stats[dir][type];
+
+	stats->messages++;
+	stats->raw += raw;
+	stats->compressed += compressed;
+}
+#endif
+
+static int process_frame(struct ocpp_websocket *ws, const struct frame *f,
+		size_t hlen)
+{
+	uint8_t *payload = &ws->rx.buf[ws->rx.scan + hlen];
+	const size_t len = (size_t)f->len;
+	int err = 0;
+
+	if (f->masked != ws->server || (f->compressed &&
+			f->opcode != OP_TEXT && f->opcode != OP_BINARY)) {
+		return -EPROTO;
+	} else if (f->masked) {
+		mask(payload, payload, len, f->key);
+	}
+
+	switch (f->opcode) {
+	case OP_TEXT: /* fall through */
+	case OP_BINARY:
+		if (ws->rx.fragmented) {
+			return -EPROTO;
+		}
+		ws->rx.head = ws->rx.scan + hlen;
+		ws->rx.len = len;
+#if OCPP_WEBSOCKET_DEFLATE
+		ws->deflate.compressed = f->compressed;
+#endif
+		break;
+	case OP_CONTINUATION:
+		if (!ws->rx.fragmented) {
+			return -EPROTO;
+		}
+		/* only the fragments of a message get moved, over the headers
+		 * in between */
+		memmove(&ws->rx.buf[ws->rx.head + ws->rx.len], payload, len);
+		ws->rx.len += len;
+		break;
+	case OP_PING:
+		if ((err = queue_frame(ws, OP_PONG, payload, len)) == -EAGAIN) {
+			err = 0; /* the peer will ping again */
+		}
+		break;
+	case OP_PONG:
+		ws->pong_pending = false;
+		break;
+	case OP_CLOSE:
+		return process_close(ws, payload, len);
+	default:
+		return -EPROTO;
+	}
+
+	ws->rx.scan += hlen + len;
+
+	if (f->opcode & 0x8) {
+		if (!ws->rx.fragmented) {
+			ws->rx.head = ws->rx.scan;
+		}
+	} else {
+		ws->rx.fragmented = !f->fin;
+		ws->rx.ready = f->fin;
+#if OCPP_WEBSOCKET_DEFLATE
+		if (ws->rx.ready && ws->deflate.compressed) {
+			err = inflate_message(ws);
+		}
+#endif
+	}
+
+	return err;
+}
+
+static int parse_frames(struct ocpp_websocket *ws)
+{
+	while (!ws->rx.ready && ws->state != OCPP_WEBSOCKET_CLOSED) {
+		struct frame f;
+		const int hlen = parse_frame_header(&ws->rx.buf[ws->rx.scan],
+				ws->rx.tail - ws->rx.scan, &f, get_rsv(ws));
+
+		if (hlen <= 0) {
+			return hlen;
+		}
+
+		/* all the frames of a message are to be in at once */
+		if (f.len > sizeof(ws->rx.buf) || ws->rx.scan - ws->rx.head +
+				(size_t)hlen + f.len > sizeof(ws->rx.buf)) {
+			return -EMSGSIZE;
+		} else if (ws->rx.tail - ws->rx.scan < (size_t)hlen + f.len) {
+			return 0;
+		}
+
+		const int err = process_frame(ws, &f, (size_t)hlen);
+		if (err) {
+			return err;
+		}
+	}
+
+	return 0;
+}
+
+static const char *find_header_end(const char *p, size_t len)
+{
+	for (size_t i = 3; i < len; i++) {
+		if (p[i] == '\n' && p[i-1] == '\r' &&
+				p[i-2] == '\n' && p[i-3] == '\r') {
+			return &p[i + 1];
+		}
+	}
+
+	return NULL;
+}
+
+static const char *get_header(const char *p, const char *end,
+		const char *name, size_t *valuelen)
+{
+	const size_t namelen = strlen(name);
+
+	while (p < end) {
+		const char *eol = p;
+		while (eol < end && *eol != '\r') {
+			eol++;
+		}
+
+		if ((size_t)(eol - p) > namelen && p[namelen] == ':' &&
+				strncasecmp(p, name, namelen) == 0) {
+			const char *v = &p[namelen + 1];
+			while (v < eol && (*v == ' ' || *v == '\t')) {
+				v++;
+			}
+			const char *e = eol;
+			while (e > v && (e[-1] == ' ' || e[-1] == '\t')) {
+				e--;
+			}
+			*valuelen = (size_t)(e - v);
+			return v;
+		}
+
+		p = eol + 2;
+	}
+
+	return NULL;
+}
+
+static bool has_token(const char *list, size_t len, const char *token)
+{
+	const size_t toklen = strlen(token);
+	const char *end = &list[len];
+
+	while (list < end) {
+		while (list < end && (*list == ' ' || *list == ',')) {
+			list++;
+		}
+		const char *e = list;
+		while (e < end && *e != ',' && *e != ' ') {
+			e++;
+		}
+		if ((size_t)(e - list) == toklen &&
+				strncasecmp(list, token, toklen) == 0) {
+			return true;
+		}
+		list = e;
+	}
+
+	return false;
+}
+
+static bool is_header(const char *p, const char *end, const char *name,
+		const char *expected)
+{
+	size_t len;
+	const char *v = get_header(p, end, name, &len);
+
+	return v && len == strlen(expected) && strncasecmp(v, expected, len) == 0;
+}
+
+#if OCPP_WEBSOCKET_DEFLATE
+static void trim(const char **p, const char **end)
+{
+	while (*p < *end && (**p == ' ' || **p == '\t')) {
+		(*p)++;
+	}
+	while (*end > *p && ((*end)[-1] == ' ' || (*end)[-1] == '\t')) {
+		(*end)--;
+	}
+}
+
+static bool is_token(const char *p, const char *end, const char *token)
+{
+	const size_t len = strlen(token);
+	return (size_t)(end - p) == len && strncasecmp(p, token, len) == 0;
+}
+
+static int parse_window_bits(const char *v, const char *end)
+{
+	int bits = 0;
+
+	if (end - v >= 2 && *v == '"' && end[-1] == '"') {
+		v++;
+		end--;
+	}
+	if (v == end || end - v > 2) {
+		return -EINVAL;
+	}
+
+	for (; v < end; v++) {
+		if (*v < '0' || *v > '9') {
+			return -EINVAL;
+		}
+		bits = bits * 10 + (*v - '0');
+	}
+
+	return bits < 8 || bits > 15? -EINVAL : bits;
+}
+
+/* Parse an offer or a response of "permessage-deflate; param; param=value"
+ * up to @p end.
+ *
+ * @return 0 on success. -ENOENT if of another extension. -EINVAL on a
+ *         parameter unknown or of an invalid value */
+static int parse_deflate_params(const char *p, const char *end,
+		struct deflate_params *params)
+{
+	memset(params, 0, sizeof(*params));
+
+	for (bool first = true;; first = false) {
+		const char *e = memchr(p, ';', (size_t)(end - p));
+		const char *name = p;
+		const char *name_end = e? e : end;
+		const char *eq = memchr(name, '=', (size_t)(name_end - name));
+		int bits = 0;
+
+		if (eq) {
+			const char *value = eq + 1;
+			const char *value_end = name_end;
+			trim(&value, &value_end);
+			name_end = eq;
+			bits = parse_window_bits(value, value_end);
+		}
+		trim(&name, &name_end);
+
+		if (first) {
+			if (eq || !is_token(name, name_end, DEFLATE_TOKEN)) {
+				return -ENOENT;
+			}
+		} else if (bits < 0) {
+			return -EINVAL;
+		} else if (!eq && is_token(name, name_end,
+					"server_no_context_takeover")) {
+			params->server_no_takeover = true;
+		} else if (!eq && is_token(name, name_end,
+					"client_no_context_takeover")) {
+			params->client_no_takeover = true;
+		} else if (eq && is_token(name, name_end,
+					"server_max_window_bits")) {
+			params->server_bits = (uint8_t)bits;
+		} else if (is_token(name, name_end, "client_max_window_bits")) {
+			params->client_bits_given = true;
+			params->client_bits = (uint8_t)bits;
+		} else {
+			return -EINVAL;
+		}
+
+		if (e == NULL) {
+			return 0;
+		}
+		p = e + 1;
+	}
+}
+
+/* As a client, the windows of both directions are asked to be bounded, to
+ * which a server of the default 32KiB window may well decline. */
+static void offer_deflate(const struct ocpp_websocket *ws,
+		char *ext, size_t extsize)
+{
+	ext[0] = '\0';
+
+	if (ws->deflate.offered) {
+		snprintf(ext, extsize, "Sec-WebSocket-Extensions: "
+				DEFLATE_TOKEN "; client_max_window_bits=%u"
+				"; server_max_window_bits=%u%s\r\n",
+				OCPP_DEFLATE_WINDOW_BITS,
+				OCPP_DEFLATE_WINDOW_BITS,
+				ws->deflate.takeover? "" :
+				"; client_no_context_takeover"
+				"; server_no_context_takeover");
+	}
+}
+
+static int check_deflate(struct ocpp_websocket *ws,
+		const char *p, const char *end)
+{
+	struct deflate_params params;
+	size_t len;
+	const char *v = get_header(p, end, "Sec-WebSocket-Extensions", &len);
+
+	if (v == NULL) {
+		return 0;
+	}
+
+	if (!ws->deflate.offered || memchr(v, ',', len) ||
+			parse_deflate_params(v, &v[len], &params) != 0 ||
+			params.server_bits == 0 ||
+			params.server_bits > OCPP_DEFLATE_WINDOW_BITS ||
+			(params.client_bits_given && params.client_bits == 0) ||
+			params.client_bits > OCPP_DEFLATE_WINDOW_BITS ||
+			(!ws->deflate.takeover && !params.server_no_takeover)) {
+		return -EPROTO;
+	}
+
+	ocpp_deflate_init(&ws->deflate.tx, params.client_bits?
+			params.client_bits : OCPP_DEFLATE_WINDOW_BITS,
+			ws->deflate.takeover && !params.client_no_takeover);
+	ocpp_inflate_init(&ws->deflate.rx, params.server_bits,
+			!params.server_no_takeover);
+	ws->deflate.negotiated = true;
+
+	return 0;
+}
+
+/* Take the first offer of permessage-deflate that bounds the window of the
+ * client, as the window of the inflater is no larger. */
+static void accept_deflate(struct ocpp_websocket *ws,
+		const char *p, const char *end, char *ext, size_t extsize)
+{
+	struct deflate_params params;
+	size_t len;
+	const char *v = get_header(p, end, "Sec-WebSocket-Extensions", &len);
+	bool found = false;
+
+	ext[0] = '\0';
+
+	if (!ws->deflate.offered || v == NULL) {
+		return;
+	}
+
+	for (const char *vend = &v[len]; !found && v < vend;) {
+		const char *e = memchr(v, ',', (size_t)(vend - v));
+		const char *offer_end = e? e : vend;
+
+		found = parse_deflate_params(v, offer_end, &params) == 0 &&
+			(params.client_bits_given ||
+			 OCPP_DEFLATE_WINDOW_BITS == 15);
+		v = e? e + 1 : vend;
+	}
+
+	if (!found) {
+		return;
+	}
+
+	const uint8_t txbits = params.server_bits &&
+		params.server_bits < OCPP_DEFLATE_WINDOW_BITS?
+		params.server_bits : OCPP_DEFLATE_WINDOW_BITS;
+	const uint8_t rxbits = params.client_bits &&
+		params.client_bits < OCPP_DEFLATE_WINDOW_BITS?
+		params.client_bits : OCPP_DEFLATE_WINDOW_BITS;
+	const bool txtakeover = ws->deflate.takeover &&
+		!params.server_no_takeover;
+	const bool rxtakeover = ws->deflate.takeover &&
+		!params.client_no_takeover;
+	char client_bits[sizeof("; client_max_window_bits=255")] = "";
+
+	if (params.client_bits_given) {
+		snprintf(client_bits, sizeof(client_bits),
+				"; client_max_window_bits=%u", rxbits);
+	}
+
+	snprintf(ext, extsize, "Sec-WebSocket-Extensions: " DEFLATE_TOKEN
+			"; server_max_window_bits=%u%s%s%s\r\n",
+			txbits, client_bits,
+			txtakeover? "" : "; server_no_context_takeover",
+			rxtakeover? "" : "; client_no_context_takeover");
+
+	ocpp_deflate_init(&ws->deflate.tx, txbits, txtakeover);
+	ocpp_inflate_init(&ws->deflate.rx, rxbits, rxtakeover);
+	ws->deflate.negotiated = true;
+}
+#endif
+
+static int send_request(struct ocpp_websocket *ws)
+{
+	char *p = (char *)&ws->tx.buf[ws->tx.tail];
+	const size_t avail = sizeof(ws->tx.buf) - ws->tx.tail;
+	char ext[160] = "";
+
+#if OCPP_WEBSOCKET_DEFLATE
+	offer_deflate(ws, ext, sizeof(ext));
+#endif
+	const int len = snprintf(p, avail, "GET %s HTTP/1.1\r\n"
+			"Host: %s\r\n"
+			"Upgrade: websocket\r\n"
+			"Connection: Upgrade\r\n"
+			"Sec-WebSocket-Key: %s\r\n"
+			"Sec-WebSocket-Version: 13\r\n"
+			"Sec-WebSocket-Protocol: " OCPP_WEBSOCKET_SUBPROTOCOL "\r\n"
+			"%s"
+			"\r\n", ws->path, ws->host, ws->key, ext);
+
+	if (len < 0 || (size_t)len >= avail) {
+		return -EMSGSIZE;
+	}
+
+	ws->tx.tail += (size_t)len;
+	ws->state = OCPP_WEBSOCKET_HANDSHAKING;
+
+	return flush_tx(ws);
+}
+
+static int check_response(struct ocpp_websocket *ws,
+		const char *p, const char *end)
+{
+	char accept[ACCEPT_LEN + 1];
+
+	make_accept_key(accept, ws->key, KEY_LEN);
+
+	if ((size_t)(end - p) < 12 || memcmp(p, "HTTP/1.1 101", 12) != 0 ||
+			!is_header(p, end, "Upgrade", "websocket") ||
+			!is_header(p, end, "Sec-WebSocket-Protocol",
+				OCPP_WEBSOCKET_SUBPROTOCOL)) {
+		return -EPROTO;
+	}
+
+	size_t len;
+	const char *v = get_header(p, end, "Sec-WebSocket-Accept", &len);
+	if (!v || len != ACCEPT_LEN || memcmp(v, accept, len) != 0) {
+		return -EPROTO;
+	}
+
+#if OCPP_WEBSOCKET_DEFLATE
+	return check_deflate(ws, p, end);
+#else
+	return 0;
+#endif
+}
+
+static int reject_request(struct ocpp_websocket *ws)
+{
+	static const char rejected[] = "HTTP/1.1 400 Bad Request\r\n"
+		"Content-Length: 0\r\n\r\n";
+
+	if (reserve_tx(ws, sizeof(rejected) - 1) == 0) {
+		memcpy(&ws->tx.buf[ws->tx.tail], rejected, sizeof(rejected) - 1);
+		ws->tx.tail += sizeof(rejected) - 1;
+		(void)flush_tx(ws);
+	}
+
+	return -EPROTO;
+}
+
+static int answer_request(struct ocpp_websocket *ws,
+		const char *p, const char *end)
+{
+	char *buf = (char *)&ws->tx.buf[ws->tx.tail];
+	const size_t avail = sizeof(ws->tx.buf) - ws->tx.tail;
+	char accept[ACCEPT_LEN + 1];
+	char ext[160] = "";
+	size_t keylen, protolen;
+
+	if ((size_t)(end - p) < 4 || memcmp(p, "GET ", 4) != 0) {
+		return reject_request(ws);
+	}
+
+	const char *key = get_header(p, end, "Sec-WebSocket-Key", &keylen);
+	const char *proto = get_header(p, end, "Sec-WebSocket-Protocol",
+			&protolen);
+	const char *path = &p[4];
+	const char *path_end = memchr(path, ' ', (size_t)(end - path));
+
+	if (!path_end || (size_t)(path_end - path) >= sizeof(ws->path) ||
+			!key || keylen != KEY_LEN || !proto ||
+			!has_token(proto, protolen,
+				OCPP_WEBSOCKET_SUBPROTOCOL)) {
+		return reject_request(ws);
+	}
+
+	memcpy(ws->path, path, (size_t)(path_end - path));
+	ws->path[path_end - path] = '\0';
+	make_accept_key(accept, key, keylen);
+#if OCPP_WEBSOCKET_DEFLATE
+	accept_deflate(ws, p, end, ext, sizeof(ext));
+#endif
+
+	const int len = snprintf(buf, avail, "HTTP/1.1 101 Switching Protocols\r\n"
+			"Upgrade: websocket\r\n"
+			"Connection: Upgrade\r\n"
+			"Sec-WebSocket-Accept: %s\r\n"
+			"Sec-WebSocket-Protocol: " OCPP_WEBSOCKET_SUBPROTOCOL "\r\n"
+			"%s"
+			"\r\n", accept, ext);
+
+	if (len < 0 || (size_t)len >= avail) {
+		return -EMSGSIZE;
+	}
+
+	ws->tx.tail += (size_t)len;
+
+	return 0;
+}
+
+static int process_handshake(struct ocpp_websocket *ws)
+{
+	int err = fill_rx(ws);
+
+	if (err < 0) {
+		return err == -EMSGSIZE? -EPROTO : err;
+	}
+
+	const char *p = (const char *)ws->rx.buf;
+	const char *end = find_header_end(p, ws->rx.tail);
+
+	if (end == NULL) {
+		return 0;
+	}
+
+	if (ws->server) {
+		err = answer_request(ws, p, end);
+	} else {
+		err = check_response(ws, p, end);
+	}
+
+	if (err == 0) {
+		/* frames may follow the handshake in the same read */
+		ws->rx.head = ws->rx.scan = (size_t)(end - p);
+		ws->state = OCPP_WEBSOCKET_OPEN;
+		ws->ping_timestamp = time(NULL);
+	}
+
+	return err;
+}
+
+static int process_connecting(struct ocpp_websocket *ws)
+{
+	struct sockaddr_storage addr;
+	socklen_t len = sizeof(int);
+	int err = 0;
+
+	if (getsockopt(ws->fd, SOL_SOCKET, SO_ERROR, &err, &len) < 0) {
+		return -errno;
+	} else if (err) {
+		return -err;
+	}
+
+	len = sizeof(addr);
+	if (getpeername(ws->fd, (struct sockaddr *)&addr, &len) < 0) {
+		return errno == ENOTCONN? 0 : -errno;
+	}
+
+	return send_request(ws);
+}
+
+static int process_ping(struct ocpp_websocket *ws)
+{
+	const int interval = ws->ping_interval < OCPP_CONF_MAX?
+		ocpp_conf_get_int(ws->ping_interval) : 0;
+	const time_t now = time(NULL);
+
+	if (interval <= 0 || now - ws->ping_timestamp < interval) {
+		return 0;
+	} else if (ws->pong_pending) {
+		return -ETIMEDOUT;
+	}
+
+	ws->ping_timestamp = now;
+
+	const int err = queue_frame(ws, OP_PING, NULL, 0);
+	if (err == 0) {
+		ws->pong_pending = true;
+	}
+
+	return err == -EAGAIN? 0 : err;
+}
+
+static int process_frames(struct ocpp_websocket *ws)
+{
+	int err;
+
+	if (ws->state == OCPP_WEBSOCKET_OPEN && (err = process_ping(ws))) {
+		return err;
+	}
+	if ((err = flush_tx(ws))) {
+		return err;
+	}
+
+	while ((err = parse_frames(ws)) == 0 && !ws->rx.ready &&
+			ws->state != OCPP_WEBSOCKET_CLOSED) {
+		if ((err = fill_rx(ws)) <= 0) {
+			break;
+		}
+	}
+
+	if (err == -EMSGSIZE || err == -EPROTO) {
+		if (queue_close(ws, err == -EPROTO?
+				CLOSE_PROTOCOL_ERROR : CLOSE_TOO_BIG) == 0) {
+			(void)flush_tx(ws);
+		}
+	} else if (err == 0 && ws->state != OCPP_WEBSOCKET_CLOSED) {
+		err = flush_tx(ws); /* pongs and the reply to a close */
+	}
+
+	return err;
+}
+
+int ocpp_websocket_step(struct ocpp_websocket *ws)
+{
+	int err;
+
+	if (ws == NULL) {
+		return -EINVAL;
+	}
+
+	switch (ws->state) {
+	case OCPP_WEBSOCKET_CONNECTING:
+		err = process_connecting(ws);
+		break;
+	case OCPP_WEBSOCKET_HANDSHAKING:
+		if ((err = flush_tx(ws)) == 0) {
+			err = process_handshake(ws);
+		}
+		if (err == 0 && ws->state == OCPP_WEBSOCKET_OPEN) {
+			err = process_frames(ws);
+		}
+		break;
+	case OCPP_WEBSOCKET_OPEN: /* fall through */
+	case OCPP_WEBSOCKET_CLOSING:
+		err = process_frames(ws);
+		break;
+	case OCPP_WEBSOCKET_CLOSED: /* fall through */
+	default:
+		return -ENOTCONN;
+	}
+
+	if (err) {
+		teardown(ws);
+	}
+
+	return err;
+}
+
+int ocpp_websocket_connect(struct ocpp_websocket *ws,
+		const char *host, uint16_t port, const char *path)
+{
+	struct addrinfo hints = {
+		.ai_family = AF_UNSPEC,
+		.ai_socktype = SOCK_STREAM,
+	};
+	struct addrinfo *res;
+	char service[sizeof("65535")];
+	uint8_t nonce[16];
+
+	if (ws == NULL || host == NULL || path == NULL ||
+			strlen(path) >= sizeof(ws->path)) {
+		return -EINVAL;
+	}
+
+	init(ws, -1);
+
+	const int len = snprintf(ws->host, sizeof(ws->host), "%s:%u",
+			host, port);
+	if (len < 0 || (size_t)len >= sizeof(ws->host)) {
+		return -EINVAL;
+	}
+	strcpy(ws->path, path);
+
+	for (size_t i = 0; i < sizeof(nonce); i += 4) {
+		const uint32_t r = next_random(ws);
+		memcpy(&nonce[i], &r, sizeof(r));
+	}
+	encode_base64(ws->key, nonce, sizeof(nonce));
+
+	snprintf(service, sizeof(service), "%u", port);
+	if (getaddrinfo(host, service, &hints, &res) != 0) {
+		return -EHOSTUNREACH;
+	}
+
+	int err = -EHOSTUNREACH;
+
+	for (const struct addrinfo *ai = res; ai; ai = ai->ai_next) {
+		const int fd = socket(ai->ai_family, ai->ai_socktype,
+				ai->ai_protocol);
+
+		if (fd < 0) {
+			err = -errno;
+			continue;
+		}
+
+		if ((err = set_nonblocking(fd)) == 0) {
+			if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0 ||
+					errno == EINPROGRESS) {
+				ws->fd = fd;
+				ws->state = OCPP_WEBSOCKET_CONNECTING;
+				break;
+			}
+			err = -errno;
+		}
+
+		close(fd);
+	}
+
+	freeaddrinfo(res);
+
+	return err;
+}
+
+int ocpp_websocket_accept(struct ocpp_websocket *ws, int fd)
+{
+	if (ws == NULL || fd < 0) {
+		return -EINVAL;
+	}
+
+	init(ws, fd);
+
+	const int err = set_nonblocking(fd);
+	if (err) {
+		close(fd);
+		ws->fd = -1;
+		return err;
+	}
+
+	ws->server = true;
+	ws->state = OCPP_WEBSOCKET_HANDSHAKING;
+
+	return 0;
+}
+
+int ocpp_websocket_close(struct ocpp_websocket *ws, uint16_t code)
+{
+	if (ws == NULL || ws->state != OCPP_WEBSOCKET_OPEN) {
+		return -ENOTCONN;
+	}
+
+	const int err = queue_close(ws, code);
+	if (err == 0) {
+		ws->state = OCPP_WEBSOCKET_CLOSING;
+		(void)flush_tx(ws);
+	}
+
+	return err;
+}
+
+int ocpp_websocket_enable_deflate(struct ocpp_websocket *ws,
+		bool context_takeover)
+{
+#if OCPP_WEBSOCKET_DEFLATE
+	if (ws == NULL) {
+		return -EINVAL;
+	} else if (ws->state != OCPP_WEBSOCKET_CONNECTING && !(ws->server &&
+				ws->state == OCPP_WEBSOCKET_HANDSHAKING)) {
+		return -EALREADY;
+	}
+
+	ws->deflate.offered = true;
+	ws->deflate.takeover = context_takeover;
+
+	return 0;
+#else
+	(void)ws;
+	(void)context_takeover;
+	return -ENOTSUP;
+#endif
+}
+
+bool ocpp_websocket_has_deflate(const struct ocpp_websocket *ws)
+{
+#if OCPP_WEBSOCKET_DEFLATE
+	return ws->deflate.negotiated;
+#else
+	(void)ws;
+	return false;
+#endif
+}
+
+int ocpp_websocket_get_deflate_stats(const struct ocpp_websocket *ws,
+		ocpp_message_t type, struct ocpp_websocket_deflate_stats *tx,
+		struct ocpp_websocket_deflate_stats *rx)
+{
+#if OCPP_WEBSOCKET_DEFLATE
+	if (ws == NULL || (unsigned int)type >= OCPP_MSG_MAX) {
+		return -EINVAL;
+	}
+
+	if (tx) {
+		*tx = ws->deflate.stats[STATS_TX][type];
+	}
+	if (rx) {
+		*rx = ws->deflate.stats[STATS_RX][type];
+	}
+
+	return 0;
+#else
+	(void)ws;
+	(void)type;
+	(void)tx;
+	(void)rx;
+	return -ENOTSUP;
+#endif
+}
+
+ocpp_websocket_state_t ocpp_websocket_state(const struct ocpp_websocket *ws)
+{
+	return ws->state;
+}
+
+int ocpp_websocket_fd(const struct ocpp_websocket *ws)
+{
+	return ws->fd;
+}
+
+bool ocpp_websocket_wants_write(const struct ocpp_websocket *ws)
+{
+	return ws->state == OCPP_WEBSOCKET_CONNECTING ||
+		ws->tx.head < ws->tx.tail;
+}
+
+int ocpp_websocket_write(struct ocpp_websocket *ws,
+		const void *data, size_t datasize)
+{
+	if (ws == NULL || ws->state != OCPP_WEBSOCKET_OPEN) {
+		return -ENOTCONN;
+	}
+
+	const int err = queue_frame(ws, OP_TEXT, data, datasize);
+	if (err == 0) {
+		(void)flush_tx(ws); /* errors to be reported in the step */
+	}
+
+	return err;
+}
+
+int ocpp_websocket_peek(struct ocpp_websocket *ws, const char **data)
+{
+	if (ws == NULL || !ws->rx.ready) {
+		return -ENOMSG;
+	}
+
+#if OCPP_WEBSOCKET_DEFLATE
+	if (ws->deflate.compressed) {
+		*data = (const char *)ws->deflate.buf;
+		return (int)ws->deflate.len;
+	}
+#endif
+	*data = (const char *)&ws->rx.buf[ws->rx.head];
+
+	return (int)ws->rx.len;
+}
+
+void ocpp_websocket_consume(struct ocpp_websocket *ws)
+{
+	if (ws == NULL || !ws->rx.ready) {
+		return;
+	}
+
+	ws->rx.ready = false;
+	ws->rx.len = 0;
+	ws->rx.head = ws->rx.scan;
+#if OCPP_WEBSOCKET_DEFLATE
+	ws->deflate.compressed = false;
+#endif
+
+	if (ws->rx.scan == ws->rx.tail) {
+		ws->rx.head = ws->rx.scan = ws->rx.tail = 0;
+	}
+}
+
+#if OCPP_WEBSOCKET_DEFLATE
+/* The frame is encoded whole after the room of the longest header, moved to
+ * the end of the queue and compressed back down, to go as it is when it
+ * does not get any smaller. */
+static int send_deflated(struct ocpp_websocket *ws,
+		const struct ocpp_message *msg)
+{
+	uint8_t *end = &ws->tx.buf[sizeof(ws->tx.buf)];
+	uint8_t *scratch = &ws->tx.buf[ws->tx.tail + FRAME_HEADER_MAXLEN];
+	const int len = ocpp_encode_message_json(msg, (char *)scratch,
+			(size_t)(end - scratch));
+
+	if (len == -ENOBUFS) {
+		return ws->tx.tail > 0? -EAGAIN : -EMSGSIZE;
+	} else if (len < 0) {
+		return len;
+	}
+
+	uint8_t *json = end - len;
+	const size_t room = (size_t)(json - scratch);
+
+	memmove(json, scratch, (size_t)len);
+	int clen = ocpp_deflate(&ws->deflate.tx, json, (size_t)len, scratch,
+			room < (size_t)len? room : (size_t)len);
+
+	if (clen < 0) {
+		memmove(scratch, json, (size_t)len);
+		commit_frame(ws, OP_TEXT, scratch, (size_t)len);
+		clen = len;
+	} else {
+		commit_frame(ws, (opcode_t)(OP_TEXT | RSV1),
+				scratch, (size_t)clen);
+	}
+
+	count_message(ws, STATS_TX, msg->type, (size_t)len, (size_t)clen);
+	(void)flush_tx(ws);
+
+	return 0;
+}
+#endif
+
+int ocpp_websocket_send(struct ocpp_websocket *ws,
+		const struct ocpp_message *msg)
+{
+	struct ocpp_iovec iov[OCPP_WEBSOCKET_IOV_MAX];
+	size_t len;
+
+	if (ws == NULL || ws->state != OCPP_WEBSOCKET_OPEN) {
+		return -ENOTCONN;
+	}
+
+	compact_tx(ws);
+
+	const size_t avail = sizeof(ws->tx.buf) - ws->tx.tail;
+	if (avail <= FRAME_HEADER_MAXLEN) {
+		return -EAGAIN;
+	}
+
+#if OCPP_WEBSOCKET_DEFLATE
+	if (ws->deflate.negotiated) {
+		return send_deflated(ws, msg);
+	}
+#endif
+
+	/* encoded after the room of the longest header, but long strings
+	 * which are referred to in place */
+	uint8_t *scratch = &ws->tx.buf[ws->tx.tail + FRAME_HEADER_MAXLEN];
+	const int n = ocpp_encode_message_jsonv(msg, iov,
+			OCPP_WEBSOCKET_IOV_MAX, (char *)scratch,
+			avail - FRAME_HEADER_MAXLEN, &len);
+
+	if (n == -ENOBUFS) {
+		return ws->tx.tail > 0? -EAGAIN : -EMSGSIZE;
+	} else if (n < 0) {
+		return n;
+	}
+
+	if (n == 1) { /* all in the scratch, to be moved down while masked */
+		commit_frame(ws, OP_TEXT, scratch, len);
+	} else {
+		const int err = commit_framev(ws, iov, (size_t)n, len, scratch);
+		if (err) {
+			return err == -EMSGSIZE && ws->tx.tail > 0? -EAGAIN : err;
+		}
+	}
+
+	(void)flush_tx(ws);
+
+	return 0;
+}
+
+int ocpp_websocket_recv(struct ocpp_websocket *ws, struct ocpp_message *msg,
+		void *buf, size_t bufsize, ocpp_callerror_t *error)
+{
+	const char *data;
+	const int len = ocpp_websocket_peek(ws, &data);
+
+	if (len < 0) {
+		return len;
+	}
+
+	const int err = ocpp_decode_message_json(data, (size_t)len,
+			msg, buf, bufsize, error);
+#if OCPP_WEBSOCKET_DEFLATE
+	if (err == 0) {
+		count_message(ws, STATS_RX, msg->type, (size_t)len,
+				ws->deflate.compressed? ws->rx.len : (size_t)len);
+	}
+#endif
+	ocpp_websocket_consume(ws);
+
+	return err;
+}
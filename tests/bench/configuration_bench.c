@@ -0,0 +1,117 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "bench.h"
+#include "ocpp/core/configuration.h"
+#include <string.h>
+
+#define ITERATIONS			100000
+
+/* The linear scan that the key string lookup used to do. */
+static bool has_configuration_linear(const char *keystr)
+{
+	for (int i = 0; i < (int)ocpp_count_configurations(); i++) {
+		if (strcmp(keystr, ocpp_get_configuration_keystr_from_index(i))
+				== 0) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static unsigned run(bool (*f)(const char *))
+{
+	const int n = (int)ocpp_count_configurations();
+	unsigned sum = 0;
+
+	for (int k = 0; k < ITERATIONS; k++) {
+		for (int i = 0; i < n; i++) {
+			sum += (*f)(ocpp_get_configuration_keystr_from_index(i));
+		}
+		sum += (*f)("UnknownConfigurationKey");
+	}
+
+	return sum;
+}
+
+static int sum_value(const char *keystr, const void *value, size_t value_size,
+		ocpp_configuration_data_t type, bool readonly, void *ctx)
+{
+	(void)keystr;
+	(void)type;
+	(void)readonly;
+	*(unsigned *)ctx += value_size? *(const uint8_t *)value : 0;
+	return 0;
+}
+
+/* A GetConfiguration of all keys, one copy per key versus in place. */
+static void run_get_all(void)
+{
+	const int n = (int)ocpp_count_configurations();
+	unsigned a = 0;
+	unsigned b = 0;
+	uint8_t buf[500];
+	uint64_t t0 = bench_now_ns();
+
+	for (int k = 0; k < ITERATIONS / 10; k++) {
+		for (int i = 0; i < n; i++) {
+			const char *keystr =
+				ocpp_get_configuration_keystr_from_index(i);
+			bool readonly;
+
+			if (!ocpp_is_configuration_readable(keystr)) {
+				continue;
+			}
+			ocpp_get_configuration_by_index(i, buf, sizeof(buf),
+					&readonly);
+			a += ocpp_get_configuration_size(keystr)? buf[0] : 0;
+		}
+	}
+
+	uint64_t t1 = bench_now_ns();
+
+	for (int k = 0; k < ITERATIONS / 10; k++) {
+		ocpp_visit_configurations(NULL, 0, sum_value, &b);
+	}
+
+	uint64_t t2 = bench_now_ns();
+
+	if (a != b) {
+		printf("mismatch %u %u\n", a, b);
+	}
+
+	bench_report("get_configuration_all/by_index",
+			(double)(t1 - t0) / (ITERATIONS / 10), "ns/request");
+	bench_report("get_configuration_all/visit",
+			(double)(t2 - t1) / (ITERATIONS / 10), "ns/request");
+}
+
+int main(void)
+{
+	ocpp_reset_configuration();
+
+	const double lookups = (double)ITERATIONS *
+		(double)(ocpp_count_configurations() + 1);
+	uint64_t t0 = bench_now_ns();
+	unsigned a = run(has_configuration_linear);
+	uint64_t t1 = bench_now_ns();
+	unsigned b = run(ocpp_has_configuration);
+	uint64_t t2 = bench_now_ns();
+
+	if (a != b) {
+		return 1;
+	}
+
+	bench_report("configuration_key/linear", (double)(t1 - t0) / lookups,
+			"ns/lookup");
+	bench_report("configuration_key/hash", (double)(t2 - t1) / lookups,
+			"ns/lookup");
+
+	run_get_all();
+
+	return 0;
+}
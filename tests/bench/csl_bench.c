@@ -0,0 +1,93 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "bench.h"
+#include "ocpp/core/configuration_csl.h"
+#include <string.h>
+
+#define ITERATIONS			20000
+#define KEYSTR				"MeterValuesSampledData"
+#define NR_MEASURANDS			22
+
+static char names[NR_MEASURANDS][32];
+
+/* Splitting the list and comparing each item against every name. */
+static int decode_linear(const char *keystr, const char *csl, size_t len,
+		int *mask)
+{
+	size_t start = 0;
+	int bits = 0;
+
+	(void)keystr;
+
+	for (size_t i = 0; i <= len; i++) {
+		if (i < len && csl[i] != ',') {
+			continue;
+		}
+
+		int bit;
+		for (bit = 0; bit < NR_MEASURANDS; bit++) {
+			if (strncmp(names[bit], &csl[start], i - start) == 0 &&
+					names[bit][i - start] == '\0') {
+				break;
+			}
+		}
+		if (bit == NR_MEASURANDS) {
+			return -1;
+		}
+
+		bits |= 1 << bit;
+		start = i + 1;
+	}
+
+	*mask = bits;
+	return __builtin_popcount((unsigned)bits);
+}
+
+static unsigned run(int (*f)(const char *, const char *, size_t, int *),
+		const char *csl)
+{
+	const size_t len = strlen(csl);
+	unsigned sum = 0;
+
+	for (int n = 0; n < ITERATIONS; n++) {
+		int mask = 0;
+		sum += (unsigned)(*f)(KEYSTR, csl, len, &mask);
+		sum += (unsigned)mask;
+	}
+
+	return sum;
+}
+
+int main(void)
+{
+	char csl[512];
+
+	for (int i = 0; i < NR_MEASURANDS; i++) {
+		ocpp_encode_configuration_csl(KEYSTR, 1 << i,
+				names[i], sizeof(names[i]));
+	}
+	ocpp_encode_configuration_csl(KEYSTR, (1 << NR_MEASURANDS) - 1,
+			csl, sizeof(csl));
+
+	const double tokens = (double)ITERATIONS * NR_MEASURANDS;
+	uint64_t t0 = bench_now_ns();
+	unsigned a = run(decode_linear, csl);
+	uint64_t t1 = bench_now_ns();
+	unsigned b = run(ocpp_decode_configuration_csl, csl);
+	uint64_t t2 = bench_now_ns();
+
+	if (a != b) {
+		return 1;
+	}
+
+	bench_report("csl_decode/linear", (double)(t1 - t0) / tokens,
+			"ns/token");
+	bench_report("csl_decode/perfect_hash", (double)(t2 - t1) / tokens,
+			"ns/token");
+
+	return 0;
+}
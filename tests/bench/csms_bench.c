@@ -0,0 +1,340 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "bench.h"
+#include "mock_csms.h"
+#include "ocpp/ocpp.h"
+#include "ocpp/websocket.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#define NR_REQUESTS			3000
+#define NR_REQUESTS_DELAYED		300
+#define NR_STATIONS			2000
+#define NR_HEARTBEATS			10 /* per station */
+#define AUTHORIZE_ERROR_EVERY		10
+#define TIMEOUT_NS			(60ull * 1000000000ull)
+
+/* the charge point of the engine in src/ocpp.c */
+static struct ocpp_websocket station;
+static union {
+	uint8_t raw[4096];
+	uint64_t align;
+} rx_payload;
+static uint64_t results;
+static uint64_t errors;
+
+int ocpp_send(const struct ocpp_message *msg)
+{
+	return ocpp_websocket_send(&station, msg);
+}
+
+int ocpp_recv(struct ocpp_message *msg)
+{
+	return ocpp_websocket_recv(&station, msg,
+			rx_payload.raw, sizeof(rx_payload.raw), NULL);
+}
+
+/* the default of the time in seconds repeats in a second */
+void ocpp_generate_message_id(void *buf, size_t bufsize)
+{
+	static unsigned long id;
+	snprintf((char *)buf, bufsize, "%lu", ++id);
+}
+
+static void on_event(ocpp_event_t event, const struct ocpp_message *msg,
+		void *ctx)
+{
+	(void)ctx;
+
+	if (event != 0) {
+		return;
+	} else if (msg->role == OCPP_MSG_ROLE_CALLRESULT) {
+		results++;
+	} else if (msg->role == OCPP_MSG_ROLE_CALLERROR) {
+		errors++;
+	}
+}
+
+static void fail(const char *what)
+{
+	fprintf(stderr, "csms: %s\n", what);
+	exit(1);
+}
+
+static void check_timeout(uint64_t t0)
+{
+	if (bench_now_ns() - t0 > TIMEOUT_NS) {
+		fail("timed out");
+	}
+}
+
+static void connect_engine(struct mock_csms *csms)
+{
+	const uint64_t t0 = bench_now_ns();
+
+	if (ocpp_websocket_connect(&station, "127.0.0.1",
+			mock_csms_port(csms), "/ocpp/ENGINE") != 0) {
+		fail("connect");
+	}
+
+	while (ocpp_websocket_state(&station) != OCPP_WEBSOCKET_OPEN) {
+		if (ocpp_websocket_step(&station) != 0) {
+			fail("handshake");
+		}
+		mock_csms_step(csms, 0);
+		check_timeout(t0);
+	}
+}
+
+/* Drives the engine through Authorize, StartTransaction and
+ * StopTransaction over the transport, one request in flight at a time as
+ * the engine sends them. */
+static void run_engine(struct mock_csms *csms, const char *name,
+		uint64_t nr_requests, uint32_t latency_ms)
+{
+	static const struct ocpp_BootNotification boot = {
+		.chargePointModel = "Bench",
+		.chargePointVendor = "libmcu",
+	};
+	static const struct ocpp_Authorize authorize = {
+		.idTag = "0123456789",
+	};
+	static const struct ocpp_StartTransaction start = {
+		.connectorId = 1,
+		.idTag = "0123456789",
+		.meterStart = 1000,
+		.timestamp = 1700000000,
+	};
+	static const struct ocpp_StopTransaction stop = {
+		.meterStop = 2000,
+		.timestamp = 1700003600,
+		.transactionId = 1,
+	};
+	static const struct {
+		ocpp_message_t type;
+		const void *data;
+		size_t size;
+	} cycle[] = {
+		{ OCPP_MSG_AUTHORIZE, &authorize, sizeof(authorize) },
+		{ OCPP_MSG_START_TRANSACTION, &start, sizeof(start) },
+		{ OCPP_MSG_STOP_TRANSACTION, &stop, sizeof(stop) },
+	};
+
+	ocpp_init(on_event, NULL);
+	ocpp_conf_set_int(OCPP_CONF_HeartbeatInterval, 0);
+	mock_csms_set_latency(csms, OCPP_MSG_MAX, latency_ms);
+	connect_engine(csms);
+
+	results = errors = 0;
+	ocpp_push_request(OCPP_MSG_BOOTNOTIFICATION, &boot, sizeof(boot), false);
+
+	const uint64_t t0 = bench_now_ns();
+	uint64_t pushed = 1;
+
+	while (results + errors < nr_requests + 1) {
+		if (pushed == results + errors && pushed < nr_requests + 1) {
+			const size_t i = (size_t)(pushed - 1) % 3;
+			ocpp_push_request(cycle[i].type, cycle[i].data,
+					cycle[i].size, false);
+			pushed++;
+		}
+
+		ocpp_step();
+		if (ocpp_websocket_step(&station) != 0) {
+			fail("engine connection");
+		}
+		mock_csms_step(csms, 0);
+		check_timeout(t0);
+	}
+
+	const uint64_t ns = bench_now_ns() - t0;
+	char label[64];
+
+	bench_report(name, (double)ns / (double)(nr_requests + 1), "ns/call");
+	if (errors > 0) {
+		snprintf(label, sizeof(label), "%s_errors", name);
+		bench_report(label, (double)errors, "calls");
+	}
+
+	ocpp_websocket_close(&station, 1000);
+	while (ocpp_websocket_state(&station) != OCPP_WEBSOCKET_CLOSED) {
+		ocpp_websocket_step(&station);
+		mock_csms_step(csms, 0);
+	}
+}
+
+static size_t raise_fd_limit(size_t nr_stations)
+{
+	struct rlimit lim;
+
+	if (getrlimit(RLIMIT_NOFILE, &lim) != 0) {
+		return 0;
+	}
+
+	lim.rlim_cur = lim.rlim_max;
+	setrlimit(RLIMIT_NOFILE, &lim);
+	getrlimit(RLIMIT_NOFILE, &lim);
+
+	/* a socket on each side of a station, and some to spare */
+	const size_t max = lim.rlim_cur > 64? (size_t)(lim.rlim_cur - 64) / 2 : 0;
+
+	return nr_stations < max? nr_stations : max;
+}
+
+static int send_call(struct ocpp_websocket *ws, ocpp_message_t type,
+		const void *data, size_t size, size_t seq)
+{
+	struct ocpp_message msg = {
+		.role = OCPP_MSG_ROLE_CALL,
+		.type = type,
+		.payload.fmt.request = data,
+		.payload.size = size,
+	};
+
+	snprintf(msg.id, sizeof(msg.id), "%zu", seq);
+
+	return ocpp_websocket_send(ws, &msg);
+}
+
+/* Stations of bare connections, each sending BootNotification and then
+ * Heartbeats one after another, all at once. */
+static void run_fleet(struct mock_csms *csms, size_t n)
+{
+	static const struct ocpp_BootNotification boot = {
+		.chargePointModel = "Bench",
+		.chargePointVendor = "libmcu",
+	};
+	struct ocpp_websocket *ws =
+		(struct ocpp_websocket *)calloc(n, sizeof(*ws));
+	struct pollfd *pfds = (struct pollfd *)calloc(n, sizeof(*pfds));
+	size_t *sent = (size_t *)calloc(n, sizeof(*sent));
+	size_t nr_open = 0;
+	size_t nr_done = 0;
+	uint64_t connected_ns = 0;
+	char path[32];
+
+	if (!ws || !pfds || !sent) {
+		fail("out of memory");
+	}
+
+	const uint64_t t0 = bench_now_ns();
+
+	for (size_t i = 0; i < n; i++) {
+		snprintf(path, sizeof(path), "/ocpp/CP%05zu", i);
+		if (ocpp_websocket_connect(&ws[i], "127.0.0.1",
+				mock_csms_port(csms), path) != 0) {
+			fail("fleet connect");
+		}
+		mock_csms_step(csms, 0);
+	}
+
+	while (nr_done < n) {
+		for (size_t i = 0; i < n; i++) {
+			pfds[i].fd = ocpp_websocket_fd(&ws[i]);
+			pfds[i].events = (short)(POLLIN |
+					(ocpp_websocket_wants_write(&ws[i])?
+						POLLOUT : 0));
+		}
+
+		if (poll(pfds, n, 0) < 0) {
+			fail("poll");
+		}
+
+		for (size_t i = 0; i < n; i++) {
+			if (pfds[i].revents == 0) {
+				continue;
+			}
+
+			const bool was_open = ocpp_websocket_state(&ws[i]) ==
+				OCPP_WEBSOCKET_OPEN;
+			const char *data;
+
+			if (ocpp_websocket_step(&ws[i]) != 0) {
+				fail("fleet connection");
+			} else if (ocpp_websocket_state(&ws[i]) !=
+					OCPP_WEBSOCKET_OPEN) {
+				continue;
+			}
+
+			if (!was_open) {
+				if (++nr_open == n) {
+					connected_ns = bench_now_ns() - t0;
+				}
+				send_call(&ws[i], OCPP_MSG_BOOTNOTIFICATION,
+						&boot, sizeof(boot), 0);
+				continue;
+			}
+
+			while (ocpp_websocket_peek(&ws[i], &data) >= 0) {
+				ocpp_websocket_consume(&ws[i]);
+
+				if (++sent[i] > NR_HEARTBEATS) {
+					nr_done++;
+				} else {
+					send_call(&ws[i], OCPP_MSG_HEARTBEAT,
+							NULL, 0, sent[i]);
+				}
+				ocpp_websocket_step(&ws[i]);
+			}
+		}
+
+		mock_csms_step(csms, 0);
+		check_timeout(t0);
+	}
+
+	const uint64_t ns = bench_now_ns() - t0;
+	char label[64];
+
+	snprintf(label, sizeof(label), "csms/fleet_%zu_connect", n);
+	bench_report(label, (double)connected_ns / 1e6, "ms");
+	snprintf(label, sizeof(label), "csms/fleet_%zu_calls", n);
+	bench_report(label, (double)(n * (NR_HEARTBEATS + 1)) * 1e9 /
+			(double)ns, "calls/s");
+
+	for (size_t i = 0; i < n; i++) {
+		if (ocpp_websocket_fd(&ws[i]) >= 0) {
+			close(ocpp_websocket_fd(&ws[i]));
+		}
+	}
+
+	free(sent);
+	free(pfds);
+	free(ws);
+}
+
+int main(void)
+{
+	const size_t nr_stations = raise_fd_limit(NR_STATIONS);
+	struct mock_csms *csms = mock_csms_create(0, nr_stations + 1);
+
+	if (csms == NULL) {
+		fail("create");
+	}
+
+	run_engine(csms, "csms/engine_roundtrip", NR_REQUESTS, 0);
+	run_engine(csms, "csms/engine_roundtrip_1ms",
+			NR_REQUESTS_DELAYED, 1);
+
+	mock_csms_set_latency(csms, OCPP_MSG_MAX, 0);
+	mock_csms_set_error(csms, OCPP_MSG_AUTHORIZE,
+			OCPP_CALLERROR_INTERNAL, AUTHORIZE_ERROR_EVERY);
+	run_engine(csms, "csms/engine_roundtrip_faulty",
+			NR_REQUESTS, 0);
+	mock_csms_set_error(csms, OCPP_MSG_MAX, OCPP_CALLERROR_GENERIC, 0);
+
+	run_fleet(csms, nr_stations);
+
+	mock_csms_destroy(csms);
+
+	return 0;
+}
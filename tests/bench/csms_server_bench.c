@@ -0,0 +1,280 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "bench.h"
+#include "ocpp/csms.h"
+#include "ocpp/overrides.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#define NR_STATIONS			1000
+#define NR_HEARTBEATS			10 /* per station */
+#define TIMEOUT_NS			(60ull * 1000000000ull)
+
+static uint64_t nr_connected;
+static uint64_t nr_responses;
+
+/* the CALLRESULTs of the stations are typed by the server */
+ocpp_message_t ocpp_get_relayed_type_from_idstr(const char *idstr)
+{
+	return ocpp_csms_get_type(idstr);
+}
+
+static void on_event(struct ocpp_csms_conn *conn, ocpp_csms_event_t event,
+		const struct ocpp_message *msg, void *ctx)
+{
+	(void)ctx;
+
+	if (event == OCPP_CSMS_EVENT_CONNECTED) {
+		__atomic_fetch_add(&nr_connected, 1, __ATOMIC_RELAXED);
+	} else if (event == OCPP_CSMS_EVENT_RESPONSE) {
+		__atomic_fetch_add(&nr_responses, 1, __ATOMIC_RELAXED);
+	} else if (event == OCPP_CSMS_EVENT_REQUEST &&
+			msg->type == OCPP_MSG_HEARTBEAT) {
+		const struct ocpp_Heartbeat_conf conf = {
+			.currentTime = 1700000000,
+		};
+		ocpp_csms_send_response(conn, msg, &conf, sizeof(conf));
+	} else if (event == OCPP_CSMS_EVENT_REQUEST &&
+			msg->type == OCPP_MSG_BOOTNOTIFICATION) {
+		const struct ocpp_BootNotification_conf conf = {
+			.currentTime = 1700000000,
+			.interval = 300,
+			.status = OCPP_BOOT_STATUS_ACCEPTED,
+		};
+		ocpp_csms_send_response(conn, msg, &conf, sizeof(conf));
+	}
+}
+
+static void fail(const char *what)
+{
+	fprintf(stderr, "csms_server: %s\n", what);
+	exit(1);
+}
+
+static void check_timeout(uint64_t t0)
+{
+	if (bench_now_ns() - t0 > TIMEOUT_NS) {
+		fail("timed out");
+	}
+}
+
+static size_t raise_fd_limit(size_t nr_stations)
+{
+	struct rlimit lim;
+
+	if (getrlimit(RLIMIT_NOFILE, &lim) != 0) {
+		return 0;
+	}
+
+	lim.rlim_cur = lim.rlim_max;
+	setrlimit(RLIMIT_NOFILE, &lim);
+	getrlimit(RLIMIT_NOFILE, &lim);
+
+	/* a socket on each side of a station, and some to spare */
+	const size_t max = lim.rlim_cur > 64? (size_t)(lim.rlim_cur - 64) / 2 : 0;
+
+	return nr_stations < max? nr_stations : max;
+}
+
+static int send_call(struct ocpp_websocket *ws, ocpp_message_t type,
+		const void *data, size_t size, size_t seq)
+{
+	struct ocpp_message msg = {
+		.role = OCPP_MSG_ROLE_CALL,
+		.type = type,
+		.payload.fmt.request = data,
+		.payload.size = size,
+	};
+
+	snprintf(msg.id, sizeof(msg.id), "%zu", seq);
+
+	return ocpp_websocket_send(ws, &msg);
+}
+
+/* Answers a CALL of the server, which a station tells from the CALLRESULT
+ * of its own by the action in the frame. */
+static bool answer_call(struct ocpp_websocket *ws, const char *data, int len)
+{
+	static const char accepted[] = "{\"status\":\"Accepted\"}";
+	char frame[OCPP_MESSAGE_ID_MAXLEN + sizeof(accepted) + 16];
+	const char *id = data + 4;
+	const char *end;
+
+	if (len < 4 || data[1] != '2' ||
+			(end = memchr(id, '"', (size_t)len - 4)) == NULL) {
+		return false;
+	}
+
+	const int n = snprintf(frame, sizeof(frame), "[3,\"%.*s\",%s]",
+			(int)(end - id), id, accepted);
+	ocpp_websocket_consume(ws);
+	ocpp_websocket_write(ws, frame, (size_t)n);
+
+	return true;
+}
+
+/* Stations of bare connections, each sending BootNotification and then
+ * Heartbeats one after another, all at once, while the server sends a
+ * ChangeAvailability to each once all are connected. */
+static void run_fleet(size_t n, uint8_t nr_workers)
+{
+	static const struct ocpp_BootNotification boot = {
+		.chargePointModel = "Bench",
+		.chargePointVendor = "libmcu",
+	};
+	static const struct ocpp_ChangeAvailability change = {
+		.connectorId = 1,
+		.type = OCPP_INOPERATIVE,
+	};
+	struct ocpp_csms csms;
+	struct ocpp_csms_conn *conns =
+		(struct ocpp_csms_conn *)calloc(n, sizeof(*conns));
+	struct ocpp_websocket *ws =
+		(struct ocpp_websocket *)calloc(n, sizeof(*ws));
+	struct pollfd *pfds = (struct pollfd *)calloc(n, sizeof(*pfds));
+	size_t *sent = (size_t *)calloc(n, sizeof(*sent));
+	size_t nr_done = 0;
+	uint64_t connected_ns = 0;
+	bool requested = false;
+	char path[32];
+
+	if (!conns || !ws || !pfds || !sent) {
+		fail("out of memory");
+	}
+
+	nr_connected = nr_responses = 0;
+
+	if (ocpp_csms_init(&csms, conns, n, on_event, NULL) != 0 ||
+			ocpp_csms_listen(&csms, 0) != 0 ||
+			ocpp_csms_start(&csms, nr_workers) != 0) {
+		fail("start");
+	}
+
+	const uint64_t t0 = bench_now_ns();
+
+	for (size_t i = 0; i < n; i++) {
+		snprintf(path, sizeof(path), "/ocpp/CP%05zu", i);
+		if (ocpp_websocket_connect(&ws[i], "127.0.0.1",
+				ocpp_csms_port(&csms), path) != 0) {
+			fail("fleet connect");
+		}
+	}
+
+	while (nr_done < n || __atomic_load_n(&nr_responses,
+			__ATOMIC_RELAXED) < n) {
+		if (!requested && __atomic_load_n(&nr_connected,
+				__ATOMIC_RELAXED) == n) {
+			connected_ns = bench_now_ns() - t0;
+			for (size_t i = 0; i < n; i++) {
+				if (ocpp_csms_send_request(&conns[i],
+						OCPP_MSG_CHANGE_AVAILABILITY,
+						&change, sizeof(change),
+						NULL) != 0) {
+					fail("server call");
+				}
+			}
+			requested = true;
+		}
+
+		for (size_t i = 0; i < n; i++) {
+			pfds[i].fd = ocpp_websocket_fd(&ws[i]);
+			pfds[i].events = (short)(POLLIN |
+					(ocpp_websocket_wants_write(&ws[i])?
+						POLLOUT : 0));
+		}
+
+		if (poll(pfds, n, 1) < 0) {
+			fail("poll");
+		}
+
+		for (size_t i = 0; i < n; i++) {
+			if (pfds[i].revents == 0) {
+				continue;
+			}
+
+			const bool was_open = ocpp_websocket_state(&ws[i]) ==
+				OCPP_WEBSOCKET_OPEN;
+			const char *data;
+			int len;
+
+			if (ocpp_websocket_step(&ws[i]) != 0) {
+				fail("fleet connection");
+			} else if (ocpp_websocket_state(&ws[i]) !=
+					OCPP_WEBSOCKET_OPEN) {
+				continue;
+			}
+
+			if (!was_open) {
+				send_call(&ws[i], OCPP_MSG_BOOTNOTIFICATION,
+						&boot, sizeof(boot), 0);
+				continue;
+			}
+
+			while ((len = ocpp_websocket_peek(&ws[i], &data)) >= 0) {
+				if (answer_call(&ws[i], data, len)) {
+					ocpp_websocket_step(&ws[i]);
+					continue;
+				}
+
+				ocpp_websocket_consume(&ws[i]);
+
+				if (++sent[i] > NR_HEARTBEATS) {
+					nr_done++;
+				} else {
+					send_call(&ws[i], OCPP_MSG_HEARTBEAT,
+							NULL, 0, sent[i]);
+				}
+				ocpp_websocket_step(&ws[i]);
+			}
+		}
+
+		check_timeout(t0);
+	}
+
+	const uint64_t ns = bench_now_ns() - t0;
+	char label[64];
+
+	snprintf(label, sizeof(label), "csms_server/%uw_%zu_connect",
+			nr_workers, n);
+	bench_report(label, (double)connected_ns / 1e6, "ms");
+	snprintf(label, sizeof(label), "csms_server/%uw_%zu_calls",
+			nr_workers, n);
+	bench_report(label, (double)(n * (NR_HEARTBEATS + 2)) * 1e9 /
+			(double)ns, "calls/s");
+
+	for (size_t i = 0; i < n; i++) {
+		if (ocpp_websocket_fd(&ws[i]) >= 0) {
+			close(ocpp_websocket_fd(&ws[i]));
+		}
+	}
+
+	ocpp_csms_stop(&csms);
+
+	free(sent);
+	free(pfds);
+	free(ws);
+	free(conns);
+}
+
+int main(void)
+{
+	const size_t nr_stations = raise_fd_limit(NR_STATIONS);
+
+	ocpp_init(NULL, NULL);
+
+	run_fleet(nr_stations, 1);
+	run_fleet(nr_stations, 2);
+	run_fleet(nr_stations, 4);
+
+	return 0;
+}
@@ -0,0 +1,135 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "bench.h"
+#include "ocpp/deflate.h"
+#include "ocpp/message_json.h"
+#include <string.h>
+
+#define ITERATIONS			20000
+#define NR_SAMPLES			4
+
+static union {
+	struct ocpp_MeterValues msg;
+	uint8_t raw[sizeof(struct ocpp_MeterValues) +
+		NR_SAMPLES * sizeof(struct ocpp_SampledValue)];
+} meter;
+
+static struct ocpp_deflater tx;
+static struct ocpp_inflater rx;
+
+/* @return true if every message is inflated back as it was */
+static bool run(const char *name, bool takeover,
+		struct ocpp_message *msgs, size_t nr_msgs)
+{
+	static char json[ITERATIONS][1024];
+	static uint8_t compressed[ITERATIONS][1024];
+	static int jsonlen[ITERATIONS];
+	static int clen[ITERATIONS];
+	uint64_t raw[OCPP_MSG_MAX] = { 0, };
+	uint64_t deflated[OCPP_MSG_MAX] = { 0, };
+	char out[1024];
+	char label[64];
+	int ok = 0;
+
+	/* ids of a counter as the engine of src/ocpp.c makes */
+	for (int n = 0; n < ITERATIONS; n++) {
+		struct ocpp_message *msg = &msgs[(size_t)n % nr_msgs];
+		snprintf(msg->id, sizeof(msg->id), "%d", n + 1);
+		jsonlen[n] = ocpp_encode_message_json(msg,
+				json[n], sizeof(json[n]));
+	}
+
+	ocpp_deflate_init(&tx, OCPP_DEFLATE_WINDOW_BITS, takeover);
+	uint64_t t0 = bench_now_ns();
+	for (int n = 0; n < ITERATIONS; n++) {
+		clen[n] = ocpp_deflate(&tx, json[n], (size_t)jsonlen[n],
+				compressed[n], sizeof(compressed[n]));
+	}
+	snprintf(label, sizeof(label), "%s_deflate", name);
+	bench_report(label, (double)(bench_now_ns() - t0) / ITERATIONS,
+			"ns/msg");
+
+	ocpp_inflate_init(&rx, OCPP_DEFLATE_WINDOW_BITS, takeover);
+	t0 = bench_now_ns();
+	for (int n = 0; n < ITERATIONS; n++) {
+		const int len = ocpp_inflate(&rx, compressed[n],
+				(size_t)clen[n], out, sizeof(out));
+		ok += len == jsonlen[n] && memcmp(out, json[n],
+				(size_t)len) == 0;
+	}
+	snprintf(label, sizeof(label), "%s_inflate", name);
+	bench_report(label, (double)(bench_now_ns() - t0) / ITERATIONS,
+			"ns/msg");
+
+	for (int n = 0; n < ITERATIONS; n++) {
+		const ocpp_message_t type = msgs[(size_t)n % nr_msgs].type;
+		raw[type] += (uint64_t)jsonlen[n];
+		deflated[type] += (uint64_t)clen[n];
+	}
+	for (size_t i = 0; i < nr_msgs; i++) {
+		const ocpp_message_t type = msgs[i].type;
+		snprintf(label, sizeof(label), "%s_%s", name,
+				ocpp_stringify_type(type));
+		bench_report(label, (double)deflated[type] * 100 /
+				(double)raw[type], "% of size");
+	}
+
+	return ok == ITERATIONS;
+}
+
+int main(void)
+{
+	struct ocpp_StatusNotification status = {
+		.connectorId = 1,
+		.errorCode = OCPP_ERROR_NONE,
+		.status = OCPP_STATUS_CHARGING,
+		.timestamp = 1700000000,
+	};
+	struct ocpp_Authorize authorize = {
+		.idTag = "0123456789",
+	};
+	struct ocpp_message msgs[] = {
+		{ .role = OCPP_MSG_ROLE_CALL, .type = OCPP_MSG_HEARTBEAT, },
+		{
+			.role = OCPP_MSG_ROLE_CALL,
+			.type = OCPP_MSG_STATUS_NOTIFICATION,
+			.payload.fmt.request = &status,
+			.payload.size = sizeof(status),
+		},
+		{
+			.role = OCPP_MSG_ROLE_CALL,
+			.type = OCPP_MSG_AUTHORIZE,
+			.payload.fmt.request = &authorize,
+			.payload.size = sizeof(authorize),
+		},
+		{
+			.role = OCPP_MSG_ROLE_CALL,
+			.type = OCPP_MSG_METER_VALUES,
+			.payload.fmt.request = &meter,
+			.payload.size = sizeof(meter),
+		},
+	};
+	const size_t nr_msgs = sizeof(msgs) / sizeof(*msgs);
+	bool ok = true;
+
+	meter.msg.connectorId = 1;
+	meter.msg.transactionId = 1234;
+	meter.msg.meterValue.timestamp = 1700000000;
+	for (int i = 0; i < NR_SAMPLES; i++) {
+		struct ocpp_SampledValue *v = &meter.msg.meterValue.sampledValue[i];
+		snprintf(v->value, sizeof(v->value), "%d.%d", 12345 + i, i);
+		v->context = OCPP_READ_CTX_SAMPLE_PERIODIC;
+		v->measurand = (ocpp_measurand_t)(1 << i);
+		v->phase = OCPP_PHASE_L1;
+		v->unit = OCPP_UNIT_WH;
+	}
+
+	ok &= run("deflate/takeover", true, msgs, nr_msgs);
+	ok &= run("deflate/no_takeover", false, msgs, nr_msgs);
+
+	return ok? 0 : 1;
+}
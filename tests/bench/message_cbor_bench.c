@@ -0,0 +1,124 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "bench.h"
+#include "ocpp/message_cbor.h"
+#include "ocpp/message_json.h"
+#include <string.h>
+
+#define ITERATIONS			200000
+#define NR_SAMPLES			8
+
+typedef int (*encode_t)(const struct ocpp_message *msg,
+		void *buf, size_t bufsize);
+typedef int (*decode_t)(const void *data, size_t len,
+		struct ocpp_message *msg, void *buf, size_t bufsize,
+		ocpp_callerror_t *error);
+
+static union {
+	struct ocpp_MeterValues msg;
+	uint8_t raw[sizeof(struct ocpp_MeterValues) +
+		NR_SAMPLES * sizeof(struct ocpp_SampledValue)];
+} meter;
+
+static union {
+	uint8_t raw[sizeof(meter)];
+	long long align;
+} out;
+
+static int encode_json(const struct ocpp_message *msg,
+		void *buf, size_t bufsize)
+{
+	return ocpp_encode_message_json(msg, (char *)buf, bufsize);
+}
+
+static int decode_json(const void *data, size_t len,
+		struct ocpp_message *msg, void *buf, size_t bufsize,
+		ocpp_callerror_t *error)
+{
+	return ocpp_decode_message_json((const char *)data, len, msg,
+			buf, bufsize, error);
+}
+
+/* @return true if every frame is decoded */
+static bool run(const char *name, const struct ocpp_message *msg,
+		encode_t encode, decode_t decode)
+{
+	uint8_t buf[2048];
+	struct ocpp_message decoded;
+	ocpp_callerror_t error;
+	char label[64];
+	int len = 0;
+	int ok = 0;
+
+	uint64_t t0 = bench_now_ns();
+	for (int n = 0; n < ITERATIONS; n++) {
+		len = (*encode)(msg, buf, sizeof(buf));
+	}
+	snprintf(label, sizeof(label), "%s_encode", name);
+	bench_report(label, (double)(bench_now_ns() - t0) / ITERATIONS,
+			"ns/msg");
+
+	t0 = bench_now_ns();
+	for (int n = 0; n < ITERATIONS; n++) {
+		ok += (*decode)(buf, (size_t)len, &decoded,
+				out.raw, sizeof(out.raw), &error) == 0;
+	}
+	snprintf(label, sizeof(label), "%s_decode", name);
+	bench_report(label, (double)(bench_now_ns() - t0) / ITERATIONS,
+			"ns/msg");
+
+	snprintf(label, sizeof(label), "%s_size", name);
+	bench_report(label, (double)len, "bytes");
+
+	return ok == ITERATIONS;
+}
+
+int main(void)
+{
+	struct ocpp_StatusNotification status = {
+		.connectorId = 1,
+		.errorCode = OCPP_ERROR_NONE,
+		.status = OCPP_STATUS_CHARGING,
+		.timestamp = 1700000000,
+	};
+	struct ocpp_message msg = {
+		.id = "f47ac10b-58cc-4372-a567-0e02b2c3d479",
+		.role = OCPP_MSG_ROLE_CALL,
+		.type = OCPP_MSG_STATUS_NOTIFICATION,
+		.payload.fmt.request = &status,
+		.payload.size = sizeof(status),
+	};
+	bool ok = true;
+
+	meter.msg.connectorId = 1;
+	meter.msg.transactionId = 1234;
+	meter.msg.meterValue.timestamp = 1700000000;
+	for (int i = 0; i < NR_SAMPLES; i++) {
+		struct ocpp_SampledValue *v = &meter.msg.meterValue.sampledValue[i];
+		strcpy(v->value, "12345.6");
+		v->context = OCPP_READ_CTX_SAMPLE_PERIODIC;
+		v->measurand = (ocpp_measurand_t)(1 << i);
+		v->phase = OCPP_PHASE_L1;
+		v->unit = OCPP_UNIT_WH;
+	}
+
+	ok &= run("message_cbor/status_notification_json", &msg,
+			encode_json, decode_json);
+	ok &= run("message_cbor/status_notification", &msg,
+			ocpp_encode_message_cbor, ocpp_decode_message_cbor);
+
+	msg.type = OCPP_MSG_METER_VALUES;
+	msg.payload.fmt.request = &meter;
+	msg.payload.size = sizeof(meter);
+
+	ok &= run("message_cbor/meter_values_json", &msg,
+			encode_json, decode_json);
+	ok &= run("message_cbor/meter_values", &msg,
+			ocpp_encode_message_cbor, ocpp_decode_message_cbor);
+
+	return ok? 0 : 1;
+}
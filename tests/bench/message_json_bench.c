@@ -0,0 +1,139 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "bench.h"
+#include "ocpp/message_json.h"
+#include <stdbool.h>
+#include <string.h>
+
+#define ITERATIONS			200000
+#define NR_SAMPLES			8
+#define DATA_TRANSFER_LEN		1536
+
+static union {
+	struct ocpp_MeterValues msg;
+	uint8_t raw[sizeof(struct ocpp_MeterValues) +
+		NR_SAMPLES * sizeof(struct ocpp_SampledValue)];
+} meter;
+
+static union {
+	struct ocpp_DataTransfer msg;
+	uint8_t raw[sizeof(struct ocpp_DataTransfer) + DATA_TRANSFER_LEN];
+} transfer;
+
+static int discard(const char *chunk, size_t chunksize, void *ctx)
+{
+	(void)chunk;
+	*(size_t *)ctx += chunksize;
+	return 0;
+}
+
+static void report(const char *name, uint64_t ns, size_t bytes)
+{
+	bench_report(name, (double)bytes * 1e9 / (double)ns / 1e6, "MB/s");
+}
+
+int main(void)
+{
+	struct ocpp_StatusNotification status = {
+		.connectorId = 1,
+		.errorCode = OCPP_ERROR_NONE,
+		.status = OCPP_STATUS_CHARGING,
+		.timestamp = 1700000000,
+	};
+	struct ocpp_message msg = {
+		.id = "f47ac10b-58cc-4372-a567-0e02b2c3d479",
+		.role = OCPP_MSG_ROLE_CALL,
+	};
+	char buf[2048];
+	size_t bytes = 0;
+
+	meter.msg.connectorId = 1;
+	meter.msg.transactionId = 1234;
+	meter.msg.meterValue.timestamp = 1700000000;
+	for (int i = 0; i < NR_SAMPLES; i++) {
+		struct ocpp_SampledValue *v = &meter.msg.meterValue.sampledValue[i];
+		strcpy(v->value, "12345.6");
+		v->context = OCPP_READ_CTX_SAMPLE_PERIODIC;
+		v->measurand = (ocpp_measurand_t)(1 << i);
+		v->phase = OCPP_PHASE_L1;
+		v->unit = OCPP_UNIT_WH;
+	}
+
+	msg.type = OCPP_MSG_STATUS_NOTIFICATION;
+	msg.payload.fmt.request = &status;
+	msg.payload.size = sizeof(status);
+	uint64_t t0 = bench_now_ns();
+	for (int n = 0; n < ITERATIONS; n++) {
+		status.connectorId = n & 1;
+		bytes += (size_t)ocpp_encode_message_json(&msg, buf, sizeof(buf));
+	}
+	report("message_json/status_notification", bench_now_ns() - t0, bytes);
+
+	msg.type = OCPP_MSG_METER_VALUES;
+	msg.payload.fmt.request = &meter;
+	msg.payload.size = sizeof(meter);
+	bytes = 0;
+	t0 = bench_now_ns();
+	for (int n = 0; n < ITERATIONS; n++) {
+		bytes += (size_t)ocpp_encode_message_json(&msg, buf, sizeof(buf));
+	}
+	report("message_json/meter_values", bench_now_ns() - t0, bytes);
+
+	size_t streamed = 0;
+	t0 = bench_now_ns();
+	for (int n = 0; n < ITERATIONS; n++) {
+		ocpp_stream_message_json(&msg, discard, &streamed);
+	}
+	report("message_json/meter_values_stream", bench_now_ns() - t0,
+			streamed);
+
+	const bool streamed_all = streamed == bytes;
+	int len = ocpp_encode_message_json(&msg, buf, sizeof(buf));
+	struct ocpp_message decoded;
+	ocpp_callerror_t error;
+	union {
+		uint8_t raw[sizeof(meter)];
+		long long align;
+	} out;
+	bytes = 0;
+	t0 = bench_now_ns();
+	for (int n = 0; n < ITERATIONS; n++) {
+		if (ocpp_decode_message_json(buf, (size_t)len, &decoded,
+				out.raw, sizeof(out.raw), &error) == 0) {
+			bytes += (size_t)len;
+		}
+	}
+	report("message_json/meter_values_decode", bench_now_ns() - t0, bytes);
+	const bool decoded_all = bytes == (size_t)len * ITERATIONS;
+
+	/* a long string copied or referred to in place */
+	struct ocpp_iovec iov[4];
+	size_t total;
+	strcpy(transfer.msg.vendorId, "com.example");
+	memset(transfer.msg.data, 'd', DATA_TRANSFER_LEN);
+	msg.type = OCPP_MSG_DATA_TRANSFER;
+	msg.payload.fmt.request = &transfer;
+	msg.payload.size = sizeof(transfer);
+	bytes = 0;
+	t0 = bench_now_ns();
+	for (int n = 0; n < ITERATIONS; n++) {
+		bytes += (size_t)ocpp_encode_message_json(&msg, buf, sizeof(buf));
+	}
+	report("message_json/data_transfer", bench_now_ns() - t0, bytes);
+
+	bytes = 0;
+	t0 = bench_now_ns();
+	for (int n = 0; n < ITERATIONS; n++) {
+		if (ocpp_encode_message_jsonv(&msg, iov, 4,
+				buf, sizeof(buf), &total) > 0) {
+			bytes += total;
+		}
+	}
+	report("message_json/data_transfer_iov", bench_now_ns() - t0, bytes);
+
+	return streamed_all && decoded_all? 0 : 1;
+}
@@ -0,0 +1,65 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "bench.h"
+#include "ocpp/ocpp.h"
+#include <string.h>
+
+#define ITERATIONS			200000
+
+static const char *unknowns[] = {
+	"Heart", "HeartbeaT", "Authorizes", "UnknownMessage",
+};
+
+/* The linear scan that ocpp_get_type_from_string() used to do. */
+static ocpp_message_t get_type_linear(const char *typestr)
+{
+	for (ocpp_message_t i = 0; i < OCPP_MSG_MAX; i++) {
+		if (strcmp(typestr, ocpp_stringify_type(i)) == 0) {
+			return i;
+		}
+	}
+
+	return OCPP_MSG_MAX;
+}
+
+static unsigned run(ocpp_message_t (*f)(const char *))
+{
+	unsigned sum = 0;
+
+	for (int n = 0; n < ITERATIONS; n++) {
+		for (ocpp_message_t i = 0; i < OCPP_MSG_MAX; i++) {
+			sum += (unsigned)(*f)(ocpp_stringify_type(i));
+		}
+		for (size_t i = 0; i < sizeof(unknowns) / sizeof(*unknowns); i++) {
+			sum += (unsigned)(*f)(unknowns[i]);
+		}
+	}
+
+	return sum;
+}
+
+int main(void)
+{
+	const double lookups = (double)ITERATIONS *
+		(OCPP_MSG_MAX + sizeof(unknowns) / sizeof(*unknowns));
+	uint64_t t0 = bench_now_ns();
+	unsigned a = run(get_type_linear);
+	uint64_t t1 = bench_now_ns();
+	unsigned b = run(ocpp_get_type_from_string);
+	uint64_t t2 = bench_now_ns();
+
+	if (a != b) {
+		return 1;
+	}
+
+	bench_report("type_from_string/linear", (double)(t1 - t0) / lookups,
+			"ns/lookup");
+	bench_report("type_from_string/switch", (double)(t2 - t1) / lookups,
+			"ns/lookup");
+
+	return 0;
+}
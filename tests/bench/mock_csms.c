@@ -0,0 +1,405 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "mock_csms.h"
+#include "bench.h"
+#include "ocpp/websocket.h"
+#include "ocpp/message_json.h"
+#include "ocpp/message_schema.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#define PAYLOAD_MAXLEN			4096
+#define BOOT_INTERVAL_SEC		300
+
+struct pending {
+	uint64_t due_ns;
+	char id[OCPP_MESSAGE_ID_MAXLEN];
+	ocpp_message_t type;
+	bool error;
+	ocpp_callerror_t code;
+};
+
+struct station {
+	struct ocpp_websocket ws;
+	struct pending pending[MOCK_CSMS_PENDING_MAX];
+	size_t nr_pending;
+};
+
+struct script {
+	uint64_t latency_ns;
+	uint32_t error_every;
+	uint32_t count;
+	ocpp_callerror_t code;
+};
+
+struct mock_csms {
+	int listener;
+	uint16_t port;
+
+	struct station **stations;
+	struct pollfd *pfds;
+	size_t max_stations;
+	size_t nr_stations;
+
+	struct script script[OCPP_MSG_MAX];
+	int transaction_id;
+
+	struct mock_csms_stats stats;
+};
+
+static union {
+	struct ocpp_CallError error;
+	uint8_t raw[PAYLOAD_MAXLEN];
+	uint64_t align;
+} payload;
+
+static size_t make_result(struct mock_csms *csms, ocpp_message_t type)
+{
+	const struct ocpp_schema *schema =
+		ocpp_get_message_schema(type, OCPP_MSG_ROLE_CALLRESULT);
+
+	memset(payload.raw, 0, schema->size);
+
+	switch (type) {
+	case OCPP_MSG_BOOTNOTIFICATION: {
+		struct ocpp_BootNotification_conf *p =
+			(struct ocpp_BootNotification_conf *)payload.raw;
+		p->currentTime = time(NULL);
+		p->interval = BOOT_INTERVAL_SEC;
+		p->status = OCPP_BOOT_STATUS_ACCEPTED;
+		} break;
+	case OCPP_MSG_AUTHORIZE: {
+		struct ocpp_Authorize_conf *p =
+			(struct ocpp_Authorize_conf *)payload.raw;
+		p->idTagInfo.status = OCPP_AUTH_STATUS_ACCEPTED;
+		} break;
+	case OCPP_MSG_START_TRANSACTION: {
+		struct ocpp_StartTransaction_conf *p =
+			(struct ocpp_StartTransaction_conf *)payload.raw;
+		p->idTagInfo.status = OCPP_AUTH_STATUS_ACCEPTED;
+		p->transactionId = ++csms->transaction_id;
+		} break;
+	case OCPP_MSG_HEARTBEAT: {
+		struct ocpp_Heartbeat_conf *p =
+			(struct ocpp_Heartbeat_conf *)payload.raw;
+		p->currentTime = time(NULL);
+		} break;
+	default:
+		break;
+	}
+
+	return schema->size;
+}
+
+/* @return true if sent or nothing to send, false to retry later */
+static bool send_reply(struct mock_csms *csms, struct station *st,
+		const struct pending *p)
+{
+	struct ocpp_message msg = {
+		.role = OCPP_MSG_ROLE_CALLRESULT,
+		.type = p->type,
+		.payload.fmt.data = payload.raw,
+	};
+
+	memcpy(msg.id, p->id, sizeof(msg.id));
+
+	if (p->error) {
+		msg.role = OCPP_MSG_ROLE_CALLERROR;
+		payload.error.errorCode = p->code;
+		strcpy(payload.error.errorDescription, "Injected by mock CSMS");
+		msg.payload.size = sizeof(payload.error);
+	} else {
+		msg.payload.size = make_result(csms, p->type);
+	}
+
+	const int err = ocpp_websocket_send(&st->ws, &msg);
+
+	if (err == -EAGAIN) {
+		return false;
+	} else if (err == 0) {
+		if (p->error) {
+			csms->stats.errors++;
+		} else {
+			csms->stats.results++;
+		}
+	}
+
+	return true;
+}
+
+static void send_due_replies(struct mock_csms *csms, struct station *st,
+		uint64_t now)
+{
+	size_t n = 0;
+
+	for (size_t i = 0; i < st->nr_pending; i++) {
+		struct pending *p = &st->pending[i];
+
+		if (p->due_ns > now || !send_reply(csms, st, p)) {
+			st->pending[n++] = *p;
+		}
+	}
+
+	st->nr_pending = n;
+}
+
+static void take_request(struct mock_csms *csms, struct station *st,
+		const char *data, size_t len, uint64_t now)
+{
+	struct ocpp_message msg = { 0, };
+	ocpp_callerror_t code = OCPP_CALLERROR_GENERIC;
+	const int err = ocpp_decode_message_json(data, len, &msg,
+			payload.raw, sizeof(payload.raw), &code);
+
+	if (msg.role != OCPP_MSG_ROLE_CALL || (err && err != -EBADMSG)) {
+		return;
+	}
+
+	csms->stats.calls++;
+
+	if (st->nr_pending >= MOCK_CSMS_PENDING_MAX) {
+		csms->stats.dropped++;
+		return;
+	}
+
+	struct pending *p = &st->pending[st->nr_pending++];
+	memcpy(p->id, msg.id, sizeof(p->id));
+	p->type = msg.type;
+	p->error = err == -EBADMSG;
+	p->code = code;
+	p->due_ns = now;
+
+	if (msg.type < OCPP_MSG_MAX) {
+		struct script *s = &csms->script[msg.type];
+
+		p->due_ns += s->latency_ns;
+
+		if (!p->error && s->error_every &&
+				++s->count % s->error_every == 0) {
+			p->error = true;
+			p->code = s->code;
+		}
+	}
+}
+
+/* @return 0 or the error of the connection */
+static int serve(struct mock_csms *csms, struct station *st, uint64_t now)
+{
+	int err;
+
+	/* a message at a time is taken in by a step */
+	while ((err = ocpp_websocket_step(&st->ws)) == 0) {
+		const char *data;
+		const int len = ocpp_websocket_peek(&st->ws, &data);
+
+		if (len < 0) {
+			break;
+		}
+
+		take_request(csms, st, data, (size_t)len, now);
+		ocpp_websocket_consume(&st->ws);
+	}
+
+	return err;
+}
+
+static void accept_stations(struct mock_csms *csms)
+{
+	while (csms->nr_stations < csms->max_stations) {
+		const int fd = accept(csms->listener, NULL, NULL);
+
+		if (fd < 0) {
+			break;
+		}
+
+		struct station *st = (struct station *)malloc(sizeof(*st));
+
+		if (st == NULL || ocpp_websocket_accept(&st->ws, fd) != 0) {
+			free(st);
+			close(fd);
+			break;
+		}
+
+		st->nr_pending = 0;
+		csms->stations[csms->nr_stations++] = st;
+		csms->stats.accepted++;
+	}
+}
+
+static void remove_station(struct mock_csms *csms, size_t index)
+{
+	struct station *st = csms->stations[index];
+
+	if (ocpp_websocket_fd(&st->ws) >= 0) {
+		close(ocpp_websocket_fd(&st->ws));
+	}
+	free(st);
+
+	csms->stations[index] = csms->stations[--csms->nr_stations];
+}
+
+int mock_csms_step(struct mock_csms *csms, int timeout_ms)
+{
+	uint64_t now = bench_now_ns();
+	uint64_t next_due = UINT64_MAX;
+
+	csms->pfds[0].fd = csms->listener;
+	csms->pfds[0].events = POLLIN;
+
+	for (size_t i = 0; i < csms->nr_stations; i++) {
+		const struct station *st = csms->stations[i];
+
+		csms->pfds[i + 1].fd = ocpp_websocket_fd(&st->ws);
+		csms->pfds[i + 1].events = (short)(POLLIN |
+				(ocpp_websocket_wants_write(&st->ws)?
+					POLLOUT : 0));
+
+		for (size_t j = 0; j < st->nr_pending; j++) {
+			if (st->pending[j].due_ns < next_due) {
+				next_due = st->pending[j].due_ns;
+			}
+		}
+	}
+
+	if (next_due != UINT64_MAX && timeout_ms != 0) {
+		const uint64_t wait_ms = next_due > now?
+			(next_due - now + 999999) / 1000000 : 0;
+		if (timeout_ms < 0 || wait_ms < (uint64_t)timeout_ms) {
+			timeout_ms = (int)wait_ms;
+		}
+	}
+
+	const size_t nfds = csms->nr_stations + 1;
+	const int nr_ready = poll(csms->pfds, nfds, timeout_ms);
+
+	if (nr_ready < 0) {
+		return -errno;
+	}
+
+	now = bench_now_ns();
+
+	/* backwards for the removal to swap in the ones done already */
+	for (size_t i = csms->nr_stations; i > 0; i--) {
+		struct station *st = csms->stations[i - 1];
+
+		if (csms->pfds[i].revents && serve(csms, st, now) != 0) {
+			remove_station(csms, i - 1);
+			continue;
+		}
+
+		send_due_replies(csms, st, now);
+	}
+
+	if (csms->pfds[0].revents & POLLIN) {
+		accept_stations(csms);
+	}
+
+	return nr_ready;
+}
+
+void mock_csms_set_latency(struct mock_csms *csms, ocpp_message_t type,
+		uint32_t latency_ms)
+{
+	for (int i = 0; i < OCPP_MSG_MAX; i++) {
+		if (type == OCPP_MSG_MAX || type == (ocpp_message_t)i) {
+			csms->script[i].latency_ns =
+				(uint64_t)latency_ms * 1000000ull;
+		}
+	}
+}
+
+void mock_csms_set_error(struct mock_csms *csms, ocpp_message_t type,
+		ocpp_callerror_t code, uint32_t every)
+{
+	for (int i = 0; i < OCPP_MSG_MAX; i++) {
+		if (type == OCPP_MSG_MAX || type == (ocpp_message_t)i) {
+			csms->script[i].error_every = every;
+			csms->script[i].count = 0;
+			csms->script[i].code = code;
+		}
+	}
+}
+
+void mock_csms_get_stats(const struct mock_csms *csms,
+		struct mock_csms_stats *stats)
+{
+	*stats = csms->stats;
+	stats->stations = csms->nr_stations;
+}
+
+uint16_t mock_csms_port(const struct mock_csms *csms)
+{
+	return csms->port;
+}
+
+struct mock_csms *mock_csms_create(uint16_t port, size_t max_stations)
+{
+	struct sockaddr_in addr = {
+		.sin_family = AF_INET,
+		.sin_port = htons(port),
+		.sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+	};
+	socklen_t len = sizeof(addr);
+	const int one = 1;
+	struct mock_csms *csms = (struct mock_csms *)calloc(1, sizeof(*csms));
+
+	if (csms == NULL) {
+		return NULL;
+	}
+
+	csms->max_stations = max_stations;
+	csms->stations = (struct station **)
+		calloc(max_stations, sizeof(*csms->stations));
+	csms->pfds = (struct pollfd *)
+		calloc(max_stations + 1, sizeof(*csms->pfds));
+	csms->listener = socket(AF_INET, SOCK_STREAM, 0);
+
+	if (!csms->stations || !csms->pfds || csms->listener < 0 ||
+			setsockopt(csms->listener, SOL_SOCKET, SO_REUSEADDR,
+				&one, sizeof(one)) != 0 ||
+			bind(csms->listener, (struct sockaddr *)&addr,
+				sizeof(addr)) != 0 ||
+			listen(csms->listener, SOMAXCONN) != 0 ||
+			getsockname(csms->listener, (struct sockaddr *)&addr,
+				&len) != 0 ||
+			fcntl(csms->listener, F_SETFL, O_NONBLOCK) != 0) {
+		mock_csms_destroy(csms);
+		return NULL;
+	}
+
+	csms->port = ntohs(addr.sin_port);
+
+	return csms;
+}
+
+void mock_csms_destroy(struct mock_csms *csms)
+{
+	if (csms == NULL) {
+		return;
+	}
+
+	while (csms->nr_stations > 0) {
+		remove_station(csms, csms->nr_stations - 1);
+	}
+
+	if (csms->listener >= 0) {
+		close(csms->listener);
+	}
+
+	free(csms->pfds);
+	free(csms->stations);
+	free(csms);
+}
@@ -0,0 +1,80 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef OCPP_MOCK_CSMS_H
+#define OCPP_MOCK_CSMS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ocpp/ocpp.h"
+
+#if !defined(MOCK_CSMS_PENDING_MAX)
+#define MOCK_CSMS_PENDING_MAX			8
+#endif
+
+struct mock_csms;
+
+struct mock_csms_stats {
+	size_t stations; /* connected now */
+	size_t accepted; /* connections so far */
+	uint64_t calls;
+	uint64_t results;
+	uint64_t errors; /* injected or of rejected frames */
+	uint64_t dropped; /* over MOCK_CSMS_PENDING_MAX */
+};
+
+/**
+ * @brief Start a stand-in CSMS listening on the loopback.
+ *
+ * It speaks OCPP-J over `src/websocket.c` to up to @p max_stations stations,
+ * answering every CALL with a CALLRESULT: BootNotification and Authorize
+ * Accepted, StartTransaction with a new transactionId, Heartbeat with the
+ * current time and the rest with the members left out or zero.
+ *
+ * @param[in] port port to listen on. 0 for any
+ * @param[in] max_stations number of the stations connected at a time
+ *
+ * @return the CSMS or NULL on failure
+ */
+struct mock_csms *mock_csms_create(uint16_t port, size_t max_stations);
+void mock_csms_destroy(struct mock_csms *csms);
+uint16_t mock_csms_port(const struct mock_csms *csms);
+
+/**
+ * @brief Delay the replies to a type of request.
+ *
+ * @param[in] csms CSMS
+ * @param[in] type type of request. `OCPP_MSG_MAX` for all
+ * @param[in] latency_ms delay in milliseconds
+ */
+void mock_csms_set_latency(struct mock_csms *csms, ocpp_message_t type,
+		uint32_t latency_ms);
+/**
+ * @brief Answer a type of request with a CALLERROR every so often.
+ *
+ * @param[in] csms CSMS
+ * @param[in] type type of request. `OCPP_MSG_MAX` for all
+ * @param[in] code error code of the CALLERROR
+ * @param[in] every every how many requests of the type, counted per type.
+ *            0 not to inject any
+ */
+void mock_csms_set_error(struct mock_csms *csms, ocpp_message_t type,
+		ocpp_callerror_t code, uint32_t every);
+
+/**
+ * @brief Accept stations, take their requests in and send the replies due.
+ *
+ * @param[in] csms CSMS
+ * @param[in] timeout_ms time to wait for any event, up to the next reply due
+ *
+ * @return the number of the sockets ready or a negative error
+ */
+int mock_csms_step(struct mock_csms *csms, int timeout_ms);
+void mock_csms_get_stats(const struct mock_csms *csms,
+		struct mock_csms_stats *stats);
+
+#endif /* OCPP_MOCK_CSMS_H */
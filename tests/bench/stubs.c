@@ -0,0 +1,65 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "ocpp/ocpp.h"
+#include <errno.h>
+
+/* weak for a bench to put the messages on a transport */
+int __attribute__((weak)) ocpp_send(const struct ocpp_message *msg)
+{
+	(void)msg;
+	return 0;
+}
+
+int __attribute__((weak)) ocpp_recv(struct ocpp_message *msg)
+{
+	(void)msg;
+	return -ENOMSG;
+}
+
+int ocpp_lock(void)
+{
+	return 0;
+}
+
+int ocpp_unlock(void)
+{
+	return 0;
+}
+
+int ocpp_configuration_lock(void)
+{
+	return 0;
+}
+
+int ocpp_configuration_unlock(void)
+{
+	return 0;
+}
+
+int ocpp_configuration_storage_read(size_t offset, void *buf, size_t bufsize)
+{
+	(void)offset;
+	(void)buf;
+	(void)bufsize;
+	return -EIO;
+}
+
+int ocpp_configuration_storage_write(size_t offset,
+		const void *data, size_t datasize)
+{
+	(void)offset;
+	(void)data;
+	(void)datasize;
+	return -EIO;
+}
+
+int ocpp_configuration_storage_erase(size_t offset, size_t size)
+{
+	(void)offset;
+	(void)size;
+	return -EIO;
+}
@@ -0,0 +1,24 @@
+# SPDX-License-Identifier: MIT
+
+COMPONENT_NAME = ConfigurationConnector
+
+SRC_FILES = \
+	../src/core/configuration.c \
+	../src/core/configuration_store.c \
+
+TEST_SRC_FILES = \
+	src/configuration_connector_test.cpp \
+	src/test_all.cpp \
+
+INCLUDE_DIRS = \
+	$(CPPUTEST_HOME)/include \
+	../include \
+	src \
+
+MOCKS_SRC_DIRS =
+CPPUTEST_CPPFLAGS = \
+	-DOCPP_CONFIGURATION_DEFINES=\"configuration_connector.def\" \
+	-DOCPP_CONFIGURATION_STORE_SECTOR_SIZE=1024 \
+	-DOCPP_CONFIGURATION_STORE_ALIGN=8
+
+include runners/MakefileRunner
@@ -0,0 +1,21 @@
+# SPDX-License-Identifier: MIT
+
+COMPONENT_NAME = ConfigurationConstraint
+
+SRC_FILES = \
+	../src/core/configuration.c \
+
+TEST_SRC_FILES = \
+	src/configuration_constraint_test.cpp \
+	src/test_all.cpp \
+
+INCLUDE_DIRS = \
+	$(CPPUTEST_HOME)/include \
+	../include \
+	src \
+
+MOCKS_SRC_DIRS =
+CPPUTEST_CPPFLAGS = \
+	-DOCPP_CONFIGURATION_DEFINES=\"configuration_constraint.def\"
+
+include runners/MakefileRunner
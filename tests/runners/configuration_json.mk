@@ -0,0 +1,21 @@
+# SPDX-License-Identifier: MIT
+
+COMPONENT_NAME = ConfigurationJson
+
+SRC_FILES = \
+	../src/core/configuration.c \
+	../src/core/configuration_csl.c \
+	../src/core/configuration_json.c \
+
+TEST_SRC_FILES = \
+	src/configuration_json_test.cpp \
+	src/test_all.cpp \
+
+INCLUDE_DIRS = \
+	$(CPPUTEST_HOME)/include \
+	../include \
+
+MOCKS_SRC_DIRS =
+CPPUTEST_CPPFLAGS =
+
+include runners/MakefileRunner
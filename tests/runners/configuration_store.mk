@@ -0,0 +1,22 @@
+# SPDX-License-Identifier: MIT
+
+COMPONENT_NAME = ConfigurationStore
+
+SRC_FILES = \
+	../src/core/configuration.c \
+	../src/core/configuration_store.c \
+
+TEST_SRC_FILES = \
+	src/configuration_store_test.cpp \
+	src/test_all.cpp \
+
+INCLUDE_DIRS = \
+	$(CPPUTEST_HOME)/include \
+	../include \
+
+MOCKS_SRC_DIRS =
+CPPUTEST_CPPFLAGS = \
+	-DOCPP_CONFIGURATION_STORE_SECTOR_SIZE=1024 \
+	-DOCPP_CONFIGURATION_STORE_ALIGN=8
+
+include runners/MakefileRunner
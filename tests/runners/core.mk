@@ -16,6 +16,7 @@ INCLUDE_DIRS = \
 	../include \
 
 MOCKS_SRC_DIRS =
-CPPUTEST_CPPFLAGS = -DOCPP_DEFAULT_TX_TIMEOUT_SEC=5 -DOCPP_DEFAULT_TX_RETRIES=2
+CPPUTEST_CPPFLAGS = -DOCPP_DEFAULT_TX_TIMEOUT_SEC=5 -DOCPP_DEFAULT_TX_RETRIES=2 \
+	-DOCPP_RESPONSE_CACHE_LEN=4
 
 include runners/MakefileRunner
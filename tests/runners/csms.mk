@@ -0,0 +1,27 @@
+# SPDX-License-Identifier: MIT
+
+COMPONENT_NAME = Csms
+
+SRC_FILES = \
+	../src/csms.c \
+	../src/ocpp.c \
+	../src/overrides.c \
+	../src/websocket.c \
+	../src/message_json.c \
+	../src/message_schema.c \
+	../src/core/configuration.c \
+	../src/core/configuration_csl.c \
+
+TEST_SRC_FILES = \
+	src/csms_test.cpp \
+	src/test_all.cpp \
+
+INCLUDE_DIRS = \
+	$(CPPUTEST_HOME)/include \
+	../include \
+
+MOCKS_SRC_DIRS =
+CPPUTEST_CPPFLAGS = -DOCPP_CSMS_TICK_MS=5 -DOCPP_CSMS_TX_TIMEOUT_SEC=2 \
+	-DOCPP_CSMS_TX_RETRIES=2
+
+include runners/MakefileRunner
@@ -0,0 +1,21 @@
+# SPDX-License-Identifier: MIT
+
+COMPONENT_NAME = Gateway
+
+SRC_FILES = \
+	../src/gateway.c \
+
+TEST_SRC_FILES = \
+	src/gateway_test.cpp \
+	src/test_all.cpp \
+
+INCLUDE_DIRS = \
+	$(CPPUTEST_HOME)/include \
+	../include \
+
+MOCKS_SRC_DIRS =
+CPPUTEST_CPPFLAGS = -DOCPP_GATEWAY_STATIONS_MAX=4 -DOCPP_GATEWAY_ROUTES_MAX=4 \
+	-DOCPP_GATEWAY_AUTH_CACHE_LEN=2 -DOCPP_GATEWAY_OFFLINE_TX_MAX=2 \
+	-DOCPP_GATEWAY_ROUTE_TIMEOUT_SEC=30
+
+include runners/MakefileRunner
@@ -0,0 +1,24 @@
+# SPDX-License-Identifier: MIT
+
+COMPONENT_NAME = MessageJson
+
+SRC_FILES = \
+	../src/ocpp.c \
+	../src/overrides.c \
+	../src/message_json.c \
+	../src/message_schema.c \
+	../src/core/configuration.c \
+	../src/core/configuration_csl.c \
+
+TEST_SRC_FILES = \
+	src/message_json_test.cpp \
+	src/test_all.cpp \
+
+INCLUDE_DIRS = \
+	$(CPPUTEST_HOME)/include \
+	../include \
+
+MOCKS_SRC_DIRS =
+CPPUTEST_CPPFLAGS =
+
+include runners/MakefileRunner
@@ -0,0 +1,26 @@
+# SPDX-License-Identifier: MIT
+
+COMPONENT_NAME = WebSocket
+
+SRC_FILES = \
+	../src/ocpp.c \
+	../src/overrides.c \
+	../src/websocket.c \
+	../src/deflate.c \
+	../src/message_json.c \
+	../src/message_schema.c \
+	../src/core/configuration.c \
+	../src/core/configuration_csl.c \
+
+TEST_SRC_FILES = \
+	src/websocket_test.cpp \
+	src/test_all.cpp \
+
+INCLUDE_DIRS = \
+	$(CPPUTEST_HOME)/include \
+	../include \
+
+MOCKS_SRC_DIRS =
+CPPUTEST_CPPFLAGS = -DOCPP_WEBSOCKET_DEFLATE=1
+
+include runners/MakefileRunner
@@ -0,0 +1,129 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+#include "ocpp/core/configuration_store.h"
+#include "ocpp/overrides.h"
+#include <errno.h>
+#include <string.h>
+
+static uint8_t flash[OCPP_CONFIGURATION_STORE_SECTOR_SIZE * 2];
+
+int ocpp_configuration_lock(void) {
+	return 0;
+}
+int ocpp_configuration_unlock(void) {
+	return 0;
+}
+
+int ocpp_configuration_storage_read(size_t offset, void *buf, size_t bufsize) {
+	memcpy(buf, &flash[offset], bufsize);
+	return 0;
+}
+int ocpp_configuration_storage_write(size_t offset,
+		const void *data, size_t datasize) {
+	const uint8_t *p = (const uint8_t *)data;
+	for (size_t i = 0; i < datasize; i++) {
+		flash[offset + i] &= p[i];
+	}
+	return 0;
+}
+int ocpp_configuration_storage_erase(size_t offset, size_t size) {
+	memset(&flash[offset], 0xff, size);
+	return 0;
+}
+
+TEST_GROUP(ConfigurationConnector) {
+	void setup(void) {
+		memset(flash, 0xff, sizeof(flash));
+		ocpp_reset_configuration();
+	}
+	void teardown(void) {
+		mock().checkExpectations();
+		mock().clear();
+	}
+};
+
+TEST(ConfigurationConnector, get_len_ShouldCountEveryConnector) {
+	LONGS_EQUAL(sizeof(int) * (OCPP_CONNECTOR_MAX + 4) + sizeof(bool) + 40,
+			ocpp_compute_configuration_size());
+}
+
+TEST(ConfigurationConnector, connector_ShouldKeepValuePerConnector) {
+	LONGS_EQUAL(OCPP_CONNECTOR_MAX + 1,
+			ocpp_count_configuration_connectors("ConnectorPhaseRotation"));
+
+	LONGS_EQUAL(0, ocpp_conf_set_csl_at(OCPP_CONF_ConnectorPhaseRotation,
+			0, OCPP_PHASE_ROTATION_RST));
+	LONGS_EQUAL(0, ocpp_conf_set_csl_at(OCPP_CONF_ConnectorPhaseRotation,
+			OCPP_CONNECTOR_MAX, OCPP_PHASE_ROTATION_TSR));
+
+	LONGS_EQUAL(OCPP_PHASE_ROTATION_RST,
+			ocpp_conf_get_csl(OCPP_CONF_ConnectorPhaseRotation));
+	LONGS_EQUAL(OCPP_PHASE_ROTATION_TSR,
+			ocpp_conf_get_csl_at(OCPP_CONF_ConnectorPhaseRotation,
+					OCPP_CONNECTOR_MAX));
+	LONGS_EQUAL(false, ocpp_is_configuration_default(
+			OCPP_CONF_ConnectorPhaseRotation));
+	LONGS_EQUAL(180, ocpp_conf_get_int(OCPP_CONF_ConnectionTimeOut));
+
+	ocpp_reset_configuration();
+	LONGS_EQUAL(0, ocpp_conf_get_csl_at(OCPP_CONF_ConnectorPhaseRotation,
+			OCPP_CONNECTOR_MAX));
+}
+
+TEST(ConfigurationConnector, connector_ShouldMarkKeyDirty_WhenAnyConnectorChanged) {
+	ocpp_clear_configuration_dirty(OCPP_CONF_ConnectorPhaseRotation);
+	ocpp_conf_set_csl_at(OCPP_CONF_ConnectorPhaseRotation,
+			OCPP_CONNECTOR_MAX, OCPP_PHASE_ROTATION_RTS);
+	LONGS_EQUAL(true, ocpp_is_configuration_dirty(
+			OCPP_CONF_ConnectorPhaseRotation));
+}
+
+static int get_span(const char *keystr, const void *value, size_t value_size,
+		ocpp_configuration_data_t type, bool readonly, void *ctx) {
+	(void)type;
+	(void)readonly;
+	if (strcmp(keystr, "ConnectorPhaseRotation") == 0) {
+		memcpy(ctx, value, value_size);
+		return 1;
+	}
+	return 0;
+}
+
+TEST(ConfigurationConnector, visit_ShouldGiveAllConnectorsOfKey) {
+	int values[OCPP_CONNECTOR_MAX + 1] = { 0, };
+
+	ocpp_conf_set_csl_at(OCPP_CONF_ConnectorPhaseRotation,
+			OCPP_CONNECTOR_MAX, OCPP_PHASE_ROTATION_SRT);
+	ocpp_visit_configurations(NULL, 0, get_span, values);
+
+	LONGS_EQUAL(OCPP_PHASE_ROTATION_SRT, values[OCPP_CONNECTOR_MAX]);
+}
+
+TEST(ConfigurationConnector, load_ShouldRestoreValuesPerConnector) {
+	ocpp_conf_set_csl_at(OCPP_CONF_ConnectorPhaseRotation,
+			0, OCPP_PHASE_ROTATION_RST);
+	ocpp_conf_set_csl_at(OCPP_CONF_ConnectorPhaseRotation,
+			OCPP_CONNECTOR_MAX, OCPP_PHASE_ROTATION_TSR);
+	LONGS_EQUAL(0, ocpp_save_configuration());
+
+	ocpp_reset_configuration();
+	LONGS_EQUAL(0, ocpp_load_configuration());
+	LONGS_EQUAL(OCPP_PHASE_ROTATION_RST,
+			ocpp_conf_get_csl(OCPP_CONF_ConnectorPhaseRotation));
+	LONGS_EQUAL(OCPP_PHASE_ROTATION_TSR,
+			ocpp_conf_get_csl_at(OCPP_CONF_ConnectorPhaseRotation,
+					OCPP_CONNECTOR_MAX));
+
+	/* and through a compaction */
+	for (int i = 0; i < 100; i++) {
+		ocpp_conf_set_int(OCPP_CONF_HeartbeatInterval, i);
+		LONGS_EQUAL(0, ocpp_save_configuration());
+	}
+	ocpp_reset_configuration();
+	LONGS_EQUAL(0, ocpp_load_configuration());
+	LONGS_EQUAL(99, ocpp_conf_get_int(OCPP_CONF_HeartbeatInterval));
+	LONGS_EQUAL(OCPP_PHASE_ROTATION_TSR,
+			ocpp_conf_get_csl_at(OCPP_CONF_ConnectorPhaseRotation,
+					OCPP_CONNECTOR_MAX));
+}
@@ -0,0 +1,54 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+#include "ocpp/core/configuration.h"
+#include "ocpp/overrides.h"
+#include <errno.h>
+
+int ocpp_configuration_lock(void) {
+	return 0;
+}
+int ocpp_configuration_unlock(void) {
+	return 0;
+}
+
+TEST_GROUP(ConfigurationConstraint) {
+	void setup(void) {
+		ocpp_reset_configuration();
+	}
+	void teardown(void) {
+		mock().checkExpectations();
+		mock().clear();
+	}
+};
+
+TEST(ConfigurationConstraint, count_ShouldReturnTheNumberOfCustomConfigurations) {
+	LONGS_EQUAL(6, ocpp_count_configurations());
+}
+
+TEST(ConfigurationConstraint, set_ShouldReturnERANGE_WhenBelowMin) {
+	int value = 9;
+	LONGS_EQUAL(-ERANGE, ocpp_set_configuration("HeartbeatInterval", &value, sizeof(value)));
+	value = 10;
+	LONGS_EQUAL(0, ocpp_set_configuration("HeartbeatInterval", &value, sizeof(value)));
+}
+
+TEST(ConfigurationConstraint, set_ShouldReturnERANGE_WhenMemberNotAllowed) {
+	int value = OCPP_MEASURAND_ENERGY_ACTIVE_IMPORT_REGISTER | OCPP_MEASURAND_SOC;
+	LONGS_EQUAL(-ERANGE, ocpp_set_configuration("MeterValuesSampledData", &value, sizeof(value)));
+	value = OCPP_MEASURAND_VOLTAGE | OCPP_MEASURAND_POWER_ACTIVE_IMPORT;
+	LONGS_EQUAL(0, ocpp_set_configuration("MeterValuesSampledData", &value, sizeof(value)));
+	LONGS_EQUAL(value, ocpp_conf_get_csl(OCPP_CONF_MeterValuesSampledData));
+}
+
+TEST(ConfigurationConstraint, change_ShouldReturnRebootRequired_WhenFlagged) {
+	int value = 30;
+	LONGS_EQUAL(OCPP_CONFIG_STATUS_REBOOT_REQUIRED, ocpp_change_configuration("WebSocketPingInterval", &value, sizeof(value)));
+	LONGS_EQUAL(30, ocpp_conf_get_int(OCPP_CONF_WebSocketPingInterval));
+	LONGS_EQUAL(OCPP_CONFIG_STATUS_ACCEPTED, ocpp_change_configuration("HeartbeatInterval", &value, sizeof(value)));
+}
+
+TEST(ConfigurationConstraint, typed_setter_ShouldBypassConstraints) {
+	LONGS_EQUAL(0, ocpp_conf_set_int(OCPP_CONF_HeartbeatInterval, 1));
+	LONGS_EQUAL(1, ocpp_conf_get_int(OCPP_CONF_HeartbeatInterval));
+}
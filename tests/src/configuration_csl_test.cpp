@@ -0,0 +1,142 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+#include "ocpp/core/configuration_csl.h"
+#include "ocpp/overrides.h"
+#include <errno.h>
+#include <string.h>
+
+int ocpp_configuration_lock(void) {
+	return 0;
+}
+int ocpp_configuration_unlock(void) {
+	return 0;
+}
+
+static int decode(const char *keystr, const char *csl, int *mask) {
+	return ocpp_decode_configuration_csl(keystr, csl, strlen(csl), mask);
+}
+
+TEST_GROUP(ConfigurationCsl) {
+	char buf[512];
+	int mask;
+
+	void setup(void) {
+		ocpp_reset_configuration();
+		mask = -1;
+	}
+	void teardown(void) {
+		mock().checkExpectations();
+		mock().clear();
+	}
+};
+
+TEST(ConfigurationCsl, decode_ShouldReturnMaskOfMeasurands) {
+	LONGS_EQUAL(2, decode("MeterValuesSampledData",
+			"Energy.Active.Import.Register,Voltage", &mask));
+	LONGS_EQUAL(OCPP_MEASURAND_ENERGY_ACTIVE_IMPORT_REGISTER |
+			OCPP_MEASURAND_VOLTAGE, mask);
+}
+
+TEST(ConfigurationCsl, decode_ShouldReturnMaskOfProfiles) {
+	LONGS_EQUAL(2, decode("SupportedFeatureProfiles",
+			"Core,SmartCharging", &mask));
+	LONGS_EQUAL(OCPP_PROFILE_CORE | OCPP_PROFILE_SMART_CHARGING, mask);
+}
+
+TEST(ConfigurationCsl, decode_ShouldIgnoreSpacesAroundItems) {
+	LONGS_EQUAL(3, decode("StopTxnSampledData",
+			" SoC ,\tRPM,  Power.Offered  ", &mask));
+	LONGS_EQUAL(OCPP_MEASURAND_SOC | OCPP_MEASURAND_RPM |
+			OCPP_MEASURAND_POWER_OFFERED, mask);
+}
+
+TEST(ConfigurationCsl, decode_ShouldReturnZero_WhenListEmpty) {
+	LONGS_EQUAL(0, decode("MeterValuesAlignedData", "", &mask));
+	LONGS_EQUAL(0, mask);
+	LONGS_EQUAL(0, decode("MeterValuesAlignedData", "  ", &mask));
+	LONGS_EQUAL(0, mask);
+}
+
+TEST(ConfigurationCsl, decode_ShouldReturnEINVAL_WhenUnknownOrEmptyItem) {
+	LONGS_EQUAL(-EINVAL, decode("MeterValuesSampledData",
+			"Voltage,Voltages", &mask));
+	LONGS_EQUAL(-EINVAL, decode("MeterValuesSampledData",
+			"Voltag", &mask));
+	LONGS_EQUAL(-EINVAL, decode("MeterValuesSampledData",
+			"Current. Export", &mask));
+	LONGS_EQUAL(-EINVAL, decode("MeterValuesSampledData",
+			"Voltage,,SoC", &mask));
+	LONGS_EQUAL(-EINVAL, decode("MeterValuesSampledData",
+			"Voltage,", &mask));
+	LONGS_EQUAL(-EINVAL, decode("SupportedFeatureProfiles",
+			"Voltage", &mask));
+	LONGS_EQUAL(-1, mask);
+}
+
+TEST(ConfigurationCsl, decode_ShouldReturnENOTSUP_WhenKeyIsNotList) {
+	LONGS_EQUAL(-ENOTSUP, decode("HeartbeatInterval", "1", &mask));
+	LONGS_EQUAL(-ENOTSUP, ocpp_encode_configuration_csl("HeartbeatInterval",
+			1, buf, sizeof(buf)));
+}
+
+TEST(ConfigurationCsl, decode_ShouldReturnE2BIG_WhenExceedingMaxLength) {
+	const int max = 2;
+
+	/* read-only to the server, so set by the typed setter */
+	ocpp_conf_set_int(OCPP_CONF_SupportedFeatureProfilesMaxLength, max);
+
+	LONGS_EQUAL(2, decode("SupportedFeatureProfiles", "Core,Reservation",
+			&mask));
+	LONGS_EQUAL(-E2BIG, decode("SupportedFeatureProfiles",
+			"Core,Reservation,RemoteTrigger", &mask));
+}
+
+TEST(ConfigurationCsl, decode_ShouldNotLimit_WhenMaxLengthIsZero) {
+	LONGS_EQUAL(0, ocpp_conf_get_int(OCPP_CONF_MeterValuesSampledDataMaxLength));
+	LONGS_EQUAL(22, decode("MeterValuesSampledData",
+			"Current.Export,Current.Import,Current.Offered,"
+			"Energy.Active.Export.Register,Energy.Active.Import.Register,"
+			"Energy.Reactive.Export.Register,Energy.Reactive.Import.Register,"
+			"Energy.Active.Export.Interval,Energy.Active.Import.Interval,"
+			"Energy.Reactive.Export.Interval,Energy.Reactive.Import.Interval,"
+			"Frequency,Power.Active.Export,Power.Active.Import,"
+			"Power.Factor,Power.Offered,Power.Reactive.Export,"
+			"Power.Reactive.Import,RPM,SoC,Temperature,Voltage", &mask));
+	LONGS_EQUAL(0x3fffff, mask);
+}
+
+TEST(ConfigurationCsl, encode_ShouldWriteNamesInBitOrder) {
+	LONGS_EQUAL(32, ocpp_encode_configuration_csl("SupportedFeatureProfiles",
+			OCPP_PROFILE_REMOTE_TRIGGER | OCPP_PROFILE_FW_MGMT,
+			buf, sizeof(buf)));
+	STRCMP_EQUAL("FirmwareManagement,RemoteTrigger", buf);
+}
+
+TEST(ConfigurationCsl, encode_ShouldWriteEmptyString_WhenNoBitSet) {
+	LONGS_EQUAL(0, ocpp_encode_configuration_csl("MeterValuesSampledData",
+			0, buf, sizeof(buf)));
+	STRCMP_EQUAL("", buf);
+}
+
+TEST(ConfigurationCsl, encode_ShouldReturnENOBUFS_WhenBufferTooSmall) {
+	LONGS_EQUAL(-ENOBUFS, ocpp_encode_configuration_csl(
+			"MeterValuesSampledData", OCPP_MEASURAND_VOLTAGE, buf, 7));
+	LONGS_EQUAL(7, ocpp_encode_configuration_csl(
+			"MeterValuesSampledData", OCPP_MEASURAND_VOLTAGE, buf, 8));
+}
+
+TEST(ConfigurationCsl, ShouldRoundTripEveryMember) {
+	for (int bit = 0; bit < 22; bit++) {
+		ocpp_encode_configuration_csl("MeterValuesSampledData",
+				1 << bit, buf, sizeof(buf));
+		LONGS_EQUAL(1, decode("MeterValuesSampledData", buf, &mask));
+		LONGS_EQUAL(1 << bit, mask);
+	}
+	for (int bit = 0; bit < 6; bit++) {
+		ocpp_encode_configuration_csl("SupportedFeatureProfiles",
+				1 << bit, buf, sizeof(buf));
+		LONGS_EQUAL(1, decode("SupportedFeatureProfiles", buf, &mask));
+		LONGS_EQUAL(1 << bit, mask);
+	}
+}
@@ -0,0 +1,213 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+#include "ocpp/core/configuration_json.h"
+#include "ocpp/overrides.h"
+#include <errno.h>
+#include <string.h>
+
+int ocpp_configuration_lock(void) {
+	return 0;
+}
+int ocpp_configuration_unlock(void) {
+	return 0;
+}
+
+static int export_all(char *buf, size_t bufsize, size_t chunksize) {
+	struct ocpp_configuration_json_writer writer = { 0, };
+	size_t len = 0;
+	int rc;
+
+	while ((rc = ocpp_export_configuration_json(&writer,
+			&buf[len], chunksize)) > 0) {
+		len += (size_t)rc;
+		if (len + chunksize >= bufsize) {
+			return -ENOBUFS;
+		}
+	}
+
+	buf[len] = '\0';
+	return rc < 0? rc : (int)len;
+}
+
+TEST_GROUP(ConfigurationJson) {
+	char buf[8192];
+
+	void setup(void) {
+		ocpp_reset_configuration();
+	}
+	void teardown(void) {
+		ocpp_unregister_configurations();
+
+		mock().checkExpectations();
+		mock().clear();
+	}
+};
+
+TEST(ConfigurationJson, export_ShouldWriteKeyValueArray) {
+	LONGS_EQUAL(true, export_all(buf, sizeof(buf), sizeof(buf) / 2) > 0);
+
+	LONGS_EQUAL('[', buf[0]);
+	LONGS_EQUAL(']', buf[strlen(buf) - 1]);
+	CHECK(strstr(buf, "{\"key\":\"HeartbeatInterval\","
+			"\"readonly\":false,\"value\":\"1800\"}") != NULL);
+	CHECK(strstr(buf, "{\"key\":\"LocalPreAuthorize\","
+			"\"readonly\":false,\"value\":false}") != NULL);
+	CHECK(strstr(buf, "{\"key\":\"ChargeProfileMaxStackLevel\","
+			"\"readonly\":true,\"value\":\"0\"}") != NULL);
+}
+
+TEST(ConfigurationJson, export_ShouldSkipWriteOnlyKeys) {
+	export_all(buf, sizeof(buf), sizeof(buf) / 2);
+	POINTERS_EQUAL(NULL, strstr(buf, "AuthorizationKey"));
+}
+
+TEST(ConfigurationJson, export_ShouldEscapeStrings) {
+	ocpp_conf_set_str(OCPP_CONF_CpoName, "a\"b\\c\n");
+	export_all(buf, sizeof(buf), sizeof(buf) / 2);
+	CHECK(strstr(buf, "\"value\":\"a\\\"b\\\\c\\u000a\"") != NULL);
+}
+
+TEST(ConfigurationJson, export_ShouldWriteTheSame_WhenSplitIntoChunks) {
+	char chunked[sizeof(buf)];
+	int len = export_all(buf, sizeof(buf), sizeof(buf) / 2);
+
+	LONGS_EQUAL(len, export_all(chunked, sizeof(chunked), 7));
+	STRCMP_EQUAL(buf, chunked);
+	LONGS_EQUAL(len, export_all(chunked, sizeof(chunked), 1));
+	STRCMP_EQUAL(buf, chunked);
+}
+
+TEST(ConfigurationJson, export_ShouldReturnESTALE_WhenKeyChangedInTheMiddle) {
+	struct ocpp_configuration_json_writer writer = { 0, };
+
+	LONGS_EQUAL(3, ocpp_export_configuration_json(&writer, buf, 3));
+	ocpp_conf_set_int(OCPP_CONF_HeartbeatInterval, 60);
+	LONGS_EQUAL(-ESTALE, ocpp_export_configuration_json(&writer, buf, 3));
+}
+
+TEST(ConfigurationJson, export_ShouldReturnEINVAL_WhenNoBufferGiven) {
+	struct ocpp_configuration_json_writer writer = { 0, };
+	LONGS_EQUAL(-EINVAL, ocpp_export_configuration_json(&writer, buf, 0));
+}
+
+TEST(ConfigurationJson, import_ShouldRestoreExportedValues) {
+	struct ocpp_configuration_json_reader reader = { 0, };
+	int len;
+
+	ocpp_conf_set_int(OCPP_CONF_HeartbeatInterval, 60);
+	ocpp_conf_set_bool(OCPP_CONF_LocalPreAuthorize, true);
+	ocpp_conf_set_str(OCPP_CONF_CpoName, "CP \"1\"");
+	len = export_all(buf, sizeof(buf), sizeof(buf) / 2);
+	ocpp_reset_configuration();
+
+	LONGS_EQUAL(0, ocpp_import_configuration_json(&reader, buf, (size_t)len));
+	LONGS_EQUAL(60, ocpp_conf_get_int(OCPP_CONF_HeartbeatInterval));
+	LONGS_EQUAL(true, ocpp_conf_get_bool(OCPP_CONF_LocalPreAuthorize));
+	ocpp_conf_get_str(OCPP_CONF_CpoName, buf, sizeof(buf));
+	STRCMP_EQUAL("CP \"1\"", buf);
+	LONGS_EQUAL(0, reader.rejected);
+}
+
+TEST(ConfigurationJson, import_ShouldParseByteByByte) {
+	const char *json = " [ {\"value\" : 120 , \"key\":\"Heartbeat\\u0049nterval\"},"
+		"\n{\"key\":\"LocalPreAuthorize\",\"readonly\":false,\"value\":\"true\"} ] ";
+	struct ocpp_configuration_json_reader reader = { 0, };
+	size_t len = strlen(json);
+
+	for (size_t i = 0; i < len - 2; i++) {
+		LONGS_EQUAL(-EAGAIN, ocpp_import_configuration_json(&reader, &json[i], 1));
+	}
+	LONGS_EQUAL(0, ocpp_import_configuration_json(&reader, &json[len - 2], 1));
+	LONGS_EQUAL(0, ocpp_import_configuration_json(&reader, &json[len - 1], 1));
+
+	LONGS_EQUAL(2, reader.applied);
+	LONGS_EQUAL(120, ocpp_conf_get_int(OCPP_CONF_HeartbeatInterval));
+	LONGS_EQUAL(true, ocpp_conf_get_bool(OCPP_CONF_LocalPreAuthorize));
+}
+
+TEST(ConfigurationJson, import_ShouldSkipUnknownAndInvalidKeys) {
+	const char *json = "[{\"key\":\"UnknownKey\",\"value\":\"1\"},"
+		"{\"key\":\"HeartbeatInterval\",\"value\":\"abc\"},"
+		"{\"key\":\"LocalPreAuthorize\",\"value\":1},"
+		"{\"key\":\"ConnectionTimeOut\",\"value\":30}]";
+	struct ocpp_configuration_json_reader reader = { 0, };
+
+	LONGS_EQUAL(0, ocpp_import_configuration_json(&reader, json, strlen(json)));
+	LONGS_EQUAL(1, reader.applied);
+	LONGS_EQUAL(3, reader.rejected);
+	LONGS_EQUAL(1800, ocpp_conf_get_int(OCPP_CONF_HeartbeatInterval));
+	LONGS_EQUAL(30, ocpp_conf_get_int(OCPP_CONF_ConnectionTimeOut));
+}
+
+TEST(ConfigurationJson, import_ShouldRejectTooLongString) {
+	struct ocpp_configuration_json_reader reader = { 0, };
+	const char *head = "[{\"key\":\"CpoName\",\"value\":\"";
+	const char *tail = "\"}]";
+	char value[300];
+
+	memset(value, 'a', sizeof(value));
+	ocpp_import_configuration_json(&reader, head, strlen(head));
+	ocpp_import_configuration_json(&reader, value, sizeof(value));
+	LONGS_EQUAL(0, ocpp_import_configuration_json(&reader, tail, strlen(tail)));
+	LONGS_EQUAL(1, reader.rejected);
+}
+
+TEST(ConfigurationJson, import_ShouldReturnEBADMSG_WhenMalformed) {
+	struct ocpp_configuration_json_reader reader = { 0, };
+	const char *json = "[{\"key\" \"HeartbeatInterval\"}]";
+
+	LONGS_EQUAL(-EBADMSG, ocpp_import_configuration_json(&reader, json, strlen(json)));
+	LONGS_EQUAL(-EBADMSG, ocpp_import_configuration_json(&reader, "]", 1));
+}
+
+TEST(ConfigurationJson, import_ShouldReturnEBADMSG_WhenTrailingGarbage) {
+	struct ocpp_configuration_json_reader reader = { 0, };
+	LONGS_EQUAL(0, ocpp_import_configuration_json(&reader, "[]", 2));
+	LONGS_EQUAL(-EBADMSG, ocpp_import_configuration_json(&reader, "[", 1));
+}
+
+TEST(ConfigurationJson, ShouldExportAndImportRegisteredKeys) {
+	struct ocpp_configuration_json_reader reader = { 0, };
+	const int level = 3;
+	int value = 0;
+	int len;
+
+	ocpp_register_configuration("VendorLevel",
+			OCPP_CONF_TYPE_INT, 0, OCPP_CONF_ACCESS_RW, &level);
+	ocpp_register_configuration("VendorSerial",
+			OCPP_CONF_TYPE_STR, 16, OCPP_CONF_ACCESS_R, "SN1");
+	len = export_all(buf, sizeof(buf), sizeof(buf) / 2);
+
+	CHECK(strstr(buf, "{\"key\":\"VendorLevel\","
+			"\"readonly\":false,\"value\":\"3\"}") != NULL);
+	CHECK(strstr(buf, "{\"key\":\"VendorSerial\","
+			"\"readonly\":true,\"value\":\"SN1\"}") != NULL);
+
+	const char *json = "[{\"key\":\"VendorLevel\",\"value\":7},"
+		"{\"key\":\"VendorSerial\",\"value\":\"SN2\"}]";
+	LONGS_EQUAL(0, ocpp_import_configuration_json(&reader, json, strlen(json)));
+	LONGS_EQUAL(1, reader.applied);
+	LONGS_EQUAL(1, reader.rejected);
+	ocpp_get_configuration("VendorLevel", &value, sizeof(value), NULL);
+	LONGS_EQUAL(7, value);
+	CHECK(len > 0);
+}
+
+TEST(ConfigurationJson, ShouldWriteAndReadCslAsNames) {
+	struct ocpp_configuration_json_reader reader = { 0, };
+
+	export_all(buf, sizeof(buf), sizeof(buf) / 2);
+	CHECK(strstr(buf, "{\"key\":\"MeterValuesSampledData\","
+			"\"readonly\":false,"
+			"\"value\":\"Energy.Active.Import.Register\"}") != NULL);
+
+	const char *json = "[{\"key\":\"MeterValuesSampledData\","
+		"\"value\":\"Voltage,SoC\"},"
+		"{\"key\":\"StopTxnSampledData\",\"value\":\"Volt\"}]";
+	LONGS_EQUAL(0, ocpp_import_configuration_json(&reader, json, strlen(json)));
+	LONGS_EQUAL(1, reader.applied);
+	LONGS_EQUAL(1, reader.rejected);
+	LONGS_EQUAL(OCPP_MEASURAND_VOLTAGE | OCPP_MEASURAND_SOC,
+			ocpp_conf_get_csl(OCPP_CONF_MeterValuesSampledData));
+}
@@ -0,0 +1,238 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+#include "ocpp/core/configuration_store.h"
+#include "ocpp/overrides.h"
+#include <errno.h>
+#include <string.h>
+
+#define SECTOR_SIZE		OCPP_CONFIGURATION_STORE_SECTOR_SIZE
+
+/* NOR flash emulator: programming only clears bits. */
+static uint8_t flash[SECTOR_SIZE * 2];
+static size_t bytes_written;
+static size_t write_budget;
+static int erase_count[2];
+
+int ocpp_configuration_lock(void) {
+	return 0;
+}
+int ocpp_configuration_unlock(void) {
+	return 0;
+}
+
+int ocpp_configuration_storage_read(size_t offset, void *buf, size_t bufsize) {
+	if (offset + bufsize > sizeof(flash)) {
+		return -EFAULT;
+	}
+	memcpy(buf, &flash[offset], bufsize);
+	return 0;
+}
+
+int ocpp_configuration_storage_write(size_t offset,
+		const void *data, size_t datasize) {
+	const uint8_t *p = (const uint8_t *)data;
+
+	CHECK((offset % OCPP_CONFIGURATION_STORE_ALIGN) == 0);
+	CHECK((datasize % OCPP_CONFIGURATION_STORE_ALIGN) == 0);
+	CHECK(offset + datasize <= sizeof(flash));
+
+	for (size_t i = 0; i < datasize; i++) {
+		if (write_budget == 0) {
+			return -EIO;
+		}
+		write_budget--;
+		LONGS_EQUAL(0xff, flash[offset + i]);
+		flash[offset + i] &= p[i];
+	}
+
+	bytes_written += datasize;
+	return 0;
+}
+
+int ocpp_configuration_storage_erase(size_t offset, size_t size) {
+	LONGS_EQUAL(0, offset % SECTOR_SIZE);
+	LONGS_EQUAL(SECTOR_SIZE, size);
+	memset(&flash[offset], 0xff, size);
+	erase_count[offset / SECTOR_SIZE]++;
+	return 0;
+}
+
+TEST_GROUP(ConfigurationStore) {
+	void setup(void) {
+		memset(flash, 0xff, sizeof(flash));
+		memset(erase_count, 0, sizeof(erase_count));
+		bytes_written = 0;
+		write_budget = sizeof(flash) * 1000;
+
+		ocpp_load_configuration();
+	}
+	void teardown(void) {
+		ocpp_unregister_configurations();
+		mock().checkExpectations();
+		mock().clear();
+	}
+
+	void reboot(void) {
+		ocpp_conf_set_int(OCPP_CONF_HeartbeatInterval, 12345);
+		LONGS_EQUAL(0, ocpp_load_configuration());
+	}
+};
+
+TEST(ConfigurationStore, load_ShouldReturnENOENT_WhenNothingSaved) {
+	LONGS_EQUAL(-ENOENT, ocpp_load_configuration());
+	LONGS_EQUAL(1800, ocpp_conf_get_int(OCPP_CONF_HeartbeatInterval));
+}
+
+TEST(ConfigurationStore, load_ShouldRestoreSavedValues) {
+	ocpp_conf_set_int(OCPP_CONF_HeartbeatInterval, 60);
+	ocpp_conf_set_bool(OCPP_CONF_LocalPreAuthorize, true);
+	ocpp_conf_set_str(OCPP_CONF_CpoName, "pazzk");
+	LONGS_EQUAL(0, ocpp_save_configuration());
+
+	reboot();
+
+	char buf[64];
+	LONGS_EQUAL(60, ocpp_conf_get_int(OCPP_CONF_HeartbeatInterval));
+	LONGS_EQUAL(true, ocpp_conf_get_bool(OCPP_CONF_LocalPreAuthorize));
+	ocpp_conf_get_str(OCPP_CONF_CpoName, buf, sizeof(buf));
+	STRCMP_EQUAL("pazzk", buf);
+	LONGS_EQUAL(false, ocpp_is_configuration_dirty(OCPP_CONF_HeartbeatInterval));
+}
+
+TEST(ConfigurationStore, load_ShouldRestoreSavedValues_WhenKeyRegisteredAfterSave) {
+	ocpp_conf_set_int(OCPP_CONF_HeartbeatInterval, 42);
+	LONGS_EQUAL(0, ocpp_save_configuration());
+
+	const int value = 7;
+	LONGS_EQUAL(0, ocpp_register_configuration("VendorKey",
+			OCPP_CONF_TYPE_INT, 0, OCPP_CONF_ACCESS_RW, &value));
+	reboot();
+
+	LONGS_EQUAL(42, ocpp_conf_get_int(OCPP_CONF_HeartbeatInterval));
+}
+
+TEST(ConfigurationStore, save_ShouldAppendOnlyChangedKeys) {
+	ocpp_conf_set_int(OCPP_CONF_ConnectionTimeOut, 60);
+	LONGS_EQUAL(0, ocpp_save_configuration());
+	bytes_written = 0;
+
+	ocpp_conf_set_int(OCPP_CONF_HeartbeatInterval, 60);
+	LONGS_EQUAL(0, ocpp_save_configuration());
+
+	/* record header, key, size and an int */
+	LONGS_EQUAL(16, bytes_written);
+	LONGS_EQUAL(1, erase_count[0] + erase_count[1]);
+}
+
+TEST(ConfigurationStore, save_ShouldWriteOnlyNonDefaultValues_WhenStartingLog) {
+	ocpp_conf_set_int(OCPP_CONF_HeartbeatInterval, 60);
+	LONGS_EQUAL(0, ocpp_save_configuration());
+
+	/* sector header and a record of an int */
+	LONGS_EQUAL(16 + 16, bytes_written);
+}
+
+TEST(ConfigurationStore, save_ShouldWriteTransactionAsSingleRecord) {
+	struct ocpp_configuration_transaction tx;
+	const int interval = 60;
+	const int timeout = 30;
+
+	ocpp_conf_set_int(OCPP_CONF_BlinkRepeat, 1);
+	LONGS_EQUAL(0, ocpp_save_configuration());
+	bytes_written = 0;
+
+	ocpp_begin_configuration_transaction(&tx);
+	ocpp_stage_configuration(&tx, "HeartbeatInterval", &interval, sizeof(interval));
+	ocpp_stage_configuration(&tx, "ConnectionTimeOut", &timeout, sizeof(timeout));
+	LONGS_EQUAL(0, ocpp_commit_configuration_transaction(&tx));
+	LONGS_EQUAL(0, ocpp_save_configuration());
+
+	/* a record header and two int entries */
+	LONGS_EQUAL(24, bytes_written);
+	reboot();
+	LONGS_EQUAL(60, ocpp_conf_get_int(OCPP_CONF_HeartbeatInterval));
+	LONGS_EQUAL(30, ocpp_conf_get_int(OCPP_CONF_ConnectionTimeOut));
+}
+
+TEST(ConfigurationStore, save_ShouldNotWrite_WhenNothingChanged) {
+	ocpp_conf_set_int(OCPP_CONF_ConnectionTimeOut, 60);
+	LONGS_EQUAL(0, ocpp_save_configuration());
+	bytes_written = 0;
+	LONGS_EQUAL(0, ocpp_save_configuration());
+	LONGS_EQUAL(0, bytes_written);
+}
+
+TEST(ConfigurationStore, save_ShouldAlternateSectors_WhenFull) {
+	for (int i = 0; i < 1000; i++) {
+		ocpp_conf_set_int(OCPP_CONF_HeartbeatInterval, i);
+		LONGS_EQUAL(0, ocpp_save_configuration());
+	}
+
+	CHECK(erase_count[0] > 1);
+	CHECK(erase_count[0] - erase_count[1] <= 1);
+	CHECK(erase_count[1] - erase_count[0] <= 1);
+
+	reboot();
+	LONGS_EQUAL(999, ocpp_conf_get_int(OCPP_CONF_HeartbeatInterval));
+}
+
+TEST(ConfigurationStore, load_ShouldKeepPrevious_WhenRecordTorn) {
+	ocpp_conf_set_int(OCPP_CONF_HeartbeatInterval, 60);
+	LONGS_EQUAL(0, ocpp_save_configuration());
+
+	ocpp_conf_set_int(OCPP_CONF_HeartbeatInterval, 70);
+	ocpp_conf_set_int(OCPP_CONF_ConnectionTimeOut, 70);
+	write_budget = 10;
+	CHECK(ocpp_save_configuration() != 0);
+	write_budget = sizeof(flash);
+
+	reboot();
+	LONGS_EQUAL(60, ocpp_conf_get_int(OCPP_CONF_HeartbeatInterval));
+	LONGS_EQUAL(180, ocpp_conf_get_int(OCPP_CONF_ConnectionTimeOut));
+
+	/* the log continues in the other sector */
+	ocpp_conf_set_int(OCPP_CONF_HeartbeatInterval, 80);
+	LONGS_EQUAL(0, ocpp_save_configuration());
+	reboot();
+	LONGS_EQUAL(80, ocpp_conf_get_int(OCPP_CONF_HeartbeatInterval));
+}
+
+TEST(ConfigurationStore, load_ShouldKeepPrevious_WhenCompactionTorn) {
+	int last = 0;
+
+	ocpp_conf_set_int(OCPP_CONF_HeartbeatInterval, last);
+	LONGS_EQUAL(0, ocpp_save_configuration());
+
+	for (int i = 1; i < 1000; i++) {
+		ocpp_conf_set_int(OCPP_CONF_HeartbeatInterval, i);
+		write_budget = 64;
+		if (ocpp_save_configuration() != 0) {
+			break;
+		}
+		last = i;
+	}
+
+	CHECK(last > 1);
+	write_budget = sizeof(flash);
+	reboot();
+	LONGS_EQUAL(last, ocpp_conf_get_int(OCPP_CONF_HeartbeatInterval));
+}
+
+TEST(ConfigurationStore, load_ShouldIgnoreCorruptedRecord) {
+	ocpp_conf_set_int(OCPP_CONF_HeartbeatInterval, 60);
+	LONGS_EQUAL(0, ocpp_save_configuration());
+	ocpp_conf_set_int(OCPP_CONF_HeartbeatInterval, 70);
+	LONGS_EQUAL(0, ocpp_save_configuration());
+
+	const int value = 70;
+	for (size_t i = sizeof(flash) - sizeof(value); i-- > 0;) {
+		if (memcmp(&flash[i], &value, sizeof(value)) == 0) {
+			flash[i] ^= 0x01;
+			break;
+		}
+	}
+
+	reboot();
+	LONGS_EQUAL(60, ocpp_conf_get_int(OCPP_CONF_HeartbeatInterval));
+}
@@ -4,8 +4,13 @@
 #include "ocpp/core/configuration.h"
 #include "ocpp/overrides.h"
 #include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+static int nr_locks;
 
 int ocpp_configuration_lock(void) {
+	nr_locks++;
 	return 0;
 }
 int ocpp_configuration_unlock(void) {
@@ -17,6 +22,8 @@ TEST_GROUP(Configuration) {
 		ocpp_reset_configuration();
 	}
 	void teardown(void) {
+		ocpp_unregister_configurations();
+
 		mock().checkExpectations();
 		mock().clear();
 	}
@@ -24,7 +31,7 @@ TEST_GROUP(Configuration) {
 
 TEST(Configuration, reset_ShouldSetTheDefaultValues) {
 	int connTimeout;
-	int authRemoteTxReq;
+	bool authRemoteTxReq;
 	int blink;
 
 	ocpp_get_configuration("ConnectionTimeOut", &connTimeout, sizeof(connTimeout), NULL);
@@ -124,3 +131,480 @@ TEST(Configuration, get_keystr_ShouldReturnKeyString_WhenKnownKeyGiven) {
 TEST(Configuration, get_keystr_ShouldReturnUnknownKeyString_WhenUnknownKeyGiven) {
 	STRCMP_EQUAL(NULL, ocpp_get_configuration_keystr_from_index(-1));
 }
+
+TEST(Configuration, has_configuration_ShouldFindEveryKey_WhenIndexedByHash) {
+	for (int i = 0; i < (int)ocpp_count_configurations(); i++) {
+		const char *keystr = ocpp_get_configuration_keystr_from_index(i);
+		LONGS_EQUAL(true, ocpp_has_configuration(keystr));
+	}
+	LONGS_EQUAL(false, ocpp_has_configuration(""));
+	LONGS_EQUAL(false, ocpp_has_configuration("heartbeatInterval"));
+}
+
+TEST(Configuration, conf_get_ShouldReturnTypedValue_WhenKeyGiven) {
+	char buf[8];
+	LONGS_EQUAL(1800, ocpp_conf_get_int(OCPP_CONF_HeartbeatInterval));
+	LONGS_EQUAL(true, ocpp_conf_get_bool(OCPP_CONF_AuthorizeRemoteTxRequests));
+	LONGS_EQUAL(OCPP_MEASURAND_ENERGY_ACTIVE_IMPORT_REGISTER, ocpp_conf_get_csl(OCPP_CONF_MeterValuesSampledData));
+	LONGS_EQUAL(6, ocpp_conf_get_str(OCPP_CONF_CpoName, buf, sizeof(buf)));
+	STRCMP_EQUAL("libmcu", buf);
+	LONGS_EQUAL(3, ocpp_conf_get_str(OCPP_CONF_CpoName, buf, 4));
+	STRCMP_EQUAL("lib", buf);
+}
+
+TEST(Configuration, conf_get_ShouldReturnZero_WhenTypeMismatches) {
+	char buf[8] = "garbage";
+	LONGS_EQUAL(0, ocpp_conf_get_int(OCPP_CONF_AuthorizeRemoteTxRequests));
+	LONGS_EQUAL(false, ocpp_conf_get_bool(OCPP_CONF_HeartbeatInterval));
+	LONGS_EQUAL(0, ocpp_conf_get_csl(OCPP_CONF_MAX));
+	LONGS_EQUAL(0, ocpp_conf_get_str(OCPP_CONF_HeartbeatInterval, buf, sizeof(buf)));
+	STRCMP_EQUAL("", buf);
+}
+
+TEST(Configuration, conf_set_ShouldSetTheValue_WhenReadOnlyKeyGiven) {
+	LONGS_EQUAL(0, ocpp_conf_set_int(OCPP_CONF_NumberOfConnectors, 2));
+	LONGS_EQUAL(2, ocpp_conf_get_int(OCPP_CONF_NumberOfConnectors));
+	LONGS_EQUAL(-EINVAL, ocpp_conf_set_bool(OCPP_CONF_NumberOfConnectors, true));
+}
+
+TEST(Configuration, conf_set_str_ShouldClearTheRest_WhenShorterStringGiven) {
+	char buf[16];
+	LONGS_EQUAL(0, ocpp_conf_set_str(OCPP_CONF_CpoName, "ab"));
+	ocpp_get_configuration("CpoName", buf, sizeof(buf), NULL);
+	STRCMP_EQUAL("ab", buf);
+	LONGS_EQUAL(-EINVAL, ocpp_conf_set_str(OCPP_CONF_CpoName,
+			"01234567890123456789012345678901234567890123456789012345678901234"));
+}
+
+TEST(Configuration, conf_from_keystr_ShouldReturnTheKey) {
+	LONGS_EQUAL(OCPP_CONF_HeartbeatInterval, ocpp_conf_from_keystr("HeartbeatInterval"));
+	LONGS_EQUAL(OCPP_CONF_MAX, ocpp_conf_from_keystr("UnknownKey"));
+}
+
+TEST(Configuration, generation_ShouldChange_WhenConfigurationChanged) {
+	uint32_t generation = ocpp_get_configuration_generation();
+	int value = 10;
+
+	ocpp_get_configuration("HeartbeatInterval", &value, sizeof(value), NULL);
+	LONGS_EQUAL(generation, ocpp_get_configuration_generation());
+	LONGS_EQUAL(-EPERM, ocpp_set_configuration("NumberOfConnectors", &value, sizeof(value)));
+	LONGS_EQUAL(generation, ocpp_get_configuration_generation());
+
+	value = 10;
+	ocpp_set_configuration("HeartbeatInterval", &value, sizeof(value));
+	LONGS_EQUAL(generation + 1, ocpp_get_configuration_generation());
+	ocpp_set_configuration("HeartbeatInterval", &value, sizeof(value));
+	LONGS_EQUAL(generation + 1, ocpp_get_configuration_generation());
+	ocpp_conf_set_int(OCPP_CONF_HeartbeatInterval, 20);
+	LONGS_EQUAL(generation + 2, ocpp_get_configuration_generation());
+}
+
+static void on_configuration_changed(ocpp_configuration_t key, void *ctx) {
+	mock().actualCall(__func__).withParameter("key", key).withPointerParameter("ctx", ctx);
+}
+
+TEST(Configuration, subscribe_ShouldNotifyObserver_WhenValueChanged) {
+	int value = 60;
+	LONGS_EQUAL(0, ocpp_subscribe_configuration(OCPP_CONF_MeterValueSampleInterval, on_configuration_changed, this));
+
+	mock().expectOneCall("on_configuration_changed").withParameter("key", OCPP_CONF_MeterValueSampleInterval).withPointerParameter("ctx", this);
+	ocpp_set_configuration("MeterValueSampleInterval", &value, sizeof(value));
+	/* no notification for the same value or other keys */
+	ocpp_set_configuration("MeterValueSampleInterval", &value, sizeof(value));
+	ocpp_set_configuration("ClockAlignedDataInterval", &value, sizeof(value));
+
+	LONGS_EQUAL(0, ocpp_unsubscribe_configuration(OCPP_CONF_MeterValueSampleInterval, on_configuration_changed, this));
+	ocpp_conf_set_int(OCPP_CONF_MeterValueSampleInterval, 30);
+}
+
+TEST(Configuration, subscribe_ShouldNotifyObserverOfAnyKey_WhenMaxGiven) {
+	LONGS_EQUAL(0, ocpp_subscribe_configuration(OCPP_CONF_MAX, on_configuration_changed, NULL));
+	mock().expectOneCall("on_configuration_changed").withParameter("key", OCPP_CONF_HeartbeatInterval).withPointerParameter("ctx", NULL);
+	mock().expectOneCall("on_configuration_changed").withParameter("key", OCPP_CONF_CpoName).withPointerParameter("ctx", NULL);
+	ocpp_conf_set_int(OCPP_CONF_HeartbeatInterval, 60);
+	ocpp_conf_set_str(OCPP_CONF_CpoName, "pazzk");
+	LONGS_EQUAL(0, ocpp_unsubscribe_configuration(OCPP_CONF_MAX, on_configuration_changed, NULL));
+}
+
+TEST(Configuration, subscribe_ShouldReturnENOSPC_WhenNoRoomLeft) {
+	for (int i = 0; i < 4; i++) {
+		LONGS_EQUAL(0, ocpp_subscribe_configuration(OCPP_CONF_MAX, on_configuration_changed, (void *)(uintptr_t)(i + 1)));
+	}
+	LONGS_EQUAL(-ENOSPC, ocpp_subscribe_configuration(OCPP_CONF_MAX, on_configuration_changed, NULL));
+	for (int i = 0; i < 4; i++) {
+		LONGS_EQUAL(0, ocpp_unsubscribe_configuration(OCPP_CONF_MAX, on_configuration_changed, (void *)(uintptr_t)(i + 1)));
+	}
+	LONGS_EQUAL(-ENOENT, ocpp_unsubscribe_configuration(OCPP_CONF_MAX, on_configuration_changed, NULL));
+}
+
+TEST(Configuration, dirty_ShouldBeSet_WhenValueChanged) {
+	uint8_t pool[512];
+	LONGS_EQUAL(0, ocpp_copy_configuration_to(pool, sizeof(pool)));
+	LONGS_EQUAL(0, ocpp_copy_configuration_from(pool, ocpp_compute_configuration_size()));
+	LONGS_EQUAL(OCPP_CONF_MAX, ocpp_get_next_dirty_configuration((ocpp_configuration_t)0));
+
+	ocpp_conf_set_bool(OCPP_CONF_LocalPreAuthorize, true);
+	ocpp_conf_set_int(OCPP_CONF_SecurityProfile, 1);
+	LONGS_EQUAL(true, ocpp_is_configuration_dirty(OCPP_CONF_LocalPreAuthorize));
+	LONGS_EQUAL(false, ocpp_is_configuration_dirty(OCPP_CONF_HeartbeatInterval));
+	LONGS_EQUAL(OCPP_CONF_LocalPreAuthorize, ocpp_get_next_dirty_configuration((ocpp_configuration_t)0));
+	LONGS_EQUAL(OCPP_CONF_SecurityProfile, ocpp_get_next_dirty_configuration((ocpp_configuration_t)(OCPP_CONF_LocalPreAuthorize + 1)));
+
+	ocpp_clear_configuration_dirty(OCPP_CONF_LocalPreAuthorize);
+	ocpp_clear_configuration_dirty(OCPP_CONF_SecurityProfile);
+	LONGS_EQUAL(OCPP_CONF_MAX, ocpp_get_next_dirty_configuration((ocpp_configuration_t)0));
+}
+
+TEST(Configuration, is_default_ShouldReturnTrue_WhenValueIsDefault) {
+	LONGS_EQUAL(true, ocpp_is_configuration_default(OCPP_CONF_HeartbeatInterval));
+	LONGS_EQUAL(true, ocpp_is_configuration_default(OCPP_CONF_CpoName));
+	ocpp_conf_set_int(OCPP_CONF_HeartbeatInterval, 60);
+	LONGS_EQUAL(false, ocpp_is_configuration_default(OCPP_CONF_HeartbeatInterval));
+	ocpp_conf_set_int(OCPP_CONF_HeartbeatInterval, 1800);
+	LONGS_EQUAL(true, ocpp_is_configuration_default(OCPP_CONF_HeartbeatInterval));
+}
+
+TEST(Configuration, reset_ShouldRestoreDefaultString) {
+	char buf[64];
+	ocpp_conf_set_str(OCPP_CONF_CpoName, "pazzk");
+	ocpp_reset_configuration();
+	ocpp_conf_get_str(OCPP_CONF_CpoName, buf, sizeof(buf));
+	STRCMP_EQUAL("libmcu", buf);
+	LONGS_EQUAL(false, ocpp_is_configuration_default(OCPP_CONF_MAX));
+}
+
+struct visited {
+	int count;
+	int unknown;
+	int stop_at;
+	int heartbeat;
+	bool readonly_max_keys;
+};
+
+static int visit_key(const char *keystr, const void *value, size_t value_size,
+		ocpp_configuration_data_t type, bool readonly, void *ctx) {
+	struct visited *p = (struct visited *)ctx;
+
+	if (value == NULL) {
+		p->unknown++;
+	} else if (strcmp(keystr, "HeartbeatInterval") == 0) {
+		LONGS_EQUAL(sizeof(int), value_size);
+		LONGS_EQUAL(OCPP_CONF_TYPE_INT, type);
+		memcpy(&p->heartbeat, value, sizeof(p->heartbeat));
+	} else if (strcmp(keystr, "GetConfigurationMaxKeys") == 0) {
+		p->readonly_max_keys = readonly;
+	}
+
+	return ++p->count == p->stop_at;
+}
+
+TEST(Configuration, visit_ShouldVisitReadableKeysUnderSingleLock_WhenNoKeysGiven) {
+	struct visited visited = { 0, };
+	nr_locks = 0;
+
+	LONGS_EQUAL(54, ocpp_visit_configurations(NULL, 0, visit_key, &visited));
+	LONGS_EQUAL(54, visited.count);
+	LONGS_EQUAL(0, visited.unknown);
+	LONGS_EQUAL(1800, visited.heartbeat);
+	LONGS_EQUAL(true, visited.readonly_max_keys);
+	LONGS_EQUAL(1, nr_locks);
+}
+
+TEST(Configuration, visit_ShouldReportUnknownKeys_WhenKeysGiven) {
+	const char *keys[] = { "HeartbeatInterval", "UnknownKey", "AuthorizationKey" };
+	struct visited visited = { 0, };
+
+	LONGS_EQUAL(3, ocpp_visit_configurations(keys, 3, visit_key, &visited));
+	LONGS_EQUAL(2, visited.unknown);
+	LONGS_EQUAL(1800, visited.heartbeat);
+}
+
+TEST(Configuration, visit_ShouldStop_WhenVisitorReturnsNonZero) {
+	struct visited visited = { 0, };
+	visited.stop_at = 3;
+	LONGS_EQUAL(3, ocpp_visit_configurations(NULL, 0, visit_key, &visited));
+}
+
+TEST(Configuration, visit_ShouldBeCappedAtGetConfigurationMaxKeys) {
+	struct visited visited = { 0, };
+	ocpp_conf_set_int(OCPP_CONF_GetConfigurationMaxKeys, 5);
+	LONGS_EQUAL(5, ocpp_visit_configurations(NULL, 0, visit_key, &visited));
+	LONGS_EQUAL(5, visited.count);
+}
+
+TEST(Configuration, visit_ShouldGiveRegisteredKeys_WhenMaxKeysLeftDefault) {
+	struct visited visited = { 0, };
+	struct visited capped = { 0, };
+
+	ocpp_register_configuration("VendorFirst",
+			OCPP_CONF_TYPE_INT, 0, OCPP_CONF_ACCESS_RW, NULL);
+	ocpp_register_configuration("VendorSecond",
+			OCPP_CONF_TYPE_BOOL, 0, OCPP_CONF_ACCESS_RW, NULL);
+
+	LONGS_EQUAL(56, ocpp_visit_configurations(NULL, 0, visit_key, &visited));
+	LONGS_EQUAL(56, visited.count);
+
+	ocpp_conf_set_int(OCPP_CONF_GetConfigurationMaxKeys, 50);
+	LONGS_EQUAL(50, ocpp_visit_configurations(NULL, 0, visit_key, &capped));
+}
+
+TEST(Configuration, visit_ShouldReturnEINVAL_WhenNoVisitorGiven) {
+	LONGS_EQUAL(-EINVAL, ocpp_visit_configurations(NULL, 0, NULL, NULL));
+}
+
+TEST(Configuration, transaction_ShouldApplyAllAtOnce_WhenCommitted) {
+	struct ocpp_configuration_transaction tx;
+	const int interval = 60;
+	const int sampled = 0x3;
+	const uint32_t generation = ocpp_get_configuration_generation();
+
+	ocpp_begin_configuration_transaction(&tx);
+	LONGS_EQUAL(0, ocpp_stage_configuration(&tx, "MeterValueSampleInterval", &interval, sizeof(interval)));
+	LONGS_EQUAL(0, ocpp_stage_configuration(&tx, "MeterValuesSampledData", &sampled, sizeof(sampled)));
+	LONGS_EQUAL(300, ocpp_conf_get_int(OCPP_CONF_MeterValueSampleInterval));
+
+	LONGS_EQUAL(0, ocpp_commit_configuration_transaction(&tx));
+	LONGS_EQUAL(60, ocpp_conf_get_int(OCPP_CONF_MeterValueSampleInterval));
+	LONGS_EQUAL(0x3, ocpp_conf_get_csl(OCPP_CONF_MeterValuesSampledData));
+	LONGS_EQUAL(generation + 1, ocpp_get_configuration_generation());
+	LONGS_EQUAL(true, ocpp_is_configuration_dirty(OCPP_CONF_MeterValueSampleInterval));
+}
+
+TEST(Configuration, transaction_ShouldApplyNothing_WhenAnyStagingFailed) {
+	struct ocpp_configuration_transaction tx;
+	const int value = 60;
+
+	ocpp_begin_configuration_transaction(&tx);
+	LONGS_EQUAL(0, ocpp_stage_configuration(&tx, "HeartbeatInterval", &value, sizeof(value)));
+	LONGS_EQUAL(-EPERM, ocpp_stage_configuration(&tx, "NumberOfConnectors", &value, sizeof(value)));
+	LONGS_EQUAL(-EINVAL, ocpp_stage_configuration(&tx, "UnknownKey", &value, sizeof(value)));
+
+	LONGS_EQUAL(-EPERM, ocpp_commit_configuration_transaction(&tx));
+	LONGS_EQUAL(1800, ocpp_conf_get_int(OCPP_CONF_HeartbeatInterval));
+}
+
+TEST(Configuration, transaction_ShouldStageReadOnlyKey_WhenStagedByKey) {
+	struct ocpp_configuration_transaction tx;
+	const int value = 2;
+
+	ocpp_begin_configuration_transaction(&tx);
+	LONGS_EQUAL(0, ocpp_conf_stage(&tx, OCPP_CONF_NumberOfConnectors, &value, sizeof(value)));
+	LONGS_EQUAL(0, ocpp_commit_configuration_transaction(&tx));
+	LONGS_EQUAL(2, ocpp_conf_get_int(OCPP_CONF_NumberOfConnectors));
+}
+
+TEST(Configuration, transaction_ShouldReturnENOSPC_WhenFull) {
+	struct ocpp_configuration_transaction tx;
+	const int value = 1;
+
+	ocpp_begin_configuration_transaction(&tx);
+	for (int i = 0; i < OCPP_CONFIGURATION_TRANSACTION_MAX; i++) {
+		LONGS_EQUAL(0, ocpp_stage_configuration(&tx, "BlinkRepeat", &value, sizeof(value)));
+	}
+	LONGS_EQUAL(-ENOSPC, ocpp_stage_configuration(&tx, "BlinkRepeat", &value, sizeof(value)));
+}
+
+TEST(Configuration, set_ShouldReturnERANGE_WhenValueOutOfRange) {
+	int value = 101;
+	LONGS_EQUAL(-ERANGE, ocpp_set_configuration("LightIntensity", &value, sizeof(value)));
+	value = -1;
+	LONGS_EQUAL(-ERANGE, ocpp_set_configuration("LightIntensity", &value, sizeof(value)));
+	value = 100;
+	LONGS_EQUAL(0, ocpp_set_configuration("LightIntensity", &value, sizeof(value)));
+	LONGS_EQUAL(100, ocpp_conf_get_int(OCPP_CONF_LightIntensity));
+}
+
+TEST(Configuration, change_ShouldReturnStatusToRespond) {
+	int value = 4;
+	LONGS_EQUAL(OCPP_CONFIG_STATUS_NOT_SUPPORTED, ocpp_change_configuration("UnknownKey", &value, sizeof(value)));
+	LONGS_EQUAL(OCPP_CONFIG_STATUS_REJECTED, ocpp_change_configuration("SecurityProfile", &value, sizeof(value)));
+	LONGS_EQUAL(OCPP_CONFIG_STATUS_REJECTED, ocpp_change_configuration("NumberOfConnectors", &value, sizeof(value)));
+	value = 2;
+	LONGS_EQUAL(OCPP_CONFIG_STATUS_ACCEPTED, ocpp_change_configuration("SecurityProfile", &value, sizeof(value)));
+	LONGS_EQUAL(2, ocpp_conf_get_int(OCPP_CONF_SecurityProfile));
+}
+
+TEST(Configuration, transaction_ShouldFailCommit_WhenValueOutOfRange) {
+	struct ocpp_configuration_transaction tx;
+	const int value = 200;
+
+	ocpp_begin_configuration_transaction(&tx);
+	LONGS_EQUAL(-ERANGE, ocpp_stage_configuration(&tx, "LightIntensity", &value, sizeof(value)));
+	LONGS_EQUAL(-ERANGE, ocpp_commit_configuration_transaction(&tx));
+}
+
+TEST(Configuration, register_ShouldAddKeyAccessibleByKeyString) {
+	const int interval = 30;
+	int value = 0;
+	bool readonly = true;
+
+	LONGS_EQUAL(0, ocpp_register_configuration("VendorInterval",
+			OCPP_CONF_TYPE_INT, 0, OCPP_CONF_ACCESS_RW, &interval));
+
+	LONGS_EQUAL(true, ocpp_has_configuration("VendorInterval"));
+	LONGS_EQUAL(56, ocpp_count_configurations());
+	LONGS_EQUAL(OCPP_CONF_TYPE_INT,
+			ocpp_get_configuration_data_type("VendorInterval"));
+	LONGS_EQUAL(sizeof(int), ocpp_get_configuration_size("VendorInterval"));
+	LONGS_EQUAL(0, ocpp_get_configuration("VendorInterval",
+			&value, sizeof(value), &readonly));
+	LONGS_EQUAL(30, value);
+	LONGS_EQUAL(false, readonly);
+
+	value = 60;
+	LONGS_EQUAL(0, ocpp_set_configuration("VendorInterval",
+			&value, sizeof(value)));
+	value = 0;
+	ocpp_get_configuration_by_index(55, &value, sizeof(value), NULL);
+	LONGS_EQUAL(60, value);
+	STRCMP_EQUAL("VendorInterval",
+			ocpp_get_configuration_keystr_from_index(55));
+	LONGS_EQUAL(OCPP_CONF_MAX, ocpp_conf_from_keystr("VendorInterval"));
+
+	ocpp_reset_configuration();
+	ocpp_get_configuration("VendorInterval", &value, sizeof(value), NULL);
+	LONGS_EQUAL(30, value);
+}
+
+TEST(Configuration, register_ShouldKeepStringDefaultAndAccess) {
+	char buf[16];
+
+	LONGS_EQUAL(0, ocpp_register_configuration("VendorName",
+			OCPP_CONF_TYPE_STR, sizeof(buf), OCPP_CONF_ACCESS_R,
+			"pazzk"));
+
+	LONGS_EQUAL(sizeof(buf), ocpp_get_configuration_size("VendorName"));
+	ocpp_get_configuration("VendorName", buf, sizeof(buf), NULL);
+	STRCMP_EQUAL("pazzk", buf);
+	LONGS_EQUAL(true, ocpp_is_configuration_readable("VendorName"));
+	LONGS_EQUAL(false, ocpp_is_configuration_writable("VendorName"));
+	LONGS_EQUAL(-EPERM, ocpp_set_configuration("VendorName", "a", 1));
+}
+
+TEST(Configuration, register_ShouldReturnEEXIST_WhenKeyExists) {
+	LONGS_EQUAL(-EEXIST, ocpp_register_configuration("HeartbeatInterval",
+			OCPP_CONF_TYPE_INT, 0, OCPP_CONF_ACCESS_RW, NULL));
+	LONGS_EQUAL(0, ocpp_register_configuration("VendorKey",
+			OCPP_CONF_TYPE_BOOL, 0, OCPP_CONF_ACCESS_RW, NULL));
+	LONGS_EQUAL(-EEXIST, ocpp_register_configuration("VendorKey",
+			OCPP_CONF_TYPE_BOOL, 0, OCPP_CONF_ACCESS_RW, NULL));
+}
+
+TEST(Configuration, register_ShouldReturnEINVAL_WhenInvalidParamsGiven) {
+	LONGS_EQUAL(-EINVAL, ocpp_register_configuration(NULL,
+			OCPP_CONF_TYPE_INT, 0, OCPP_CONF_ACCESS_RW, NULL));
+	LONGS_EQUAL(-EINVAL, ocpp_register_configuration("",
+			OCPP_CONF_TYPE_INT, 0, OCPP_CONF_ACCESS_RW, NULL));
+	LONGS_EQUAL(-EINVAL, ocpp_register_configuration("VendorKey",
+			OCPP_CONF_TYPE_UNKNOWN, 0, OCPP_CONF_ACCESS_RW, NULL));
+	LONGS_EQUAL(-EINVAL, ocpp_register_configuration("VendorKey",
+			OCPP_CONF_TYPE_STR, 0, OCPP_CONF_ACCESS_RW, NULL));
+	LONGS_EQUAL(-EINVAL, ocpp_register_configuration("VendorKey",
+			OCPP_CONF_TYPE_STR, 256, OCPP_CONF_ACCESS_RW, NULL));
+	LONGS_EQUAL(-EINVAL, ocpp_register_configuration(
+			"VendorKeyLongerThanFiftyCharactersWhichIsNotAllowed",
+			OCPP_CONF_TYPE_INT, 0, OCPP_CONF_ACCESS_RW, NULL));
+}
+
+TEST(Configuration, register_ShouldReturnENOSPC_WhenRegistryFull) {
+	struct ocpp_configuration_registry_usage usage;
+	char keystr[24];
+	int rc = 0;
+	int i;
+
+	for (i = 0; rc == 0; i++) {
+		snprintf(keystr, sizeof(keystr), "VendorKey%d", i);
+		rc = ocpp_register_configuration(keystr,
+				OCPP_CONF_TYPE_INT, 0, OCPP_CONF_ACCESS_RW, NULL);
+	}
+
+	LONGS_EQUAL(-ENOSPC, rc);
+	ocpp_get_configuration_registry_usage(&usage);
+	LONGS_EQUAL(i - 1, usage.nr_keys);
+	CHECK(usage.nr_keys == usage.max_keys ||
+			usage.arena_size - usage.arena_used < 16 + sizeof(int) * 2);
+	LONGS_EQUAL(55 + i - 1, ocpp_count_configurations());
+
+	/* every one of them is still found by the key string */
+	while (--i > 0) {
+		snprintf(keystr, sizeof(keystr), "VendorKey%d", i - 1);
+		LONGS_EQUAL(true, ocpp_has_configuration(keystr));
+	}
+	LONGS_EQUAL(true, ocpp_has_configuration("HeartbeatInterval"));
+}
+
+TEST(Configuration, has_configuration_ShouldKeepBuiltInKeys_WhenRegistryCleared) {
+	LONGS_EQUAL(0, ocpp_register_configuration("VendorOld",
+			OCPP_CONF_TYPE_INT, 0, OCPP_CONF_ACCESS_RW, NULL));
+	ocpp_unregister_configurations();
+	ocpp_reset_configuration();
+
+	LONGS_EQUAL(false, ocpp_has_configuration("VendorOld"));
+	LONGS_EQUAL(0, ocpp_register_configuration("VendorNew",
+			OCPP_CONF_TYPE_INT, 0, OCPP_CONF_ACCESS_RW, NULL));
+	LONGS_EQUAL(true, ocpp_has_configuration("VendorNew"));
+
+	for (int i = 0; i < (int)OCPP_CONF_MAX; i++) {
+		const char *keystr = ocpp_get_configuration_keystr_from_index(i);
+		LONGS_EQUAL(true, ocpp_has_configuration(keystr));
+	}
+}
+
+TEST(Configuration, usage_ShouldReportArenaUsed) {
+	struct ocpp_configuration_registry_usage usage;
+
+	ocpp_get_configuration_registry_usage(&usage);
+	LONGS_EQUAL(0, usage.nr_keys);
+	LONGS_EQUAL(0, usage.arena_used);
+	CHECK(usage.max_keys > 0);
+	CHECK(usage.arena_size > 0);
+
+	ocpp_register_configuration("VendorFlag",
+			OCPP_CONF_TYPE_BOOL, 0, OCPP_CONF_ACCESS_RW, NULL);
+	ocpp_get_configuration_registry_usage(&usage);
+	LONGS_EQUAL(1, usage.nr_keys);
+	LONGS_EQUAL(sizeof("VendorFlag") + sizeof(bool) * 2, usage.arena_used);
+}
+
+static int count_visited(const char *keystr, const void *value,
+		size_t value_size, ocpp_configuration_data_t type,
+		bool readonly, void *ctx) {
+	(void)value;
+	(void)value_size;
+	(void)type;
+	(void)readonly;
+	if (strcmp(keystr, "VendorFlag") == 0) {
+		(*(int *)ctx)++;
+	}
+	return 0;
+}
+
+TEST(Configuration, visit_ShouldIncludeRegisteredKeys) {
+	int found = 0;
+
+	ocpp_register_configuration("VendorFlag",
+			OCPP_CONF_TYPE_BOOL, 0, OCPP_CONF_ACCESS_RW, NULL);
+	ocpp_visit_configurations(NULL, 0, count_visited, &found);
+	LONGS_EQUAL(1, found);
+}
+
+TEST(Configuration, connector_ShouldReadSharedValue_WhenKeyNotPerConnector) {
+	ocpp_conf_set_int(OCPP_CONF_HeartbeatInterval, 60);
+
+	LONGS_EQUAL(1, ocpp_count_configuration_connectors("HeartbeatInterval"));
+	LONGS_EQUAL(60, ocpp_conf_get_int_at(OCPP_CONF_HeartbeatInterval,
+			OCPP_CONNECTOR_MAX));
+	LONGS_EQUAL(-EINVAL, ocpp_conf_set_int_at(OCPP_CONF_HeartbeatInterval,
+			OCPP_CONNECTOR_MAX, 30));
+	LONGS_EQUAL(60, ocpp_conf_get_int(OCPP_CONF_HeartbeatInterval));
+}
+
+TEST(Configuration, connector_ShouldReturnZero_WhenConnectorOutOfRange) {
+	LONGS_EQUAL(-EINVAL, ocpp_conf_set_csl_at(
+			OCPP_CONF_ConnectorPhaseRotation, OCPP_CONNECTOR_MAX + 1, 1));
+	LONGS_EQUAL(-EINVAL, ocpp_conf_set_csl_at(
+			OCPP_CONF_ConnectorPhaseRotation, -1, 1));
+	LONGS_EQUAL(0, ocpp_conf_get_csl_at(
+			OCPP_CONF_ConnectorPhaseRotation, OCPP_CONNECTOR_MAX + 1));
+	LONGS_EQUAL(0, ocpp_count_configuration_connectors("UnknownKey"));
+}
@@ -6,6 +6,7 @@
 #include <errno.h>
 #include <time.h>
 #include <stdlib.h>
+#include <string.h>
 
 static struct {
 	uint8_t message_id[OCPP_MESSAGE_ID_MAXLEN];
@@ -49,6 +50,11 @@ int ocpp_configuration_unlock(void) {
 	return 0;
 }
 
+ocpp_message_t ocpp_get_relayed_type_from_idstr(const char *idstr) {
+	return strcmp(idstr, "relayed") == 0?
+		OCPP_MSG_DATA_TRANSFER : OCPP_MSG_MAX;
+}
+
 void ocpp_generate_message_id(void *buf, size_t bufsize)
 {
 	char *p = (char *)buf;
@@ -231,3 +237,88 @@ TEST(Core, t) {
 	step(0);
 	check_tx(OCPP_MSG_ROLE_CALL, OCPP_MSG_BOOTNOTIFICATION);
 }
+
+TEST(Core, get_type_from_string_ShouldReturnType_WhenKnownActionGiven) {
+	for (int i = 0; i < OCPP_MSG_MAX; i++) {
+		ocpp_message_t type = (ocpp_message_t)i;
+		LONGS_EQUAL(type, ocpp_get_type_from_string(ocpp_stringify_type(type)));
+	}
+}
+
+TEST(Core, get_type_from_string_ShouldReturnMax_WhenUnknownActionGiven) {
+	LONGS_EQUAL(OCPP_MSG_MAX, ocpp_get_type_from_string(""));
+	LONGS_EQUAL(OCPP_MSG_MAX, ocpp_get_type_from_string("Heart"));
+	LONGS_EQUAL(OCPP_MSG_MAX, ocpp_get_type_from_string("heartbeat"));
+	LONGS_EQUAL(OCPP_MSG_MAX, ocpp_get_type_from_string("HeartbeaT"));
+	LONGS_EQUAL(OCPP_MSG_MAX, ocpp_get_type_from_string("Authorizes"));
+	LONGS_EQUAL(OCPP_MSG_MAX, ocpp_get_type_from_string("CxxxxxxxxxxxxxxxX"));
+	LONGS_EQUAL(OCPP_MSG_MAX, ocpp_get_type_from_string("UnknownMessage"));
+}
+
+TEST(Core, get_type_from_idstr_ShouldAskRelayedType_WhenNotPending) {
+	LONGS_EQUAL(OCPP_MSG_DATA_TRANSFER, ocpp_get_type_from_idstr("relayed"));
+	LONGS_EQUAL(OCPP_MSG_MAX, ocpp_get_type_from_idstr("unknown"));
+}
+
+TEST(Core, ShouldAnswerRetransmittedRequest_WithCachedResponse) {
+	struct ocpp_message req = {
+		.id = "retransmitted",
+		.role = OCPP_MSG_ROLE_CALL,
+		.type = OCPP_MSG_CHANGE_CONFIGURATION,
+	};
+	struct ocpp_ChangeConfiguration_conf conf = {
+		.status = OCPP_CONFIG_STATUS_ACCEPTED,
+	};
+
+	mock().expectOneCall("ocpp_recv").withOutputParameterReturning("msg", &req, sizeof(req));
+	mock().expectOneCall("on_ocpp_event").withParameter("event_type", OCPP_EVENT_MESSAGE_INCOMING);
+	step(0);
+
+	LONGS_EQUAL(0, ocpp_push_response(&req, &conf, sizeof(conf), false));
+	mock().expectOneCall("ocpp_recv").ignoreOtherParameters().andReturnValue(-ENOMSG);
+	mock().expectOneCall("ocpp_send").andReturnValue(0);
+	mock().expectOneCall("on_ocpp_event").withParameter("event_type", OCPP_EVENT_MESSAGE_FREE);
+	step(1);
+	check_tx(OCPP_MSG_ROLE_CALLRESULT, OCPP_MSG_CHANGE_CONFIGURATION);
+
+	memset(&sent, 0, sizeof(sent));
+	mock().expectOneCall("ocpp_recv").withOutputParameterReturning("msg", &req, sizeof(req));
+	mock().expectOneCall("ocpp_send").andReturnValue(0);
+	step(2);
+	check_tx(OCPP_MSG_ROLE_CALLRESULT, OCPP_MSG_CHANGE_CONFIGURATION);
+	STRCMP_EQUAL("retransmitted", (const char *)sent.message_id);
+}
+
+TEST(Core, ShouldDropRetransmittedRequest_WhenStillBeingHandled) {
+	struct ocpp_message req = {
+		.id = "pending",
+		.role = OCPP_MSG_ROLE_CALL,
+		.type = OCPP_MSG_REMOTE_START_TRANSACTION,
+	};
+
+	mock().expectOneCall("ocpp_recv").withOutputParameterReturning("msg", &req, sizeof(req));
+	mock().expectOneCall("on_ocpp_event").withParameter("event_type", OCPP_EVENT_MESSAGE_INCOMING);
+	step(0);
+	mock().expectOneCall("ocpp_recv").withOutputParameterReturning("msg", &req, sizeof(req));
+	step(1);
+}
+
+TEST(Core, ShouldEvictLeastRecentlyUsedResponse_WhenCacheIsFull) {
+	struct ocpp_message req = {
+		.role = OCPP_MSG_ROLE_CALL,
+		.type = OCPP_MSG_RESET,
+	};
+
+	for (int i = 0; i <= OCPP_RESPONSE_CACHE_LEN; i++) {
+		req.id[0] = (char)('a' + i);
+		mock().expectOneCall("ocpp_recv").withOutputParameterReturning("msg", &req, sizeof(req));
+		mock().expectOneCall("on_ocpp_event").withParameter("event_type", OCPP_EVENT_MESSAGE_INCOMING);
+		step(i);
+	}
+
+	/* the first one has been evicted, so it reaches the application. */
+	req.id[0] = 'a';
+	mock().expectOneCall("ocpp_recv").withOutputParameterReturning("msg", &req, sizeof(req));
+	mock().expectOneCall("on_ocpp_event").withParameter("event_type", OCPP_EVENT_MESSAGE_INCOMING);
+	step(OCPP_RESPONSE_CACHE_LEN + 1);
+}
@@ -0,0 +1,375 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+#include "ocpp/csms.h"
+#include "ocpp/core/configuration.h"
+#include <errno.h>
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define NR_CONNS			6
+
+static volatile time_t now;
+
+static struct {
+	pthread_mutex_t lock;
+	int count[OCPP_CSMS_EVENT_TIMEOUT + 1];
+	struct ocpp_csms_conn *conn;
+	struct ocpp_message msg;
+	int status; /* of ChangeAvailability.conf */
+	char identity[OCPP_CSMS_IDENTITY_MAXLEN];
+} events = { PTHREAD_MUTEX_INITIALIZER, };
+
+time_t time(time_t *second) {
+	return now;
+}
+
+int ocpp_send(const struct ocpp_message *msg) {
+	return 0;
+}
+int ocpp_recv(struct ocpp_message *msg) {
+	return -ENOMSG;
+}
+int ocpp_lock(void) {
+	return 0;
+}
+int ocpp_unlock(void) {
+	return 0;
+}
+int ocpp_configuration_lock(void) {
+	return 0;
+}
+int ocpp_configuration_unlock(void) {
+	return 0;
+}
+ocpp_message_t ocpp_get_relayed_type_from_idstr(const char *idstr) {
+	return ocpp_csms_get_type(idstr);
+}
+
+static void on_event(struct ocpp_csms_conn *conn, ocpp_csms_event_t event,
+		const struct ocpp_message *msg, void *ctx)
+{
+	if (event == OCPP_CSMS_EVENT_REQUEST &&
+			msg->type == OCPP_MSG_HEARTBEAT) {
+		struct ocpp_Heartbeat_conf conf = { .currentTime = now, };
+		ocpp_csms_send_response(conn, msg, &conf, sizeof(conf));
+	}
+
+	pthread_mutex_lock(&events.lock);
+	events.count[event]++;
+	events.conn = conn;
+	if (msg) {
+		events.msg = *msg;
+		if (event == OCPP_CSMS_EVENT_RESPONSE &&
+				msg->type == OCPP_MSG_CHANGE_AVAILABILITY &&
+				msg->role == OCPP_MSG_ROLE_CALLRESULT) {
+			events.status = ((const struct
+					ocpp_ChangeAvailability_conf *)
+					msg->payload.fmt.response)->status;
+		}
+	}
+	if (event == OCPP_CSMS_EVENT_CONNECTED) {
+		strcpy(events.identity, ocpp_csms_identity(conn));
+	}
+	pthread_mutex_unlock(&events.lock);
+}
+
+static int count(ocpp_csms_event_t event)
+{
+	pthread_mutex_lock(&events.lock);
+	const int n = events.count[event];
+	pthread_mutex_unlock(&events.lock);
+	return n;
+}
+
+TEST_GROUP(Csms) {
+	struct ocpp_csms csms;
+	struct ocpp_csms_conn conns[NR_CONNS];
+	struct ocpp_websocket clients[NR_CONNS + 1];
+	bool started;
+
+	void setup(void) {
+		now = 1700000000;
+		started = false;
+		ocpp_init(NULL, NULL);
+
+		pthread_mutex_lock(&events.lock);
+		memset(events.count, 0, sizeof(events.count));
+		events.conn = NULL;
+		events.status = -1;
+		events.identity[0] = '\0';
+		pthread_mutex_unlock(&events.lock);
+
+		for (int i = 0; i < NR_CONNS + 1; i++) {
+			memset(&clients[i], 0, sizeof(clients[i]));
+			clients[i].fd = -1;
+		}
+
+		LONGS_EQUAL(0, ocpp_csms_init(&csms, conns, NR_CONNS,
+				on_event, NULL));
+		LONGS_EQUAL(0, ocpp_csms_listen(&csms, 0));
+	}
+	void teardown(void) {
+		if (started) {
+			ocpp_csms_stop(&csms);
+		} else {
+			close(csms.listener);
+		}
+		for (int i = 0; i < NR_CONNS + 1; i++) {
+			if (clients[i].fd >= 0) {
+				close(clients[i].fd);
+			}
+		}
+
+		ocpp_unregister_configurations();
+		mock().checkExpectations();
+		mock().clear();
+	}
+
+	void start(uint8_t nr_workers) {
+		LONGS_EQUAL(0, ocpp_csms_start(&csms, nr_workers));
+		started = true;
+	}
+	/* @return true once the condition holds, stepping the clients */
+	template <typename F> bool pump(F cond) {
+		for (int i = 0; i < 2000; i++) {
+			for (int j = 0; j < NR_CONNS + 1; j++) {
+				if (clients[j].state != OCPP_WEBSOCKET_CLOSED) {
+					ocpp_websocket_step(&clients[j]);
+				}
+			}
+			if (cond()) {
+				return true;
+			}
+			usleep(500);
+		}
+		return false;
+	}
+	void connect(int i) {
+		char path[32];
+		snprintf(path, sizeof(path), "/ocpp/CP%03d", i);
+		LONGS_EQUAL(0, ocpp_websocket_connect(&clients[i],
+				"127.0.0.1", ocpp_csms_port(&csms), path));
+	}
+	void open(int nr_clients) {
+		for (int i = 0; i < nr_clients; i++) {
+			connect(i);
+		}
+		CHECK(pump([&] {
+			for (int i = 0; i < nr_clients; i++) {
+				if (clients[i].state != OCPP_WEBSOCKET_OPEN) {
+					return false;
+				}
+			}
+			return count(OCPP_CSMS_EVENT_CONNECTED) == nr_clients;
+		}));
+		LONGS_EQUAL(nr_clients, ocpp_csms_count_connections(&csms));
+	}
+	struct ocpp_csms_conn *last_conn(void) {
+		pthread_mutex_lock(&events.lock);
+		struct ocpp_csms_conn *conn = events.conn;
+		pthread_mutex_unlock(&events.lock);
+		return conn;
+	}
+	/* @return the message received by the client, null-terminated */
+	std::string receive(int i) {
+		const char *data = NULL;
+		int len = -ENOMSG;
+		CHECK(pump([&] {
+			return (len = ocpp_websocket_peek(&clients[i], &data))
+				>= 0;
+		}));
+		if (len < 0) {
+			return std::string();
+		}
+		std::string s(data, (size_t)len);
+		ocpp_websocket_consume(&clients[i]);
+		return s;
+	}
+	void write(int i, const char *text) {
+		LONGS_EQUAL(0, ocpp_websocket_write(&clients[i],
+				text, strlen(text)));
+	}
+};
+
+TEST(Csms, init_ShouldReturnEINVAL_WhenInvalidParamsGiven) {
+	struct ocpp_csms other;
+
+	LONGS_EQUAL(-EINVAL, ocpp_csms_init(NULL, conns, NR_CONNS,
+			on_event, NULL));
+	LONGS_EQUAL(-EINVAL, ocpp_csms_init(&other, NULL, NR_CONNS,
+			on_event, NULL));
+	LONGS_EQUAL(-EINVAL, ocpp_csms_init(&other, conns, 0,
+			on_event, NULL));
+	LONGS_EQUAL(-EINVAL, ocpp_csms_init(&other, conns, NR_CONNS,
+			NULL, NULL));
+}
+
+TEST(Csms, start_ShouldReturnEINVAL_WhenNotListening) {
+	struct ocpp_csms other;
+	struct ocpp_csms_conn conn;
+
+	LONGS_EQUAL(0, ocpp_csms_init(&other, &conn, 1, on_event, NULL));
+	LONGS_EQUAL(-EINVAL, ocpp_csms_start(&other, 1));
+	LONGS_EQUAL(-EINVAL, ocpp_csms_start(&csms, 0));
+	LONGS_EQUAL(-EINVAL, ocpp_csms_start(&csms,
+			OCPP_CSMS_WORKERS_MAX + 1));
+}
+
+TEST(Csms, ShouldNotifyConnected_WithIdentityOfPath) {
+	start(1);
+	open(1);
+	STRCMP_EQUAL("CP000", events.identity);
+	STRCMP_EQUAL("CP000", ocpp_csms_identity(last_conn()));
+}
+
+TEST(Csms, ShouldNotifyDisconnected_WhenStationCloses) {
+	start(1);
+	open(1);
+	LONGS_EQUAL(0, ocpp_websocket_close(&clients[0], 1000));
+	CHECK(pump([&] {
+		return count(OCPP_CSMS_EVENT_DISCONNECTED) == 1;
+	}));
+	LONGS_EQUAL(0, ocpp_csms_count_connections(&csms));
+}
+
+TEST(Csms, ShouldPassRequestOfStation_AndSendResponse) {
+	start(1);
+	open(1);
+	write(0, "[2,\"42\",\"Heartbeat\",{}]");
+
+	std::string res = receive(0);
+	CHECK(res.find("[3,\"42\",{\"currentTime\":") == 0);
+	LONGS_EQUAL(1, count(OCPP_CSMS_EVENT_REQUEST));
+	LONGS_EQUAL(OCPP_MSG_HEARTBEAT, events.msg.type);
+	STRCMP_EQUAL("42", events.msg.id);
+}
+
+TEST(Csms, ShouldAnswerCallError_WhenRequestRejected) {
+	start(1);
+	open(1);
+	write(0, "[2,\"7\",\"NoSuchAction\",{}]");
+
+	std::string res = receive(0);
+	CHECK(res.find("[4,\"7\",\"NotImplemented\"") == 0);
+	LONGS_EQUAL(0, count(OCPP_CSMS_EVENT_REQUEST));
+}
+
+TEST(Csms, send_request_ShouldNotifyResponse_WhenStationAnswers) {
+	struct ocpp_ChangeAvailability req = {
+		.connectorId = 1,
+		.type = OCPP_INOPERATIVE,
+	};
+	char id[OCPP_MESSAGE_ID_MAXLEN];
+	char res[64];
+
+	start(1);
+	open(1);
+	LONGS_EQUAL(0, ocpp_csms_send_request(last_conn(),
+			OCPP_MSG_CHANGE_AVAILABILITY, &req, sizeof(req), id));
+	STRCMP_EQUAL("1", id);
+
+	std::string call = receive(0);
+	CHECK(call.find("[2,\"1\",\"ChangeAvailability\",") == 0);
+
+	snprintf(res, sizeof(res), "[3,\"%s\",{\"status\":\"Accepted\"}]", id);
+	write(0, res);
+	CHECK(pump([&] { return count(OCPP_CSMS_EVENT_RESPONSE) == 1; }));
+	LONGS_EQUAL(OCPP_MSG_CHANGE_AVAILABILITY, events.msg.type);
+	LONGS_EQUAL(OCPP_AVAILABILITY_STATUS_ACCEPTED, events.status);
+
+	/* answered once */
+	write(0, res);
+	write(0, "[2,\"1\",\"Heartbeat\",{}]");
+	receive(0);
+	LONGS_EQUAL(1, count(OCPP_CSMS_EVENT_RESPONSE));
+}
+
+TEST(Csms, send_request_ShouldReturnEBUSY_WhenTooManyInFlight) {
+	struct ocpp_ChangeAvailability req = { .connectorId = 1, };
+
+	start(1);
+	open(1);
+	for (int i = 0; i < OCPP_CSMS_PENDING_MAX; i++) {
+		LONGS_EQUAL(0, ocpp_csms_send_request(last_conn(),
+				OCPP_MSG_CHANGE_AVAILABILITY,
+				&req, sizeof(req), NULL));
+	}
+	LONGS_EQUAL(-EBUSY, ocpp_csms_send_request(last_conn(),
+			OCPP_MSG_CHANGE_AVAILABILITY, &req, sizeof(req), NULL));
+}
+
+TEST(Csms, send_request_ShouldSendAgain_ThenTimeOut) {
+	struct ocpp_ChangeAvailability req = { .connectorId = 1, };
+
+	start(1);
+	open(1);
+	LONGS_EQUAL(0, ocpp_csms_send_request(last_conn(),
+			OCPP_MSG_CHANGE_AVAILABILITY, &req, sizeof(req), NULL));
+	std::string first = receive(0);
+
+	for (int i = 1; i < OCPP_CSMS_TX_RETRIES; i++) {
+		now += OCPP_CSMS_TX_TIMEOUT_SEC;
+		std::string again = receive(0);
+		STRCMP_EQUAL(first.c_str(), again.c_str());
+	}
+
+	LONGS_EQUAL(0, count(OCPP_CSMS_EVENT_TIMEOUT));
+	now += OCPP_CSMS_TX_TIMEOUT_SEC;
+	CHECK(pump([&] { return count(OCPP_CSMS_EVENT_TIMEOUT) == 1; }));
+	LONGS_EQUAL(OCPP_MSG_CHANGE_AVAILABILITY, events.msg.type);
+	STRCMP_EQUAL("1", events.msg.id);
+
+	/* the slot is free again */
+	LONGS_EQUAL(0, ocpp_csms_send_request(last_conn(),
+			OCPP_MSG_CHANGE_AVAILABILITY, &req, sizeof(req), NULL));
+}
+
+TEST(Csms, send_request_ShouldReturnENOTCONN_WhenClosed) {
+	struct ocpp_ChangeAvailability req = { .connectorId = 1, };
+
+	start(1);
+	open(1);
+	struct ocpp_csms_conn *conn = last_conn();
+	LONGS_EQUAL(0, ocpp_websocket_close(&clients[0], 1000));
+	CHECK(pump([&] {
+		return count(OCPP_CSMS_EVENT_DISCONNECTED) == 1;
+	}));
+	LONGS_EQUAL(-ENOTCONN, ocpp_csms_send_request(conn,
+			OCPP_MSG_CHANGE_AVAILABILITY, &req, sizeof(req), NULL));
+}
+
+TEST(Csms, ShouldServeStations_AcrossWorkers) {
+	start(2);
+	open(NR_CONNS);
+
+	for (int i = 0; i < NR_CONNS; i++) {
+		write(i, "[2,\"1\",\"Heartbeat\",{}]");
+	}
+	for (int i = 0; i < NR_CONNS; i++) {
+		CHECK(receive(i).find("[3,\"1\",") == 0);
+	}
+	LONGS_EQUAL(NR_CONNS, count(OCPP_CSMS_EVENT_REQUEST));
+}
+
+TEST(Csms, ShouldCloseStation_WhenPoolIsFull) {
+	start(1);
+	open(NR_CONNS);
+	connect(NR_CONNS);
+	CHECK(pump([&] {
+		return clients[NR_CONNS].state == OCPP_WEBSOCKET_CLOSED;
+	}));
+	LONGS_EQUAL(NR_CONNS, ocpp_csms_count_connections(&csms));
+}
+
+TEST(Csms, stop_ShouldNotifyDisconnected_OfAllOpen) {
+	start(2);
+	open(3);
+	ocpp_csms_stop(&csms);
+	started = false;
+	csms.listener = -1;
+	LONGS_EQUAL(3, count(OCPP_CSMS_EVENT_DISCONNECTED));
+	LONGS_EQUAL(0, ocpp_csms_count_connections(&csms));
+}
@@ -0,0 +1,152 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+#include "ocpp/deflate.h"
+#include <errno.h>
+#include <string.h>
+
+static const char boot[] = "[2,\"19223201\",\"BootNotification\","
+	"{\"chargePointVendor\":\"VendorX\","
+	"\"chargePointModel\":\"SingleSocketCharger\"}]";
+
+TEST_GROUP(Deflate) {
+	struct ocpp_deflater tx;
+	struct ocpp_inflater rx;
+	uint8_t compressed[8192];
+	char out[8192];
+
+	void setup(void) {
+		ocpp_deflate_init(&tx, OCPP_DEFLATE_WINDOW_BITS, true);
+		ocpp_inflate_init(&rx, OCPP_DEFLATE_WINDOW_BITS, true);
+	}
+	void teardown(void) {
+		mock().checkExpectations();
+		mock().clear();
+	}
+
+	int roundtrip(const void *data, size_t len) {
+		const int clen = ocpp_deflate(&tx, data, len,
+				compressed, sizeof(compressed));
+		CHECK(clen > 0);
+		LONGS_EQUAL(len, ocpp_inflate(&rx, compressed, (size_t)clen,
+				out, sizeof(out)));
+		MEMCMP_EQUAL(data, out, len);
+		return clen;
+	}
+};
+
+TEST(Deflate, ShouldInflateRfcExamples) {
+	/* "Hello" in a fixed block, and then referring to the first */
+	const uint8_t fixed[] = { 0xf2, 0x48, 0xcd, 0xc9, 0xc9, 0x07, 0x00 };
+	const uint8_t again[] = { 0xf2, 0x00, 0x11, 0x00, 0x00 };
+	const uint8_t stored[] = {
+		0x00, 0x05, 0x00, 0xfa, 0xff, 0x48, 0x65, 0x6c, 0x6c, 0x6f, 0x00,
+	};
+
+	LONGS_EQUAL(5, ocpp_inflate(&rx, fixed, sizeof(fixed), out, sizeof(out)));
+	MEMCMP_EQUAL("Hello", out, 5);
+	LONGS_EQUAL(5, ocpp_inflate(&rx, again, sizeof(again), out, sizeof(out)));
+	MEMCMP_EQUAL("Hello", out, 5);
+	LONGS_EQUAL(5, ocpp_inflate(&rx, stored, sizeof(stored),
+			out, sizeof(out)));
+	MEMCMP_EQUAL("Hello", out, 5);
+}
+
+TEST(Deflate, ShouldInflateDynamicBlock_WhenOfZlib) {
+	/* MeterValues by zlib of the level 9 and the window of 2^10 */
+	const char expected[] = "[2,\"19223201\",\"MeterValues\",{"
+		"\"connectorId\":1,\"meterValue\":[{"
+		"\"timestamp\":\"2024-01-01T00:00:00Z\",\"sampledValue\":["
+		"{\"value\":\"1234.5\","
+		"\"measurand\":\"Energy.Active.Import.Register\",\"unit\":\"Wh\"},"
+		"{\"value\":\"7.2\",\"measurand\":\"Power.Active.Import\","
+		"\"unit\":\"kW\"}]}]}]";
+	const uint8_t data[] = {
+		0x5c, 0x8d, 0xc1, 0x0a, 0xc2, 0x30, 0x10, 0x44, 0xff, 0x65,
+		0xcf, 0x31, 0x24, 0x69, 0x45, 0xec, 0xcd, 0x83, 0x87, 0x1e,
+		0x04, 0x11, 0xb1, 0x60, 0xf1, 0x10, 0xda, 0x45, 0x83, 0x4d,
+		0x52, 0x92, 0xb4, 0x22, 0xa5, 0xff, 0x6e, 0xaa, 0x60, 0x51,
+		0x76, 0x0e, 0x0b, 0x33, 0xf3, 0xa6, 0x14, 0x04, 0xf8, 0x5a,
+		0x88, 0x44, 0x30, 0x0e, 0x04, 0x76, 0x18, 0xd0, 0x9d, 0x64,
+		0xd3, 0xa1, 0x07, 0x32, 0x40, 0x65, 0x8d, 0xc1, 0x2a, 0x58,
+		0x97, 0xd7, 0x90, 0x71, 0x02, 0xfa, 0x6b, 0x43, 0x56, 0x0e,
+		0x10, 0x94, 0x46, 0x1f, 0xa4, 0x6e, 0x21, 0x03, 0xc1, 0x44,
+		0xba, 0x60, 0x3c, 0xea, 0xc8, 0x58, 0xf6, 0xd6, 0x39, 0x02,
+		0x7d, 0x74, 0x1b, 0xac, 0xe7, 0x4e, 0xff, 0xf9, 0x80, 0x8b,
+		0x24, 0xa5, 0x4b, 0x98, 0x98, 0xd2, 0x77, 0x4e, 0x9a, 0xb8,
+		0x00, 0x5b, 0x83, 0xee, 0xfa, 0xa4, 0x9b, 0x2a, 0xa8, 0x1e,
+		0x69, 0xae, 0x5b, 0xeb, 0x02, 0x3d, 0xe0, 0x55, 0xf9, 0xb8,
+		0x1b, 0xb3, 0x9d, 0x51, 0x21, 0xc6, 0x8a, 0x1b, 0x8c, 0x64,
+		0x46, 0xad, 0xa8, 0xf8, 0xe3, 0xec, 0xed, 0x03, 0xdd, 0x2f,
+		0x66, 0x6e, 0xdf, 0x0b, 0x18, 0x2f, 0xd3, 0xbd, 0x00,
+	};
+
+	LONGS_EQUAL(sizeof(expected) - 1, ocpp_inflate(&rx, data, sizeof(data),
+			out, sizeof(out)));
+	MEMCMP_EQUAL(expected, out, sizeof(expected) - 1);
+}
+
+TEST(Deflate, ShouldRoundTrip_WhenEmpty) {
+	roundtrip("", 0);
+}
+
+TEST(Deflate, ShouldCompressRepeatingMessages_WhenContextTakenOver) {
+	const int first = roundtrip(boot, sizeof(boot) - 1);
+	const int second = roundtrip(boot, sizeof(boot) - 1);
+
+	CHECK(first < (int)sizeof(boot) - 1);
+	CHECK(second * 4 < first);
+}
+
+TEST(Deflate, ShouldCompressEachAlone_WhenNoContextTakeover) {
+	ocpp_deflate_init(&tx, OCPP_DEFLATE_WINDOW_BITS, false);
+	ocpp_inflate_init(&rx, OCPP_DEFLATE_WINDOW_BITS, false);
+
+	const int first = roundtrip(boot, sizeof(boot) - 1);
+	LONGS_EQUAL(first, roundtrip(boot, sizeof(boot) - 1));
+}
+
+TEST(Deflate, ShouldRoundTrip_WhenLongerThanWindow) {
+	static char data[5000];
+
+	for (size_t i = 0; i < sizeof(data); i++) {
+		data[i] = (char)('a' + (i * 7 + i / 13) % 26);
+	}
+
+	roundtrip(data, sizeof(data));
+	roundtrip(&data[100], sizeof(data) - 100);
+	roundtrip(data, 100);
+}
+
+TEST(Deflate, ShouldKeepContext_WhenOutputTooSmall) {
+	roundtrip(boot, sizeof(boot) - 1);
+	LONGS_EQUAL(-ENOBUFS, ocpp_deflate(&tx, boot, sizeof(boot) - 1,
+			compressed, 4));
+	roundtrip(boot, sizeof(boot) - 1);
+}
+
+TEST(Deflate, ShouldReturnNoBufs_WhenInflatedTooBig) {
+	const int clen = ocpp_deflate(&tx, boot, sizeof(boot) - 1,
+			compressed, sizeof(compressed));
+	LONGS_EQUAL(-ENOBUFS, ocpp_inflate(&rx, compressed, (size_t)clen,
+			out, 10));
+}
+
+TEST(Deflate, ShouldReject_WhenReferringBeyondWindow) {
+	const uint8_t again[] = { 0xf2, 0x00, 0x11, 0x00, 0x00 };
+	LONGS_EQUAL(-EBADMSG, ocpp_inflate(&rx, again, sizeof(again),
+			out, sizeof(out)));
+}
+
+TEST(Deflate, ShouldReject_WhenCorrupt) {
+	const uint8_t reserved[] = { 0x07 };
+	const uint8_t truncated[] = { 0xf2, 0x48, 0xcd };
+	const uint8_t stored[] = { 0x00, 0x05, 0x00, 0xfb, 0xff, 'H' };
+
+	LONGS_EQUAL(-EBADMSG, ocpp_inflate(&rx, reserved, sizeof(reserved),
+			out, sizeof(out)));
+	LONGS_EQUAL(-EBADMSG, ocpp_inflate(&rx, truncated, sizeof(truncated),
+			out, sizeof(out)));
+	LONGS_EQUAL(-EBADMSG, ocpp_inflate(&rx, stored, sizeof(stored),
+			out, sizeof(out)));
+}
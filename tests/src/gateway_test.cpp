@@ -0,0 +1,431 @@
+#include "CppUTest/TestHarness.h"
+
+#include "ocpp/gateway.h"
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+
+struct sent {
+	int count;
+	int link;
+	struct ocpp_message msg;
+	uint8_t payload[512];
+};
+
+static time_t now;
+static struct sent up;
+static struct sent down;
+static int up_err;
+
+time_t time(time_t *second) {
+	return now;
+}
+
+static void capture(struct sent *p, int link, const struct ocpp_message *msg)
+{
+	p->count++;
+	p->link = link;
+	p->msg = *msg;
+	memset(p->payload, 0, sizeof(p->payload));
+	if (msg->payload.fmt.data != NULL) {
+		memcpy(p->payload, msg->payload.fmt.data,
+				msg->payload.size < sizeof(p->payload)?
+				msg->payload.size : sizeof(p->payload));
+	}
+	p->msg.payload.fmt.data = p->payload;
+}
+
+static int send_upstream(int link, const struct ocpp_message *msg, void *ctx)
+{
+	capture(&up, link, msg);
+	return up_err;
+}
+
+static int send_downstream(int link, const struct ocpp_message *msg,
+		void *ctx)
+{
+	capture(&down, link, msg);
+	return 0;
+}
+
+TEST_GROUP(Gateway) {
+	struct ocpp_gateway gw;
+
+	void setup(void) {
+		now = 1700000000;
+		memset(&up, 0, sizeof(up));
+		memset(&down, 0, sizeof(down));
+		up_err = 0;
+
+		LONGS_EQUAL(0, ocpp_gateway_init(&gw, 2,
+				send_upstream, send_downstream, NULL));
+		LONGS_EQUAL(0, ocpp_gateway_add_station(&gw, "CP0"));
+		LONGS_EQUAL(1, ocpp_gateway_add_station(&gw, "CP1"));
+		LONGS_EQUAL(0, ocpp_gateway_set_uplink(&gw, 0, true));
+		LONGS_EQUAL(0, ocpp_gateway_set_uplink(&gw, 1, true));
+	}
+
+	int call(int station, const char *id, ocpp_message_t type,
+			void *payload, size_t size) {
+		struct ocpp_message msg = { .role = OCPP_MSG_ROLE_CALL, };
+		strcpy(msg.id, id);
+		msg.type = type;
+		msg.payload.fmt.data = payload;
+		msg.payload.size = size;
+		return ocpp_gateway_from_station(&gw, station, &msg);
+	}
+	int answer_upstream(const char *id, ocpp_message_role_t role,
+			void *payload, size_t size) {
+		struct ocpp_message msg = { .role = role, };
+		strcpy(msg.id, id);
+		msg.type = ocpp_gateway_get_type(&gw, true, id);
+		msg.payload.fmt.data = payload;
+		msg.payload.size = size;
+		return ocpp_gateway_from_upstream(&gw, up.link, &msg);
+	}
+	void authorize_online(const char *idTag, ocpp_auth_status_t status,
+			time_t expiry) {
+		struct ocpp_Authorize req = { 0, };
+		struct ocpp_Authorize_conf conf = { 0, };
+		strcpy(req.idTag, idTag);
+		conf.idTagInfo.status = status;
+		conf.idTagInfo.expiryDate = expiry;
+		LONGS_EQUAL(0, call(0, "a", OCPP_MSG_AUTHORIZE,
+				&req, sizeof(req)));
+		LONGS_EQUAL(0, answer_upstream(up.msg.id,
+				OCPP_MSG_ROLE_CALLRESULT, &conf, sizeof(conf)));
+	}
+	ocpp_auth_status_t authorize_offline(int station, const char *idTag) {
+		struct ocpp_Authorize req = { 0, };
+		strcpy(req.idTag, idTag);
+		LONGS_EQUAL(0, call(station, "b", OCPP_MSG_AUTHORIZE,
+				&req, sizeof(req)));
+		LONGS_EQUAL(OCPP_MSG_ROLE_CALLRESULT, down.msg.role);
+		STRCMP_EQUAL("b", down.msg.id);
+		return ((struct ocpp_Authorize_conf *)down.payload)
+			->idTagInfo.status;
+	}
+	int start_offline(int station, const char *idTag) {
+		struct ocpp_StartTransaction req = { 0, };
+		req.connectorId = 1;
+		strcpy(req.idTag, idTag);
+		LONGS_EQUAL(0, call(station, "s", OCPP_MSG_START_TRANSACTION,
+				&req, sizeof(req)));
+		return ((struct ocpp_StartTransaction_conf *)down.payload)
+			->transactionId;
+	}
+};
+
+TEST(Gateway, init_ShouldReturnEINVAL_WhenInvalidParamsGiven) {
+	LONGS_EQUAL(-EINVAL, ocpp_gateway_init(NULL, 1,
+			send_upstream, send_downstream, NULL));
+	LONGS_EQUAL(-EINVAL, ocpp_gateway_init(&gw, 0,
+			send_upstream, send_downstream, NULL));
+	LONGS_EQUAL(-EINVAL, ocpp_gateway_init(&gw,
+			OCPP_GATEWAY_UPLINKS_MAX + 1,
+			send_upstream, send_downstream, NULL));
+	LONGS_EQUAL(-EINVAL, ocpp_gateway_init(&gw, 1,
+			NULL, send_downstream, NULL));
+}
+
+TEST(Gateway, add_station_ShouldRejectInvalidOrDuplicateIdentity) {
+	LONGS_EQUAL(-EEXIST, ocpp_gateway_add_station(&gw, "CP0"));
+	LONGS_EQUAL(-EINVAL, ocpp_gateway_add_station(&gw, ""));
+	LONGS_EQUAL(-EINVAL, ocpp_gateway_add_station(&gw, "CP:2"));
+	LONGS_EQUAL(-EINVAL, ocpp_gateway_add_station(&gw, "CP#2"));
+	LONGS_EQUAL(-EINVAL, ocpp_gateway_add_station(&gw,
+			"123456789012345678901"));
+	LONGS_EQUAL(2, ocpp_gateway_add_station(&gw, "CP2"));
+	LONGS_EQUAL(3, ocpp_gateway_add_station(&gw, "CP3"));
+	LONGS_EQUAL(-ENOSPC, ocpp_gateway_add_station(&gw, "CP4"));
+	LONGS_EQUAL(0, ocpp_gateway_remove_station(&gw, 1));
+	LONGS_EQUAL(-ENOENT, ocpp_gateway_remove_station(&gw, 1));
+	LONGS_EQUAL(1, ocpp_gateway_add_station(&gw, "CP4"));
+}
+
+TEST(Gateway, ShouldSpreadStationsOverUplinks) {
+	LONGS_EQUAL(2, ocpp_gateway_add_station(&gw, "CP2"));
+	LONGS_EQUAL(0, ocpp_gateway_get_uplink(&gw, 0));
+	LONGS_EQUAL(1, ocpp_gateway_get_uplink(&gw, 1));
+	LONGS_EQUAL(0, ocpp_gateway_get_uplink(&gw, 2));
+	LONGS_EQUAL(-ENOENT, ocpp_gateway_get_uplink(&gw, 3));
+
+	LONGS_EQUAL(0, call(1, "42", OCPP_MSG_HEARTBEAT, NULL, 0));
+	LONGS_EQUAL(1, up.link);
+	LONGS_EQUAL(0, call(2, "42", OCPP_MSG_HEARTBEAT, NULL, 0));
+	LONGS_EQUAL(0, up.link);
+}
+
+TEST(Gateway, ShouldRouteResultBackToStation_WithOriginalId) {
+	struct ocpp_Heartbeat_conf conf = { .currentTime = 1700000001, };
+
+	LONGS_EQUAL(0, call(1, "42", OCPP_MSG_HEARTBEAT, NULL, 0));
+	STRCMP_EQUAL("CP1#1", up.msg.id);
+	LONGS_EQUAL(OCPP_MSG_HEARTBEAT, up.msg.type);
+	LONGS_EQUAL(OCPP_MSG_HEARTBEAT,
+			ocpp_gateway_get_type(&gw, true, "CP1#1"));
+
+	LONGS_EQUAL(0, answer_upstream("CP1#1", OCPP_MSG_ROLE_CALLRESULT,
+			&conf, sizeof(conf)));
+	LONGS_EQUAL(1, down.count);
+	LONGS_EQUAL(1, down.link);
+	STRCMP_EQUAL("42", down.msg.id);
+	LONGS_EQUAL(OCPP_MSG_ROLE_CALLRESULT, down.msg.role);
+	LONGS_EQUAL(1700000001, ((struct ocpp_Heartbeat_conf *)
+			down.payload)->currentTime);
+
+	LONGS_EQUAL(OCPP_MSG_MAX, ocpp_gateway_get_type(&gw, true, "CP1#1"));
+	LONGS_EQUAL(-ENOENT, answer_upstream("CP1#1",
+			OCPP_MSG_ROLE_CALLRESULT, &conf, sizeof(conf)));
+}
+
+TEST(Gateway, ShouldKeepIdsOfStationsApart_WhenSameIdsUsed) {
+	LONGS_EQUAL(0, call(0, "1", OCPP_MSG_HEARTBEAT, NULL, 0));
+	LONGS_EQUAL(0, call(1, "1", OCPP_MSG_HEARTBEAT, NULL, 0));
+
+	LONGS_EQUAL(0, answer_upstream("CP0#1", OCPP_MSG_ROLE_CALLERROR,
+			NULL, 0));
+	LONGS_EQUAL(0, down.link);
+	STRCMP_EQUAL("1", down.msg.id);
+	LONGS_EQUAL(OCPP_MSG_ROLE_CALLERROR, down.msg.role);
+	LONGS_EQUAL(0, answer_upstream("CP1#2", OCPP_MSG_ROLE_CALLRESULT,
+			NULL, 0));
+	LONGS_EQUAL(1, down.link);
+	STRCMP_EQUAL("1", down.msg.id);
+}
+
+TEST(Gateway, ShouldRouteCallOfCentralSystem_ByIdentityPrefix) {
+	struct ocpp_message req = {
+		.id = "CP1:abc",
+		.role = OCPP_MSG_ROLE_CALL,
+		.type = OCPP_MSG_RESET,
+	};
+	struct ocpp_message res = {
+		.id = "CP1:abc",
+		.role = OCPP_MSG_ROLE_CALLRESULT,
+		.type = OCPP_MSG_RESET,
+	};
+
+	LONGS_EQUAL(0, ocpp_gateway_from_upstream(&gw, 1, &req));
+	LONGS_EQUAL(1, down.link);
+	STRCMP_EQUAL("CP1:abc", down.msg.id);
+	LONGS_EQUAL(OCPP_MSG_RESET,
+			ocpp_gateway_get_type(&gw, false, "CP1:abc"));
+
+	LONGS_EQUAL(-ENOENT, ocpp_gateway_from_station(&gw, 0, &res));
+	LONGS_EQUAL(0, ocpp_gateway_from_station(&gw, 1, &res));
+	LONGS_EQUAL(1, up.link);
+	STRCMP_EQUAL("CP1:abc", up.msg.id);
+	LONGS_EQUAL(-ENOENT, ocpp_gateway_from_station(&gw, 1, &res));
+}
+
+TEST(Gateway, ShouldKeepWaysApart_WhenBothSidesUseSameId) {
+	struct ocpp_Heartbeat_conf conf = { .currentTime = 1700000001, };
+	struct ocpp_message req = {
+		.id = "CP1:1",
+		.role = OCPP_MSG_ROLE_CALL,
+		.type = OCPP_MSG_RESET,
+	};
+	struct ocpp_message res = {
+		.id = "CP1:1",
+		.role = OCPP_MSG_ROLE_CALLRESULT,
+		.type = OCPP_MSG_RESET,
+	};
+
+	/* the station sends its CALL of "CP1:1" as the central system does */
+	LONGS_EQUAL(0, call(1, "CP1:1", OCPP_MSG_HEARTBEAT, NULL, 0));
+	STRCMP_EQUAL("CP1#1", up.msg.id);
+	LONGS_EQUAL(0, ocpp_gateway_from_upstream(&gw, 1, &req));
+
+	LONGS_EQUAL(OCPP_MSG_RESET,
+			ocpp_gateway_get_type(&gw, false, "CP1:1"));
+	LONGS_EQUAL(OCPP_MSG_MAX, ocpp_gateway_get_type(&gw, true, "CP1:1"));
+	LONGS_EQUAL(OCPP_MSG_HEARTBEAT,
+			ocpp_gateway_get_type(&gw, true, "CP1#1"));
+	LONGS_EQUAL(OCPP_MSG_MAX, ocpp_gateway_get_type(&gw, false, "CP1#1"));
+
+	LONGS_EQUAL(0, ocpp_gateway_from_station(&gw, 1, &res));
+	STRCMP_EQUAL("CP1:1", up.msg.id);
+	LONGS_EQUAL(OCPP_MSG_RESET, up.msg.type);
+
+	LONGS_EQUAL(0, answer_upstream("CP1#1", OCPP_MSG_ROLE_CALLRESULT,
+			&conf, sizeof(conf)));
+	LONGS_EQUAL(1, down.link);
+	STRCMP_EQUAL("CP1:1", down.msg.id);
+	LONGS_EQUAL(OCPP_MSG_HEARTBEAT, down.msg.type);
+}
+
+TEST(Gateway, ShouldRejectCallOfCentralSystem_WhenNoStationMatches) {
+	struct ocpp_message req = {
+		.id = "CP9:1",
+		.role = OCPP_MSG_ROLE_CALL,
+		.type = OCPP_MSG_RESET,
+	};
+
+	LONGS_EQUAL(-ENOENT, ocpp_gateway_from_upstream(&gw, 0, &req));
+	strcpy(req.id, "CP1:1"); /* not of the uplink */
+	LONGS_EQUAL(-ENOENT, ocpp_gateway_from_upstream(&gw, 0, &req));
+	strcpy(req.id, "CP0");
+	LONGS_EQUAL(-ENOENT, ocpp_gateway_from_upstream(&gw, 0, &req));
+	LONGS_EQUAL(0, down.count);
+}
+
+TEST(Gateway, ShouldReturnENOSPC_WhenTooManyRequestsInFlight) {
+	for (int i = 0; i < OCPP_GATEWAY_ROUTES_MAX; i++) {
+		LONGS_EQUAL(0, call(0, "1", OCPP_MSG_HEARTBEAT, NULL, 0));
+	}
+	LONGS_EQUAL(-ENOSPC, call(0, "1", OCPP_MSG_HEARTBEAT, NULL, 0));
+}
+
+TEST(Gateway, ShouldDropRequest_WhenSendFails) {
+	up_err = -EIO;
+	LONGS_EQUAL(-EIO, call(0, "1", OCPP_MSG_HEARTBEAT, NULL, 0));
+	LONGS_EQUAL(OCPP_MSG_MAX, ocpp_gateway_get_type(&gw, true, up.msg.id));
+}
+
+TEST(Gateway, step_ShouldDropRequestsTimedOut) {
+	LONGS_EQUAL(0, call(0, "1", OCPP_MSG_HEARTBEAT, NULL, 0));
+	now += OCPP_GATEWAY_ROUTE_TIMEOUT_SEC - 1;
+	ocpp_gateway_step(&gw);
+	LONGS_EQUAL(OCPP_MSG_HEARTBEAT,
+			ocpp_gateway_get_type(&gw, true, "CP0#1"));
+	now += 1;
+	ocpp_gateway_step(&gw);
+	LONGS_EQUAL(OCPP_MSG_MAX, ocpp_gateway_get_type(&gw, true, "CP0#1"));
+}
+
+TEST(Gateway, ShouldDropRequestsInFlight_WhenUplinkGoesDown) {
+	LONGS_EQUAL(0, call(0, "1", OCPP_MSG_HEARTBEAT, NULL, 0));
+	LONGS_EQUAL(0, call(1, "1", OCPP_MSG_HEARTBEAT, NULL, 0));
+	LONGS_EQUAL(0, ocpp_gateway_set_uplink(&gw, 0, false));
+	LONGS_EQUAL(OCPP_MSG_MAX, ocpp_gateway_get_type(&gw, true, "CP0#1"));
+	LONGS_EQUAL(OCPP_MSG_HEARTBEAT,
+			ocpp_gateway_get_type(&gw, true, "CP1#2"));
+	LONGS_EQUAL(-EINVAL, ocpp_gateway_set_uplink(&gw, 2, false));
+}
+
+TEST(Gateway, ShouldRefuseCalls_WhenUplinkDown) {
+	LONGS_EQUAL(0, ocpp_gateway_set_uplink(&gw, 0, false));
+	LONGS_EQUAL(-ENOTCONN, call(0, "1", OCPP_MSG_HEARTBEAT, NULL, 0));
+	LONGS_EQUAL(0, call(1, "1", OCPP_MSG_HEARTBEAT, NULL, 0));
+	LONGS_EQUAL(0, down.count);
+}
+
+TEST(Gateway, ShouldAuthorizeOffline_FromIdTagsLearned) {
+	authorize_online("good", OCPP_AUTH_STATUS_ACCEPTED, 0);
+	authorize_online("blocked", OCPP_AUTH_STATUS_BLOCKED, 0);
+	authorize_online("expiring", OCPP_AUTH_STATUS_ACCEPTED, now + 10);
+	LONGS_EQUAL(0, ocpp_gateway_set_uplink(&gw, 0, false));
+	now += 10;
+
+	/* the least recently used of the cache is replaced */
+	LONGS_EQUAL(OCPP_AUTH_STATUS_INVALID, authorize_offline(0, "good"));
+	LONGS_EQUAL(OCPP_AUTH_STATUS_BLOCKED, authorize_offline(0, "blocked"));
+	LONGS_EQUAL(OCPP_AUTH_STATUS_EXPIRED,
+			authorize_offline(0, "expiring"));
+	LONGS_EQUAL(OCPP_AUTH_STATUS_INVALID, authorize_offline(0, "other"));
+	ocpp_gateway_allow_offline_unknown(&gw, true);
+	LONGS_EQUAL(OCPP_AUTH_STATUS_ACCEPTED, authorize_offline(0, "other"));
+	LONGS_EQUAL(3, up.count);
+}
+
+TEST(Gateway, ShouldReplayTransactionStartedOffline_WhenUplinkUp) {
+	struct ocpp_StartTransaction_conf conf = { .transactionId = 1234, };
+	struct ocpp_StopTransaction stop = { .transactionId = 0, };
+
+	conf.idTagInfo.status = OCPP_AUTH_STATUS_ACCEPTED;
+	authorize_online("good", OCPP_AUTH_STATUS_ACCEPTED, 0);
+	LONGS_EQUAL(0, ocpp_gateway_set_uplink(&gw, 0, false));
+
+	LONGS_EQUAL(-1, start_offline(0, "good"));
+	STRCMP_EQUAL("s", down.msg.id);
+	LONGS_EQUAL(OCPP_AUTH_STATUS_ACCEPTED,
+			((struct ocpp_StartTransaction_conf *)down.payload)
+			->idTagInfo.status);
+	stop.transactionId = -1;
+	LONGS_EQUAL(-ENOTCONN, call(0, "t", OCPP_MSG_STOP_TRANSACTION,
+			&stop, sizeof(stop)));
+
+	const int nr_up = up.count;
+	ocpp_gateway_step(&gw);
+	LONGS_EQUAL(nr_up, up.count);
+
+	LONGS_EQUAL(0, ocpp_gateway_set_uplink(&gw, 0, true));
+	LONGS_EQUAL(-EAGAIN, call(0, "t", OCPP_MSG_STOP_TRANSACTION,
+			&stop, sizeof(stop)));
+	ocpp_gateway_step(&gw);
+	LONGS_EQUAL(nr_up + 1, up.count);
+	LONGS_EQUAL(OCPP_MSG_START_TRANSACTION, up.msg.type);
+	STRCMP_EQUAL("good", ((struct ocpp_StartTransaction *)up.payload)
+			->idTag);
+	ocpp_gateway_step(&gw); /* not again while in flight */
+	LONGS_EQUAL(nr_up + 1, up.count);
+
+	const int nr_down = down.count;
+	LONGS_EQUAL(0, answer_upstream(up.msg.id, OCPP_MSG_ROLE_CALLRESULT,
+			&conf, sizeof(conf)));
+	LONGS_EQUAL(nr_down, down.count);
+
+	LONGS_EQUAL(0, call(0, "t", OCPP_MSG_STOP_TRANSACTION,
+			&stop, sizeof(stop)));
+	LONGS_EQUAL(1234, ((struct ocpp_StopTransaction *)up.payload)
+			->transactionId);
+	LONGS_EQUAL(0, answer_upstream(up.msg.id, OCPP_MSG_ROLE_CALLRESULT,
+			NULL, 0));
+	STRCMP_EQUAL("t", down.msg.id);
+
+	/* forgotten once stopped */
+	stop.transactionId = -1;
+	LONGS_EQUAL(0, call(0, "t", OCPP_MSG_STOP_TRANSACTION,
+			&stop, sizeof(stop)));
+	LONGS_EQUAL(-1, ((struct ocpp_StopTransaction *)up.payload)
+			->transactionId);
+}
+
+TEST(Gateway, ShouldReplayAgain_WhenReplayTimesOut) {
+	LONGS_EQUAL(0, ocpp_gateway_set_uplink(&gw, 0, false));
+	LONGS_EQUAL(-1, start_offline(0, "any"));
+	LONGS_EQUAL(0, ocpp_gateway_set_uplink(&gw, 0, true));
+
+	ocpp_gateway_step(&gw);
+	LONGS_EQUAL(1, up.count);
+	now += OCPP_GATEWAY_ROUTE_TIMEOUT_SEC;
+	ocpp_gateway_step(&gw);
+	LONGS_EQUAL(2, up.count);
+	STRCMP_EQUAL("CP0#2", up.msg.id);
+}
+
+TEST(Gateway, ShouldRefuseTransactionsOffline_WhenTooMany) {
+	struct ocpp_StartTransaction req = { 0, };
+
+	LONGS_EQUAL(0, ocpp_gateway_set_uplink(&gw, 0, false));
+	LONGS_EQUAL(-1, start_offline(0, "a"));
+	LONGS_EQUAL(-2, start_offline(0, "b"));
+	LONGS_EQUAL(-ENOSPC, call(0, "s", OCPP_MSG_START_TRANSACTION,
+			&req, sizeof(req)));
+}
+
+TEST(Gateway, ShouldTranslateRemoteStop_IntoLocalTransactionId) {
+	struct ocpp_StartTransaction_conf conf = { .transactionId = 77, };
+	struct ocpp_RemoteStopTransaction stop = { .transactionId = 77, };
+	struct ocpp_message req = {
+		.id = "CP0:x",
+		.role = OCPP_MSG_ROLE_CALL,
+		.type = OCPP_MSG_REMOTE_STOP_TRANSACTION,
+	};
+
+	req.payload.fmt.data = &stop;
+	req.payload.size = sizeof(stop);
+
+	conf.idTagInfo.status = OCPP_AUTH_STATUS_ACCEPTED;
+	LONGS_EQUAL(0, ocpp_gateway_set_uplink(&gw, 0, false));
+	LONGS_EQUAL(-1, start_offline(0, "any"));
+	LONGS_EQUAL(0, ocpp_gateway_set_uplink(&gw, 0, true));
+	ocpp_gateway_step(&gw);
+	LONGS_EQUAL(0, answer_upstream(up.msg.id, OCPP_MSG_ROLE_CALLRESULT,
+			&conf, sizeof(conf)));
+
+	LONGS_EQUAL(0, ocpp_gateway_from_upstream(&gw, 0, &req));
+	LONGS_EQUAL(-1, ((struct ocpp_RemoteStopTransaction *)down.payload)
+			->transactionId);
+}
@@ -0,0 +1,299 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+#include "ocpp/message_cbor.h"
+#include "ocpp/message_json.h"
+#include <errno.h>
+#include <string.h>
+
+static char sent_id[OCPP_MESSAGE_ID_MAXLEN];
+
+int ocpp_send(const struct ocpp_message *msg) {
+	memcpy(sent_id, msg->id, sizeof(sent_id));
+	return 0;
+}
+int ocpp_recv(struct ocpp_message *msg) {
+	return -ENOMSG;
+}
+int ocpp_lock(void) {
+	return 0;
+}
+int ocpp_unlock(void) {
+	return 0;
+}
+int ocpp_configuration_lock(void) {
+	return 0;
+}
+int ocpp_configuration_unlock(void) {
+	return 0;
+}
+
+TEST_GROUP(MessageCbor) {
+	struct ocpp_message msg;
+	struct ocpp_message decoded;
+	uint8_t cbor[2048];
+	char json[2048];
+	union {
+		char buf[2048];
+		long long align;
+	} u;
+	ocpp_callerror_t error;
+
+	void setup(void) {
+		ocpp_init(NULL, NULL);
+		memset(&msg, 0, sizeof(msg));
+		strcpy(msg.id, "19223201");
+		error = OCPP_CALLERROR_GENERIC;
+	}
+	void teardown(void) {
+		mock().checkExpectations();
+		mock().clear();
+	}
+
+	void set(ocpp_message_role_t role, ocpp_message_t type,
+			const void *data, size_t datasize) {
+		msg.role = role;
+		msg.type = type;
+		msg.payload.fmt.request = data;
+		msg.payload.size = datasize;
+	}
+	int decode(const uint8_t *data, size_t len) {
+		return ocpp_decode_message_cbor(data, len, &decoded,
+				u.buf, sizeof(u.buf), &error);
+	}
+	/* decoded back and translated to OCPP-J as a local controller does */
+	void check_roundtrip(void) {
+		char expected[2048];
+		const int len = ocpp_encode_message_cbor(&msg,
+				cbor, sizeof(cbor));
+		const int jsonlen = ocpp_encode_message_json(&msg,
+				expected, sizeof(expected));
+
+		CHECK(len > 0);
+		CHECK(len < jsonlen);
+		LONGS_EQUAL(0, decode(cbor, (size_t)len));
+		LONGS_EQUAL(jsonlen, ocpp_encode_message_json(&decoded,
+				json, sizeof(json)));
+		STRCMP_EQUAL(expected, json);
+	}
+	void send_request(ocpp_message_t type) {
+		struct ocpp_BootNotification boot = { 0, };
+		ocpp_push_request(type, &boot, sizeof(boot), false);
+		ocpp_step();
+	}
+};
+
+TEST(MessageCbor, ShouldEncodeCallInShortestForms) {
+	struct ocpp_Heartbeat_conf conf = { .currentTime = 1700000000 };
+	strcpy(msg.id, "1");
+	set(OCPP_MSG_ROLE_CALLRESULT, OCPP_MSG_HEARTBEAT, &conf, sizeof(conf));
+	const uint8_t expected[] = {
+		0x83, 0x03, 0x61, '1',
+		0xa1, 0x00, 0x1a, 0x65, 0x53, 0xf1, 0x00,
+	};
+
+	LONGS_EQUAL(sizeof(expected), ocpp_encode_message_cbor(&msg,
+			cbor, sizeof(cbor)));
+	MEMCMP_EQUAL(expected, cbor, sizeof(expected));
+}
+
+TEST(MessageCbor, ShouldRoundtripStatusNotification) {
+	struct ocpp_StatusNotification req = {
+		.connectorId = 2,
+		.errorCode = OCPP_ERROR_GROUND,
+		.status = OCPP_STATUS_FAULTED,
+		.timestamp = 1709177696,
+	};
+	strcpy(req.info, "\xc3\xa9\n");
+	set(OCPP_MSG_ROLE_CALL, OCPP_MSG_STATUS_NOTIFICATION, &req, sizeof(req));
+
+	check_roundtrip();
+	LONGS_EQUAL(OCPP_MSG_ROLE_CALL, decoded.role);
+	LONGS_EQUAL(OCPP_MSG_STATUS_NOTIFICATION, decoded.type);
+	STRCMP_EQUAL("19223201", decoded.id);
+	MEMCMP_EQUAL(&req, decoded.payload.fmt.data, sizeof(req));
+}
+
+TEST(MessageCbor, ShouldRoundtripFlexibleArraysAndDecimals) {
+	union {
+		struct ocpp_MeterValues req;
+		uint8_t raw[sizeof(struct ocpp_MeterValues) +
+			2 * sizeof(struct ocpp_SampledValue)];
+	} meter;
+	memset(&meter, 0, sizeof(meter));
+	meter.req.connectorId = 1;
+	meter.req.transactionId = -1234;
+	meter.req.meterValue.timestamp = 1700000000;
+	for (int i = 0; i < 2; i++) {
+		struct ocpp_SampledValue *v =
+			&meter.req.meterValue.sampledValue[i];
+		strcpy(v->value, "12345.6");
+		v->context = OCPP_READ_CTX_SAMPLE_PERIODIC;
+		v->measurand = (ocpp_measurand_t)(1 << i);
+		v->phase = OCPP_PHASE_L1;
+		v->unit = OCPP_UNIT_WH;
+	}
+	set(OCPP_MSG_ROLE_CALL, OCPP_MSG_METER_VALUES, &meter, sizeof(meter));
+
+	check_roundtrip();
+	LONGS_EQUAL(sizeof(meter), decoded.payload.size);
+}
+
+TEST(MessageCbor, ShouldRoundtripTrailingStringAndU64) {
+	union {
+		struct ocpp_DataTransfer req;
+		uint8_t raw[sizeof(struct ocpp_DataTransfer) + 300];
+	} transfer;
+	struct ocpp_StopTransaction stop = {
+		.meterStop = 5000000000ull,
+		.timestamp = 951782400,
+		.transactionId = -3,
+		.reason = OCPP_STOP_REASON_EV_DISCONNECTED,
+	};
+	memset(&transfer, 0, sizeof(transfer));
+	strcpy(transfer.req.vendorId, "com.example");
+	memset(transfer.req.data, 'd', 300);
+
+	set(OCPP_MSG_ROLE_CALL, OCPP_MSG_DATA_TRANSFER,
+			&transfer, sizeof(transfer));
+	check_roundtrip();
+	set(OCPP_MSG_ROLE_CALL, OCPP_MSG_STOP_TRANSACTION, &stop, sizeof(stop));
+	check_roundtrip();
+}
+
+TEST(MessageCbor, ShouldDecodeResultOfPendingRequest) {
+	struct ocpp_BootNotification_conf conf = {
+		.currentTime = 1700000000,
+		.interval = 300,
+		.status = OCPP_BOOT_STATUS_ACCEPTED,
+	};
+	send_request(OCPP_MSG_BOOTNOTIFICATION);
+	strcpy(msg.id, sent_id);
+	set(OCPP_MSG_ROLE_CALLRESULT, OCPP_MSG_BOOTNOTIFICATION,
+			&conf, sizeof(conf));
+
+	check_roundtrip();
+	LONGS_EQUAL(OCPP_MSG_BOOTNOTIFICATION, decoded.type);
+}
+
+TEST(MessageCbor, ShouldReturnENOENT_WhenNoRequestPending) {
+	struct ocpp_Heartbeat_conf conf = { .currentTime = 1 };
+	set(OCPP_MSG_ROLE_CALLRESULT, OCPP_MSG_HEARTBEAT, &conf, sizeof(conf));
+	const int len = ocpp_encode_message_cbor(&msg, cbor, sizeof(cbor));
+
+	LONGS_EQUAL(-ENOENT, decode(cbor, (size_t)len));
+}
+
+TEST(MessageCbor, ShouldRoundtripCallError) {
+	struct ocpp_CallError err = {
+		.errorCode = OCPP_CALLERROR_NOT_SUPPORTED,
+		.errorDescription = "not here",
+	};
+	send_request(OCPP_MSG_DATA_TRANSFER);
+	strcpy(msg.id, sent_id);
+	set(OCPP_MSG_ROLE_CALLERROR, OCPP_MSG_DATA_TRANSFER, &err, sizeof(err));
+
+	check_roundtrip();
+	const struct ocpp_CallError *p =
+		(const struct ocpp_CallError *)decoded.payload.fmt.data;
+	LONGS_EQUAL(OCPP_CALLERROR_NOT_SUPPORTED, p->errorCode);
+	STRCMP_EQUAL("not here", p->errorDescription);
+}
+
+TEST(MessageCbor, ShouldReturnENOBUFS_WhenBufferTooSmall) {
+	struct ocpp_Authorize req = { .idTag = "0123456789" };
+	set(OCPP_MSG_ROLE_CALL, OCPP_MSG_AUTHORIZE, &req, sizeof(req));
+
+	LONGS_EQUAL(-ENOBUFS, ocpp_encode_message_cbor(&msg, cbor, 8));
+	LONGS_EQUAL(-EINVAL, ocpp_encode_message_cbor(NULL, cbor, 8));
+}
+
+TEST(MessageCbor, ShouldSkipUnknownMembers) {
+	/* [2, "a", Authorize, {0: "TAG", 9: [1, {}], 10: 1.5}] */
+	const uint8_t data[] = {
+		0x84, 0x02, 0x61, 'a', OCPP_MSG_AUTHORIZE,
+		0xa3, 0x00, 0x63, 'T', 'A', 'G',
+		0x09, 0x82, 0x01, 0xa0,
+		0x0a, 0xf9, 0x3e, 0x00,
+	};
+
+	LONGS_EQUAL(0, decode(data, sizeof(data)));
+	STRCMP_EQUAL("TAG", ((const struct ocpp_Authorize *)
+			decoded.payload.fmt.data)->idTag);
+}
+
+TEST(MessageCbor, ShouldReturnFormationViolation_WhenTagsNestTooDeep) {
+	/* [2, "a", Authorize, {0: "TAG", 9: 0(0(...0(1)))}] */
+	static uint8_t data[200 * 1024];
+	const uint8_t head[] = {
+		0x84, 0x02, 0x61, 'a', OCPP_MSG_AUTHORIZE,
+		0xa2, 0x00, 0x63, 'T', 'A', 'G', 0x09,
+	};
+	memcpy(data, head, sizeof(head));
+
+	memset(&data[sizeof(head)], 0xc0, 2);
+	data[sizeof(head) + 2] = 0x01;
+	LONGS_EQUAL(0, decode(data, sizeof(head) + 3));
+
+	memset(&data[sizeof(head)], 0xc0, sizeof(data) - sizeof(head) - 1);
+	data[sizeof(data) - 1] = 0x01;
+	LONGS_EQUAL(-EBADMSG, decode(data, sizeof(data)));
+	LONGS_EQUAL(OCPP_CALLERROR_FORMATION_VIOLATION, error);
+}
+
+TEST(MessageCbor, ShouldReturnOccurrenceViolation_WhenRequiredMissing) {
+	const uint8_t data[] = {
+		0x84, 0x02, 0x61, 'a', OCPP_MSG_AUTHORIZE, 0xa0,
+	};
+
+	LONGS_EQUAL(-EBADMSG, decode(data, sizeof(data)));
+	LONGS_EQUAL(OCPP_CALLERROR_OCCURRENCE_CONSTRAINT_VIOLATION, error);
+}
+
+TEST(MessageCbor, ShouldReturnPropertyViolation_WhenValueInvalid) {
+	/* idTag of 21 characters */
+	uint8_t data[32] = {
+		0x84, 0x02, 0x61, 'a', OCPP_MSG_AUTHORIZE, 0xa1, 0x00, 0x75,
+	};
+	memset(&data[8], 'x', 21);
+
+	LONGS_EQUAL(-EBADMSG, decode(data, 8 + 21));
+	LONGS_EQUAL(OCPP_CALLERROR_PROPERTY_CONSTRAINT_VIOLATION, error);
+}
+
+TEST(MessageCbor, ShouldReturnTypeViolation_WhenTypeMismatch) {
+	const uint8_t data[] = {
+		0x84, 0x02, 0x61, 'a', OCPP_MSG_AUTHORIZE, 0xa1, 0x00, 0x01,
+	};
+
+	LONGS_EQUAL(-EBADMSG, decode(data, sizeof(data)));
+	LONGS_EQUAL(OCPP_CALLERROR_TYPE_CONSTRAINT_VIOLATION, error);
+}
+
+TEST(MessageCbor, ShouldReturnNotImplemented_WhenTypeUnknown) {
+	const uint8_t data[] = {
+		0x84, 0x02, 0x61, 'a', 0x18, OCPP_MSG_MAX, 0xa0,
+	};
+
+	LONGS_EQUAL(-EBADMSG, decode(data, sizeof(data)));
+	LONGS_EQUAL(OCPP_CALLERROR_NOT_IMPLEMENTED, error);
+}
+
+TEST(MessageCbor, ShouldReturnFormationViolation_WhenMalformed) {
+	struct ocpp_Authorize req = { .idTag = "0123456789" };
+	set(OCPP_MSG_ROLE_CALL, OCPP_MSG_AUTHORIZE, &req, sizeof(req));
+	const int len = ocpp_encode_message_cbor(&msg, cbor, sizeof(cbor));
+
+	for (int i = 0; i < len; i++) { /* truncated anywhere */
+		LONGS_EQUAL(-EBADMSG, decode(cbor, (size_t)i));
+		LONGS_EQUAL(OCPP_CALLERROR_FORMATION_VIOLATION, error);
+	}
+
+	cbor[len] = 0x00; /* trailing garbage */
+	LONGS_EQUAL(-EBADMSG, decode(cbor, (size_t)len + 1));
+	LONGS_EQUAL(OCPP_CALLERROR_FORMATION_VIOLATION, error);
+
+	const uint8_t indefinite[] = { 0x9f, 0x02, 0xff };
+	LONGS_EQUAL(-EBADMSG, decode(indefinite, sizeof(indefinite)));
+	LONGS_EQUAL(OCPP_CALLERROR_FORMATION_VIOLATION, error);
+}
@@ -0,0 +1,645 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+#include "ocpp/message_json.h"
+#include <errno.h>
+#include <string.h>
+
+static char sent_id[OCPP_MESSAGE_ID_MAXLEN];
+
+int ocpp_send(const struct ocpp_message *msg) {
+	memcpy(sent_id, msg->id, sizeof(sent_id));
+	return 0;
+}
+int ocpp_recv(struct ocpp_message *msg) {
+	return -ENOMSG;
+}
+int ocpp_lock(void) {
+	return 0;
+}
+int ocpp_unlock(void) {
+	return 0;
+}
+int ocpp_configuration_lock(void) {
+	return 0;
+}
+int ocpp_configuration_unlock(void) {
+	return 0;
+}
+
+static int collect(const char *chunk, size_t chunksize, void *ctx) {
+	std::string *s = (std::string *)ctx;
+	LONGS_EQUAL(1, chunksize <= OCPP_MESSAGE_JSON_CHUNK_SIZE);
+	s->append(chunk, chunksize);
+	return mock().actualCall(__func__).returnIntValueOrDefault(0);
+}
+
+TEST_GROUP(MessageJson) {
+	struct ocpp_message msg;
+	char buf[4096];
+
+	void setup(void) {
+		memset(&msg, 0, sizeof(msg));
+		strcpy(msg.id, "19223201");
+	}
+	void teardown(void) {
+		mock().checkExpectations();
+		mock().clear();
+	}
+
+	void set(ocpp_message_role_t role, ocpp_message_t type,
+			const void *data, size_t datasize) {
+		msg.role = role;
+		msg.type = type;
+		msg.payload.fmt.request = data;
+		msg.payload.size = datasize;
+	}
+	int encode(void) {
+		return ocpp_encode_message_json(&msg, buf, sizeof(buf));
+	}
+};
+
+TEST(MessageJson, ShouldEncodeCall) {
+	struct ocpp_BootNotification boot = { 0, };
+	strcpy(boot.chargePointModel, "SingleSocketCharger");
+	strcpy(boot.chargePointVendor, "VendorX");
+	set(OCPP_MSG_ROLE_CALL, OCPP_MSG_BOOTNOTIFICATION, &boot, sizeof(boot));
+
+	const char *expected = "[2,\"19223201\",\"BootNotification\","
+		"{\"chargePointModel\":\"SingleSocketCharger\","
+		"\"chargePointVendor\":\"VendorX\"}]";
+	LONGS_EQUAL(strlen(expected), encode());
+	STRCMP_EQUAL(expected, buf);
+}
+
+TEST(MessageJson, ShouldEncodeCallResult) {
+	struct ocpp_BootNotification_conf conf = {
+		.currentTime = 1700000000,
+		.interval = 300,
+		.status = OCPP_BOOT_STATUS_ACCEPTED,
+	};
+	set(OCPP_MSG_ROLE_CALLRESULT, OCPP_MSG_BOOTNOTIFICATION,
+			&conf, sizeof(conf));
+
+	encode();
+	STRCMP_EQUAL("[3,\"19223201\",{\"currentTime\":\"2023-11-14T22:13:20Z\","
+			"\"interval\":300,\"status\":\"Accepted\"}]", buf);
+}
+
+TEST(MessageJson, ShouldEncodeCallError) {
+	struct ocpp_CallError err = {
+		.errorCode = OCPP_CALLERROR_NOT_IMPLEMENTED,
+	};
+	strcpy(err.errorDescription, "not \"yet\"");
+	set(OCPP_MSG_ROLE_CALLERROR, OCPP_MSG_DATA_TRANSFER, &err, sizeof(err));
+
+	encode();
+	STRCMP_EQUAL("[4,\"19223201\",\"NotImplemented\",\"not \\\"yet\\\"\","
+			"{}]", buf);
+}
+
+TEST(MessageJson, ShouldEncodeCallErrorAsGeneric_WhenNoPayload) {
+	set(OCPP_MSG_ROLE_CALLERROR, OCPP_MSG_HEARTBEAT, NULL, 0);
+	encode();
+	STRCMP_EQUAL("[4,\"19223201\",\"GenericError\",\"\",{}]", buf);
+}
+
+TEST(MessageJson, ShouldEncodeCallError_WhenTypeUnknown) {
+	struct ocpp_CallError err = {
+		.errorCode = OCPP_CALLERROR_NOT_IMPLEMENTED,
+	};
+	set(OCPP_MSG_ROLE_CALLERROR, OCPP_MSG_MAX, &err, sizeof(err));
+	encode();
+	STRCMP_EQUAL("[4,\"19223201\",\"NotImplemented\",\"\",{}]", buf);
+}
+
+TEST(MessageJson, ShouldEncodeEmptyPayload) {
+	set(OCPP_MSG_ROLE_CALL, OCPP_MSG_HEARTBEAT, NULL, 0);
+	encode();
+	STRCMP_EQUAL("[2,\"19223201\",\"Heartbeat\",{}]", buf);
+}
+
+TEST(MessageJson, ShouldEscapeStrings) {
+	struct ocpp_Authorize auth = { 0, };
+	strcpy(auth.idTag, "a\\b\n\x01");
+	set(OCPP_MSG_ROLE_CALL, OCPP_MSG_AUTHORIZE, &auth, sizeof(auth));
+	encode();
+	STRCMP_EQUAL("[2,\"19223201\",\"Authorize\","
+			"{\"idTag\":\"a\\\\b\\u000a\\u0001\"}]", buf);
+}
+
+TEST(MessageJson, ShouldEncodeSampledValuesBoundedByPayloadSize) {
+	union {
+		struct ocpp_MeterValues mv;
+		uint8_t raw[sizeof(struct ocpp_MeterValues) +
+			2 * sizeof(struct ocpp_SampledValue)];
+	} u;
+	memset(&u, 0, sizeof(u));
+	u.mv.connectorId = 1;
+	u.mv.transactionId = 42;
+	u.mv.meterValue.timestamp = 86400;
+	strcpy(u.mv.meterValue.sampledValue[0].value, "1234");
+	u.mv.meterValue.sampledValue[0].measurand =
+		OCPP_MEASURAND_ENERGY_ACTIVE_IMPORT_REGISTER;
+	u.mv.meterValue.sampledValue[0].unit = OCPP_UNIT_WH;
+	strcpy(u.mv.meterValue.sampledValue[1].value, "230.1");
+	u.mv.meterValue.sampledValue[1].context = OCPP_READ_CTX_SAMPLE_PERIODIC;
+	u.mv.meterValue.sampledValue[1].phase = OCPP_PHASE_L1_N;
+	set(OCPP_MSG_ROLE_CALL, OCPP_MSG_METER_VALUES, &u, sizeof(u));
+
+	encode();
+	STRCMP_EQUAL("[2,\"19223201\",\"MeterValues\",{\"connectorId\":1,"
+			"\"transactionId\":42,\"meterValue\":[{"
+			"\"timestamp\":\"1970-01-02T00:00:00Z\",\"sampledValue\":["
+			"{\"value\":\"1234\","
+			"\"measurand\":\"Energy.Active.Import.Register\","
+			"\"unit\":\"Wh\"},"
+			"{\"value\":\"230.1\",\"context\":\"Sample.Periodic\","
+			"\"phase\":\"L1-N\"}]}]}]", buf);
+}
+
+TEST(MessageJson, ShouldEncodeChargingProfile) {
+	union {
+		struct ocpp_SetChargingProfile req;
+		uint8_t raw[sizeof(struct ocpp_SetChargingProfile) +
+			2 * sizeof(struct ocpp_ChargingSchedulePeriod)];
+	} u;
+	memset(&u, 0, sizeof(u));
+	struct ocpp_ChargingProfile *p = &u.req.csChargingProfiles;
+	u.req.connectorId = 1;
+	p->chargingProfileId = 7;
+	p->stackLevel = 2;
+	p->chargingProfilePurpose = OCPP_CHARGING_PROFILE_TX_DEFAULT;
+	p->chargingProfileKind = OCPP_CHARGING_PROFILE_KIND_RECURRING;
+	p->recurrencyKind = OCPP_CHARGING_PROFILE_RECURRENCY_DAILY;
+	p->chargingSchedule.chargingRateUnit = OCPP_CHARGING_UNIT_AMPERE;
+	p->chargingSchedule.nr_chargingSchedulePeriod = 3; /* more than held */
+	p->chargingSchedule.chargingSchedulePeriod[0].limit_tenth = 320;
+	p->chargingSchedule.chargingSchedulePeriod[1].startPeriod = 3600;
+	p->chargingSchedule.chargingSchedulePeriod[1].limit_tenth = 65;
+	p->chargingSchedule.chargingSchedulePeriod[1].numberPhases = 3;
+	set(OCPP_MSG_ROLE_CALL, OCPP_MSG_SET_CHARGING_PROFILE, &u, sizeof(u));
+
+	encode();
+	STRCMP_EQUAL("[2,\"19223201\",\"SetChargingProfile\",{\"connectorId\":1,"
+			"\"csChargingProfiles\":{\"chargingProfileId\":7,"
+			"\"stackLevel\":2,"
+			"\"chargingProfilePurpose\":\"TxDefaultProfile\","
+			"\"chargingProfileKind\":\"Recurring\","
+			"\"recurrencyKind\":\"Daily\",\"chargingSchedule\":{"
+			"\"chargingRateUnit\":\"A\",\"chargingSchedulePeriod\":["
+			"{\"startPeriod\":0,\"limit\":32.0},"
+			"{\"startPeriod\":3600,\"limit\":6.5,\"numberPhases\":3}"
+			"]}}}]", buf);
+}
+
+TEST(MessageJson, ShouldLeaveOutMembersDependingOnAnother) {
+	struct ocpp_GetCompositeSchedule_conf conf = {
+		.status = OCPP_PROFILE_STATUS_REJECTED,
+		.connectorId = 1,
+	};
+	set(OCPP_MSG_ROLE_CALLRESULT, OCPP_MSG_GET_COMPOSITE_SCHEDULE,
+			&conf, sizeof(conf));
+
+	encode();
+	STRCMP_EQUAL("[3,\"19223201\",{\"status\":\"Rejected\"}]", buf);
+}
+
+TEST(MessageJson, ShouldEncodeZero_WhenFlaggedGiven) {
+	struct ocpp_TriggerMessage req = {
+		.requestedMessage = OCPP_TRIGGER_STATUS_NOTIFICATION,
+	};
+	set(OCPP_MSG_ROLE_CALL, OCPP_MSG_TRIGGER_MESSAGE, &req, sizeof(req));
+
+	encode();
+	STRCMP_EQUAL("[2,\"19223201\",\"TriggerMessage\","
+			"{\"requestedMessage\":\"StatusNotification\"}]", buf);
+
+	req.has_connectorId = true;
+	encode();
+	STRCMP_EQUAL("[2,\"19223201\",\"TriggerMessage\","
+			"{\"requestedMessage\":\"StatusNotification\","
+			"\"connectorId\":0}]", buf);
+}
+
+TEST(MessageJson, ShouldEncodeTrailingString) {
+	union {
+		struct ocpp_DataTransfer req;
+		uint8_t raw[sizeof(struct ocpp_DataTransfer) + 8];
+	} u;
+	memset(&u, 0, sizeof(u));
+	strcpy(u.req.vendorId, "com.example");
+	memcpy(u.req.data, "12345678", 8); /* not terminated */
+	set(OCPP_MSG_ROLE_CALL, OCPP_MSG_DATA_TRANSFER, &u, sizeof(u));
+
+	encode();
+	STRCMP_EQUAL("[2,\"19223201\",\"DataTransfer\","
+			"{\"vendorId\":\"com.example\",\"data\":\"12345678\"}]",
+			buf);
+}
+
+TEST(MessageJson, ShouldEncodeStopTransactionWithoutTransactionData) {
+	struct ocpp_StopTransaction stop = {
+		.meterStop = 5000000000ull,
+		.timestamp = 951782400, /* leap day of 2000 */
+		.transactionId = -3,
+		.reason = OCPP_STOP_REASON_EV_DISCONNECTED,
+	};
+	set(OCPP_MSG_ROLE_CALL, OCPP_MSG_STOP_TRANSACTION, &stop, sizeof(stop));
+
+	encode();
+	STRCMP_EQUAL("[2,\"19223201\",\"StopTransaction\","
+			"{\"meterStop\":5000000000,"
+			"\"timestamp\":\"2000-02-29T00:00:00Z\","
+			"\"transactionId\":-3,\"reason\":\"EVDisconnected\"}]", buf);
+}
+
+TEST(MessageJson, ShouldEncodeEveryMessageType) {
+	static uint8_t zero[4096];
+	char firmware[] = "https://example.com/fw.bin";
+	struct ocpp_SignedUpdateFirmware *fw =
+		(struct ocpp_SignedUpdateFirmware *)zero;
+
+	for (int type = 0; type < OCPP_MSG_MAX; type++) {
+		for (int role = OCPP_MSG_ROLE_CALL;
+				role <= OCPP_MSG_ROLE_CALLERROR; role++) {
+			fw->firmware.location = firmware;
+			set((ocpp_message_role_t)role, (ocpp_message_t)type,
+					zero, sizeof(zero));
+			int len = encode();
+			CHECK(len > 0);
+			LONGS_EQUAL(len, strlen(buf));
+			LONGS_EQUAL('[', buf[0]);
+			LONGS_EQUAL(']', buf[len - 1]);
+			memset(zero, 0, sizeof(zero));
+		}
+	}
+}
+
+TEST(MessageJson, ShouldReturnEINVAL_WhenPayloadSmallerThanStruct) {
+	struct ocpp_Authorize auth = { 0, };
+	set(OCPP_MSG_ROLE_CALL, OCPP_MSG_AUTHORIZE, &auth, sizeof(auth) - 1);
+	LONGS_EQUAL(-EINVAL, encode());
+	set(OCPP_MSG_ROLE_CALL, OCPP_MSG_AUTHORIZE, NULL, sizeof(auth));
+	LONGS_EQUAL(-EINVAL, encode());
+}
+
+TEST(MessageJson, ShouldReturnEINVAL_WhenRoleOrTypeInvalid) {
+	set(OCPP_MSG_ROLE_ALLOC, OCPP_MSG_HEARTBEAT, NULL, 0);
+	LONGS_EQUAL(-EINVAL, encode());
+	set(OCPP_MSG_ROLE_CALL, OCPP_MSG_MAX, NULL, 0);
+	LONGS_EQUAL(-EINVAL, encode());
+}
+
+TEST(MessageJson, ShouldReturnENOBUFS_WhenBufferTooSmall) {
+	set(OCPP_MSG_ROLE_CALL, OCPP_MSG_HEARTBEAT, NULL, 0);
+	const int len = encode();
+	LONGS_EQUAL(-ENOBUFS, ocpp_encode_message_json(&msg, buf, (size_t)len));
+	LONGS_EQUAL(len, ocpp_encode_message_json(&msg, buf, (size_t)len + 1));
+}
+
+TEST(MessageJson, stream_ShouldWriteTheSameFrameInChunks) {
+	struct ocpp_StatusNotification status = {
+		.connectorId = 1,
+		.errorCode = OCPP_ERROR_NONE,
+		.status = OCPP_STATUS_SUSPENDED_EVSE,
+		.timestamp = 1700000000,
+	};
+	strcpy(status.vendorId, "a vendor id long enough to span a few chunks "
+			"of the stream writer");
+	set(OCPP_MSG_ROLE_CALL, OCPP_MSG_STATUS_NOTIFICATION,
+			&status, sizeof(status));
+	std::string s;
+	const int len = encode();
+	mock().expectNCalls((len + OCPP_MESSAGE_JSON_CHUNK_SIZE - 1) /
+			OCPP_MESSAGE_JSON_CHUNK_SIZE, "collect");
+
+	LONGS_EQUAL(len, ocpp_stream_message_json(&msg, collect, &s));
+	STRCMP_EQUAL(buf, s.c_str());
+}
+
+TEST(MessageJson, stream_ShouldStop_WhenWriterFails) {
+	struct ocpp_ChangeConfiguration req = { 0, };
+	memset(req.value, 'x', sizeof(req.value) - 1);
+	set(OCPP_MSG_ROLE_CALL, OCPP_MSG_CHANGE_CONFIGURATION, &req, sizeof(req));
+	std::string s;
+	mock().expectOneCall("collect").andReturnValue(-EIO);
+
+	LONGS_EQUAL(-EIO, ocpp_stream_message_json(&msg, collect, &s));
+}
+
+TEST(MessageJson, jsonv_ShouldReferToLongStringsInPlace) {
+	union {
+		struct ocpp_DataTransfer req;
+		uint8_t raw[sizeof(struct ocpp_DataTransfer) + 512];
+	} u;
+	memset(&u, 0, sizeof(u));
+	strcpy(u.req.vendorId, "com.example");
+	memset(u.req.data, 'd', 512);
+	set(OCPP_MSG_ROLE_CALL, OCPP_MSG_DATA_TRANSFER, &u, sizeof(u));
+	struct ocpp_iovec iov[4];
+	char scratch[128];
+	size_t len;
+
+	LONGS_EQUAL(3, ocpp_encode_message_jsonv(&msg, iov, 4,
+			scratch, sizeof(scratch), &len));
+	POINTERS_EQUAL(u.req.data, iov[1].base);
+	LONGS_EQUAL(512, iov[1].len);
+
+	std::string s;
+	for (int i = 0; i < 3; i++) {
+		s.append((const char *)iov[i].base, iov[i].len);
+	}
+	LONGS_EQUAL(encode(), len);
+	STRCMP_EQUAL(buf, s.c_str());
+}
+
+TEST(MessageJson, jsonv_ShouldCopyAll_WhenSingleSegment) {
+	union {
+		struct ocpp_DataTransfer req;
+		uint8_t raw[sizeof(struct ocpp_DataTransfer) + 512];
+	} u;
+	memset(&u, 0, sizeof(u));
+	strcpy(u.req.vendorId, "com.example");
+	memset(u.req.data, 'd', 512);
+	set(OCPP_MSG_ROLE_CALL, OCPP_MSG_DATA_TRANSFER, &u, sizeof(u));
+	struct ocpp_iovec iov[1];
+	static char scratch[1024];
+	size_t len;
+
+	LONGS_EQUAL(1, ocpp_encode_message_jsonv(&msg, iov, 1,
+			scratch, sizeof(scratch), &len));
+	POINTERS_EQUAL(scratch, iov[0].base);
+	LONGS_EQUAL(encode(), len);
+	MEMCMP_EQUAL(buf, scratch, len);
+}
+
+TEST(MessageJson, jsonv_ShouldReturnENOBUFS_WhenScratchTooSmall) {
+	struct ocpp_BootNotification req = { 0, };
+	strcpy(req.chargePointModel, "model");
+	strcpy(req.chargePointVendor, "vendor");
+	set(OCPP_MSG_ROLE_CALL, OCPP_MSG_BOOTNOTIFICATION, &req, sizeof(req));
+	struct ocpp_iovec iov[4];
+	char scratch[16];
+	size_t len;
+
+	LONGS_EQUAL(-ENOBUFS, ocpp_encode_message_jsonv(&msg, iov, 4,
+			scratch, sizeof(scratch), &len));
+	LONGS_EQUAL(-EINVAL, ocpp_encode_message_jsonv(&msg, iov, 0,
+			scratch, sizeof(scratch), &len));
+}
+
+TEST_GROUP(MessageJsonDecode) {
+	struct ocpp_message msg;
+	union {
+		char buf[2048];
+		long long align;
+	} u;
+	ocpp_callerror_t error;
+
+	void setup(void) {
+		ocpp_init(NULL, NULL);
+		error = OCPP_CALLERROR_GENERIC;
+	}
+	void teardown(void) {
+		mock().checkExpectations();
+		mock().clear();
+	}
+
+	int decode(const char *json) {
+		return ocpp_decode_message_json(json, strlen(json), &msg,
+				u.buf, sizeof(u.buf), &error);
+	}
+	void send_request(ocpp_message_t type) {
+		struct ocpp_BootNotification boot = { 0, };
+		ocpp_push_request(type, &boot, sizeof(boot), false);
+		ocpp_step();
+	}
+};
+
+TEST(MessageJsonDecode, ShouldDecodeCall) {
+	LONGS_EQUAL(0, decode("[2, \"id-1\", \"StatusNotification\", {"
+			"\"connectorId\": 2, \"errorCode\": \"GroundFailure\", "
+			"\"status\": \"Faulted\", \"info\": \"\\u00e9\\n\", "
+			"\"timestamp\": \"2024-02-29T12:34:56.789+09:00\"}]"));
+
+	const struct ocpp_StatusNotification *p =
+		(const struct ocpp_StatusNotification *)msg.payload.fmt.data;
+	STRCMP_EQUAL("id-1", msg.id);
+	LONGS_EQUAL(OCPP_MSG_ROLE_CALL, msg.role);
+	LONGS_EQUAL(OCPP_MSG_STATUS_NOTIFICATION, msg.type);
+	LONGS_EQUAL(sizeof(*p), msg.payload.size);
+	LONGS_EQUAL(2, p->connectorId);
+	LONGS_EQUAL(OCPP_ERROR_GROUND, p->errorCode);
+	LONGS_EQUAL(OCPP_STATUS_FAULTED, p->status);
+	STRCMP_EQUAL("\xc3\xa9\n", p->info);
+	LONGS_EQUAL(1709177696, p->timestamp);
+}
+
+TEST(MessageJsonDecode, ShouldFlagZeroGiven_WhenOptionalIntDecoded) {
+	LONGS_EQUAL(0, decode("[2,\"1\",\"GetDiagnostics\","
+			"{\"location\":\"ftp://a\",\"retries\":0}]"));
+	const struct ocpp_GetDiagnostics *p =
+		(const struct ocpp_GetDiagnostics *)msg.payload.fmt.data;
+	LONGS_EQUAL(0, p->retries);
+	LONGS_EQUAL(true, p->has_retries);
+
+	LONGS_EQUAL(0, decode("[2,\"1\",\"GetDiagnostics\","
+			"{\"location\":\"ftp://a\"}]"));
+	LONGS_EQUAL(false, p->has_retries);
+}
+
+TEST(MessageJsonDecode, ShouldDecodeFlexibleArraysAndDecimals) {
+	const char *json = "[2,\"a\",\"RemoteStartTransaction\",{"
+		"\"connectorId\":1,\"idTag\":\"TAG\",\"chargingProfile\":{"
+		"\"chargingProfileId\":3,\"stackLevel\":0,"
+		"\"chargingProfilePurpose\":\"TxProfile\","
+		"\"chargingProfileKind\":\"Absolute\",\"chargingSchedule\":{"
+		"\"chargingRateUnit\":\"W\",\"chargingSchedulePeriod\":["
+		"{\"startPeriod\":0,\"limit\":11000.5},"
+		"{\"startPeriod\":60,\"limit\":7,\"numberPhases\":1}]}}}]";
+	char out[sizeof(u.buf)];
+
+	LONGS_EQUAL(0, decode(json));
+
+	const struct ocpp_RemoteStartTransaction *p =
+		(const struct ocpp_RemoteStartTransaction *)msg.payload.fmt.data;
+	const struct ocpp_ChargingSchedule *schedule =
+		&p->chargingProfile.chargingSchedule;
+	LONGS_EQUAL(2, schedule->nr_chargingSchedulePeriod);
+	LONGS_EQUAL(110005, schedule->chargingSchedulePeriod[0].limit_tenth);
+	LONGS_EQUAL(60, schedule->chargingSchedulePeriod[1].startPeriod);
+	LONGS_EQUAL(70, schedule->chargingSchedulePeriod[1].limit_tenth);
+	LONGS_EQUAL(1, schedule->chargingSchedulePeriod[1].numberPhases);
+
+	LONGS_EQUAL(strlen(json) + 2/* .0 */,
+			ocpp_encode_message_json(&msg, out, sizeof(out)));
+}
+
+TEST(MessageJsonDecode, ShouldRoundTripSampledValues) {
+	const char *json = "[2,\"m\",\"MeterValues\",{\"connectorId\":1,"
+		"\"meterValue\":[{\"timestamp\":\"2024-01-01T00:00:00Z\","
+		"\"sampledValue\":[{\"value\":\"1\",\"measurand\":\"Voltage\","
+		"\"unit\":\"V\"},{\"value\":\"2\",\"context\":\"Trigger\"},"
+		"{\"value\":\"3\",\"format\":\"SignedData\","
+		"\"location\":\"Outlet\"}]}]}]";
+	char out[sizeof(u.buf)];
+
+	LONGS_EQUAL(0, decode(json));
+	LONGS_EQUAL(strlen(json), ocpp_encode_message_json(&msg,
+				out, sizeof(out)));
+	STRCMP_EQUAL(json, out);
+}
+
+TEST(MessageJsonDecode, ShouldStoreTrailingStringAfterStruct) {
+	char json[1024];
+	char data[600];
+	memset(data, 'd', sizeof(data) - 1);
+	data[sizeof(data) - 1] = '\0';
+	data[100] = '"'; /* escaped below */
+	snprintf(json, sizeof(json), "[2,\"x\",\"DataTransfer\",{\"vendorId\":"
+			"\"v\",\"data\":\"%.100s\\\"%s\"}]", data, &data[101]);
+
+	LONGS_EQUAL(0, decode(json));
+
+	const struct ocpp_DataTransfer *p =
+		(const struct ocpp_DataTransfer *)msg.payload.fmt.data;
+	STRCMP_EQUAL(data, p->data);
+	LONGS_EQUAL(offsetof(struct ocpp_DataTransfer, data) + sizeof(data),
+			msg.payload.size);
+	LONGS_EQUAL(-ENOBUFS, ocpp_decode_message_json(json, strlen(json),
+			&msg, u.buf, sizeof(struct ocpp_DataTransfer) + 100,
+			&error));
+}
+
+TEST(MessageJsonDecode, ShouldPointStringsIntoBuffer) {
+	LONGS_EQUAL(0, decode("[2,\"f\",\"SignedUpdateFirmware\",{"
+			"\"requestId\":9,\"firmware\":{\"location\":\"loc\","
+			"\"retrieveDateTime\":\"2024-01-01T00:00:00Z\","
+			"\"signingCertificate\":\"cert\","
+			"\"signature\":\"sig\"}}]"));
+
+	const struct ocpp_SignedUpdateFirmware *p =
+		(const struct ocpp_SignedUpdateFirmware *)msg.payload.fmt.data;
+	STRCMP_EQUAL("loc", p->firmware.location);
+	STRCMP_EQUAL("cert", p->firmware.signingCertificate);
+	STRCMP_EQUAL("sig", p->firmware.signature);
+	LONGS_EQUAL(sizeof(*p) + 4 + 5 + 4, msg.payload.size);
+}
+
+TEST(MessageJsonDecode, ShouldKeepFirstElementAndSkipUnknownMembers) {
+	LONGS_EQUAL(0, decode("[2,\"g\",\"GetConfiguration\",{\"vendor\":"
+			"{\"x\":[1,2.5e3,true,null,\"s\"]},"
+			"\"key\":[\"HeartbeatInterval\",\"Other\"]}]"));
+	STRCMP_EQUAL("HeartbeatInterval", ((const struct ocpp_GetConfiguration *)
+				msg.payload.fmt.data)->key);
+}
+
+TEST(MessageJsonDecode, ShouldDecodeCallResultOfPendingRequest) {
+	char json[256];
+	send_request(OCPP_MSG_BOOTNOTIFICATION);
+	snprintf(json, sizeof(json), "[3,\"%s\",{\"status\":\"Accepted\","
+			"\"currentTime\":\"2024-01-01T00:00:00Z\","
+			"\"interval\":300}]", sent_id);
+
+	LONGS_EQUAL(0, decode(json));
+	LONGS_EQUAL(OCPP_MSG_ROLE_CALLRESULT, msg.role);
+	LONGS_EQUAL(OCPP_MSG_BOOTNOTIFICATION, msg.type);
+
+	const struct ocpp_BootNotification_conf *p =
+		(const struct ocpp_BootNotification_conf *)msg.payload.fmt.data;
+	LONGS_EQUAL(1704067200, p->currentTime);
+	LONGS_EQUAL(300, p->interval);
+}
+
+TEST(MessageJsonDecode, ShouldDecodeCallError) {
+	char json[256];
+	send_request(OCPP_MSG_DATA_TRANSFER);
+	snprintf(json, sizeof(json), "[4,\"%s\",\"NotSupported\",\"nope\","
+			"{\"a\":1}]", sent_id);
+
+	LONGS_EQUAL(0, decode(json));
+	const struct ocpp_CallError *p =
+		(const struct ocpp_CallError *)msg.payload.fmt.data;
+	LONGS_EQUAL(OCPP_MSG_DATA_TRANSFER, msg.type);
+	LONGS_EQUAL(OCPP_CALLERROR_NOT_SUPPORTED, p->errorCode);
+	STRCMP_EQUAL("nope", p->errorDescription);
+}
+
+TEST(MessageJsonDecode, ShouldReturnENOENT_WhenNoRequestPending) {
+	LONGS_EQUAL(-ENOENT, decode("[3,\"unknown\",{}]"));
+}
+
+TEST(MessageJsonDecode, ShouldReturnNotImplemented_WhenActionUnknown) {
+	LONGS_EQUAL(-EBADMSG, decode("[2,\"id\",\"Foo\",{}]"));
+	LONGS_EQUAL(OCPP_CALLERROR_NOT_IMPLEMENTED, error);
+	STRCMP_EQUAL("id", msg.id);
+}
+
+TEST(MessageJsonDecode, ShouldReturnOccurrenceViolation_WhenRequiredMissing) {
+	LONGS_EQUAL(-EBADMSG, decode("[2,\"id\",\"ChangeAvailability\","
+			"{\"connectorId\":1}]"));
+	LONGS_EQUAL(OCPP_CALLERROR_OCCURRENCE_CONSTRAINT_VIOLATION, error);
+	LONGS_EQUAL(OCPP_MSG_CHANGE_AVAILABILITY, msg.type);
+}
+
+TEST(MessageJsonDecode, ShouldReturnPropertyViolation_WhenValueInvalid) {
+	LONGS_EQUAL(-EBADMSG, decode("[2,\"id\",\"Authorize\",{\"idTag\":"
+			"\"123456789012345678901\"}]"));
+	LONGS_EQUAL(OCPP_CALLERROR_PROPERTY_CONSTRAINT_VIOLATION, error);
+	LONGS_EQUAL(-EBADMSG, decode("[2,\"id\",\"Reset\",{\"type\":\"Warm\"}]"));
+	LONGS_EQUAL(OCPP_CALLERROR_PROPERTY_CONSTRAINT_VIOLATION, error);
+	LONGS_EQUAL(-EBADMSG, decode("[2,\"id\",\"UnlockConnector\","
+			"{\"connectorId\":2147483648}]"));
+	LONGS_EQUAL(OCPP_CALLERROR_PROPERTY_CONSTRAINT_VIOLATION, error);
+}
+
+TEST(MessageJsonDecode, ShouldReturnTypeViolation_WhenTypeMismatch) {
+	LONGS_EQUAL(-EBADMSG, decode("[2,\"id\",\"UnlockConnector\","
+			"{\"connectorId\":\"1\"}]"));
+	LONGS_EQUAL(OCPP_CALLERROR_TYPE_CONSTRAINT_VIOLATION, error);
+	LONGS_EQUAL(-EBADMSG, decode("[2,\"id\",\"UnlockConnector\","
+			"{\"connectorId\":1.5}]"));
+	LONGS_EQUAL(OCPP_CALLERROR_TYPE_CONSTRAINT_VIOLATION, error);
+	LONGS_EQUAL(-EBADMSG, decode("[2,\"id\",\"ReserveNow\",{"
+			"\"connectorId\":1,\"expiryDate\":\"tomorrow\","
+			"\"idTag\":\"a\",\"reservationId\":1}]"));
+	LONGS_EQUAL(OCPP_CALLERROR_TYPE_CONSTRAINT_VIOLATION, error);
+}
+
+TEST(MessageJsonDecode, ShouldReturnFormationViolation_WhenMalformed) {
+	const char *frames[] = {
+		"",
+		"[2,\"id\",\"Heartbeat\",{}",
+		"[2,\"id\",\"Heartbeat\",{}] x",
+		"[5,\"id\",\"Heartbeat\",{}]",
+		"[2,\"id\",\"Heartbeat\",{,}]",
+		"[2,\"id\",\"Heartbeat\",{\"a\":01}]",
+		"[2,\"id\",\"Heartbeat\",{\"a\":\"\\x\"}]",
+		"[2,\"id\",\"Heartbeat\",{\"a\":\"\n\"}]",
+		"[2,\"id\",\"Heartbeat\",{\"a\":[[[[[[[[[]]]]]]]]]}]",
+	};
+
+	for (size_t i = 0; i < sizeof(frames) / sizeof(*frames); i++) {
+		error = OCPP_CALLERROR_GENERIC;
+		LONGS_EQUAL(-EBADMSG, decode(frames[i]));
+		LONGS_EQUAL(OCPP_CALLERROR_FORMATION_VIOLATION, error);
+	}
+}
+
+TEST(MessageJsonDecode, ShouldScanLongStringsWithEscapesAnywhere) {
+	char json[256];
+	char expected[64];
+
+	for (int i = 0; i < 50; i++) {
+		memset(expected, 'a', 50);
+		expected[i] = '\\';
+		expected[50] = '\0';
+		snprintf(json, sizeof(json), "[2,\"id\",\"ChangeConfiguration\","
+				"{\"key\":\"%.*s\\\\%s\",\"value\":\"\"}]",
+				i, expected, &expected[i + 1]);
+		LONGS_EQUAL(0, decode(json));
+		STRCMP_EQUAL(expected, ((const struct ocpp_ChangeConfiguration *)
+					msg.payload.fmt.data)->key);
+	}
+}
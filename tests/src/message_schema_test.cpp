@@ -0,0 +1,113 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+#include "ocpp/message_schema.h"
+#include <string.h>
+
+static void check_schema(const struct ocpp_schema *schema) {
+	CHECK(schema != NULL);
+	CHECK(schema->nr_fields <= 32);
+
+	for (uint8_t i = 0; i < schema->nr_fields; i++) {
+		const struct ocpp_field *f = &schema->fields[i];
+
+		LONGS_EQUAL(f->namelen + 3, strlen(f->name));
+		LONGS_EQUAL('"', f->name[0]);
+		STRCMP_EQUAL("\":", &f->name[f->namelen + 1]);
+		CHECK(f->offset + f->size <= schema->size);
+		CHECK(f->count == OCPP_FIELD_NONE ||
+				f->count + sizeof(int) <= schema->size);
+		CHECK(f->when == OCPP_FIELD_NONE ||
+				f->when + sizeof(int) <= schema->size);
+		CHECK(f->has == OCPP_FIELD_NONE ||
+				f->has + sizeof(bool) <= schema->size);
+
+		switch (f->type) {
+		case OCPP_FIELD_ENUM:
+			CHECK(f->spec != NULL);
+			CHECK(((const struct ocpp_names *)f->spec)->nr_names > 0);
+			break;
+		case OCPP_FIELD_OBJECT:
+		case OCPP_FIELD_ARRAY:
+			check_schema((const struct ocpp_schema *)f->spec);
+			break;
+		default:
+			POINTERS_EQUAL(NULL, f->spec);
+			break;
+		}
+	}
+}
+
+TEST_GROUP(MessageSchema) {
+	void setup(void) {
+	}
+	void teardown(void) {
+		mock().checkExpectations();
+		mock().clear();
+	}
+};
+
+TEST(MessageSchema, ShouldReturnNull_WhenTypeOrRoleInvalid) {
+	POINTERS_EQUAL(NULL, ocpp_get_message_schema(OCPP_MSG_MAX,
+				OCPP_MSG_ROLE_CALL));
+	POINTERS_EQUAL(NULL, ocpp_get_message_schema(OCPP_MSG_HEARTBEAT,
+				OCPP_MSG_ROLE_CALLERROR));
+	POINTERS_EQUAL(NULL, ocpp_get_message_schema(OCPP_MSG_HEARTBEAT,
+				OCPP_MSG_ROLE_ALLOC));
+}
+
+TEST(MessageSchema, ShouldDescribeEveryMessageType) {
+	for (int type = 0; type < OCPP_MSG_MAX; type++) {
+		check_schema(ocpp_get_message_schema((ocpp_message_t)type,
+				OCPP_MSG_ROLE_CALL));
+		check_schema(ocpp_get_message_schema((ocpp_message_t)type,
+				OCPP_MSG_ROLE_CALLRESULT));
+	}
+}
+
+TEST(MessageSchema, ShouldListMembersInOrderWithConstraints) {
+	const struct ocpp_schema *schema = ocpp_get_message_schema(
+			OCPP_MSG_STATUS_NOTIFICATION, OCPP_MSG_ROLE_CALL);
+	const struct ocpp_field *f = schema->fields;
+
+	LONGS_EQUAL(sizeof(struct ocpp_StatusNotification), schema->size);
+	LONGS_EQUAL(7, schema->nr_fields);
+	STRCMP_EQUAL("\"connectorId\":", f[0].name);
+	LONGS_EQUAL(OCPP_FIELD_INT, f[0].type);
+	LONGS_EQUAL(OCPP_FIELD_REQUIRED, f[0].flags);
+	LONGS_EQUAL(offsetof(struct ocpp_StatusNotification, info),
+			f[2].offset);
+	LONGS_EQUAL(sizeof(((struct ocpp_StatusNotification *)0)->info),
+			f[2].size);
+	LONGS_EQUAL(OCPP_FIELD_OPTIONAL, f[2].flags);
+	STRCMP_EQUAL("Faulted", ((const struct ocpp_names *)f[3].spec)
+			->names[OCPP_STATUS_FAULTED]);
+}
+
+TEST(MessageSchema, ShouldHaveNoFields_WhenMessageWithoutMembers) {
+	const struct ocpp_schema *schema = ocpp_get_message_schema(
+			OCPP_MSG_HEARTBEAT, OCPP_MSG_ROLE_CALL);
+	LONGS_EQUAL(0, schema->nr_fields);
+	LONGS_EQUAL(0, schema->size);
+}
+
+TEST(MessageSchema, ShouldDescribeFlexibleArrayWithCount) {
+	const struct ocpp_schema *schema = ocpp_get_message_schema(
+			OCPP_MSG_SET_CHARGING_PROFILE, OCPP_MSG_ROLE_CALL);
+	const struct ocpp_schema *profile =
+		(const struct ocpp_schema *)schema->fields[1].spec;
+	const struct ocpp_schema *sched =
+		(const struct ocpp_schema *)profile->fields[8].spec;
+	const struct ocpp_field *periods = &sched->fields[3];
+
+	LONGS_EQUAL(OCPP_FIELD_ARRAY, periods->type);
+	LONGS_EQUAL(0, periods->size);
+	LONGS_EQUAL(offsetof(struct ocpp_ChargingSchedule,
+				nr_chargingSchedulePeriod), periods->count);
+	LONGS_EQUAL(sizeof(struct ocpp_ChargingSchedulePeriod),
+			((const struct ocpp_schema *)periods->spec)->size);
+	LONGS_EQUAL(offsetof(struct ocpp_ChargingProfile, chargingProfileKind),
+			profile->fields[5].when);
+	LONGS_EQUAL(OCPP_CHARGING_PROFILE_KIND_RECURRING,
+			profile->fields[5].when_value);
+}
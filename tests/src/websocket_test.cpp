@@ -0,0 +1,489 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+#include "ocpp/websocket.h"
+#include "ocpp/core/configuration.h"
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+static time_t now;
+
+time_t time(time_t *second) {
+	return now;
+}
+
+int ocpp_send(const struct ocpp_message *msg) {
+	return 0;
+}
+int ocpp_recv(struct ocpp_message *msg) {
+	return -ENOMSG;
+}
+int ocpp_lock(void) {
+	return 0;
+}
+int ocpp_unlock(void) {
+	return 0;
+}
+int ocpp_configuration_lock(void) {
+	return 0;
+}
+int ocpp_configuration_unlock(void) {
+	return 0;
+}
+
+TEST_GROUP(WebSocket) {
+	struct ocpp_websocket client;
+	struct ocpp_websocket server;
+	int listener;
+	uint16_t port;
+	int raw;
+
+	void setup(void) {
+		struct sockaddr_in addr = { 0, };
+		socklen_t len = sizeof(addr);
+
+		now = 1700000000;
+		raw = -1;
+		ocpp_reset_configuration();
+
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		listener = socket(AF_INET, SOCK_STREAM, 0);
+		LONGS_EQUAL(0, bind(listener, (struct sockaddr *)&addr,
+				sizeof(addr)));
+		LONGS_EQUAL(0, listen(listener, 1));
+		getsockname(listener, (struct sockaddr *)&addr, &len);
+		port = ntohs(addr.sin_port);
+
+		memset(&client, 0, sizeof(client));
+		memset(&server, 0, sizeof(server));
+		client.fd = server.fd = -1;
+	}
+	void teardown(void) {
+		if (client.fd >= 0) {
+			close(client.fd);
+		}
+		if (server.fd >= 0) {
+			close(server.fd);
+		}
+		if (raw >= 0) {
+			close(raw);
+		}
+		close(listener);
+
+		ocpp_unregister_configurations();
+		mock().checkExpectations();
+		mock().clear();
+	}
+
+	void step(void) {
+		for (int i = 0; i < 100; i++) {
+			if (client.state != OCPP_WEBSOCKET_CLOSED) {
+				ocpp_websocket_step(&client);
+			}
+			if (server.state != OCPP_WEBSOCKET_CLOSED) {
+				ocpp_websocket_step(&server);
+			}
+			usleep(100);
+		}
+	}
+	void open(void) {
+		LONGS_EQUAL(0, ocpp_websocket_connect(&client,
+				"127.0.0.1", port, "/ocpp/CP001"));
+		LONGS_EQUAL(0, ocpp_websocket_accept(&server,
+				accept(listener, NULL, NULL)));
+		step();
+		LONGS_EQUAL(OCPP_WEBSOCKET_OPEN, ocpp_websocket_state(&client));
+		LONGS_EQUAL(OCPP_WEBSOCKET_OPEN, ocpp_websocket_state(&server));
+	}
+	void open_deflate(bool client_takeover, bool server_takeover) {
+		LONGS_EQUAL(0, ocpp_websocket_connect(&client,
+				"127.0.0.1", port, "/ocpp/CP001"));
+		LONGS_EQUAL(0, ocpp_websocket_enable_deflate(&client,
+				client_takeover));
+		LONGS_EQUAL(0, ocpp_websocket_accept(&server,
+				accept(listener, NULL, NULL)));
+		LONGS_EQUAL(0, ocpp_websocket_enable_deflate(&server,
+				server_takeover));
+		step();
+		LONGS_EQUAL(OCPP_WEBSOCKET_OPEN, ocpp_websocket_state(&client));
+		LONGS_EQUAL(OCPP_WEBSOCKET_OPEN, ocpp_websocket_state(&server));
+	}
+
+	/* a client of hand-made frames, with the example key of RFC 6455 */
+	void open_raw(const char *protocol, bool deflate = false) {
+		struct sockaddr_in addr = { 0, };
+		char req[512];
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		addr.sin_port = htons(port);
+		raw = socket(AF_INET, SOCK_STREAM, 0);
+		LONGS_EQUAL(0, connect(raw, (struct sockaddr *)&addr,
+				sizeof(addr)));
+		LONGS_EQUAL(0, ocpp_websocket_accept(&server,
+				accept(listener, NULL, NULL)));
+		if (deflate) {
+			LONGS_EQUAL(0, ocpp_websocket_enable_deflate(&server,
+					true));
+		}
+
+		int len = snprintf(req, sizeof(req), "GET /ocpp/CP002 HTTP/1.1\r\n"
+				"Host: 127.0.0.1\r\n"
+				"Upgrade: websocket\r\n"
+				"Connection: Upgrade\r\n"
+				"Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+				"Sec-WebSocket-Version: 13\r\n"
+				"%s\r\n", protocol);
+		LONGS_EQUAL(len, send(raw, req, (size_t)len, 0));
+		step();
+		fcntl(raw, F_SETFL, O_NONBLOCK);
+	}
+	std::string read_raw(void) {
+		char buf[8192];
+		ssize_t n = recv(raw, buf, sizeof(buf), 0);
+		return n > 0? std::string(buf, (size_t)n) : std::string();
+	}
+	void send_raw(const void *data, size_t len) {
+		LONGS_EQUAL(len, send(raw, data, len, 0));
+		step();
+	}
+	std::string peek(struct ocpp_websocket *ws) {
+		const char *data;
+		int len = ocpp_websocket_peek(ws, &data);
+		return len < 0? std::string() : std::string(data, (size_t)len);
+	}
+	void make_status_notification(struct ocpp_message *msg,
+			struct ocpp_StatusNotification *req, const char *id) {
+		memset(msg, 0, sizeof(*msg));
+		memset(req, 0, sizeof(*req));
+		req->connectorId = 1;
+		req->errorCode = OCPP_ERROR_NONE;
+		req->status = OCPP_STATUS_AVAILABLE;
+		req->timestamp = 1700000000;
+		strcpy(msg->id, id);
+		msg->role = OCPP_MSG_ROLE_CALL;
+		msg->type = OCPP_MSG_STATUS_NOTIFICATION;
+		msg->payload.fmt.request = req;
+		msg->payload.size = sizeof(*req);
+	}
+	size_t exchange(struct ocpp_websocket *from, struct ocpp_websocket *to,
+			const struct ocpp_message *msg) {
+		struct ocpp_message received;
+		uint8_t buf[512];
+		LONGS_EQUAL(0, ocpp_websocket_send(from, msg));
+		step();
+		const size_t len = to->rx.len; /* on the wire */
+		LONGS_EQUAL(0, ocpp_websocket_recv(to, &received,
+				buf, sizeof(buf), NULL));
+		STRCMP_EQUAL(msg->id, received.id);
+		LONGS_EQUAL(msg->type, received.type);
+		return len;
+	}
+};
+
+TEST(WebSocket, ShouldOpenWithOcppSubprotocol) {
+	open();
+	STRCMP_EQUAL("/ocpp/CP001", server.path);
+	LONGS_EQUAL(ocpp_websocket_fd(&client) >= 0, 1);
+	LONGS_EQUAL(0, ocpp_websocket_wants_write(&client));
+}
+
+TEST(WebSocket, ShouldAnswerHandshakeByRfcExample) {
+	open_raw("Sec-WebSocket-Protocol: ocpp2.0, ocpp1.6\r\n");
+	std::string resp = read_raw();
+	CHECK(resp.find("HTTP/1.1 101") == 0);
+	CHECK(resp.find("Sec-WebSocket-Accept: s3pPLMBiTxaQ9kYGzzhZRbK+xOo=\r\n")
+			!= std::string::npos);
+	CHECK(resp.find("Sec-WebSocket-Protocol: ocpp1.6\r\n")
+			!= std::string::npos);
+	STRCMP_EQUAL("/ocpp/CP002", server.path);
+}
+
+TEST(WebSocket, ShouldRejectClient_WhenOcppSubprotocolNotOffered) {
+	open_raw("Sec-WebSocket-Protocol: ocpp2.0.1\r\n");
+	CHECK(read_raw().find("HTTP/1.1 400") == 0);
+	LONGS_EQUAL(OCPP_WEBSOCKET_CLOSED, ocpp_websocket_state(&server));
+}
+
+TEST(WebSocket, ShouldExchangeTextBothWays) {
+	open();
+	LONGS_EQUAL(-ENOMSG, ocpp_websocket_peek(&server, NULL));
+	LONGS_EQUAL(0, ocpp_websocket_write(&client, "hello", 5));
+	LONGS_EQUAL(0, ocpp_websocket_write(&server, "world!", 6));
+	step();
+	STRCMP_EQUAL("hello", peek(&server).c_str());
+	STRCMP_EQUAL("world!", peek(&client).c_str());
+}
+
+TEST(WebSocket, ShouldKeepMessagesInOrder_WhenManyInOneRead) {
+	open();
+	LONGS_EQUAL(0, ocpp_websocket_write(&client, "first", 5));
+	LONGS_EQUAL(0, ocpp_websocket_write(&client, "second", 6));
+	step();
+	STRCMP_EQUAL("first", peek(&server).c_str());
+	ocpp_websocket_consume(&server);
+	step();
+	STRCMP_EQUAL("second", peek(&server).c_str());
+	ocpp_websocket_consume(&server);
+	LONGS_EQUAL(-ENOMSG, ocpp_websocket_peek(&server, NULL));
+	LONGS_EQUAL(0, server.rx.tail);
+}
+
+TEST(WebSocket, ShouldMaskLongPayloads) {
+	std::string data;
+	for (int i = 0; i < 3000; i++) {
+		data += (char)('a' + i % 26);
+	}
+	open();
+	LONGS_EQUAL(0, ocpp_websocket_write(&client, data.c_str(), 3000));
+	step();
+	STRCMP_EQUAL(data.c_str(), peek(&server).c_str());
+	LONGS_EQUAL(-EMSGSIZE, ocpp_websocket_write(&client, NULL,
+			OCPP_WEBSOCKET_TXBUF_SIZE));
+}
+
+TEST(WebSocket, ShouldSendAndReceiveOcppMessages) {
+	struct ocpp_BootNotification boot = { 0, };
+	struct ocpp_message msg = { 0, };
+	struct ocpp_message received;
+	uint8_t buf[512];
+
+	strcpy(boot.chargePointModel, "SingleSocketCharger");
+	strcpy(boot.chargePointVendor, "VendorX");
+	strcpy(msg.id, "19223201");
+	msg.role = OCPP_MSG_ROLE_CALL;
+	msg.type = OCPP_MSG_BOOTNOTIFICATION;
+	msg.payload.fmt.request = &boot;
+	msg.payload.size = sizeof(boot);
+
+	open();
+	LONGS_EQUAL(0, ocpp_websocket_send(&client, &msg));
+	step();
+	LONGS_EQUAL(0, ocpp_websocket_recv(&server, &received,
+			buf, sizeof(buf), NULL));
+	STRCMP_EQUAL("19223201", received.id);
+	LONGS_EQUAL(OCPP_MSG_BOOTNOTIFICATION, received.type);
+	STRCMP_EQUAL("VendorX", ((const struct ocpp_BootNotification *)
+			received.payload.fmt.data)->chargePointVendor);
+	LONGS_EQUAL(-ENOMSG, ocpp_websocket_recv(&server, &received,
+			buf, sizeof(buf), NULL));
+}
+
+TEST(WebSocket, ShouldSendLongStringsInPlace_WhenBothWays) {
+	union {
+		struct ocpp_DataTransfer req;
+		uint8_t raw[sizeof(struct ocpp_DataTransfer) + 1001];
+	} u;
+	struct ocpp_message msg = { 0, };
+	struct ocpp_message received;
+	static uint8_t buf[2048];
+
+	memset(&u, 0, sizeof(u));
+	strcpy(u.req.vendorId, "com.example"); /* off the mask phase */
+	for (int i = 0; i < 1001; i++) {
+		u.req.data[i] = (char)('a' + i % 26);
+	}
+	strcpy(msg.id, "1");
+	msg.role = OCPP_MSG_ROLE_CALL;
+	msg.type = OCPP_MSG_DATA_TRANSFER;
+	msg.payload.fmt.request = &u;
+	msg.payload.size = sizeof(u);
+
+	open();
+	LONGS_EQUAL(0, ocpp_websocket_send(&client, &msg));
+	LONGS_EQUAL(0, ocpp_websocket_send(&server, &msg));
+	step();
+
+	struct ocpp_websocket *ws[] = { &server, &client };
+	for (int i = 0; i < 2; i++) {
+		LONGS_EQUAL(0, ocpp_websocket_recv(ws[i], &received,
+				buf, sizeof(buf), NULL));
+		const struct ocpp_DataTransfer *p = (const struct ocpp_DataTransfer *)
+			received.payload.fmt.data;
+		STRCMP_EQUAL("com.example", p->vendorId);
+		MEMCMP_EQUAL(u.req.data, p->data, 1001);
+	}
+}
+
+TEST(WebSocket, ShouldReassembleFragments_WhenControlFramesInBetween) {
+	/* masked with the zero key, so the payload reads as it is */
+	const uint8_t frames[] = {
+		0x01, 0x83, 0, 0, 0, 0, '[', '2', ',',
+		0x89, 0x82, 0, 0, 0, 0, 'h', 'i',
+		0x00, 0x82, 0, 0, 0, 0, '"', 'x',
+		0x80, 0x82, 0, 0, 0, 0, '"', ']',
+	};
+	open_raw("Sec-WebSocket-Protocol: ocpp1.6\r\n");
+	read_raw();
+	send_raw(frames, sizeof(frames));
+	STRCMP_EQUAL("[2,\"x\"]", peek(&server).c_str());
+
+	const uint8_t pong[] = { 0x8a, 0x02, 'h', 'i' };
+	MEMCMP_EQUAL(pong, read_raw().data(), sizeof(pong));
+}
+
+TEST(WebSocket, ShouldFail_WhenClientFrameNotMasked) {
+	const uint8_t frame[] = { 0x81, 0x02, 'h', 'i' };
+	open_raw("Sec-WebSocket-Protocol: ocpp1.6\r\n");
+	read_raw();
+	LONGS_EQUAL(sizeof(frame), send(raw, frame, sizeof(frame), 0));
+	usleep(1000);
+	LONGS_EQUAL(-EPROTO, ocpp_websocket_step(&server));
+	const uint8_t close_frame[] = { 0x88, 0x02, 0x03, 0xea/*1002*/ };
+	MEMCMP_EQUAL(close_frame, read_raw().data(), sizeof(close_frame));
+}
+
+TEST(WebSocket, ShouldFail_WhenMessageTooBig) {
+	const uint8_t frame[] = { 0x81, 0xfe, 0xff, 0xff, 0, 0, 0, 0 };
+	open_raw("Sec-WebSocket-Protocol: ocpp1.6\r\n");
+	read_raw();
+	LONGS_EQUAL(sizeof(frame), send(raw, frame, sizeof(frame), 0));
+	usleep(1000);
+	LONGS_EQUAL(-EMSGSIZE, ocpp_websocket_step(&server));
+}
+
+TEST(WebSocket, ShouldPingEveryInterval) {
+	ocpp_conf_set_int(OCPP_CONF_WebSocketPingInterval, 10);
+	open();
+	now += 9;
+	step();
+	LONGS_EQUAL(0, client.pong_pending);
+	now += 1;
+	ocpp_websocket_step(&client);
+	LONGS_EQUAL(1, client.pong_pending);
+	step();
+	LONGS_EQUAL(0, client.pong_pending);
+	LONGS_EQUAL(OCPP_WEBSOCKET_OPEN, ocpp_websocket_state(&client));
+}
+
+TEST(WebSocket, ShouldTimeout_WhenPongMissing) {
+	ocpp_conf_set_int(OCPP_CONF_WebSocketPingInterval, 10);
+	open();
+	now += 10;
+	LONGS_EQUAL(0, ocpp_websocket_step(&client));
+	now += 10;
+	LONGS_EQUAL(-ETIMEDOUT, ocpp_websocket_step(&client));
+	LONGS_EQUAL(OCPP_WEBSOCKET_CLOSED, ocpp_websocket_state(&client));
+}
+
+TEST(WebSocket, ShouldNotPing_WhenIntervalIsZero) {
+	open();
+	now += 3600;
+	LONGS_EQUAL(0, ocpp_websocket_step(&client));
+	LONGS_EQUAL(0, client.pong_pending);
+}
+
+TEST(WebSocket, ShouldCloseGracefully) {
+	open();
+	LONGS_EQUAL(0, ocpp_websocket_close(&client, 1000));
+	LONGS_EQUAL(OCPP_WEBSOCKET_CLOSING, ocpp_websocket_state(&client));
+	LONGS_EQUAL(-ENOTCONN, ocpp_websocket_write(&client, "x", 1));
+	usleep(1000);
+	LONGS_EQUAL(-ECONNRESET, ocpp_websocket_step(&server));
+	usleep(1000);
+	LONGS_EQUAL(0, ocpp_websocket_step(&client));
+	LONGS_EQUAL(OCPP_WEBSOCKET_CLOSED, ocpp_websocket_state(&client));
+	LONGS_EQUAL(-ENOTCONN, ocpp_websocket_step(&client));
+}
+
+TEST(WebSocket, ShouldCompressBothWays_WhenDeflateNegotiated) {
+	struct ocpp_StatusNotification req;
+	struct ocpp_message msg;
+	struct ocpp_websocket_deflate_stats tx, rx;
+
+	open_deflate(true, true);
+	LONGS_EQUAL(1, ocpp_websocket_has_deflate(&client));
+	LONGS_EQUAL(1, ocpp_websocket_has_deflate(&server));
+
+	make_status_notification(&msg, &req, "1");
+	const size_t first = exchange(&client, &server, &msg);
+	make_status_notification(&msg, &req, "2");
+	const size_t second = exchange(&client, &server, &msg);
+	exchange(&server, &client, &msg);
+	CHECK(second < first); /* referring to the first in the window */
+
+	LONGS_EQUAL(0, ocpp_websocket_get_deflate_stats(&client,
+			OCPP_MSG_STATUS_NOTIFICATION, &tx, &rx));
+	LONGS_EQUAL(2, tx.messages);
+	LONGS_EQUAL(first + second, tx.compressed);
+	CHECK(tx.compressed * 2 < tx.raw);
+	LONGS_EQUAL(1, rx.messages);
+	LONGS_EQUAL(0, ocpp_websocket_get_deflate_stats(&server,
+			OCPP_MSG_STATUS_NOTIFICATION, NULL, &rx));
+	LONGS_EQUAL(2, rx.messages);
+	LONGS_EQUAL(tx.raw, rx.raw);
+	LONGS_EQUAL(tx.compressed, rx.compressed);
+}
+
+TEST(WebSocket, ShouldCompressEachAlone_WhenNoContextTakeover) {
+	struct ocpp_StatusNotification req;
+	struct ocpp_message msg;
+
+	open_deflate(false, true);
+	LONGS_EQUAL(0, server.deflate.tx.takeover);
+	LONGS_EQUAL(0, server.deflate.rx.takeover);
+
+	make_status_notification(&msg, &req, "1");
+	const size_t first = exchange(&server, &client, &msg);
+	LONGS_EQUAL(first, exchange(&server, &client, &msg));
+	LONGS_EQUAL(first, exchange(&client, &server, &msg));
+	LONGS_EQUAL(first, exchange(&client, &server, &msg));
+}
+
+TEST(WebSocket, ShouldNotCompress_WhenServerNotEnablingDeflate) {
+	struct ocpp_StatusNotification req;
+	struct ocpp_message msg;
+
+	LONGS_EQUAL(0, ocpp_websocket_connect(&client,
+			"127.0.0.1", port, "/ocpp/CP001"));
+	LONGS_EQUAL(0, ocpp_websocket_enable_deflate(&client, true));
+	LONGS_EQUAL(0, ocpp_websocket_accept(&server,
+			accept(listener, NULL, NULL)));
+	step();
+	LONGS_EQUAL(OCPP_WEBSOCKET_OPEN, ocpp_websocket_state(&client));
+	LONGS_EQUAL(0, ocpp_websocket_has_deflate(&client));
+	LONGS_EQUAL(-EALREADY, ocpp_websocket_enable_deflate(&client, true));
+
+	make_status_notification(&msg, &req, "1");
+	exchange(&client, &server, &msg);
+	exchange(&server, &client, &msg);
+}
+
+TEST(WebSocket, ShouldInflateRfcExamples_WhenDeflateAccepted) {
+	/* "Hello" compressed and then again referring to the first */
+	const uint8_t frames[] = {
+		0xc1, 0x87, 0, 0, 0, 0, 0xf2, 0x48, 0xcd, 0xc9, 0xc9, 0x07, 0x00,
+		0xc1, 0x85, 0, 0, 0, 0, 0xf2, 0x00, 0x11, 0x00, 0x00,
+	};
+	open_raw("Sec-WebSocket-Protocol: ocpp1.6\r\n"
+			"Sec-WebSocket-Extensions: x-webkit-deflate-frame, "
+			"permessage-deflate; client_max_window_bits\r\n", true);
+	std::string resp = read_raw();
+	CHECK(resp.find("Sec-WebSocket-Extensions: permessage-deflate; "
+				"server_max_window_bits=10; "
+				"client_max_window_bits=10\r\n")
+			!= std::string::npos);
+	send_raw(frames, sizeof(frames));
+	STRCMP_EQUAL("Hello", peek(&server).c_str());
+	ocpp_websocket_consume(&server);
+	step();
+	STRCMP_EQUAL("Hello", peek(&server).c_str());
+}
+
+TEST(WebSocket, ShouldDeclineDeflate_WhenClientWindowNotBounded) {
+	const uint8_t frame[] = { 0xc1, 0x81, 0, 0, 0, 0, 0x00 };
+	open_raw("Sec-WebSocket-Protocol: ocpp1.6\r\n"
+			"Sec-WebSocket-Extensions: permessage-deflate\r\n", true);
+	std::string resp = read_raw();
+	CHECK(resp.find("HTTP/1.1 101") == 0);
+	CHECK(resp.find("Sec-WebSocket-Extensions") == std::string::npos);
+	LONGS_EQUAL(sizeof(frame), send(raw, frame, sizeof(frame), 0));
+	usleep(1000);
+	LONGS_EQUAL(-EPROTO, ocpp_websocket_step(&server));
+}